@@ -0,0 +1,50 @@
+// Copyright (c) 2020 The Zcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "chainparams.h"
+#include "dbwrapper.h"
+#include "llmq/quorums_signing.h"
+#include "random.h"
+
+#include <memory>
+
+// Lookups of recovered sigs which are not in the db, which is the common case for invs, sig shares and InstantSend
+// input checks. These are answered by the keys filter without reading from the db
+static void RecoveredSigsDb_HasMissing(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+
+    CDBWrapper dbw("", 1 << 20, true);
+    llmq::CRecoveredSigsDb db(dbw);
+
+    auto llmqType = Params().GetConsensus().llmqForInstantSend;
+    for (int i = 0; i < 10000; i++) {
+        llmq::CRecoveredSig recSig;
+        recSig.llmqType = llmqType;
+        recSig.quorumHash = GetRandHash();
+        recSig.id = GetRandHash();
+        recSig.msgHash = GetRandHash();
+        recSig.sig.Set(CBLSSignature());
+        recSig.UpdateHash();
+        db.WriteRecoveredSig(recSig);
+    }
+
+    std::vector<uint256> hashes(1000);
+    for (auto& h : hashes) {
+        h = GetRandHash();
+    }
+
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        const auto& h = hashes[i++ % hashes.size()];
+        db.HasRecoveredSigForId(llmqType, h);
+        db.HasRecoveredSigForSession(h);
+        db.HasRecoveredSigForHash(h);
+        db.HasRecoveredSig(llmqType, h, h);
+    }
+}
+
+BENCHMARK(RecoveredSigsDb_HasMissing);
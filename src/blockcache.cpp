@@ -0,0 +1,89 @@
+// Copyright (c) 2020 The Zcoin Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockcache.h"
+
+#include "primitives/transaction.h"
+#include "streams.h"
+#include "version.h"
+
+CServedBlockCache servedBlockCache;
+
+static bool BlockHasWitness(const CBlock& block)
+{
+    for (const auto& tx : block.vtx) {
+        if (tx->HasWitness())
+            return true;
+    }
+    return false;
+}
+
+std::shared_ptr<const std::vector<unsigned char>> CServedBlock::GetSerialized(bool fWitness) const
+{
+    // Without witness data both forms are identical, so share a single buffer
+    if (fWitness && !BlockHasWitness(*block))
+        fWitness = false;
+
+    {
+        LOCK(cs);
+        if (serialized[fWitness])
+            return serialized[fWitness];
+    }
+
+    // Serialize outside of the lock, a concurrent request at worst does the same work twice
+    auto data = std::make_shared<std::vector<unsigned char>>();
+    int nVersion = PROTOCOL_VERSION | (fWitness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS);
+    CVectorWriter(SER_NETWORK, nVersion, *data, 0, *block);
+
+    LOCK(cs);
+    if (!serialized[fWitness])
+        serialized[fWitness] = data;
+    return serialized[fWitness];
+}
+
+CServedBlockCache::CServedBlockCache(size_t nMaxSize) :
+    cache(nMaxSize, nMaxSize)
+{
+}
+
+void CServedBlockCache::Add(const std::shared_ptr<const CBlock>& pblock)
+{
+    uint256 hash = pblock->GetHash();
+
+    LOCK(cs);
+    if (cache.exists(hash))
+        return;
+    cache.insert(hash, std::make_shared<const CServedBlock>(pblock));
+}
+
+CServedBlockPtr CServedBlockCache::Get(const uint256& hash)
+{
+    CServedBlockPtr entry;
+    {
+        LOCK(cs);
+        cache.get(hash, entry);
+    }
+
+    if (entry)
+        nHits++;
+    else
+        nMisses++;
+    return entry;
+}
+
+void CServedBlockCache::Clear()
+{
+    LOCK(cs);
+    cache.clear();
+}
+
+void CServedBlockCache::GetStats(CServedBlockCacheStats& stats) const
+{
+    {
+        LOCK(cs);
+        stats.nEntries = cache.size();
+    }
+    stats.nHits = nHits;
+    stats.nMisses = nMisses;
+}
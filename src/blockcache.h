@@ -0,0 +1,78 @@
+// Copyright (c) 2020 The Zcoin Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef ZCOIN_BLOCKCACHE_H
+#define ZCOIN_BLOCKCACHE_H
+
+#include "primitives/block.h"
+#include "saltedhasher.h"
+#include "sync.h"
+#include "uint256.h"
+#include "unordered_lru_cache.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/** Maximum number of recently connected blocks kept for serving to peers */
+static const size_t MAX_SERVED_BLOCK_CACHE_SIZE = 8;
+
+/**
+ * A recently connected block as served to peers. The serialized network form
+ * (MTP payload included) is built on first request and then shared by every
+ * peer asking for the same block.
+ */
+class CServedBlock
+{
+private:
+    mutable CCriticalSection cs;
+    // index 0: without witness data, index 1: with witness data
+    mutable std::shared_ptr<const std::vector<unsigned char>> serialized[2];
+
+public:
+    const std::shared_ptr<const CBlock> block;
+
+    explicit CServedBlock(const std::shared_ptr<const CBlock>& _block) : block(_block) {}
+
+    /** Returns the payload of a BLOCK message carrying this block */
+    std::shared_ptr<const std::vector<unsigned char>> GetSerialized(bool fWitness) const;
+};
+
+typedef std::shared_ptr<const CServedBlock> CServedBlockPtr;
+
+struct CServedBlockCacheStats
+{
+    size_t nEntries;
+    uint64_t nHits;
+    uint64_t nMisses;
+};
+
+/**
+ * Bounded cache of recently connected blocks, shared across all peers. It is
+ * filled from ConnectTip so that getdata, getblocktxn and compact block
+ * announcements for the new tip don't need to read the block from disk.
+ */
+class CServedBlockCache
+{
+private:
+    mutable CCriticalSection cs;
+    unordered_lru_cache<uint256, CServedBlockPtr, StaticSaltedHasher> cache;
+
+    std::atomic<uint64_t> nHits{0};
+    std::atomic<uint64_t> nMisses{0};
+
+public:
+    explicit CServedBlockCache(size_t nMaxSize = MAX_SERVED_BLOCK_CACHE_SIZE);
+
+    void Add(const std::shared_ptr<const CBlock>& pblock);
+    /** Returns the cached block or nullptr, updating the hit statistics */
+    CServedBlockPtr Get(const uint256& hash);
+    void Clear();
+
+    void GetStats(CServedBlockCacheStats& stats) const;
+};
+
+extern CServedBlockCache servedBlockCache;
+
+#endif // ZCOIN_BLOCKCACHE_H
@@ -139,6 +139,13 @@ public:
     std::future<bool> AsyncVerifySig(const CBLSSignature& sig, const CBLSPublicKey& pubKey, const uint256& msgHash, CancelCond cancelCond = [] { return false; });
     bool IsAsyncVerifyInProgress();
 
+    // Runs a job on the worker pool. The job must not wait for other jobs of the pool, these might never get started
+    template <typename Callable>
+    auto AsyncRun(Callable&& f) -> std::future<decltype(f(0))>
+    {
+        return workerPool.push(std::forward<Callable>(f));
+    }
+
 private:
     void PushSigVerifyBatch();
 };
@@ -0,0 +1,424 @@
+// Copyright (c) 2020 The Zcoin Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "dandelion.h"
+
+#include "chainparams.h"
+#include "consensus/validation.h"
+#include "net.h"
+#include "protocol.h"
+#include "random.h"
+#include "txmempool.h"
+#include "util.h"
+#include "utiltime.h"
+#include "validation.h"
+
+#include <algorithm>
+#include <limits>
+
+CDandelionManager dandelion;
+
+CDandelionManager::CDandelionManager() :
+    localDestination(nullptr),
+    vTimerWheel(DANDELION_TIMER_WHEEL_SLOTS),
+    nNextTick(0)
+{
+}
+
+// Randomly selects one of the destinations with the fewest routes going to it
+CNode* CDandelionManager::SelectDestination()
+{
+    AssertLockHeld(cs);
+
+    std::vector<CNode*> vCandidates;
+    size_t nMinRoutes = std::numeric_limits<size_t>::max();
+    for (CNode* pnode : vDestinations) {
+        auto it = mapDestinationRoutes.find(pnode);
+        size_t nRoutes = it == mapDestinationRoutes.end() ? 0 : it->second;
+        if (nRoutes < nMinRoutes) {
+            nMinRoutes = nRoutes;
+            vCandidates.clear();
+        }
+        if (nRoutes == nMinRoutes)
+            vCandidates.push_back(pnode);
+    }
+    if (vCandidates.empty())
+        return nullptr;
+
+    FastRandomContext rng;
+    return vCandidates[rng.randrange(vCandidates.size())];
+}
+
+void CDandelionManager::AddRoute(const CNode* pfrom, CNode* pto)
+{
+    AssertLockHeld(cs);
+    if (mapRoutes.emplace(pfrom, pto).second)
+        mapDestinationRoutes[pto]++;
+}
+
+void CDandelionManager::RemoveRoute(std::unordered_map<const CNode*, CNode*>::iterator it)
+{
+    AssertLockHeld(cs);
+    auto itCount = mapDestinationRoutes.find(it->second);
+    if (itCount != mapDestinationRoutes.end() && --itCount->second == 0)
+        mapDestinationRoutes.erase(itCount);
+    mapRoutes.erase(it);
+}
+
+std::vector<std::pair<uint256, int64_t>>& CDandelionManager::GetWheelSlot(int64_t nTick)
+{
+    return vTimerWheel[nTick % DANDELION_TIMER_WHEEL_SLOTS];
+}
+
+void CDandelionManager::AddInbound(CNode* pnode)
+{
+    LOCK(cs);
+    setInbound.insert(pnode);
+    CNode* pto = SelectDestination();
+    if (pto != nullptr)
+        AddRoute(pnode, pto);
+    LogPrint("dandelion", "Added inbound Dandelion connection:\n%s", ToStringInternal());
+}
+
+void CDandelionManager::AddOutbound(CNode* pnode)
+{
+    LOCK(cs);
+    vOutbound.push_back(pnode);
+    if (vDestinations.size() < Params().GetConsensus().nDandelionMaxDestinations)
+        vDestinations.push_back(pnode);
+}
+
+void CDandelionManager::RemoveNode(const CNode* pnode)
+{
+    LOCK(cs);
+
+    setInbound.erase(pnode);
+    vOutbound.erase(std::remove(vOutbound.begin(), vOutbound.end(), pnode), vOutbound.end());
+
+    auto itDest = std::find(vDestinations.begin(), vDestinations.end(), pnode);
+    if (itDest != vDestinations.end()) {
+        vDestinations.erase(itDest);
+        // Replace it by an outbound peer which isn't a destination yet
+        std::vector<CNode*> vCandidates;
+        for (CNode* pcandidate : vOutbound) {
+            if (std::find(vDestinations.begin(), vDestinations.end(), pcandidate) == vDestinations.end())
+                vCandidates.push_back(pcandidate);
+        }
+        if (!vCandidates.empty()) {
+            FastRandomContext rng;
+            vDestinations.push_back(vCandidates[rng.randrange(vCandidates.size())]);
+        }
+    }
+
+    auto itRoute = mapRoutes.find(pnode);
+    if (itRoute != mapRoutes.end())
+        RemoveRoute(itRoute);
+
+    if (mapDestinationRoutes.count(pnode)) {
+        // Move the routes which went to pnode to the remaining destinations
+        std::vector<const CNode*> vOrphaned;
+        for (const auto& route : mapRoutes) {
+            if (route.second == pnode)
+                vOrphaned.push_back(route.first);
+        }
+        for (const CNode* pfrom : vOrphaned) {
+            RemoveRoute(mapRoutes.find(pfrom));
+            CNode* pto = SelectDestination();
+            if (pto != nullptr)
+                AddRoute(pfrom, pto);
+        }
+    }
+
+    if (localDestination == pnode)
+        localDestination = SelectDestination();
+
+    LogPrint("dandelion", "After closing Dandelion connections:\n%s", ToStringInternal());
+}
+
+void CDandelionManager::Shuffle()
+{
+    LOCK(cs);
+    LogPrint("dandelion", "Before Dandelion shuffle:\n%s", ToStringInternal());
+
+    mapRoutes.clear();
+    mapDestinationRoutes.clear();
+    localDestination = nullptr;
+
+    // Sample new destinations from the outbound peers
+    std::vector<CNode*> vCandidates = vOutbound;
+    vDestinations.clear();
+    FastRandomContext rng;
+    size_t nMaxDestinations = Params().GetConsensus().nDandelionMaxDestinations;
+    while (vDestinations.size() < nMaxDestinations && !vCandidates.empty()) {
+        size_t i = rng.randrange(vCandidates.size());
+        vDestinations.push_back(vCandidates[i]);
+        vCandidates.erase(vCandidates.begin() + i);
+    }
+
+    // Generate new routes
+    for (const CNode* pfrom : setInbound) {
+        CNode* pto = SelectDestination();
+        if (pto != nullptr)
+            AddRoute(pfrom, pto);
+    }
+    localDestination = SelectDestination();
+
+    LogPrint("dandelion", "After Dandelion shuffle:\n%s", ToStringInternal());
+}
+
+bool CDandelionManager::IsInbound(const CNode* pnode) const
+{
+    LOCK(cs);
+    return setInbound.count(pnode) != 0;
+}
+
+bool CDandelionManager::PushToDestination(CNode* pfrom, const CInv& inv)
+{
+    // Destinations are only deleted after RemoveNode, so pushing while holding cs is safe
+    LOCK(cs);
+    CNode* pto;
+    auto it = mapRoutes.find(pfrom);
+    if (it != mapRoutes.end()) {
+        pto = it->second;
+    } else {
+        pto = SelectDestination();
+        if (pto == nullptr)
+            return false;
+        AddRoute(pfrom, pto);
+    }
+    pto->PushInventory(inv);
+    nStemRelayed++;
+    return true;
+}
+
+bool CDandelionManager::PushToLocalDestination(const CInv& inv)
+{
+    LOCK(cs);
+    if (localDestination == nullptr) {
+        localDestination = SelectDestination();
+        LogPrint("dandelion", "Set local Dandelion destination:\n%s", ToStringInternal());
+        if (localDestination == nullptr)
+            return false;
+    }
+    localDestination->PushInventory(inv);
+    nStemRelayed++;
+    return true;
+}
+
+bool CDandelionManager::AddEmbargo(const CTransactionRef& tx, int64_t nEmbargo)
+{
+    LOCK(cs);
+    if (!mapEmbargoes.emplace(tx->GetHash(), CEmbargo{nEmbargo, tx}).second)
+        return false;
+
+    int64_t nTick = nEmbargo / DANDELION_TIMER_WHEEL_RESOLUTION;
+    if (nTick < nNextTick)
+        nTick = nNextTick;
+    GetWheelSlot(nTick).emplace_back(tx->GetHash(), nEmbargo);
+    return true;
+}
+
+bool CDandelionManager::IsEmbargoed(const uint256& hash) const
+{
+    LOCK(cs);
+    return mapEmbargoes.count(hash) != 0;
+}
+
+bool CDandelionManager::RemoveEmbargo(const uint256& hash)
+{
+    LOCK(cs);
+    // The timer wheel entry is dropped once its slot is due
+    if (mapEmbargoes.erase(hash) == 0)
+        return false;
+    nEmbargoCleared++;
+    return true;
+}
+
+CTransactionRef CDandelionManager::GetEmbargoedTx(const uint256& hash) const
+{
+    LOCK(cs);
+    auto it = mapEmbargoes.find(hash);
+    return it == mapEmbargoes.end() ? nullptr : it->second.tx;
+}
+
+std::vector<CTransactionRef> CDandelionManager::PopExpiredEmbargoes(int64_t nNow)
+{
+    std::vector<CTransactionRef> vExpired;
+    int64_t nNowTick = nNow / DANDELION_TIMER_WHEEL_RESOLUTION;
+
+    LOCK(cs);
+    if (nNextTick == 0)
+        nNextTick = nNowTick;
+    if (mapEmbargoes.empty()) {
+        // Nothing can be due, all wheel entries are stale
+        for (auto& slot : vTimerWheel)
+            slot.clear();
+        nNextTick = nNowTick;
+        return vExpired;
+    }
+
+    // Visit every slot at most once, even after a long pause
+    int64_t nFirstTick = std::max(nNextTick, nNowTick - (int64_t)DANDELION_TIMER_WHEEL_SLOTS + 1);
+    for (int64_t nTick = nFirstTick; nTick <= nNowTick; nTick++) {
+        auto& slot = GetWheelSlot(nTick);
+        for (size_t i = 0; i < slot.size();) {
+            auto it = mapEmbargoes.find(slot[i].first);
+            bool fStale = it == mapEmbargoes.end() || it->second.nEmbargo != slot[i].second;
+            bool fExpired = !fStale && slot[i].second < nNow;
+            if (fExpired) {
+                vExpired.push_back(it->second.tx);
+                mapEmbargoes.erase(it);
+            }
+            if (fStale || fExpired) {
+                slot[i] = slot.back();
+                slot.pop_back();
+            } else {
+                // Due later in this tick or in a later round of the wheel
+                i++;
+            }
+        }
+    }
+    // The current tick is visited again, its embargoes may not have ended yet
+    nNextTick = nNowTick;
+    return vExpired;
+}
+
+void CDandelionManager::RelayTransaction(const CTransactionRef& tx, CNode* pfrom, CConnman& connman)
+{
+    FastRandomContext rng;
+    if (rng.randrange(100) < Params().GetConsensus().nDandelionFluff) {
+        // Start fluffing the transaction
+        CValidationState state;
+        bool fMissingInputs = false;
+        std::list<CTransactionRef> lRemovedTxn;
+        AcceptToMemoryPool(
+            mempool,
+            state,
+            tx,
+            true, // fLimitFree
+            &fMissingInputs,
+            &lRemovedTxn,
+            false, /* fOverrideMempoolLimit */
+            0, /* nAbsurdFee */
+            false /*isCheckWalletTransaction*/
+            );
+        if (mempool.exists(tx->GetHash())) {
+            LOCK(cs);
+            mapEmbargoes.erase(tx->GetHash());
+        }
+        nFluffed++;
+        connman.RelayTransaction(*tx);
+    } else {
+        // Relay the transaction to a single dandelion destination
+        PushToDestination(pfrom, CInv(MSG_DANDELION_TX, tx->GetHash()));
+    }
+}
+
+void CDandelionManager::CheckEmbargoes(CConnman& connman)
+{
+    AssertLockHeld(cs_main);
+
+    for (const CTransactionRef& tx : PopExpiredEmbargoes(GetTimeMicros())) {
+        // We got the transaction back in the fluff phase
+        if (mempool.exists(tx->GetHash())) {
+            nEmbargoCleared++;
+            continue;
+        }
+
+        // The transaction was mined, conflicted or evicted meanwhile
+        if (!txpools.getStemTxPool().exists(tx->GetHash())) {
+            nEmbargoDropped++;
+            continue;
+        }
+
+        // The embargo is over and we did not see the transaction in the fluff phase,
+        // so start fluffing it ourselves
+        CValidationState state;
+        bool fMissingInputs = false;
+        std::list<CTransactionRef> lRemovedTxn;
+        bool fAccepted = AcceptToMemoryPool(
+            mempool,
+            state,
+            tx,
+            true, // fLimitFree
+            &fMissingInputs,
+            &lRemovedTxn,
+            false, /* fOverrideMempoolLimit */
+            0, /* nAbsurdFee */
+            false /*isCheckWalletTransaction*/
+            );
+        if (!fAccepted) {
+            LogPrint("net", "%s: embargoed tx %s was not accepted to the mempool: %s\n", __func__,
+                     tx->GetHash().ToString(), FormatStateMessage(state));
+            nEmbargoDropped++;
+            continue;
+        }
+        LogPrintf("AcceptToMemoryPool: accepted %s (poolsz %u txn, %u kB)\n",
+                  tx->GetHash().ToString(),
+                  mempool.size(),
+                  mempool.DynamicMemoryUsage() / 1000);
+        nEmbargoExpired++;
+        connman.RelayTransaction(*tx);
+    }
+}
+
+void CDandelionManager::GetStats(CDandelionStats& stats) const
+{
+    {
+        LOCK(cs);
+        stats.nInbound = setInbound.size();
+        stats.nOutbound = vOutbound.size();
+        stats.nDestinations = vDestinations.size();
+        stats.nRoutes = mapRoutes.size();
+        stats.nEmbargoes = mapEmbargoes.size();
+    }
+    stats.nStemRelayed = nStemRelayed;
+    stats.nFluffed = nFluffed;
+    stats.nEmbargoExpired = nEmbargoExpired;
+    stats.nEmbargoCleared = nEmbargoCleared;
+    stats.nEmbargoDropped = nEmbargoDropped;
+}
+
+std::string CDandelionManager::ToStringInternal() const
+{
+    AssertLockHeld(cs);
+
+    std::string str = "  inbound: ";
+    for (const CNode* pnode : setInbound)
+        str += std::to_string(pnode->GetId()) + " ";
+    str += "\n  outbound: ";
+    for (const CNode* pnode : vOutbound)
+        str += std::to_string(pnode->GetId()) + " ";
+    str += "\n  destinations: ";
+    for (const CNode* pnode : vDestinations)
+        str += std::to_string(pnode->GetId()) + " ";
+    str += "\n  routes: ";
+    for (const auto& route : mapRoutes)
+        str += "(" + std::to_string(route.first->GetId()) + "," + std::to_string(route.second->GetId()) + ") ";
+    str += "\n  local destination: ";
+    str += localDestination == nullptr ? "nullptr" : std::to_string(localDestination->GetId());
+    str += "\n";
+    return str;
+}
+
+std::string CDandelionManager::ToString() const
+{
+    LOCK(cs);
+    return ToStringInternal();
+}
+
+void CDandelionManager::Clear()
+{
+    LOCK(cs);
+    setInbound.clear();
+    vOutbound.clear();
+    vDestinations.clear();
+    mapRoutes.clear();
+    mapDestinationRoutes.clear();
+    localDestination = nullptr;
+    mapEmbargoes.clear();
+    for (auto& slot : vTimerWheel)
+        slot.clear();
+    nNextTick = 0;
+}
@@ -0,0 +1,137 @@
+// Copyright (c) 2020 The Zcoin Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef ZCOIN_DANDELION_H
+#define ZCOIN_DANDELION_H
+
+#include "primitives/transaction.h"
+#include "saltedhasher.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+class CConnman;
+class CInv;
+class CNode;
+
+/** Granularity of the embargo timer wheel in microseconds */
+static const int64_t DANDELION_TIMER_WHEEL_RESOLUTION = 1000000;
+/** Number of slots in the embargo timer wheel, embargoes further out wrap around */
+static const size_t DANDELION_TIMER_WHEEL_SLOTS = 64;
+
+struct CDandelionStats
+{
+    size_t nInbound;
+    size_t nOutbound;
+    size_t nDestinations;
+    size_t nRoutes;
+    size_t nEmbargoes;
+    /** Transactions passed on to a single destination */
+    uint64_t nStemRelayed;
+    /** Transactions switched to the fluff phase by the random coin flip */
+    uint64_t nFluffed;
+    /** Transactions fluffed because their embargo expired */
+    uint64_t nEmbargoExpired;
+    /** Embargoed transactions seen back in the fluff phase */
+    uint64_t nEmbargoCleared;
+    /** Expired embargoes dropped because the transaction left the stempool or was rejected */
+    uint64_t nEmbargoDropped;
+};
+
+/**
+ * Dandelion routing state: the stem routes of the inbound peers, the outbound
+ * destinations and the embargoes of transactions in the stem phase.
+ *
+ * Every inbound peer maps to one destination and the number of routes per
+ * destination is kept up to date, so route lookup and destination selection
+ * don't scan all routes. Embargoes are kept in a timer wheel, checking them
+ * only looks at the slots that became due since the last check.
+ *
+ * Embargoed transactions are kept here as well, so serving and fluffing them
+ * doesn't need to go through the indexes of the stem pool.
+ */
+class CDandelionManager
+{
+private:
+    struct CEmbargo
+    {
+        int64_t nEmbargo;
+        CTransactionRef tx;
+    };
+
+    mutable CCriticalSection cs;
+
+    std::unordered_set<const CNode*> setInbound;
+    std::vector<CNode*> vOutbound;
+    std::vector<CNode*> vDestinations;
+    // Inbound peer -> destination its transactions are stemmed to
+    std::unordered_map<const CNode*, CNode*> mapRoutes;
+    // Destination -> number of routes in mapRoutes going to it
+    std::unordered_map<const CNode*, size_t> mapDestinationRoutes;
+    // Destination of the transactions of our own wallet
+    CNode* localDestination;
+
+    std::unordered_map<uint256, CEmbargo, StaticSaltedHasher> mapEmbargoes;
+    // Slot (embargo / DANDELION_TIMER_WHEEL_RESOLUTION) % DANDELION_TIMER_WHEEL_SLOTS holds the
+    // transactions whose embargo ends in that tick. Entries may be stale when an embargo was
+    // removed or replaced, they are matched against mapEmbargoes when their slot is due.
+    std::vector<std::vector<std::pair<uint256, int64_t>>> vTimerWheel;
+    int64_t nNextTick;
+
+    std::atomic<uint64_t> nStemRelayed{0};
+    std::atomic<uint64_t> nFluffed{0};
+    std::atomic<uint64_t> nEmbargoExpired{0};
+    std::atomic<uint64_t> nEmbargoCleared{0};
+    std::atomic<uint64_t> nEmbargoDropped{0};
+
+    CNode* SelectDestination();
+    void AddRoute(const CNode* pfrom, CNode* pto);
+    void RemoveRoute(std::unordered_map<const CNode*, CNode*>::iterator it);
+    std::vector<std::pair<uint256, int64_t>>& GetWheelSlot(int64_t nTick);
+    std::string ToStringInternal() const;
+
+public:
+    CDandelionManager();
+
+    void AddInbound(CNode* pnode);
+    void AddOutbound(CNode* pnode);
+    /** Forgets about pnode, replacing it where it served as a destination */
+    void RemoveNode(const CNode* pnode);
+    /** Picks new destinations and routes */
+    void Shuffle();
+
+    bool IsInbound(const CNode* pnode) const;
+    /** Announces inv to the destination of pfrom, returns false if there is none */
+    bool PushToDestination(CNode* pfrom, const CInv& inv);
+    /** Announces inv to the destination of our own transactions, returns false if there is none */
+    bool PushToLocalDestination(const CInv& inv);
+
+    bool AddEmbargo(const CTransactionRef& tx, int64_t nEmbargo);
+    bool IsEmbargoed(const uint256& hash) const;
+    /** Lifts the embargo of a transaction which was seen in the fluff phase */
+    bool RemoveEmbargo(const uint256& hash);
+    /** Returns the embargoed transaction with the given hash or nullptr */
+    CTransactionRef GetEmbargoedTx(const uint256& hash) const;
+    /** Removes the embargoes which ended before nNow and returns their transactions */
+    std::vector<CTransactionRef> PopExpiredEmbargoes(int64_t nNow);
+
+    /** Relays a stem pool transaction received from pfrom, either stemming or fluffing it */
+    void RelayTransaction(const CTransactionRef& tx, CNode* pfrom, CConnman& connman);
+    /** Fluffs the transactions whose embargo expired, cs_main must be held */
+    void CheckEmbargoes(CConnman& connman);
+
+    void GetStats(CDandelionStats& stats) const;
+    std::string ToString() const;
+    void Clear();
+};
+
+extern CDandelionManager dandelion;
+
+#endif // ZCOIN_DANDELION_H
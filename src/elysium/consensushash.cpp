@@ -17,7 +17,10 @@
 
 #include <stdint.h>
 #include <algorithm>
+#include <map>
+#include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <openssl/sha.h>
@@ -98,6 +101,180 @@ std::string GenerateConsensusString(const uint32_t propertyId, const std::string
     return strprintf("%d|%s", propertyId, address);
 }
 
+namespace {
+
+/** Number of addresses between two saved states of the balances hash. */
+const size_t BALANCES_HASH_CHECKPOINT_INTERVAL = 1024;
+
+/**
+ * Cache of the balances stage of the consensus hash.
+ *
+ * The consensus strings of every address are kept ordered by address and only generated
+ * again for the addresses whose balances changed. The state of the hash is saved every
+ * BALANCES_HASH_CHECKPOINT_INTERVAL addresses, so hashing resumes at the last saved state
+ * before the first changed address instead of at the first address.
+ *
+ * Guarded by cs_main, like the tally map.
+ */
+class BalancesHashCache
+{
+public:
+    BalancesHashCache() : fInitialized(false), fHashed(false)
+    {
+    }
+
+    void MarkChanged(const std::string& address)
+    {
+        if (fInitialized) {
+            changed.insert(address);
+        }
+    }
+
+    void Clear()
+    {
+        fInitialized = false;
+        fHashed = false;
+        entries.clear();
+        changed.clear();
+        checkpoints.clear();
+    }
+
+    /** Sets the hash to the state after adding the balances of every address, the balances are the first stage. */
+    void Hash(SHA256_CTX& shaCtx)
+    {
+        AssertLockHeld(cs_main);
+
+        Update();
+
+        if (!fHashed || elysium_debug_consensus_hash) {
+            HashEntries();
+            fHashed = true;
+        }
+
+        shaCtx = hashed;
+    }
+
+    /** Updates the hash with the balances of a single property. */
+    void HashProperty(SHA256_CTX& shaCtx, uint32_t propertyId)
+    {
+        AssertLockHeld(cs_main);
+
+        Update();
+
+        for (const auto& entry : entries) {
+            for (const auto& balance : entry.second) {
+                if (balance.first != propertyId) continue;
+                if (elysium_debug_consensus_hash) PrintToLog("Adding data to balances hash: %s\n", balance.second);
+                SHA256_Update(&shaCtx, balance.second.c_str(), balance.second.length());
+            }
+        }
+    }
+
+private:
+    typedef std::vector<std::pair<uint32_t, std::string>> BalanceStrings;
+
+    bool fInitialized;
+    // Consensus strings of the non-empty balances of each address, ordered by property ID
+    std::map<std::string, BalanceStrings> entries;
+    // Addresses with balances changed since the last update
+    std::set<std::string> changed;
+    // State of the hash before the balances of the key address were added
+    std::map<std::string, SHA256_CTX> checkpoints;
+    // State of the hash after the balances of every address were added
+    bool fHashed;
+    SHA256_CTX hashed;
+
+    static BalanceStrings GenerateBalanceStrings(CMPTally& tally, const std::string& address)
+    {
+        BalanceStrings strings;
+        for (CMPTally::const_iterator it = tally.consensusBegin(); it != tally.end(); ++it) {
+            uint32_t propertyId = it->first;
+            std::string dataStr = GenerateConsensusString(tally, address, propertyId);
+            if (dataStr.empty()) continue; // skip empty balances
+            strings.push_back(std::make_pair(propertyId, dataStr));
+        }
+        return strings;
+    }
+
+    void SetEntry(const std::string& address, CMPTally* tally)
+    {
+        BalanceStrings strings;
+        if (tally) {
+            strings = GenerateBalanceStrings(*tally, address);
+        }
+
+        if (strings.empty()) {
+            entries.erase(address);
+        } else {
+            entries[address] = std::move(strings);
+        }
+    }
+
+    void Update()
+    {
+        if (!fInitialized) {
+            for (std::unordered_map<std::string, CMPTally>::iterator it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
+                SetEntry(it->first, &it->second);
+            }
+            fInitialized = true;
+            return;
+        }
+
+        if (changed.empty()) {
+            return;
+        }
+
+        for (const auto& address : changed) {
+            SetEntry(address, getTally(address));
+        }
+
+        // Saved states before the first changed address are still valid
+        checkpoints.erase(checkpoints.upper_bound(*changed.begin()), checkpoints.end());
+        changed.clear();
+        fHashed = false;
+    }
+
+    void HashEntries()
+    {
+        SHA256_CTX ctx;
+        std::map<std::string, BalanceStrings>::const_iterator it = entries.begin();
+
+        if (checkpoints.empty() || elysium_debug_consensus_hash) {
+            SHA256_Init(&ctx);
+        } else {
+            ctx = checkpoints.rbegin()->second;
+            it = entries.lower_bound(checkpoints.rbegin()->first);
+        }
+
+        for (size_t n = 0; it != entries.end(); ++it, ++n) {
+            if (n > 0 && n % BALANCES_HASH_CHECKPOINT_INTERVAL == 0) {
+                checkpoints[it->first] = ctx;
+            }
+            for (const auto& balance : it->second) {
+                const std::string& dataStr = balance.second;
+                if (elysium_debug_consensus_hash) PrintToLog("Adding balance data to consensus hash: %s\n", dataStr);
+                SHA256_Update(&ctx, dataStr.c_str(), dataStr.length());
+            }
+        }
+
+        hashed = ctx;
+    }
+};
+
+BalancesHashCache balancesHashCache;
+
+} // anonymous namespace
+
+void NotifyConsensusHashBalanceChanged(const std::string& address)
+{
+    balancesHashCache.MarkChanged(address);
+}
+
+void ClearConsensusHashCache()
+{
+    balancesHashCache.Clear();
+}
+
 /**
  * Obtains a hash of the active state to use for consensus verification and checkpointing.
  *
@@ -157,25 +334,10 @@ uint256 GetConsensusHash()
 
     if (elysium_debug_consensus_hash) PrintToLog("Beginning generation of current consensus hash...\n");
 
-    // Balances - loop through the tally map, updating the sha context with the data from each balance and tally type
+    // Balances - add the cached consensus strings of every address, which are sorted alphabetically and only generated
+    // again for addresses whose balances changed
     // Placeholders:  "address|propertyid|balance|selloffer_reserve|accept_reserve|metadex_reserve"
-    // Sort alphabetically first
-    std::map<std::string, CMPTally> tallyMapSorted;
-    for (std::unordered_map<string, CMPTally>::iterator uoit = mp_tally_map.begin(); uoit != mp_tally_map.end(); ++uoit) {
-        tallyMapSorted.insert(std::make_pair(uoit->first,uoit->second));
-    }
-    for (std::map<string, CMPTally>::iterator my_it = tallyMapSorted.begin(); my_it != tallyMapSorted.end(); ++my_it) {
-        const std::string& address = my_it->first;
-        CMPTally& tally = my_it->second;
-        tally.init();
-        uint32_t propertyId = 0;
-        while (0 != (propertyId = (tally.next()))) {
-            std::string dataStr = GenerateConsensusString(tally, address, propertyId);
-            if (dataStr.empty()) continue; // skip empty balances
-            if (elysium_debug_consensus_hash) PrintToLog("Adding balance data to consensus hash: %s\n", dataStr);
-            SHA256_Update(&shaCtx, dataStr.c_str(), dataStr.length());
-        }
-    }
+    balancesHashCache.Hash(shaCtx);
 
     // DEx sell offers - loop through the DEx and add each sell offer to the consensus hash (ordered by txid)
     // Placeholders: "txid|address|propertyid|offeramount|btcdesired|minfee|timelimit"
@@ -318,23 +480,7 @@ uint256 GetBalancesHash(const uint32_t hashPropertyId)
 
     LOCK(cs_main);
 
-    std::map<std::string, CMPTally> tallyMapSorted;
-    for (std::unordered_map<string, CMPTally>::iterator uoit = mp_tally_map.begin(); uoit != mp_tally_map.end(); ++uoit) {
-        tallyMapSorted.insert(std::make_pair(uoit->first,uoit->second));
-    }
-    for (std::map<string, CMPTally>::iterator my_it = tallyMapSorted.begin(); my_it != tallyMapSorted.end(); ++my_it) {
-        const std::string& address = my_it->first;
-        CMPTally& tally = my_it->second;
-        tally.init();
-        uint32_t propertyId = 0;
-        while (0 != (propertyId = (tally.next()))) {
-            if (propertyId != hashPropertyId) continue;
-            std::string dataStr = GenerateConsensusString(tally, address, propertyId);
-            if (dataStr.empty()) continue;
-            if (elysium_debug_consensus_hash) PrintToLog("Adding data to balances hash: %s\n", dataStr);
-            SHA256_Update(&shaCtx, dataStr.c_str(), dataStr.length());
-        }
-    }
+    balancesHashCache.HashProperty(shaCtx, hashPropertyId);
 
     uint256 balancesHash;
     SHA256_Final((unsigned char*)&balancesHash, &shaCtx);
@@ -3,6 +3,8 @@
 
 #include "uint256.h"
 
+#include <string>
+
 namespace elysium
 {
 /** Checks if a given block should be consensus hashed. */
@@ -17,6 +19,12 @@ uint256 GetMetaDExHash(const uint32_t propertyId = 0);
 /** Obtains a hash of the balances for a specific property. */
 uint256 GetBalancesHash(const uint32_t hashPropertyId);
 
+/** Marks the balances of an address as changed, so its part of the consensus hash is generated again. */
+void NotifyConsensusHashBalanceChanged(const std::string& address);
+
+/** Discards the cached balances part of the consensus hash, to be called when the tally map is cleared. */
+void ClearConsensusHashCache();
+
 } // namespace elysium
 
 #endif // ELYSIUM_CONSENSUSHASH_H
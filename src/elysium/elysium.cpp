@@ -16,6 +16,7 @@
 #include "script.h"
 #include "sigmadb.h"
 #include "sp.h"
+#include "statedb.h"
 #include "tally.h"
 #include "tx.h"
 #include "txprocessor.h"
@@ -23,6 +24,7 @@
 #include "utilsbitcoin.h"
 #include "version.h"
 #ifdef ENABLE_WALLET
+#include "spendjobs.h"
 #include "wallet.h"
 #endif
 #include "walletcache.h"
@@ -69,10 +71,13 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include <condition_variable>
 #include <fstream>
 #include <map>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -117,7 +122,12 @@ bool autoCommit = true;
 //! Number of "Dev ELYSIUM" of the last processed block
 static int64_t elysium_prev = 0;
 
-static boost::filesystem::path MPPersistencePath;
+//! Block of the most recently stored state
+static uint256 lastStateBlock;
+//! Balances changed since the most recently stored state
+static std::set<std::pair<std::string, uint32_t> > stateChangedBalances;
+//! Number of blocks between two full snapshots of the state
+static int stateSnapshotInterval = DEFAULT_STATE_SNAPSHOT_INTERVAL;
 
 static int elysiumInitialized = 0;
 
@@ -130,6 +140,7 @@ CMPSTOList *elysium::s_stolistdb;
 CElysiumTransactionDB *elysium::p_ElysiumTXDB;
 CElysiumFeeCache *elysium::p_feecache;
 CElysiumFeeHistory *elysium::p_feehistory;
+CElysiumStateDB *elysium::p_statedb;
 
 // indicate whether persistence is enabled at this point, or not
 // used to write/read files, for breakout mode, debugging, etc.
@@ -244,6 +255,7 @@ CrowdMap elysium::my_crowds;
 
 // this is the master list of all amounts for all addresses for all properties, map is unsorted
 std::unordered_map<std::string, CMPTally> elysium::mp_tally_map;
+CMPHolderIndex elysium::mp_holder_index;
 
 CMPTally* elysium::getTally(const std::string& address)
 {
@@ -381,6 +393,7 @@ void elysium::freezeAddress(const std::string& address, uint32_t propertyId)
 {
     setFrozenAddresses.insert(std::make_pair(address, propertyId));
     assert(isAddressFrozen(address, propertyId));
+    NotifyWalletCacheBalanceChanged(address);
     PrintToLog("Address %s has been frozen for property %d.\n", address, propertyId);
 }
 
@@ -388,6 +401,7 @@ void elysium::unfreezeAddress(const std::string& address, uint32_t propertyId)
 {
     setFrozenAddresses.erase(std::make_pair(address, propertyId));
     assert(!isAddressFrozen(address, propertyId));
+    NotifyWalletCacheBalanceChanged(address);
     PrintToLog("Address %s has been unfrozen for property %d.\n", address, propertyId);
 }
 
@@ -418,7 +432,6 @@ std::string elysium::getTokenLabel(uint32_t propertyId)
 // optionally counts the number of addresses who own that property: n_owners_total
 int64_t elysium::getTotalTokens(uint32_t propertyId, int64_t* n_owners_total)
 {
-    int64_t prev = 0;
     int64_t owners = 0;
     int64_t totalTokens = 0;
 
@@ -430,18 +443,10 @@ int64_t elysium::getTotalTokens(uint32_t propertyId, int64_t* n_owners_total)
     }
 
     if (!property.fixed || n_owners_total) {
-        for (std::unordered_map<std::string, CMPTally>::const_iterator it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
-            const CMPTally& tally = it->second;
-
-            totalTokens += tally.getMoney(propertyId, BALANCE);
-            totalTokens += tally.getMoney(propertyId, SELLOFFER_RESERVE);
-            totalTokens += tally.getMoney(propertyId, ACCEPT_RESERVE);
-            totalTokens += tally.getMoney(propertyId, METADEX_RESERVE);
-
-            if (prev != totalTokens) {
-                prev = totalTokens;
-                owners++;
-            }
+        const CMPHolders* holders = mp_holder_index.get(propertyId);
+        if (holders) {
+            totalTokens = holders->getTotalTokens();
+            owners = holders->addresses.size();
         }
         int64_t cachedFee = p_feecache->GetCachedAmount(propertyId);
         totalTokens += cachedFee;
@@ -489,6 +494,20 @@ bool elysium::update_tally_map(const std::string& who, uint32_t propertyId, int6
     CMPTally& tally = my_it->second;
     bRet = tally.updateMoney(propertyId, amount, ttype);
 
+    if (bRet) {
+        mp_holder_index.update(who, propertyId, amount, ttype);
+        NotifyWalletCacheBalanceChanged(who);
+    }
+
+    if (bRet && ttype != PENDING) {
+        NotifyConsensusHashBalanceChanged(who);
+
+        // only changes on top of a stored state are stored as changes
+        if (!lastStateBlock.IsNull()) {
+            stateChangedBalances.insert(std::make_pair(who, propertyId));
+        }
+    }
+
     after = getMPbalance(who, propertyId, ttype);
     if (!bRet) {
         assert(before == after);
@@ -597,25 +616,12 @@ void CheckWalletUpdate(bool forceUpdate)
     global_balance_reserved.clear();
 
     // populate global balance totals and wallet property list - note global balances do not include additional balances from watch-only addresses
-    for (std::unordered_map<std::string, CMPTally>::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
-        // check if the address is a wallet address (including watched addresses)
-        std::string address = my_it->first;
-        int addressIsMine = IsMyAddress(address);
-        if (!addressIsMine) continue;
-        // iterate only those properties in the TokenMap for this address
-        my_it->second.init();
-        uint32_t propertyId;
-        while (0 != (propertyId = (my_it->second).next())) {
-            // add to the global wallet property list
-            global_wallet_property_list.insert(propertyId);
-            // check if the address is spendable (only spendable balances are included in totals)
-            if (addressIsMine != ISMINE_SPENDABLE) continue;
-            // work out the balances and add to globals
-            global_balance_money[propertyId] += getUserAvailableMPbalance(address, propertyId);
-            global_balance_reserved[propertyId] += getMPbalance(address, propertyId, SELLOFFER_RESERVE);
-            global_balance_reserved[propertyId] += getMPbalance(address, propertyId, METADEX_RESERVE);
-            global_balance_reserved[propertyId] += getMPbalance(address, propertyId, ACCEPT_RESERVE);
-        }
+    std::map<uint32_t, WalletBalance> balances = GetWalletBalances();
+    for (std::map<uint32_t, WalletBalance>::const_iterator it = balances.begin(); it != balances.end(); ++it) {
+        uint32_t propertyId = it->first;
+        global_wallet_property_list.insert(propertyId);
+        global_balance_money[propertyId] = it->second.available;
+        global_balance_reserved[propertyId] = it->second.reserved;
     }
     // signal an Elysium balance change
     uiInterface.ElysiumBalanceChanged();
@@ -1125,6 +1131,118 @@ public:
     }
 };
 
+namespace {
+
+/**
+ * Reads the blocks of the initial scan ahead on background threads.
+ *
+ * Reading a block includes checking its proof of work, which is what the scan
+ * spends most of its time on. The readers also pick the transactions which may
+ * carry a packet, so the scan only parses those.
+ */
+class BlockPrefetcher
+{
+public:
+    struct Entry
+    {
+        bool fRead;
+        CBlock block;
+        //! Whether the transaction at the same position may carry a packet
+        std::vector<bool> candidates;
+
+        Entry() : fRead(false) {}
+    };
+
+private:
+    const std::vector<CBlockIndex*> blocks;
+    const size_t nReadAhead;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::map<size_t, Entry> ready;
+    size_t nNextRead;
+    size_t nNextTaken;
+    bool fStop;
+
+    std::vector<std::thread> threads;
+
+    void ThreadRead()
+    {
+        RenameThread("zcoin-elyscan");
+
+        while (true) {
+            size_t n;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [this] {
+                    return fStop || nNextRead >= blocks.size() || nNextRead < nNextTaken + nReadAhead;
+                });
+                if (fStop || nNextRead >= blocks.size()) {
+                    return;
+                }
+                n = nNextRead++;
+            }
+
+            Entry entry;
+            entry.fRead = ReadBlockFromDisk(entry.block, blocks[n], Params().GetConsensus());
+            if (entry.fRead) {
+                entry.candidates.reserve(entry.block.vtx.size());
+                for (const auto& tx : entry.block.vtx) {
+                    entry.candidates.push_back(MayHavePacket(*tx));
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ready.emplace(n, std::move(entry));
+            }
+            cond.notify_all();
+        }
+    }
+
+public:
+    BlockPrefetcher(const std::vector<CBlockIndex*>& blocksIn, size_t nThreads, size_t nReadAheadIn)
+        : blocks(blocksIn), nReadAhead(nReadAheadIn), nNextRead(0), nNextTaken(0), fStop(false)
+    {
+        for (size_t i = 0; i < nThreads; i++) {
+            threads.emplace_back(&BlockPrefetcher::ThreadRead, this);
+        }
+    }
+
+    ~BlockPrefetcher()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            fStop = true;
+        }
+        cond.notify_all();
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    /** Waits for the next block in order and takes it. */
+    Entry Take()
+    {
+        Entry entry;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [this] { return ready.count(nNextTaken) > 0; });
+
+            std::map<size_t, Entry>::iterator it = ready.find(nNextTaken);
+            entry = std::move(it->second);
+            ready.erase(it);
+            ++nNextTaken;
+        }
+        cond.notify_all();
+
+        return entry;
+    }
+};
+
+} // namespace
+
 /**
  * Scans the blockchain for meta transactions.
  *
@@ -1159,6 +1277,16 @@ static int elysium_initial_scan(int nFirstBlock)
     // used to print the progress to the console and notifies the UI
     ProgressReporter progressReporter(chainActive[nFirstBlock], chainActive[nLastBlock]);
 
+    // the readers can't look up the active chain, so hand them the blocks to read
+    std::vector<CBlockIndex*> vBlocks;
+    vBlocks.reserve(nLastBlock - nFirstBlock + 1);
+    for (nBlock = nFirstBlock; nBlock <= nLastBlock && chainActive[nBlock] != NULL; ++nBlock) {
+        vBlocks.push_back(chainActive[nBlock]);
+    }
+
+    int nThreads = std::max(1, (int) GetArg("-elysiumscanthreads", DEFAULT_ELYSIUM_SCAN_THREADS));
+    BlockPrefetcher prefetcher(vBlocks, nThreads, ELYSIUM_SCAN_READ_AHEAD);
+
     for (nBlock = nFirstBlock; nBlock <= nLastBlock; ++nBlock)
     {
         if (ShutdownRequested()) {
@@ -1166,8 +1294,8 @@ static int elysium_initial_scan(int nFirstBlock)
             break;
         }
 
-        CBlockIndex* pblockindex = chainActive[nBlock];
-        if (NULL == pblockindex) break;
+        if (nBlock - nFirstBlock >= (int) vBlocks.size()) break;
+        CBlockIndex* pblockindex = vBlocks[nBlock - nFirstBlock];
         std::string strBlockHash = pblockindex->GetBlockHash().GetHex();
 
         if (elysium_debug_ely) PrintToLog("%s(%d; max=%d):%s, line %d, file: %s\n",
@@ -1179,18 +1307,26 @@ static int elysium_initial_scan(int nFirstBlock)
         }
 
         // Get block to parse.
-        CBlock block;
+        BlockPrefetcher::Entry entry = prefetcher.Take();
 
-        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus())) {
+        if (!entry.fRead) {
             break;
         }
 
+        const CBlock& block = entry.block;
+
         // Parse block.
         unsigned parsed = 0;
 
         elysium_handler_block_begin(nBlock, pblockindex);
 
         for (unsigned i = 0; i < block.vtx.size(); i++) {
+            if (!entry.candidates[i]) {
+                // not a packet, only a pending transaction may need to be cleared
+                PendingDelete(block.vtx[i]->GetHash());
+                continue;
+            }
+
             if (elysium_handler_tx(*block.vtx[i], nBlock, i, pblockindex)) {
                 parsed++;
             }
@@ -1212,337 +1348,98 @@ static int elysium_initial_scan(int nFirstBlock)
     return 0;
 }
 
-int input_elysium_balances_string(const std::string& s)
+/**
+ * Credits a restored amount of a tally type to an empty tally.
+ */
+static bool restore_tally_amount(CMPTally& tally, const std::string& address, uint32_t propertyId, int64_t amount, TallyType ttype)
 {
-    // "address=propertybalancedata"
-    std::vector<std::string> addrData;
-    boost::split(addrData, s, boost::is_any_of("="), boost::token_compress_on);
-    if (addrData.size() != 2) return -1;
-
-    std::string strAddress = addrData[0];
-
-    // split the tuples of properties
-    std::vector<std::string> vProperties;
-    boost::split(vProperties, addrData[1], boost::is_any_of(";"), boost::token_compress_on);
-
-    std::vector<std::string>::const_iterator iter;
-    for (iter = vProperties.begin(); iter != vProperties.end(); ++iter) {
-        if ((*iter).empty()) {
-            continue;
-        }
-
-        // "propertyid:balancedata"
-        std::vector<std::string> curProperty;
-        boost::split(curProperty, *iter, boost::is_any_of(":"), boost::token_compress_on);
-        if (curProperty.size() != 2) return -1;
-
-        // "balance,sellreserved,acceptreserved,metadexreserved"
-        std::vector<std::string> curBalance;
-        boost::split(curBalance, curProperty[1], boost::is_any_of(","), boost::token_compress_on);
-        if (curBalance.size() != 4) return -1;
-
-        uint32_t propertyId = boost::lexical_cast<uint32_t>(curProperty[0]);
-
-        int64_t balance = boost::lexical_cast<int64_t>(curBalance[0]);
-        int64_t sellReserved = boost::lexical_cast<int64_t>(curBalance[1]);
-        int64_t acceptReserved = boost::lexical_cast<int64_t>(curBalance[2]);
-        int64_t metadexReserved = boost::lexical_cast<int64_t>(curBalance[3]);
-
-        if (balance) update_tally_map(strAddress, propertyId, balance, BALANCE);
-        if (sellReserved) update_tally_map(strAddress, propertyId, sellReserved, SELLOFFER_RESERVE);
-        if (acceptReserved) update_tally_map(strAddress, propertyId, acceptReserved, ACCEPT_RESERVE);
-        if (metadexReserved) update_tally_map(strAddress, propertyId, metadexReserved, METADEX_RESERVE);
+    if (0 == amount) {
+        return true;
     }
-
-    return 0;
-}
-
-// seller-address, offer_block, amount, property, desired BTC , property_desired, fee, blocktimelimit
-// 13z1JFtDMGTYQvtMq5gs4LmCztK3rmEZga,299076,76375000,1,6415500,0,10000,6
-int input_mp_offers_string(const std::string& s)
-{
-    std::vector<std::string> vstr;
-    boost::split(vstr, s, boost::is_any_of(" ,="), boost::token_compress_on);
-
-    if (9 != vstr.size()) return -1;
-
-    int i = 0;
-
-    std::string sellerAddr = vstr[i++];
-    int offerBlock = boost::lexical_cast<int>(vstr[i++]);
-    int64_t amountOriginal = boost::lexical_cast<int64_t>(vstr[i++]);
-    uint32_t prop = boost::lexical_cast<uint32_t>(vstr[i++]);
-    int64_t btcDesired = boost::lexical_cast<int64_t>(vstr[i++]);
-    uint32_t prop_desired = boost::lexical_cast<uint32_t>(vstr[i++]);
-    int64_t minFee = boost::lexical_cast<int64_t>(vstr[i++]);
-    uint8_t blocktimelimit = boost::lexical_cast<unsigned int>(vstr[i++]); // lexical_cast can't handle char!
-    uint256 txid = uint256S(vstr[i++]);
-
-    // TODO: should this be here? There are usually no sanity checks..
-    if (ELYSIUM_PROPERTY_XZC != prop_desired) return -1;
-
-    const std::string combo = STR_SELLOFFER_ADDR_PROP_COMBO(sellerAddr, prop);
-    CMPOffer newOffer(offerBlock, amountOriginal, prop, btcDesired, minFee, blocktimelimit, txid);
-
-    if (!my_offers.insert(std::make_pair(combo, newOffer)).second) return -1;
-
-    return 0;
-}
-
-// seller-address, property, buyer-address, amount, fee, block
-// 13z1JFtDMGTYQvtMq5gs4LmCztK3rmEZga,1, 148EFCFXbk2LrUhEHDfs9y3A5dJ4tttKVd,100000,11000,299126
-// 13z1JFtDMGTYQvtMq5gs4LmCztK3rmEZga,1,1Md8GwMtWpiobRnjRabMT98EW6Jh4rEUNy,50000000,11000,299132
-int input_mp_accepts_string(const string &s)
-{
-  int nBlock;
-  unsigned char blocktimelimit;
-  std::vector<std::string> vstr;
-  boost::split(vstr, s, boost::is_any_of(" ,="), token_compress_on);
-  uint64_t amountRemaining, amountOriginal, offerOriginal, btcDesired;
-  unsigned int prop;
-  string sellerAddr, buyerAddr, txidStr;
-  int i = 0;
-
-  if (10 != vstr.size()) return -1;
-
-  sellerAddr = vstr[i++];
-  prop = boost::lexical_cast<unsigned int>(vstr[i++]);
-  buyerAddr = vstr[i++];
-  nBlock = atoi(vstr[i++]);
-  amountRemaining = boost::lexical_cast<uint64_t>(vstr[i++]);
-  amountOriginal = boost::lexical_cast<uint64_t>(vstr[i++]);
-  blocktimelimit = atoi(vstr[i++]);
-  offerOriginal = boost::lexical_cast<uint64_t>(vstr[i++]);
-  btcDesired = boost::lexical_cast<uint64_t>(vstr[i++]);
-  txidStr = vstr[i++];
-
-  const string combo = STR_ACCEPT_ADDR_PROP_ADDR_COMBO(sellerAddr, buyerAddr, prop);
-  CMPAccept newAccept(amountOriginal, amountRemaining, nBlock, blocktimelimit, prop, offerOriginal, btcDesired, uint256S(txidStr));
-  if (my_accepts.insert(std::make_pair(combo, newAccept)).second) {
-    return 0;
-  } else {
-    return -1;
-  }
-}
-
-// elysium_prev
-int input_globals_state_string(const string &s)
-{
-  uint64_t elysiumPrev;
-  unsigned int nextSPID, nextTestSPID;
-  std::vector<std::string> vstr;
-  boost::split(vstr, s, boost::is_any_of(" ,="), token_compress_on);
-  if (3 != vstr.size()) return -1;
-
-  int i = 0;
-  elysiumPrev = boost::lexical_cast<uint64_t>(vstr[i++]);
-  nextSPID = boost::lexical_cast<unsigned int>(vstr[i++]);
-  nextTestSPID = boost::lexical_cast<unsigned int>(vstr[i++]);
-
-  elysium_prev = elysiumPrev;
-  _my_sps->init(nextSPID, nextTestSPID);
-  return 0;
+    if (!tally.updateMoney(propertyId, amount, ttype)) {
+        return false;
+    }
+    mp_holder_index.update(address, propertyId, amount, ttype);
+    return true;
 }
 
-// addr,propertyId,nValue,property_desired,deadline,early_bird,percentage,txid
-int input_mp_crowdsale_string(const std::string& s)
+bool elysium::RestoreTallies(const std::vector<CElysiumState>& states)
 {
-    std::vector<std::string> vstr;
-    boost::split(vstr, s, boost::is_any_of(" ,"), boost::token_compress_on);
-
-    if (9 > vstr.size()) return -1;
-
-    unsigned int i = 0;
-
-    std::string sellerAddr = vstr[i++];
-    uint32_t propertyId = boost::lexical_cast<uint32_t>(vstr[i++]);
-    int64_t nValue = boost::lexical_cast<int64_t>(vstr[i++]);
-    uint32_t property_desired = boost::lexical_cast<uint32_t>(vstr[i++]);
-    int64_t deadline = boost::lexical_cast<int64_t>(vstr[i++]);
-    uint8_t early_bird = boost::lexical_cast<unsigned int>(vstr[i++]); // lexical_cast can't handle char!
-    uint8_t percentage = boost::lexical_cast<unsigned int>(vstr[i++]); // lexical_cast can't handle char!
-    int64_t u_created = boost::lexical_cast<int64_t>(vstr[i++]);
-    int64_t i_created = boost::lexical_cast<int64_t>(vstr[i++]);
-
-    CMPCrowd newCrowdsale(propertyId, nValue, property_desired, deadline, early_bird, percentage, u_created, i_created);
-
-    // load the remaining as database pairs
-    while (i < vstr.size()) {
-        std::vector<std::string> entryData;
-        boost::split(entryData, vstr[i++], boost::is_any_of("="), boost::token_compress_on);
-        if (2 != entryData.size()) return -1;
-
-        std::vector<std::string> valueData;
-        boost::split(valueData, entryData[1], boost::is_any_of(";"), boost::token_compress_on);
+    LOCK(cs_main);
 
-        std::vector<int64_t> vals;
-        for (std::vector<std::string>::const_iterator it = valueData.begin(); it != valueData.end(); ++it) {
-            vals.push_back(boost::lexical_cast<int64_t>(*it));
+    // Later states hold the current amounts of the balances changed since
+    std::map<std::pair<std::string, uint32_t>, const CElysiumStateBalance*> balances;
+    for (const CElysiumState& state : states) {
+        for (const CElysiumStateBalance& entry : state.balances) {
+            balances[std::make_pair(entry.address, entry.propertyId)] = &entry;
         }
-
-        uint256 txHash = uint256S(entryData[0]);
-        newCrowdsale.insertDatabase(txHash, vals);
     }
 
-    if (!my_crowds.insert(std::make_pair(sellerAddr, newCrowdsale)).second) {
-        return -1;
-    }
-
-    return 0;
-}
-
-// address, block, amount for sale, property, amount desired, property desired, subaction, idx, txid, amount remaining
-int input_mp_mdexorder_string(const std::string& s)
-{
-    std::vector<std::string> vstr;
-    boost::split(vstr, s, boost::is_any_of(" ,="), boost::token_compress_on);
-
-    if (10 != vstr.size()) return -1;
-
-    int i = 0;
-
-    std::string addr = vstr[i++];
-    int block = boost::lexical_cast<int>(vstr[i++]);
-    int64_t amount_forsale = boost::lexical_cast<int64_t>(vstr[i++]);
-    uint32_t property = boost::lexical_cast<uint32_t>(vstr[i++]);
-    int64_t amount_desired = boost::lexical_cast<int64_t>(vstr[i++]);
-    uint32_t desired_property = boost::lexical_cast<uint32_t>(vstr[i++]);
-    uint8_t subaction = boost::lexical_cast<unsigned int>(vstr[i++]); // lexical_cast can't handle char!
-    unsigned int idx = boost::lexical_cast<unsigned int>(vstr[i++]);
-    uint256 txid = uint256S(vstr[i++]);
-    int64_t amount_remaining = boost::lexical_cast<int64_t>(vstr[i++]);
-
-    CMPMetaDEx mdexObj(addr, block, property, amount_forsale, desired_property,
-            amount_desired, txid, idx, subaction, amount_remaining);
+    mp_tally_map.clear();
+    mp_holder_index.clear();
 
-    if (!MetaDEx_INSERT(mdexObj)) return -1;
+    for (const auto& balance : balances) {
+        const CElysiumStateBalance& entry = *balance.second;
+        if (!entry.balance && !entry.sellReserved && !entry.acceptReserved && !entry.metadexReserved) {
+            continue;
+        }
+        CMPTally& tally = mp_tally_map[entry.address];
+        if (!restore_tally_amount(tally, entry.address, entry.propertyId, entry.balance, BALANCE) ||
+                !restore_tally_amount(tally, entry.address, entry.propertyId, entry.sellReserved, SELLOFFER_RESERVE) ||
+                !restore_tally_amount(tally, entry.address, entry.propertyId, entry.acceptReserved, ACCEPT_RESERVE) ||
+                !restore_tally_amount(tally, entry.address, entry.propertyId, entry.metadexReserved, METADEX_RESERVE)) {
+            PrintToLog("%s(): invalid balance of %s in property %d\n", __func__, entry.address, entry.propertyId);
+            return false;
+        }
+    }
 
-    return 0;
+    return true;
 }
 
-static int elysium_file_load(const string &filename, int what, bool verifyHash = false)
+/**
+ * Restores the state as of a block from the most recent snapshot before it
+ * and the balance changes of the blocks in between.
+ *
+ * @param pBlockIndex  The block
+ * @return True, if the state was restored
+ */
+static bool load_state(CBlockIndex const *pBlockIndex)
 {
-  int lines = 0;
-  int (*inputLineFunc)(const string &) = NULL;
-
-  SHA256_CTX shaCtx;
-  SHA256_Init(&shaCtx);
-
-  switch (what)
-  {
-    case FILETYPE_BALANCES:
-      mp_tally_map.clear();
-      inputLineFunc = input_elysium_balances_string;
-      break;
-
-    case FILETYPE_OFFERS:
-      my_offers.clear();
-      inputLineFunc = input_mp_offers_string;
-      break;
-
-    case FILETYPE_ACCEPTS:
-      my_accepts.clear();
-      inputLineFunc = input_mp_accepts_string;
-      break;
-
-    case FILETYPE_GLOBALS:
-      inputLineFunc = input_globals_state_string;
-      break;
-
-    case FILETYPE_CROWDSALES:
-      my_crowds.clear();
-      inputLineFunc = input_mp_crowdsale_string;
-      break;
-
-    case FILETYPE_MDEXORDERS:
-      // FIXME
-      // memory leak ... gotta unallocate inner layers first....
-      // TODO
-      // ...
-      metadex.clear();
-      inputLineFunc = input_mp_mdexorder_string;
-      break;
-
-    default:
-      return -1;
-  }
-
-  if (elysium_debug_persistence)
-  {
-    LogPrintf("Loading %s ... \n", filename);
-    PrintToLog("%s(%s), line %d, file: %s\n", __FUNCTION__, filename, __LINE__, __FILE__);
-  }
-
-  std::ifstream file;
-  file.open(filename.c_str());
-  if (!file.is_open())
-  {
-    if (elysium_debug_persistence) LogPrintf("%s(%s): file not found, line %d, file: %s\n", __FUNCTION__, filename, __LINE__, __FILE__);
-    return -1;
-  }
-
-  int res = 0;
-
-  std::string fileHash;
-  while (file.good())
-  {
-    std::string line;
-    std::getline(file, line);
-    if (line.empty() || line[0] == '#') continue;
-
-    // remove \r if the file came from Windows
-    line.erase( std::remove( line.begin(), line.end(), '\r' ), line.end() ) ;
-
-    // record and skip hashes in the file
-    if (line[0] == '!') {
-      fileHash = line.substr(1);
-      continue;
+    std::vector<CElysiumState> states;
+    if (!p_statedb->ReadStates(pBlockIndex, states)) {
+        return false;
     }
 
-    // update hash?
-    if (verifyHash) {
-      SHA256_Update(&shaCtx, line.c_str(), line.length());
-    }
+    ClearConsensusHashCache();
+    ClearWalletCache();
 
-    if (inputLineFunc) {
-      if (inputLineFunc(line) < 0) {
-        res = -1;
-        break;
-      }
+    if (!RestoreTallies(states)) {
+        return false;
     }
 
-    ++lines;
-  }
-
-  file.close();
+    const CElysiumState& state = states.back();
+    elysium_prev = state.elysiumPrev;
+    _my_sps->init(state.nextSPID, state.nextTestSPID);
+    my_offers = state.offers;
+    my_accepts = state.accepts;
+    my_crowds = state.crowds;
 
-  if (verifyHash && res == 0) {
-    // generate and wite the double hash of all the contents written
-    uint256 hash1;
-    SHA256_Final((unsigned char*)&hash1, &shaCtx);
-    uint256 hash2;
-    SHA256((unsigned char*)&hash1, sizeof(hash1), (unsigned char*)&hash2);
-
-    if (false == boost::iequals(hash2.ToString(), fileHash)) {
-      PrintToLog("File %s loaded, but failed hash validation!\n", filename);
-      res = -1;
+    MetaDEx_CLEAR();
+    for (const CMPMetaDEx& trade : state.trades) {
+        if (!MetaDEx_INSERT(trade)) {
+            PrintToLog("%s(): duplicate trade %s\n", __func__, trade.getHash().GetHex());
+            return false;
+        }
     }
-  }
 
-  PrintToLog("%s(%s), loaded lines= %d, res= %d\n", __FUNCTION__, filename, lines, res);
-  LogPrintf("%s(): file: %s , loaded lines= %d, res= %d\n", __FUNCTION__, filename, lines, res);
+    stateChangedBalances.clear();
+    lastStateBlock = pBlockIndex->GetBlockHash();
 
-  return res;
-}
+    PrintToLog("%s(): loaded state of block %d from a snapshot and %d blocks of changes\n", __func__,
+        pBlockIndex->nHeight, states.size() - 1);
 
-static char const * const statePrefix[NUM_FILETYPES] = {
-    "balances",
-    "offers",
-    "accepts",
-    "globals",
-    "crowdsales",
-    "mdexorders",
-};
+    return true;
+}
 
 // returns the height of the state loaded
 static int load_most_relevant_state()
@@ -1576,60 +1473,17 @@ static int load_most_relevant_state()
     }
   }
 
-  // prepare a set of available files by block hash pruning any that are
-  // not in the active chain
-  std::set<uint256> persistedBlocks;
-  boost::filesystem::directory_iterator dIter(MPPersistencePath);
-  boost::filesystem::directory_iterator endIter;
-  for (; dIter != endIter; ++dIter) {
-    if (false == boost::filesystem::is_regular_file(dIter->status()) || dIter->path().empty()) {
-      // skip funny business
-      continue;
-    }
-
-    std::string fName = (*--dIter->path().end()).string();
-    std::vector<std::string> vstr;
-    boost::split(vstr, fName, boost::is_any_of("-."), token_compress_on);
-    if (  vstr.size() == 3 &&
-          boost::equals(vstr[2], "dat")) {
-      uint256 blockHash;
-      blockHash.SetHex(vstr[1]);
-      CBlockIndex *pBlockIndex = GetBlockIndex(blockHash);
-      if (pBlockIndex == NULL || false == chainActive.Contains(pBlockIndex)) {
-        continue;
-      }
-
-      // this is a valid block in the active chain, store it
-      persistedBlocks.insert(blockHash);
-    }
-  }
-
   // using the SP's watermark after its fixed-up as the tip
-  // walk backwards until we find a valid and full set of persisted state files
+  // walk backwards until we find a block with a complete state
   // for each block we discard, roll back the SP database
   // Note: to avoid rolling back all the way to the genesis block (which appears as if client is hung) abort after MAX_STATE_HISTORY attempts
   CBlockIndex const *curTip = spBlockIndex;
   int abortRollBackBlock;
   if (curTip != NULL) abortRollBackBlock = curTip->nHeight - (MAX_STATE_HISTORY+1);
-  while (NULL != curTip && persistedBlocks.size() > 0 && curTip->nHeight > abortRollBackBlock) {
-    if (persistedBlocks.find(spBlockIndex->GetBlockHash()) != persistedBlocks.end()) {
-      int success = -1;
-      for (int i = 0; i < NUM_FILETYPES; ++i) {
-        boost::filesystem::path path = MPPersistencePath / strprintf("%s-%s.dat", statePrefix[i], curTip->GetBlockHash().ToString());
-        const std::string strFile = path.string();
-        success = elysium_file_load(strFile, i, true);
-        if (success < 0) {
-          break;
-        }
-      }
-
-      if (success >= 0) {
-        res = curTip->nHeight;
-        break;
-      }
-
-      // remove this from the persistedBlock Set
-      persistedBlocks.erase(spBlockIndex->GetBlockHash());
+  while (NULL != curTip && curTip->nHeight > abortRollBackBlock) {
+    if (load_state(curTip)) {
+      res = curTip->nHeight;
+      break;
     }
 
     // go to the previous block
@@ -1643,270 +1497,96 @@ static int load_most_relevant_state()
     }
   }
 
-  if (persistedBlocks.size() == 0) {
-    // trigger a reparse if we exhausted the persistence files without success
-    return -1;
-  }
-
   // return the height of the block we settled at
   return res;
 }
 
-static int write_elysium_balances(std::ofstream& file, SHA256_CTX* shaCtx)
+/**
+ * Adds the balances of an address in a property to a state.
+ */
+static void add_state_balance(CElysiumState& state, const std::string& address, uint32_t propertyId)
 {
-    std::unordered_map<std::string, CMPTally>::iterator iter;
-    for (iter = mp_tally_map.begin(); iter != mp_tally_map.end(); ++iter) {
-        bool emptyWallet = true;
-
-        std::string lineOut = (*iter).first;
-        lineOut.append("=");
-        CMPTally& curAddr = (*iter).second;
-        curAddr.init();
-        uint32_t propertyId = 0;
-        while (0 != (propertyId = curAddr.next())) {
-            int64_t balance = (*iter).second.getMoney(propertyId, BALANCE);
-            int64_t sellReserved = (*iter).second.getMoney(propertyId, SELLOFFER_RESERVE);
-            int64_t acceptReserved = (*iter).second.getMoney(propertyId, ACCEPT_RESERVE);
-            int64_t metadexReserved = (*iter).second.getMoney(propertyId, METADEX_RESERVE);
-
-            // we don't allow 0 balances to read in, so if we don't write them
-            // it makes things match up better between persisted state and processed state
-            if (0 == balance && 0 == sellReserved && 0 == acceptReserved && 0 == metadexReserved) {
-                continue;
-            }
-
-            emptyWallet = false;
-
-            lineOut.append(strprintf("%d:%d,%d,%d,%d;",
-                    propertyId,
-                    balance,
-                    sellReserved,
-                    acceptReserved,
-                    metadexReserved));
-        }
-
-        if (false == emptyWallet) {
-            // add the line to the hash
-            SHA256_Update(shaCtx, lineOut.c_str(), lineOut.length());
+    CElysiumStateBalance entry;
+    entry.address = address;
+    entry.propertyId = propertyId;
+    entry.balance = getMPbalance(address, propertyId, BALANCE);
+    entry.sellReserved = getMPbalance(address, propertyId, SELLOFFER_RESERVE);
+    entry.acceptReserved = getMPbalance(address, propertyId, ACCEPT_RESERVE);
+    entry.metadexReserved = getMPbalance(address, propertyId, METADEX_RESERVE);
 
-            // write the line
-            file << lineOut << endl;
-        }
+    // we don't allow 0 balances to read in, so snapshots don't include them,
+    // changes do to replace the earlier balance
+    if (state.fSnapshot && 0 == entry.balance && 0 == entry.sellReserved &&
+            0 == entry.acceptReserved && 0 == entry.metadexReserved) {
+        return;
     }
 
-    return 0;
+    state.balances.push_back(entry);
 }
 
-static int write_mp_offers(ofstream &file, SHA256_CTX *shaCtx)
+int elysium_save_state( CBlockIndex const *pBlockIndex )
 {
-  OfferMap::const_iterator iter;
-  for (iter = my_offers.begin(); iter != my_offers.end(); ++iter) {
-    // decompose the key for address
-    std::vector<std::string> vstr;
-    boost::split(vstr, (*iter).first, boost::is_any_of("-"), token_compress_on);
-    CMPOffer const &offer = (*iter).second;
-    offer.saveOffer(file, shaCtx, vstr[0]);
-  }
+    CElysiumState state;
 
+    // the changes of a block can only be stored on top of the state of its previous block
+    state.fSnapshot = (NULL == pBlockIndex->pprev || lastStateBlock != pBlockIndex->pprev->GetBlockHash() ||
+            0 == pBlockIndex->nHeight % stateSnapshotInterval);
 
-  return 0;
-}
-
-static int write_mp_metadex(ofstream &file, SHA256_CTX *shaCtx)
-{
-  for (md_PropertiesMap::iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it)
-  {
-    md_PricesMap & prices = my_it->second;
-    for (md_PricesMap::iterator it = prices.begin(); it != prices.end(); ++it)
-    {
-      md_Set & indexes = (it->second);
-      for (md_Set::iterator it = indexes.begin(); it != indexes.end(); ++it)
-      {
-        CMPMetaDEx meta = *it;
-        meta.saveOffer(file, shaCtx);
-      }
+    if (state.fSnapshot) {
+        for (std::unordered_map<std::string, CMPTally>::const_iterator it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
+            for (CMPTally::const_iterator token_it = it->second.consensusBegin(); token_it != it->second.end(); ++token_it) {
+                add_state_balance(state, it->first, token_it->first);
+            }
+        }
+    } else {
+        for (const std::pair<std::string, uint32_t>& changed : stateChangedBalances) {
+            add_state_balance(state, changed.first, changed.second);
+        }
     }
-  }
-
-  return 0;
-}
 
-static int write_mp_accepts(ofstream &file, SHA256_CTX *shaCtx)
-{
-  AcceptMap::const_iterator iter;
-  for (iter = my_accepts.begin(); iter != my_accepts.end(); ++iter) {
-    // decompose the key for address
-    std::vector<std::string> vstr;
-    boost::split(vstr, (*iter).first, boost::is_any_of("-+"), token_compress_on);
-    CMPAccept const &accept = (*iter).second;
-    accept.saveAccept(file, shaCtx, vstr[0], vstr[1]);
-  }
-
-  return 0;
-}
+    state.elysiumPrev = elysium_prev;
+    state.nextSPID = _my_sps->peekNextSPID(ELYSIUM_PROPERTY_ELYSIUM);
+    state.nextTestSPID = _my_sps->peekNextSPID(ELYSIUM_PROPERTY_TELYSIUM);
+    state.offers = my_offers;
+    state.accepts = my_accepts;
+    state.crowds = my_crowds;
 
-static int write_globals_state(ofstream &file, SHA256_CTX *shaCtx)
-{
-  unsigned int nextSPID = _my_sps->peekNextSPID(ELYSIUM_PROPERTY_ELYSIUM);
-  unsigned int nextTestSPID = _my_sps->peekNextSPID(ELYSIUM_PROPERTY_TELYSIUM);
-  std::string lineOut = strprintf("%d,%d,%d",
-    elysium_prev,
-    nextSPID,
-    nextTestSPID);
-
-  // add the line to the hash
-  SHA256_Update(shaCtx, lineOut.c_str(), lineOut.length());
-
-  // write the line
-  file << lineOut << endl;
-
-  return 0;
-}
-
-static int write_mp_crowdsales(std::ofstream& file, SHA256_CTX* shaCtx)
-{
-    for (CrowdMap::const_iterator it = my_crowds.begin(); it != my_crowds.end(); ++it) {
-        // decompose the key for address
-        const CMPCrowd& crowd = it->second;
-        crowd.saveCrowdSale(file, shaCtx, it->first);
+    for (md_PropertiesMap::const_iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it) {
+        for (md_PricesMap::const_iterator it = my_it->second.begin(); it != my_it->second.end(); ++it) {
+            state.trades.insert(state.trades.end(), it->second.begin(), it->second.end());
+        }
     }
 
-    return 0;
-}
-
-static int write_state_file( CBlockIndex const *pBlockIndex, int what )
-{
-  boost::filesystem::path path = MPPersistencePath / strprintf("%s-%s.dat", statePrefix[what], pBlockIndex->GetBlockHash().ToString());
-  const std::string strFile = path.string();
-
-  std::ofstream file;
-  file.open(strFile.c_str());
-
-  SHA256_CTX shaCtx;
-  SHA256_Init(&shaCtx);
-
-  int result = 0;
-
-  switch(what) {
-  case FILETYPE_BALANCES:
-    result = write_elysium_balances(file, &shaCtx);
-    break;
-
-  case FILETYPE_OFFERS:
-    result = write_mp_offers(file, &shaCtx);
-    break;
-
-  case FILETYPE_ACCEPTS:
-    result = write_mp_accepts(file, &shaCtx);
-    break;
-
-  case FILETYPE_GLOBALS:
-    result = write_globals_state(file, &shaCtx);
-    break;
-
-  case FILETYPE_CROWDSALES:
-      result = write_mp_crowdsales(file, &shaCtx);
-      break;
-
-  case FILETYPE_MDEXORDERS:
-      result = write_mp_metadex(file, &shaCtx);
-      break;
-  }
-
-  // generate and wite the double hash of all the contents written
-  uint256 hash1;
-  SHA256_Final((unsigned char*)&hash1, &shaCtx);
-  uint256 hash2;
-  SHA256((unsigned char*)&hash1, sizeof(hash1), (unsigned char*)&hash2);
-  file << "!" << hash2.ToString() << endl;
+    // write the new state as of the given block and clean up the states no longer needed
+    p_statedb->WriteState(pBlockIndex, state);
+    p_statedb->Prune(pBlockIndex);
 
-  file.flush();
-  file.close();
-  return result;
-}
+    stateChangedBalances.clear();
+    lastStateBlock = pBlockIndex->GetBlockHash();
 
-static bool is_state_prefix( std::string const &str )
-{
-  for (int i = 0; i < NUM_FILETYPES; ++i) {
-    if (boost::equals(str,  statePrefix[i])) {
-      return true;
-    }
-  }
+    _my_sps->setWatermark(pBlockIndex->GetBlockHash());
 
-  return false;
+    return 0;
 }
 
-static void prune_state_files( CBlockIndex const *topIndex )
+/**
+ * Removes the text based state files written by earlier versions.
+ */
+static void remove_legacy_state_files(const boost::filesystem::path& path)
 {
-  // build a set of blockHashes for which we have any state files
-  std::set<uint256> statefulBlockHashes;
-
-  boost::filesystem::directory_iterator dIter(MPPersistencePath);
-  boost::filesystem::directory_iterator endIter;
-  for (; dIter != endIter; ++dIter) {
-    std::string fName = dIter->path().empty() ? "<invalid>" : (*--dIter->path().end()).string();
-    if (false == boost::filesystem::is_regular_file(dIter->status())) {
-      // skip funny business
-      PrintToLog("Non-regular file found in persistence directory : %s\n", fName);
-      continue;
-    }
+    if (!boost::filesystem::is_directory(path)) return;
 
-    std::vector<std::string> vstr;
-    boost::split(vstr, fName, boost::is_any_of("-."), token_compress_on);
-    if (  vstr.size() == 3 &&
-          is_state_prefix(vstr[0]) &&
-          boost::equals(vstr[2], "dat")) {
-      uint256 blockHash;
-      blockHash.SetHex(vstr[1]);
-      statefulBlockHashes.insert(blockHash);
-    } else {
-      PrintToLog("None state file found in persistence directory : %s\n", fName);
+    std::vector<boost::filesystem::path> files;
+    boost::filesystem::directory_iterator endIter;
+    for (boost::filesystem::directory_iterator dIter(path); dIter != endIter; ++dIter) {
+        if (boost::filesystem::is_regular_file(dIter->status()) && dIter->path().extension() == ".dat") {
+            files.push_back(dIter->path());
+        }
     }
-  }
 
-  // for each blockHash in the set, determine the distance from the given block
-  std::set<uint256>::const_iterator iter;
-  for (iter = statefulBlockHashes.begin(); iter != statefulBlockHashes.end(); ++iter) {
-    // look up the CBlockIndex for height info
-    CBlockIndex const *curIndex = GetBlockIndex(*iter);
-
-    // if we have nothing int the index, or this block is too old..
-    if (NULL == curIndex || (topIndex->nHeight - curIndex->nHeight) > MAX_STATE_HISTORY ) {
-     if (elysium_debug_persistence)
-     {
-      if (curIndex) {
-        PrintToLog("State from Block:%s is no longer need, removing files (age-from-tip: %d)\n", (*iter).ToString(), topIndex->nHeight - curIndex->nHeight);
-      } else {
-        PrintToLog("State from Block:%s is no longer need, removing files (not in index)\n", (*iter).ToString());
-      }
-     }
-
-      // destroy the associated files!
-      std::string strBlockHash = iter->ToString();
-      for (int i = 0; i < NUM_FILETYPES; ++i) {
-        boost::filesystem::path path = MPPersistencePath / strprintf("%s-%s.dat", statePrefix[i], strBlockHash);
-        boost::filesystem::remove(path);
-      }
+    for (const boost::filesystem::path& file : files) {
+        boost::filesystem::remove(file);
     }
-  }
-}
-
-int elysium_save_state( CBlockIndex const *pBlockIndex )
-{
-    // write the new state as of the given block
-    write_state_file(pBlockIndex, FILETYPE_BALANCES);
-    write_state_file(pBlockIndex, FILETYPE_OFFERS);
-    write_state_file(pBlockIndex, FILETYPE_ACCEPTS);
-    write_state_file(pBlockIndex, FILETYPE_GLOBALS);
-    write_state_file(pBlockIndex, FILETYPE_CROWDSALES);
-    write_state_file(pBlockIndex, FILETYPE_MDEXORDERS);
-
-    // clean-up the directory
-    prune_state_files(pBlockIndex);
-
-    _my_sps->setWatermark(pBlockIndex->GetBlockHash());
-
-    return 0;
 }
 
 /**
@@ -1918,10 +1598,13 @@ void clear_all_state()
 
     // Memory based storage
     mp_tally_map.clear();
+    mp_holder_index.clear();
+    ClearConsensusHashCache();
+    ClearWalletCache();
     my_offers.clear();
     my_accepts.clear();
     my_crowds.clear();
-    metadex.clear();
+    MetaDEx_CLEAR();
     my_pending.clear();
     ResetConsensusParams();
     ClearActivations();
@@ -1937,8 +1620,11 @@ void clear_all_state()
     p_ElysiumTXDB->Clear();
     p_feecache->Clear();
     p_feehistory->Clear();
+    p_statedb->Clear();
     assert(p_txlistdb->setDBVersion() == DB_VERSION); // new set of databases, set DB version
     elysium_prev = 0;
+    lastStateBlock.SetNull();
+    stateChangedBalances.clear();
 
     // Clear wallet state
 #ifdef ENABLE_WALLET
@@ -2012,20 +1698,25 @@ int elysium_init()
     p_feecache = new CElysiumFeeCache(GetDataDir() / "EXODUS_feecache", fReindex);
     p_feehistory = new CElysiumFeeHistory(GetDataDir() / "EXODUS_feehistory", fReindex);
 
-    MPPersistencePath = GetDataDir() / "MP_persist";
-    TryCreateDirectory(MPPersistencePath);
+    remove_legacy_state_files(GetDataDir() / "MP_persist");
+    p_statedb = new CElysiumStateDB(GetDataDir() / "MP_persist", fReindex);
+    stateSnapshotInterval = std::max(1, (int) GetArg("-elysiumsnapshotinterval", DEFAULT_STATE_SNAPSHOT_INTERVAL));
 
     txProcessor = new TxProcessor();
 
 #ifdef ENABLE_WALLET
     if (pwalletMain) {
         wallet = new Wallet(pwalletMain->strWalletFile);
+        spendJobs = new SpendJobs(std::max(1, (int) GetArg("-elysiumspendthreads", DEFAULT_ELYSIUM_SPEND_THREADS)));
 
         if (!pwalletMain->IsLocked()) {
             wallet->ReloadMasterKey();
         }
+
+        RegisterWalletCacheSignals(pwalletMain);
     } else {
         wallet = nullptr;
+        spendJobs = nullptr;
     }
 #endif
 
@@ -2102,11 +1793,25 @@ int elysium_init()
     return 0;
 }
 
+/**
+ * Global handler to stop the background work of Elysium Core.
+ *
+ * Queued spends are dropped and running ones are waited for, as they use
+ * objects which are destroyed early in the shutdown.
+ */
+void elysium_interrupt()
+{
+#ifdef ENABLE_WALLET
+    // spends use the connection manager, the chain state and the wallet, and running ones may wait for cs_main
+    if (spendJobs) spendJobs->Stop();
+#endif
+}
+
 /**
  * Global handler to shut down Elysium Core.
  *
  * In particular, the LevelDB databases of the global state objects are closed
- * properly.
+ * properly. elysium_interrupt() must have been called before.
  *
  * @return An exit code, indicating success or failure
  */
@@ -2115,6 +1820,10 @@ int elysium_shutdown()
     LOCK(cs_main);
 
 #ifdef ENABLE_WALLET
+    if (pwalletMain) {
+        UnregisterWalletCacheSignals(pwalletMain);
+    }
+    delete spendJobs; spendJobs = nullptr;
     delete wallet; wallet = nullptr;
 #endif
     delete txProcessor; txProcessor = nullptr;
@@ -2126,6 +1835,7 @@ int elysium_shutdown()
     delete p_ElysiumTXDB; p_ElysiumTXDB = nullptr;
     delete p_feecache; p_feecache = nullptr;
     delete p_feehistory; p_feehistory = nullptr;
+    delete p_statedb; p_statedb = nullptr;
 
     elysiumInitialized = 0;
 
@@ -2352,7 +2062,7 @@ void CElysiumTransactionDB::RecordTransaction(const uint256& txid, uint32_t posI
     const std::string key = txid.ToString();
     const std::string value = strprintf("%d:%d", posInBlock, processingResult);
 
-    Status status = pdb->Put(writeoptions, key, value);
+    Status status = Put(key, value);
     ++nWritten;
 }
 
@@ -2362,7 +2072,7 @@ std::vector<std::string> CElysiumTransactionDB::FetchTransactionDetails(const ui
     std::string strValue;
     std::vector<std::string> vTransactionDetails;
 
-    Status status = pdb->Get(readoptions, txid.ToString(), &strValue);
+    Status status = Get(txid.ToString(), &strValue);
     if (status.ok()) {
         std::vector<std::string> vStr;
         boost::split(vStr, strValue, boost::is_any_of(":"), boost::token_compress_on);
@@ -2699,7 +2409,7 @@ int CMPTxList::getDBVersion()
     std::string strValue;
     int verDB = 0;
 
-    Status status = pdb->Get(readoptions, "dbversion", &strValue);
+    Status status = Get("dbversion", &strValue);
     if (status.ok()) {
         verDB = boost::lexical_cast<uint64_t>(strValue);
     }
@@ -2717,7 +2427,7 @@ int CMPTxList::getDBVersion()
 int CMPTxList::setDBVersion()
 {
     std::string verStr = boost::lexical_cast<std::string>(DB_VERSION);
-    Status status = pdb->Put(writeoptions, "dbversion", verStr);
+    Status status = Put("dbversion", verStr);
 
     if (elysium_debug_txdb) PrintToLog("%s(): dbversion %s status %s, line %d, file: %s\n", __FUNCTION__, verStr, status.ToString(), __LINE__, __FILE__);
 
@@ -2730,7 +2440,7 @@ int CMPTxList::getNumberOfMetaDExCancels(const uint256 txid)
     int numberOfCancels = 0;
     std::vector<std::string> vstr;
     string strValue;
-    Status status = pdb->Get(readoptions, txid.ToString() + "-C", &strValue);
+    Status status = Get(txid.ToString() + "-C", &strValue);
     if (status.ok())
     {
         // parse the string returned
@@ -2752,7 +2462,7 @@ int CMPTxList::getNumberOfSubRecords(const uint256& txid)
     int numberOfSubRecords = 0;
 
     std::string strValue;
-    Status status = pdb->Get(readoptions, txid.ToString(), &strValue);
+    Status status = Get(txid.ToString(), &strValue);
     if (status.ok()) {
         std::vector<std::string> vstr;
         boost::split(vstr, strValue, boost::is_any_of(":"), boost::token_compress_on);
@@ -2806,7 +2516,7 @@ string CMPTxList::getKeyValue(string key)
 {
     if (!pdb) return "";
     string strValue;
-    Status status = pdb->Get(readoptions, key, &strValue);
+    Status status = Get(key, &strValue);
     if (status.ok()) { return strValue; } else { return ""; }
 }
 
@@ -2817,7 +2527,7 @@ bool CMPTxList::getSendAllDetails(const uint256& txid, int subSend, uint32_t& pr
 {
     std::string strKey = strprintf("%s-%d", txid.ToString(), subSend);
     std::string strValue;
-    leveldb::Status status = pdb->Get(readoptions, strKey, &strValue);
+    leveldb::Status status = Get(strKey, &strValue);
     if (status.ok()) {
         std::vector<std::string> vstr;
         boost::split(vstr, strValue, boost::is_any_of(":"), boost::token_compress_on);
@@ -2835,7 +2545,7 @@ bool CMPTxList::getPurchaseDetails(const uint256 txid, int purchaseNumber, strin
     if (!pdb) return 0;
     std::vector<std::string> vstr;
     string strValue;
-    Status status = pdb->Get(readoptions, txid.ToString()+"-"+to_string(purchaseNumber), &strValue);
+    Status status = Get(txid.ToString()+"-"+to_string(purchaseNumber), &strValue);
     if (status.ok())
     {
         // parse the string returned
@@ -2869,7 +2579,7 @@ void CMPTxList::recordMetaDExCancelTX(const uint256 &txidMaster, const uint256 &
        // Step 2b - If does exist add +1 to existing ref and set this ref as new number of affected
        std::vector<std::string> vstr;
        string strValue;
-       Status status = pdb->Get(readoptions, txidMasterStr, &strValue);
+       Status status = Get(txidMasterStr, &strValue);
        if (status.ok())
        {
            // parse the string returned
@@ -2889,7 +2599,7 @@ void CMPTxList::recordMetaDExCancelTX(const uint256 &txidMaster, const uint256 &
        PrintToLog("METADEXCANCELDEBUG : Writing master record %s(%s, valid=%s, block= %d, type= %d, number of affected transactions= %d)\n", __FUNCTION__, txidMaster.ToString(), fValid ? "YES":"NO", nBlock, type, refNumber);
        if (pdb)
        {
-           status = pdb->Put(writeoptions, key, value);
+           status = Put(key, value);
            PrintToLog("METADEXCANCELDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
        }
 
@@ -2901,7 +2611,7 @@ void CMPTxList::recordMetaDExCancelTX(const uint256 &txidMaster, const uint256 &
        PrintToLog("METADEXCANCELDEBUG : Writing sub-record %s with value %s\n", subKey, subValue);
        if (pdb)
        {
-           subStatus = pdb->Put(writeoptions, subKey, subValue);
+           subStatus = Put(subKey, subValue);
            PrintToLog("METADEXCANCELDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, subStatus.ToString(), __LINE__, __FILE__);
        }
 }
@@ -2914,7 +2624,7 @@ void CMPTxList::recordSendAllSubRecord(const uint256& txid, int subRecordNumber,
     std::string strKey = strprintf("%s-%d", txid.ToString(), subRecordNumber);
     std::string strValue = strprintf("%d:%d", propertyId, nValue);
 
-    leveldb::Status status = pdb->Put(writeoptions, strKey, strValue);
+    leveldb::Status status = Put(strKey, strValue);
     ++nWritten;
     if (elysium_debug_txdb) PrintToLog("%s(): store: %s=%s, status: %s\n", __func__, strKey, strValue, status.ToString());
 }
@@ -2939,7 +2649,7 @@ void CMPTxList::recordPaymentTX(const uint256 &txid, bool fValid, int nBlock, un
            //retrieve old numberOfPayments
            std::vector<std::string> vstr;
            string strValue;
-           Status status = pdb->Get(readoptions, txid.ToString(), &strValue);
+           Status status = Get(txid.ToString(), &strValue);
            if (status.ok())
            {
                // parse the string returned
@@ -2962,7 +2672,7 @@ void CMPTxList::recordPaymentTX(const uint256 &txid, bool fValid, int nBlock, un
        PrintToLog("DEXPAYDEBUG : Writing master record %s(%s, valid=%s, block= %d, type= %d, number of payments= %lu)\n", __FUNCTION__, txid.ToString(), fValid ? "YES":"NO", nBlock, type, numberOfPayments);
        if (pdb)
        {
-           status = pdb->Put(writeoptions, key, value);
+           status = Put(key, value);
            PrintToLog("DEXPAYDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
        }
 
@@ -2974,7 +2684,7 @@ void CMPTxList::recordPaymentTX(const uint256 &txid, bool fValid, int nBlock, un
        PrintToLog("DEXPAYDEBUG : Writing sub-record %s with value %s\n", subKey, subValue);
        if (pdb)
        {
-           subStatus = pdb->Put(writeoptions, subKey, subValue);
+           subStatus = Put(subKey, subValue);
            PrintToLog("DEXPAYDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, subStatus.ToString(), __LINE__, __FILE__);
        }
 }
@@ -2996,7 +2706,7 @@ Status status;
 
   if (pdb)
   {
-    status = pdb->Put(writeoptions, key, value);
+    status = Put(key, value);
     ++nWritten;
     if (elysium_debug_txdb) PrintToLog("%s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
   }
@@ -3007,7 +2717,7 @@ bool CMPTxList::exists(const uint256 &txid)
   if (!pdb) return false;
 
 string strValue;
-Status status = pdb->Get(readoptions, txid.ToString(), &strValue);
+Status status = Get(txid.ToString(), &strValue);
 
   if (!status.ok())
   {
@@ -3019,7 +2729,7 @@ Status status = pdb->Get(readoptions, txid.ToString(), &strValue);
 
 bool CMPTxList::getTX(const uint256 &txid, string &value)
 {
-Status status = pdb->Get(readoptions, txid.ToString(), &value);
+Status status = Get(txid.ToString(), &value);
 
   ++nRead;
 
@@ -3087,7 +2797,7 @@ unsigned int n_found = 0;
       {
         ++n_found;
         PrintToLog("%s() DELETING: %s=%s\n", __FUNCTION__, skey.ToString(), svalue.ToString());
-        if (bDeleteFound) pdb->Delete(writeoptions, skey);
+        if (bDeleteFound) Delete(skey);
       }
     }
   }
@@ -3220,7 +2930,7 @@ bool CMPSTOList::exists(string address)
   if (!pdb) return false;
 
   string strValue;
-  Status status = pdb->Get(readoptions, address, &strValue);
+  Status status = Get(address, &strValue);
 
   if (!status.ok())
   {
@@ -3240,7 +2950,7 @@ void CMPSTOList::recordSTOReceive(string address, const uint256 &txid, int nBloc
       //retrieve existing record
       std::vector<std::string> vstr;
       string strValue;
-      Status status = pdb->Get(readoptions, address, &strValue);
+      Status status = Get(address, &strValue);
       if (status.ok())
       {
           // add details to record
@@ -3255,7 +2965,7 @@ void CMPSTOList::recordSTOReceive(string address, const uint256 &txid, int nBloc
           Status status;
           if (pdb)
           {
-              status = pdb->Put(writeoptions, key, strValue);
+              status = Put(key, strValue);
               PrintToLog("STODBDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
           }
       }
@@ -3267,7 +2977,7 @@ void CMPSTOList::recordSTOReceive(string address, const uint256 &txid, int nBloc
       Status status;
       if (pdb)
       {
-          status = pdb->Put(writeoptions, key, value);
+          status = Put(key, value);
           PrintToLog("STODBDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
       }
   }
@@ -3322,7 +3032,7 @@ int CMPSTOList::deleteAboveBlock(int blockNum)
       }
       if (needsUpdate) { // rewrite record with existing key and new value
           ++n_found;
-          leveldb::Status status = pdb->Put(writeoptions, it->key().ToString(), newValue);
+          leveldb::Status status = Put(it->key().ToString(), newValue);
           PrintToLog("DEBUG STO - rewriting STO data after reorg\n");
           PrintToLog("STODBDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
       }
@@ -3547,7 +3257,7 @@ void CMPTradeList::recordNewTrade(const uint256& txid, const std::string& addres
 {
   if (!pdb) return;
   std::string strValue = strprintf("%s:%d:%d:%d:%d", address, propertyIdForSale, propertyIdDesired, blockNum, blockIndex);
-  Status status = pdb->Put(writeoptions, txid.ToString(), strValue);
+  Status status = Put(txid.ToString(), strValue);
   ++nWritten;
   if (elysium_debug_tradedb) PrintToLog("%s(): %s\n", __FUNCTION__, status.ToString());
 }
@@ -3560,7 +3270,7 @@ void CMPTradeList::recordMatchedTrade(const uint256 txid1, const uint256 txid2,
   Status status;
   if (pdb)
   {
-    status = pdb->Put(writeoptions, key, value);
+    status = Put(key, value);
     ++nWritten;
     if (elysium_debug_tradedb) PrintToLog("%s(): %s\n", __FUNCTION__, status.ToString());
   }
@@ -3591,7 +3301,7 @@ int CMPTradeList::deleteAboveBlock(int blockNum)
     if (block >= blockNum) {
         ++n_found;
         PrintToLog("%s() DELETING FROM TRADEDB: %s=%s\n", __FUNCTION__, skey.ToString(), svalue.ToString());
-        pdb->Delete(writeoptions, skey);
+        Delete(skey);
     }
   }
 
@@ -3698,6 +3408,36 @@ int validity = 0;
   return true;
 }
 
+/**
+ * Collects the records of the transactions of a block in one batch per database.
+ */
+static void BeginBlockBatches()
+{
+    if (p_txlistdb) p_txlistdb->BeginBatch();
+    if (t_tradelistdb) t_tradelistdb->BeginBatch();
+    if (s_stolistdb) s_stolistdb->BeginBatch();
+    if (p_ElysiumTXDB) p_ElysiumTXDB->BeginBatch();
+}
+
+/**
+ * Writes the records of the transactions of a block.
+ */
+static void CommitBlockBatches(int nBlock)
+{
+    std::vector<CDBBase*> dbs;
+    if (p_txlistdb) dbs.push_back(p_txlistdb);
+    if (t_tradelistdb) dbs.push_back(t_tradelistdb);
+    if (s_stolistdb) dbs.push_back(s_stolistdb);
+    if (p_ElysiumTXDB) dbs.push_back(p_ElysiumTXDB);
+
+    for (CDBBase* db : dbs) {
+        leveldb::Status status = db->CommitBatch();
+        if (!status.ok()) {
+            PrintToLog("%s(): failed to write the records of block %d: %s\n", __func__, nBlock, status.ToString());
+        }
+    }
+}
+
 int elysium_handler_block_begin(int nBlockPrev, CBlockIndex const * pBlockIndex)
 {
     LOCK(cs_main);
@@ -3748,6 +3488,9 @@ int elysium_handler_block_begin(int nBlockPrev, CBlockIndex const * pBlockIndex)
 
     eraseExpiredCrowdsale(pBlockIndex);
 
+    // records of the transactions of this block are written at the end of the block
+    BeginBlockBatches();
+
     return 0;
 }
 
@@ -3790,8 +3533,9 @@ int elysium_handler_block_end(int nBlockNow, CBlockIndex const * pBlockIndex,
     // check that pending transactions are still in the mempool
     PendingCheck();
 
-    // transactions were found in the block, signal the UI accordingly
-    if (countMP > 0) CheckWalletUpdate(true);
+    // fold in tally changes without Elysium transactions as well, e.g. expired accepts or evicted pending
+    // transactions, and signal a balance change to the UI if transactions were found in the block
+    CheckWalletUpdate(countMP > 0);
 
     // calculate and print a consensus hash if required
     if (ShouldConsensusHashBlock(nBlockNow)) {
@@ -3799,6 +3543,9 @@ int elysium_handler_block_end(int nBlockNow, CBlockIndex const * pBlockIndex,
         PrintToLog("Consensus hash for block %d: %s\n", nBlockNow, consensusHash.GetHex());
     }
 
+    // write the records of this block before the state which refers to them
+    CommitBlockBatches(nBlockNow);
+
     // request checkpoint verification
     bool checkpointValid = VerifyCheckpoint(nBlockNow, pBlockIndex->GetBlockHash());
     if (!checkpointValid) {
@@ -5,6 +5,7 @@ class CBlockIndex;
 class CCoinsView;
 class CCoinsViewCache;
 class CTransaction;
+struct CElysiumState;
 
 #include "log.h"
 #include "persistence.h"
@@ -35,6 +36,11 @@ using std::string;
 
 int const MAX_STATE_HISTORY = 50;
 
+//! Default number of threads reading blocks ahead during the initial scan
+int const DEFAULT_ELYSIUM_SCAN_THREADS = 4;
+//! Maximum number of blocks read ahead of the initial scan
+int const ELYSIUM_SCAN_READ_AHEAD = 64;
+
 constexpr size_t ELYSIUM_MAX_SIMPLE_MINTS = std::numeric_limits<uint8_t>::max();
 
 // increment this value to force a refresh of the state (similar to --startclean)
@@ -56,16 +62,6 @@ constexpr size_t ELYSIUM_MAX_SIMPLE_MINTS = std::numeric_limits<uint8_t>::max();
 #define ELYSIUM_PROPERTY_TYPE_INDIVISIBLE_APPENDING   129
 #define ELYSIUM_PROPERTY_TYPE_DIVISIBLE_APPENDING     130
 
-enum FILETYPES {
-  FILETYPE_BALANCES = 0,
-  FILETYPE_OFFERS,
-  FILETYPE_ACCEPTS,
-  FILETYPE_GLOBALS,
-  FILETYPE_CROWDSALES,
-  FILETYPE_MDEXORDERS,
-  NUM_FILETYPES
-};
-
 #define PKT_RETURNED_OBJECT    (1000)
 
 #define PKT_ERROR             ( -9000)
@@ -250,6 +246,9 @@ bool isElysiumEnabled();
 /** Global handler to initialize Elysium Core. */
 int elysium_init();
 
+/** Global handler to stop the background work of Elysium Core, before the node state it uses is torn down. */
+void elysium_interrupt();
+
 /** Global handler to shut down Elysium Core. */
 int elysium_shutdown();
 
@@ -269,6 +268,8 @@ int elysium_save_state( CBlockIndex const *pBlockIndex );
 namespace elysium
 {
 extern std::unordered_map<std::string, CMPTally> mp_tally_map;
+//! Holders of every property, maintained by update_tally_map()
+extern CMPHolderIndex mp_holder_index;
 extern CMPTxList *p_txlistdb;
 extern CMPTradeList *t_tradelistdb;
 extern CMPSTOList *s_stolistdb;
@@ -312,6 +313,13 @@ bool getValidMPTX(const uint256 &txid, int *block = NULL, unsigned int *type = N
 
 bool update_tally_map(const std::string& who, uint32_t propertyId, int64_t amount, TallyType ttype);
 
+/**
+ * Replaces the tally map and the holder index with the balances of a snapshot
+ * and the balance changes after it. The final amounts are written directly,
+ * frozen addresses are restored like any other.
+ */
+bool RestoreTallies(const std::vector<CElysiumState>& states);
+
 std::string getTokenLabel(uint32_t propertyId);
 
 /**
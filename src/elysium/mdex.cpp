@@ -11,6 +11,7 @@
 
 #include "arith_uint256.h"
 #include "chain.h"
+#include "saltedhasher.h"
 #include "validation.h"
 #include "tinyformat.h"
 #include "uint256.h"
@@ -30,6 +31,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <unordered_map>
 
 typedef boost::multiprecision::cpp_dec_float_100 dec_float;
 typedef boost::multiprecision::checked_int128_t int128_t;
@@ -42,6 +44,20 @@ using namespace elysium;
 //! Global map for price and order data
 md_PropertiesMap elysium::metadex;
 
+//! Open trades in the MetaDEx maps by txid, kept in sync with the maps
+static std::unordered_map<uint256, md_Set::iterator, StaticSaltedHasher> metadexTxids;
+
+/**
+ * Removes a trade from the set of its price level and from the txid index.
+ *
+ * @return Iterator to the trade following the removed one
+ */
+static md_Set::iterator MetaDEx_ERASE(md_Set& indexes, md_Set::iterator it)
+{
+    metadexTxids.erase(it->getHash());
+    return indexes.erase(it);
+}
+
 md_PricesMap* elysium::get_Prices(uint32_t prop)
 {
     md_PropertiesMap::iterator it = metadex.find(prop);
@@ -315,12 +331,13 @@ static MatchReturnType x_Trade(CMPMetaDEx* const pnew)
 
             if (elysium_debug_metadex1) PrintToLog("++ erased old: %s\n", offerIt->ToString());
             // erase the old seller element
-            pofferSet->erase(offerIt++);
+            offerIt = MetaDEx_ERASE(*pofferSet, offerIt);
 
             // insert the updated one in place of the old
             if (0 < seller_replacement.getAmountRemaining()) {
                 PrintToLog("++ inserting seller_replacement: %s\n", seller_replacement.ToString());
-                pofferSet->insert(seller_replacement);
+                std::pair<md_Set::iterator, bool> ret = pofferSet->insert(seller_replacement);
+                if (ret.second) metadexTxids[seller_replacement.getHash()] = ret.first;
             }
 
             if (bBuyerSatisfied) {
@@ -426,28 +443,6 @@ std::string CMPMetaDEx::ToString() const
         property, FormatMP(property, amount_forsale), desired_property, FormatMP(desired_property, amount_desired));
 }
 
-void CMPMetaDEx::saveOffer(std::ofstream& file, SHA256_CTX* shaCtx) const
-{
-    std::string lineOut = strprintf("%s,%d,%d,%d,%d,%d,%d,%d,%s,%d",
-        addr,
-        block,
-        amount_forsale,
-        property,
-        amount_desired,
-        desired_property,
-        subaction,
-        idx,
-        txid.ToString(),
-        amount_remaining
-    );
-
-    // add the line to the hash
-    SHA256_Update(shaCtx, lineOut.c_str(), lineOut.length());
-
-    // write the line
-    file << lineOut << std::endl;
-}
-
 bool MetaDEx_compare::operator()(const CMPMetaDEx &lhs, const CMPMetaDEx &rhs) const
 {
     if (lhs.getBlock() == rhs.getBlock()) return lhs.getIdx() < rhs.getIdx();
@@ -456,39 +451,27 @@ bool MetaDEx_compare::operator()(const CMPMetaDEx &lhs, const CMPMetaDEx &rhs) c
 
 bool elysium::MetaDEx_INSERT(const CMPMetaDEx& objMetaDEx)
 {
-    // Create an empty price map (to use in case price map for this property does not already exist)
-    md_PricesMap temp_prices;
-    // Attempt to obtain the price map for the property
-    md_PricesMap *p_prices = get_Prices(objMetaDEx.getProperty());
-
-    // Create an empty set of metadex objects (to use in case no set currently exists at this price)
-    md_Set temp_indexes;
-    md_Set *p_indexes = NULL;
-
-    // Prepare for return code
-    std::pair <md_Set::iterator, bool> ret;
-
-    // Attempt to obtain a set of metadex objects for this price from the price map
-    if (p_prices) p_indexes = get_Indexes(p_prices, objMetaDEx.unitPrice());
-    // See if the set was populated, if not no set exists at this price level, use the empty set that we created earlier
-    if (!p_indexes) p_indexes = &temp_indexes;
+    // Obtain the set of metadex objects at this price, the price map and the set are created if they don't exist yet
+    md_Set& indexes = metadex[objMetaDEx.getProperty()][objMetaDEx.unitPrice()];
 
     // Attempt to insert the metadex object into the set
-    ret = p_indexes->insert(objMetaDEx);
+    std::pair<md_Set::iterator, bool> ret = indexes.insert(objMetaDEx);
     if (false == ret.second) return false;
 
-    // If a prices map did not exist for this property, set p_prices to the temp empty price map
-    if (!p_prices) p_prices = &temp_prices;
-
-    // Update the prices map with the new set at this price
-    (*p_prices)[objMetaDEx.unitPrice()] = *p_indexes;
-
-    // Set the metadex map for the property to the updated (or new if it didn't exist) price map
-    metadex[objMetaDEx.getProperty()] = *p_prices;
+    metadexTxids[objMetaDEx.getHash()] = ret.first;
 
     return true;
 }
 
+/**
+ * Removes all trades.
+ */
+void elysium::MetaDEx_CLEAR()
+{
+    metadexTxids.clear();
+    metadex.clear();
+}
+
 // pretty much directly linked to the ADD TX21 command off the wire
 int elysium::MetaDEx_ADD(const std::string& sender_addr, uint32_t prop, int64_t amount, int block, uint32_t property_desired, int64_t amount_desired, const uint256& txid, unsigned int idx)
 {
@@ -541,12 +524,9 @@ int elysium::MetaDEx_CANCEL_AT_PRICE(const uint256& txid, unsigned int block, co
         return rc -1;
     }
 
-    // within the desired property map (given one property) iterate over the items
-    for (md_PricesMap::iterator my_it = prices->begin(); my_it != prices->end(); ++my_it) {
-        rational_t sellers_price = my_it->first;
-
-        if (mdex.unitPrice() != sellers_price) continue;
-
+    // within the desired property map (given one property) look up the items at the price
+    md_PricesMap::iterator my_it = prices->find(mdex.unitPrice());
+    if (my_it != prices->end()) {
         md_Set* indexes = &(my_it->second);
 
         for (md_Set::iterator iitt = indexes->begin(); iitt != indexes->end();) {
@@ -570,7 +550,7 @@ int elysium::MetaDEx_CANCEL_AT_PRICE(const uint256& txid, unsigned int block, co
             bool bValid = true;
             p_txlistdb->recordMetaDExCancelTX(txid, p_mdex->getHash(), bValid, block, p_mdex->getProperty(), p_mdex->getAmountRemaining());
 
-            indexes->erase(iitt++);
+            iitt = MetaDEx_ERASE(*indexes, iitt);
         }
     }
 
@@ -619,7 +599,7 @@ int elysium::MetaDEx_CANCEL_ALL_FOR_PAIR(const uint256& txid, unsigned int block
             bool bValid = true;
             p_txlistdb->recordMetaDExCancelTX(txid, p_mdex->getHash(), bValid, block, p_mdex->getProperty(), p_mdex->getAmountRemaining());
 
-            indexes->erase(iitt++);
+            iitt = MetaDEx_ERASE(*indexes, iitt);
         }
     }
 
@@ -676,7 +656,7 @@ int elysium::MetaDEx_CANCEL_EVERYTHING(const uint256& txid, unsigned int block,
                 bool bValid = true;
                 p_txlistdb->recordMetaDExCancelTX(txid, it->getHash(), bValid, block, it->getProperty(), it->getAmountRemaining());
 
-                indexes.erase(it++);
+                it = MetaDEx_ERASE(indexes, it);
             }
         }
     }
@@ -704,7 +684,9 @@ int elysium::MetaDEx_SHUTDOWN_ALLPAIR()
                     // move from reserve to balance
                     assert(update_tally_map(it->getAddr(), it->getProperty(), -it->getAmountRemaining(), METADEX_RESERVE));
                     assert(update_tally_map(it->getAddr(), it->getProperty(), it->getAmountRemaining(), BALANCE));
-                    indexes.erase(it++);
+                    it = MetaDEx_ERASE(indexes, it);
+                } else {
+                    ++it;
                 }
             }
         }
@@ -728,29 +710,21 @@ int elysium::MetaDEx_SHUTDOWN()
                 // move from reserve to balance
                 assert(update_tally_map(it->getAddr(), it->getProperty(), -it->getAmountRemaining(), METADEX_RESERVE));
                 assert(update_tally_map(it->getAddr(), it->getProperty(), it->getAmountRemaining(), BALANCE));
-                indexes.erase(it++);
+                it = MetaDEx_ERASE(indexes, it);
             }
         }
     }
     return rc;
 }
 
-// searches the metadex maps to see if a trade is still open
-// allows search to be optimized if propertyIdForSale is specified
+// looks up whether a trade is still open
+// optionally only if it is a trade for propertyIdForSale
 bool elysium::MetaDEx_isOpen(const uint256& txid, uint32_t propertyIdForSale)
 {
-    for (md_PropertiesMap::iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it) {
-        if (propertyIdForSale != 0 && propertyIdForSale != my_it->first) continue;
-        md_PricesMap & prices = my_it->second;
-        for (md_PricesMap::iterator it = prices.begin(); it != prices.end(); ++it) {
-            md_Set & indexes = (it->second);
-            for (md_Set::iterator it = indexes.begin(); it != indexes.end(); ++it) {
-                CMPMetaDEx obj = *it;
-                if( obj.getHash().GetHex() == txid.GetHex() ) return true;
-            }
-        }
-    }
-    return false;
+    std::unordered_map<uint256, md_Set::iterator, StaticSaltedHasher>::const_iterator it = metadexTxids.find(txid);
+    if (it == metadexTxids.end()) return false;
+
+    return propertyIdForSale == 0 || propertyIdForSale == it->second->getProperty();
 }
 
 /**
@@ -837,14 +811,8 @@ void elysium::MetaDEx_debug_print(bool bShowPriceLevel, bool bDisplay)
  */
 const CMPMetaDEx* elysium::MetaDEx_RetrieveTrade(const uint256& txid)
 {
-    for (md_PropertiesMap::iterator propIter = metadex.begin(); propIter != metadex.end(); ++propIter) {
-        md_PricesMap & prices = propIter->second;
-        for (md_PricesMap::iterator pricesIter = prices.begin(); pricesIter != prices.end(); ++pricesIter) {
-            md_Set & indexes = pricesIter->second;
-            for (md_Set::iterator tradesIter = indexes.begin(); tradesIter != indexes.end(); ++tradesIter) {
-                if (txid == (*tradesIter).getHash()) return &(*tradesIter);
-            }
-        }
-    }
-    return (CMPMetaDEx*) NULL;
+    std::unordered_map<uint256, md_Set::iterator, StaticSaltedHasher>::const_iterator it = metadexTxids.find(txid);
+    if (it == metadexTxids.end()) return (CMPMetaDEx*) NULL;
+
+    return &(*it->second);
 }
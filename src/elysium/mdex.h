@@ -3,6 +3,7 @@
 
 #include "elysium/tx.h"
 
+#include "serialize.h"
 #include "uint256.h"
 
 #include <boost/lexical_cast.hpp>
@@ -99,7 +100,22 @@ public:
     /** Used for display of unit prices with 50 decimal places at RPC layer. */
     std::string displayFullUnitPrice() const;
 
-    void saveOffer(std::ofstream& file, SHA256_CTX* shaCtx) const;
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(block);
+        READWRITE(txid);
+        READWRITE(idx);
+        READWRITE(property);
+        READWRITE(amount_forsale);
+        READWRITE(desired_property);
+        READWRITE(amount_desired);
+        READWRITE(amount_remaining);
+        READWRITE(subaction);
+        READWRITE(addr);
+    }
 };
 
 namespace elysium
@@ -132,6 +148,7 @@ int MetaDEx_CANCEL_EVERYTHING(const uint256& txid, uint32_t block, const std::st
 int MetaDEx_SHUTDOWN();
 int MetaDEx_SHUTDOWN_ALLPAIR();
 bool MetaDEx_INSERT(const CMPMetaDEx& objMetaDEx);
+void MetaDEx_CLEAR();
 void MetaDEx_debug_print(bool bShowPriceLevel = false, bool bDisplay = false);
 bool MetaDEx_isOpen(const uint256& txid, uint32_t propertyIdForSale = 0);
 int MetaDEx_getStatus(const uint256& txid, uint32_t propertyIdForSale, int64_t amountForSale, int64_t totalSold = -1);
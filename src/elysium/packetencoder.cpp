@@ -47,6 +47,16 @@ std::array<unsigned char, 32> PacketKeyGenerator::Next()
 
 // Functions.
 
+static bool HasMagic(const CScript& script)
+{
+    // Check if the first push is prefixed with magic bytes.
+    std::vector<std::vector<unsigned char>> pushes;
+
+    GetPushedValues(script, std::back_inserter(pushes));
+
+    return !pushes.empty() && pushes[0].size() >= magic.size() && std::equal(magic.begin(), magic.end(), pushes[0].begin());
+}
+
 const CBitcoinAddress& GetSystemAddress()
 {
     static const CBitcoinAddress mainAddress("ZzzcQkPmXomcTcSVGsDHsGBCvxg67joaj5");
@@ -83,12 +93,7 @@ boost::optional<PacketClass> DeterminePacketClass(const CTransaction& tx, int he
         } else if (type == TX_MULTISIG) {
             hasMultisig = true;
         } else if (type == TX_NULL_DATA) {
-            // Check if the first push is prefixed with magic bytes.
-            std::vector<std::vector<unsigned char>> pushes;
-
-            GetPushedValues(output.scriptPubKey, std::back_inserter(pushes));
-
-            if (!pushes.empty() && pushes[0].size() >= magic.size() && std::equal(magic.begin(), magic.end(), pushes[0].begin())) {
+            if (HasMagic(output.scriptPubKey)) {
                 hasOpReturn = true;
             }
         }
@@ -106,6 +111,37 @@ boost::optional<PacketClass> DeterminePacketClass(const CTransaction& tx, int he
     return boost::none;
 }
 
+bool MayHavePacket(const CTransaction& tx)
+{
+    auto& sysAddr = GetSystemAddress();
+    bool hasSysAddr = false;
+    bool hasMultisig = false;
+
+    for (auto& output : tx.vout) {
+        txnouttype type;
+
+        if (!GetOutputType(output.scriptPubKey, type)) {
+            continue;
+        }
+
+        if (type == TX_PUBKEYHASH) {
+            CTxDestination dest;
+
+            if (!hasSysAddr && ExtractDestination(output.scriptPubKey, dest) && CBitcoinAddress(dest) == sysAddr) {
+                hasSysAddr = true;
+            }
+        } else if (type == TX_MULTISIG) {
+            hasMultisig = true;
+        } else if (type == TX_NULL_DATA) {
+            if (HasMagic(output.scriptPubKey)) {
+                return true;
+            }
+        }
+    }
+
+    return hasSysAddr && hasMultisig;
+}
+
 } // namespace elysium
 
 namespace std {
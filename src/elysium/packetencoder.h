@@ -137,6 +137,14 @@ extern const std::array<unsigned char, 6> magic;
 const CBitcoinAddress& GetSystemAddress();
 boost::optional<PacketClass> DeterminePacketClass(const CTransaction& tx, int height);
 
+/**
+ * Checks whether a transaction has the outputs of a packet of any class, regardless of which output types are
+ * allowed at which height. DeterminePacketClass() never finds a class for transactions this returns false for.
+ *
+ * Unlike DeterminePacketClass() this doesn't depend on the consensus parameters, so it can be used off the main thread.
+ **/
+bool MayHavePacket(const CTransaction& tx);
+
 /**
  * Embedds a payload in obfuscated multisig outputs, then adds P2PKH output to system address.
  *
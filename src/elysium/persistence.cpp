@@ -26,24 +26,101 @@ leveldb::Status CDBBase::Open(const boost::filesystem::path& path, bool fWipe)
     return leveldb::DB::Open(options, path.string(), &pdb);
 }
 
+/**
+ * Reads a value, taking writes of an open batch into account.
+ */
+leveldb::Status CDBBase::Get(const leveldb::Slice& key, std::string* value) const
+{
+    if (fBatch) {
+        auto it = batchValues.find(key.ToString());
+        if (it != batchValues.end()) {
+            if (!it->second) return leveldb::Status::NotFound(key);
+            *value = *it->second;
+            return leveldb::Status::OK();
+        }
+    }
+
+    return pdb->Get(readoptions, key, value);
+}
+
+/**
+ * Writes a value, or adds it to the batch, if one is open.
+ */
+leveldb::Status CDBBase::Put(const leveldb::Slice& key, const leveldb::Slice& value)
+{
+    if (!fBatch) {
+        return pdb->Put(writeoptions, key, value);
+    }
+
+    batch.Put(key, value);
+    batchValues[key.ToString()] = value.ToString();
+    return leveldb::Status::OK();
+}
+
+/**
+ * Erases a value, or adds the removal to the batch, if one is open.
+ */
+leveldb::Status CDBBase::Delete(const leveldb::Slice& key)
+{
+    if (!fBatch) {
+        return pdb->Delete(writeoptions, key);
+    }
+
+    batch.Delete(key);
+    batchValues[key.ToString()] = boost::none;
+    return leveldb::Status::OK();
+}
+
+/**
+ * Starts collecting writes in a batch, until the batch is committed.
+ */
+void CDBBase::BeginBatch()
+{
+    fBatch = true;
+}
+
+/**
+ * Writes all collected writes atomically and closes the batch.
+ */
+leveldb::Status CDBBase::CommitBatch()
+{
+    leveldb::Status status;
+
+    if (fBatch && !batchValues.empty()) {
+        assert(pdb != NULL);
+        status = pdb->Write(writeoptions, &batch);
+        if (elysium_debug_persistence) PrintToLog("Committed %d entries: %s\n", batchValues.size(), status.ToString());
+    }
+
+    fBatch = false;
+    batch.Clear();
+    batchValues.clear();
+
+    return status;
+}
+
 /**
  * Deletes all entries of the database, and resets the counters.
  */
 void CDBBase::Clear()
 {
+    fBatch = false;
+    batch.Clear();
+    batchValues.clear();
+
     int64_t nTimeStart = GetTimeMicros();
     unsigned int n = 0;
-    leveldb::WriteBatch batch;
+    leveldb::WriteBatch deletes;
     leveldb::Iterator* it = NewIterator();
 
     for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        batch.Delete(it->key());
+        deletes.Delete(it->key());
         ++n;
     }
 
     delete it;
 
-    leveldb::Status status = pdb->Write(writeoptions, &batch);
+    leveldb::Status status = pdb->Write(writeoptions, &deletes);
     nRead = 0;
     nWritten = 0;
 
@@ -58,6 +135,10 @@ void CDBBase::Clear()
  */
 void CDBBase::Close()
 {
+    fBatch = false;
+    batch.Clear();
+    batchValues.clear();
+
     if (pdb) {
         delete pdb;
         pdb = NULL;
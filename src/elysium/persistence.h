@@ -2,12 +2,17 @@
 #define ELYSIUM_PERSISTENCE_H
 
 #include "leveldb/db.h"
+#include "leveldb/write_batch.h"
 
 #include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
 
 #include <assert.h>
 #include <stddef.h>
 
+#include <map>
+#include <string>
+
 /** Base class for LevelDB based storage.
  */
 class CDBBase
@@ -16,6 +21,15 @@ private:
     //! Options used when iterating over values of the database
     leveldb::ReadOptions iteroptions;
 
+    //! Whether writes are collected in the batch instead of being written directly
+    bool fBatch;
+
+    //! Writes collected since the batch was opened
+    leveldb::WriteBatch batch;
+
+    //! Values put into the batch, or none if erased, so reads see the pending writes
+    std::map<std::string, boost::optional<std::string>> batchValues;
+
 protected:
     //! Database options used
     leveldb::Options options;
@@ -38,7 +52,7 @@ protected:
     //! Number of entries written
     unsigned int nWritten;
 
-    CDBBase() : pdb(NULL), nRead(0), nWritten(0)
+    CDBBase() : fBatch(false), pdb(NULL), nRead(0), nWritten(0)
     {
         options.paranoid_checks = true;
         options.create_if_missing = true;
@@ -69,6 +83,34 @@ protected:
         return pdb->NewIterator(iteroptions);
     }
 
+    /**
+     * Reads a value, taking writes of an open batch into account.
+     *
+     * Iterators don't see the writes of an open batch.
+     *
+     * @param key    The key to look up
+     * @param value  The value, if found
+     * @return A Status object, indicating success or failure
+     */
+    leveldb::Status Get(const leveldb::Slice& key, std::string* value) const;
+
+    /**
+     * Writes a value, or adds it to the batch, if one is open.
+     *
+     * @param key    The key to write
+     * @param value  The value to write
+     * @return A Status object, indicating success or failure
+     */
+    leveldb::Status Put(const leveldb::Slice& key, const leveldb::Slice& value);
+
+    /**
+     * Erases a value, or adds the removal to the batch, if one is open.
+     *
+     * @param key  The key to erase
+     * @return A Status object, indicating success or failure
+     */
+    leveldb::Status Delete(const leveldb::Slice& key);
+
     /**
      * Opens or creates a LevelDB based database.
      *
@@ -89,8 +131,24 @@ protected:
 public:
     /**
      * Deletes all entries of the database, and resets the counters.
+     *
+     * An open batch is discarded.
      */
     void Clear();
+
+    /**
+     * Starts collecting writes in a batch, until the batch is committed.
+     *
+     * Nothing happens, if a batch is already open.
+     */
+    void BeginBatch();
+
+    /**
+     * Writes all collected writes atomically and closes the batch.
+     *
+     * @return A Status object, indicating success or failure
+     */
+    leveldb::Status CommitBatch();
 };
 
 
@@ -28,6 +28,7 @@
 #include "tx.h"
 #include "utilsbitcoin.h"
 #include "version.h"
+#include "walletcache.h"
 #include "wallettxs.h"
 
 #ifdef ENABLE_WALLET
@@ -218,6 +219,27 @@ bool BalanceToJSON(const std::string& address, uint32_t property, UniValue& bala
     }
 }
 
+#ifdef ENABLE_WALLET
+// Obtains the cached balance of the wallet in a property, returns false if it is empty
+static bool WalletBalanceToJSON(uint32_t propertyId, const WalletBalance& balance, UniValue& balance_obj)
+{
+    balance_obj.push_back(Pair("propertyid", (uint64_t) propertyId));
+    balance_obj.push_back(Pair("name", balance.name));
+
+    if (balance.divisible) {
+        balance_obj.push_back(Pair("balance", FormatDivisibleMP(balance.available)));
+        balance_obj.push_back(Pair("reserved", FormatDivisibleMP(balance.reserved)));
+        if (balance.frozen != 0) balance_obj.push_back(Pair("frozen", FormatDivisibleMP(balance.frozen)));
+    } else {
+        balance_obj.push_back(Pair("balance", FormatIndivisibleMP(balance.available)));
+        balance_obj.push_back(Pair("reserved", FormatIndivisibleMP(balance.reserved)));
+        if (balance.frozen != 0) balance_obj.push_back(Pair("frozen", FormatIndivisibleMP(balance.frozen)));
+    }
+
+    return balance.available != 0 || balance.reserved != 0;
+}
+#endif
+
 // Obtains details of a fee distribution
 UniValue elysium_getfeedistribution(const JSONRPCRequest& request)
 {
@@ -701,14 +723,12 @@ UniValue elysiumrpc(const JSONRPCRequest& request)
         case 3:
         {
             LOCK(cs_main);
-            uint32_t id = 0;
             // for each address display all currencies it holds
             for (std::unordered_map<std::string, CMPTally>::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
                 PrintToLog("%34s => ", my_it->first);
                 (my_it->second).print(extra2);
-                (my_it->second).init();
-                while (0 != (id = (my_it->second).next())) {
-                    PrintToLog("Id: %u=0x%X ", id, id);
+                for (CMPTally::const_iterator it = my_it->second.begin(); it != my_it->second.end(); ++it) {
+                    PrintToLog("Id: %u=0x%X ", it->first, it->first);
                 }
                 PrintToLog("\n");
             }
@@ -866,17 +886,8 @@ UniValue elysium_getallbalancesforid(const JSONRPCRequest& request)
     LOCK(cs_main);
 
     for (std::unordered_map<std::string, CMPTally>::iterator it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
-        uint32_t id = 0;
-        bool includeAddress = false;
         std::string address = it->first;
-        (it->second).init();
-        while (0 != (id = (it->second).next())) {
-            if (id == propertyId) {
-                includeAddress = true;
-                break;
-            }
-        }
-        if (!includeAddress) {
+        if (!(it->second).hasProperty(propertyId)) {
             continue; // ignore this address, has never transacted in this propertyId
         }
         UniValue balanceObj(UniValue::VOBJ);
@@ -925,10 +936,8 @@ UniValue elysium_getallbalancesforaddress(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Address not found");
     }
 
-    addressTally->init();
-
-    uint32_t propertyId = 0;
-    while (0 != (propertyId = addressTally->next())) {
+    for (CMPTally::const_iterator it = addressTally->begin(); it != addressTally->end(); ++it) {
+        uint32_t propertyId = it->first;
         UniValue balanceObj(UniValue::VOBJ);
         balanceObj.push_back(Pair("propertyid", (uint64_t) propertyId));
         bool nonEmptyBalance = BalanceToJSON(address, propertyId, balanceObj, isPropertyDivisible(propertyId));
@@ -941,6 +950,109 @@ UniValue elysium_getallbalancesforaddress(const JSONRPCRequest& request)
     return response;
 }
 
+#ifdef ENABLE_WALLET
+UniValue elysium_getwalletbalances(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw runtime_error(
+            "elysium_getwalletbalances ( includewatchonly )\n"
+            "\nReturns a list of the total token balances of the whole wallet.\n"
+            "\nBalances are cached and updated after every block and pending transaction, addresses added to the wallet are included after the next block.\n"
+            "\nArguments:\n"
+            "1. includewatchonly     (boolean, optional) include balances of watchonly addresses (default: false)\n"
+            "\nResult:\n"
+            "[                           (array of JSON objects)\n"
+            "  {\n"
+            "    \"propertyid\" : n,         (number) the property identifier\n"
+            "    \"name\" : \"name\",            (string) the name of the property\n"
+            "    \"balance\" : \"n.nnnnnnnn\",   (string) the total available balance for the token\n"
+            "    \"reserved\" : \"n.nnnnnnnn\"   (string) the total amount reserved by sell offers and accepts\n"
+            "  },\n"
+            "  ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("elysium_getwalletbalances", "")
+            + HelpExampleRpc("elysium_getwalletbalances", "")
+        );
+
+    bool includeWatchOnly = false;
+    if (request.params.size() > 0) {
+        includeWatchOnly = request.params[0].get_bool();
+    }
+
+    UniValue response(UniValue::VARR);
+
+    std::map<uint32_t, WalletBalance> balances = GetWalletBalances(includeWatchOnly);
+    for (std::map<uint32_t, WalletBalance>::const_iterator it = balances.begin(); it != balances.end(); ++it) {
+        UniValue balanceObj(UniValue::VOBJ);
+        if (WalletBalanceToJSON(it->first, it->second, balanceObj)) {
+            response.push_back(balanceObj);
+        }
+    }
+
+    return response;
+}
+
+UniValue elysium_getwalletaddressbalances(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw runtime_error(
+            "elysium_getwalletaddressbalances ( includewatchonly )\n"
+            "\nReturns a list of all token balances for every wallet address.\n"
+            "\nBalances are cached and updated after every block and pending transaction, addresses added to the wallet are included after the next block.\n"
+            "\nArguments:\n"
+            "1. includewatchonly     (boolean, optional) include balances of watchonly addresses (default: false)\n"
+            "\nResult:\n"
+            "[                           (array of JSON objects)\n"
+            "  {\n"
+            "    \"address\" : \"address\",      (string) the address linked to the following balances\n"
+            "    \"balances\" :\n"
+            "    [\n"
+            "      {\n"
+            "        \"propertyid\" : n,         (number) the property identifier\n"
+            "        \"name\" : \"name\",            (string) the name of the token\n"
+            "        \"balance\" : \"n.nnnnnnnn\",   (string) the available balance for the token\n"
+            "        \"reserved\" : \"n.nnnnnnnn\"   (string) the amount reserved by sell offers and accepts\n"
+            "      },\n"
+            "      ...\n"
+            "    ]\n"
+            "  },\n"
+            "  ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("elysium_getwalletaddressbalances", "")
+            + HelpExampleRpc("elysium_getwalletaddressbalances", "")
+        );
+
+    bool includeWatchOnly = false;
+    if (request.params.size() > 0) {
+        includeWatchOnly = request.params[0].get_bool();
+    }
+
+    UniValue response(UniValue::VARR);
+
+    std::map<std::string, std::map<uint32_t, WalletBalance>> addresses = GetWalletAddressBalances(includeWatchOnly);
+    for (std::map<std::string, std::map<uint32_t, WalletBalance>>::const_iterator it = addresses.begin(); it != addresses.end(); ++it) {
+        UniValue arrBalances(UniValue::VARR);
+        for (std::map<uint32_t, WalletBalance>::const_iterator pit = it->second.begin(); pit != it->second.end(); ++pit) {
+            UniValue balanceObj(UniValue::VOBJ);
+            if (WalletBalanceToJSON(pit->first, pit->second, balanceObj)) {
+                arrBalances.push_back(balanceObj);
+            }
+        }
+
+        if (arrBalances.size() > 0) {
+            UniValue objEntry(UniValue::VOBJ);
+            objEntry.push_back(Pair("address", it->first));
+            objEntry.push_back(Pair("balances", arrBalances));
+            response.push_back(objEntry);
+        }
+    }
+
+    return response;
+}
+#endif
+
 UniValue elysium_getproperty(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -2432,6 +2544,8 @@ static const CRPCCommand commands[] =
     { "elysium (data retrieval)", "elysium_listmints",                 &elysium_listmints,                  false },
     { "elysium (data retrieval)", "elysium_listpendingmints",          &elysium_listpendingmints,           false },
     { "elysium (data retrieval)", "elysium_getfeeshare",               &elysium_getfeeshare,                false },
+    { "elysium (data retrieval)", "elysium_getwalletbalances",         &elysium_getwalletbalances,          false },
+    { "elysium (data retrieval)", "elysium_getwalletaddressbalances",  &elysium_getwalletaddressbalances,   false },
     { "elysium (configuration)",  "elysium_setautocommit",             &elysium_setautocommit,              true  },
 #endif
     { "hidden",                   "elysiumrpc",                        &elysiumrpc,                          true  },
@@ -10,6 +10,7 @@
 #include "rules.h"
 #include "signaturebuilder.h"
 #include "sp.h"
+#include "spendjobs.h"
 #include "tx.h"
 #include "utilsbitcoin.h"
 #include "wallet.h"
@@ -1710,6 +1711,119 @@ UniValue elysium_sendmint(const JSONRPCRequest& request)
 }
 
 
+/**
+ * Generates the proof of a prepared spend, then builds the transaction (and if needed commits it).
+ *
+ * The reserved mint is marked as used on success and released on failure.
+ *
+ * @return The hex-encoded transaction hash or the raw transaction, depending on autocommit
+ */
+static std::string SendSigmaSpend(const std::string& toAddress, int64_t referenceAmount, const Wallet::SigmaSpendInput& input)
+{
+    try {
+        std::vector<unsigned char> payload;
+
+        try {
+            auto spend = Wallet::CreateSigmaSpend(input);
+            auto key = wallet->GetSigmaSignatureKey(spend.mint);
+            auto pubkey = key.GetPubKey();
+
+            SigmaV1SignatureBuilder sigBuilder(CBitcoinAddress(toAddress), referenceAmount, spend.proof);
+            auto signature = sigBuilder.Sign(key);
+
+            if (!sigBuilder.Verify(pubkey, signature)) {
+                throw JSONRPCError(RPC_WALLET_ERROR, "Fail to create valid signature to spend.");
+            }
+
+            payload = CreatePayload_SimpleSpend(
+                spend.mint.property,
+                spend.mint.denomination,
+                spend.group,
+                spend.groupSize,
+                spend.proof,
+                signature,
+                pubkey);
+
+        } catch (WalletError &e) {
+            throw JSONRPCError(RPC_WALLET_ERROR, e.what());
+        }
+
+        // request the wallet build the transaction (and if needed commit it)
+        uint256 txid;
+        std::string rawHex;
+        int result = WalletTxBuilder(
+            "",
+            toAddress,
+            "",
+            referenceAmount,
+            payload,
+            txid,
+            rawHex,
+            autoCommit,
+            InputMode::SIGMA
+        );
+
+        // check error and return the txid (or raw hex depending on autocommit)
+        if (result != 0) {
+            throw JSONRPCError(result, error_str(result));
+        }
+
+        // mark the coin as used
+        const SigmaMintId& mint = input.id;
+        wallet->SetSigmaMintUsedTransaction(mint, txid);
+
+        if (!autoCommit) {
+            return rawHex;
+        } else {
+            PendingAdd(
+                txid,
+                "Spend",
+                ELYSIUM_TYPE_SIMPLE_SPEND,
+                mint.property,
+                GetDenominationValue(mint.property, mint.denomination),
+                false,
+                toAddress);
+            return txid.GetHex();
+        }
+    } catch (...) {
+        wallet->ReleaseSigmaMint(input.id);
+        throw;
+    }
+}
+
+/**
+ * Parses and checks the arguments of a spend, then selects and reserves the mint to spend.
+ */
+static Wallet::SigmaSpendInput PrepareSigmaSpend(const JSONRPCRequest& request, std::string& toAddress, int64_t& referenceAmount)
+{
+    // obtain parameters & info
+    toAddress = ParseAddress(request.params[0]);
+    auto propertyId = ParsePropertyId(request.params[1]);
+    auto denomination = ParseSigmaDenomination(request.params[2]);
+    referenceAmount = (request.params.size() > 3) ? ParseAmount(request.params[3], true): 0;
+
+    // perform checks
+    RequireExistingProperty(propertyId);
+    RequireExistingDenomination(propertyId, denomination);
+    RequireSaneReferenceAmount(referenceAmount);
+    RequireSigmaSpendV1Feature();
+
+    // calculate reference amount
+    if (referenceAmount <= 0) {
+        CScript scriptPubKey = GetScriptForDestination(CBitcoinAddress(toAddress).Get());
+        referenceAmount = GetDustThreshold(scriptPubKey);
+    }
+
+    try {
+        bool fPadding = chainActive.Height() >= ::Params().GetConsensus().nSigmaPaddingBlock;
+        return wallet->PrepareSigmaSpendV1(propertyId, denomination, fPadding);
+    } catch (InsufficientFunds& e) {
+        throw JSONRPCError(RPC_WALLET_INSUFFICIENT_FUNDS, e.what());
+    } catch (WalletError &e) {
+        throw JSONRPCError(RPC_WALLET_ERROR, e.what());
+    }
+}
+
 UniValue elysium_sendspend(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 3 || request.params.size() > 4) {
@@ -1729,96 +1843,99 @@ UniValue elysium_sendspend(const JSONRPCRequest& request)
         );
     }
 
-    // obtain parameters & info
-    auto toAddress = ParseAddress(request.params[0]);
-    auto propertyId = ParsePropertyId(request.params[1]);
-    auto denomination = ParseSigmaDenomination(request.params[2]);
-    auto referenceAmount = (request.params.size() > 3) ? ParseAmount(request.params[3], true): 0;
-
-    // perform checks
-    RequireExistingProperty(propertyId);
-    RequireExistingDenomination(propertyId, denomination);
-    RequireSaneReferenceAmount(referenceAmount);
-    RequireSigmaSpendV1Feature();
+    std::string toAddress;
+    int64_t referenceAmount;
+    auto input = PrepareSigmaSpend(request, toAddress, referenceAmount);
 
-    // create spend
-    SigmaMintId mint;
-    std::vector<unsigned char> payload;
+    return SendSigmaSpend(toAddress, referenceAmount, input);
+}
 
-    // calculate reference amount
-    CBitcoinAddress address(toAddress);
-    if (referenceAmount <= 0) {
-        CScript scriptPubKey = GetScriptForDestination(CBitcoinAddress(address).Get());
-        referenceAmount = GetDustThreshold(scriptPubKey);
+UniValue elysium_sendspendasync(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 3 || request.params.size() > 4) {
+        throw std::runtime_error(
+            "elysium_sendspendasync \"toaddress\" propertyid denomination ( \"referenceamount\" )\n"
+            "\nCreate spend in the background.\n"
+            "\nThe mint is selected right away, the proof is generated and the transaction is created "
+            "on a worker thread. Use elysium_getspendjob to obtain the result.\n"
+            "\nArguments:\n"
+            "1. toaddress                    (string, required) the address to spend to\n"
+            "2. propertyid                   (number, required) the property to spend\n"
+            "3. denomination                 (number, required) the id of the denomination need to spend\n"
+            "4. referenceamount              (string, optional) a zcoin amount that is sent to the receiver (minimal by default)\n"
+            "\nResult:\n"
+            "n                               (number) the identifier of the job\n"
+            "\nExamples:\n"
+            + HelpExampleCli("elysium_sendspendasync", "\"3M9qvHKtgARhqcMtM5cRT9VaiDJ5PSfQGY\" 1 1")
+            + HelpExampleRpc("elysium_sendspendasync", "\"3M9qvHKtgARhqcMtM5cRT9VaiDJ5PSfQGY\", 1, 1")
+        );
     }
 
-    try {
+    if (!spendJobs) {
+        throw JSONRPCError(RPC_WALLET_ERROR, "Background spends are not available");
+    }
 
-        bool fPadding = chainActive.Height() >= ::Params().GetConsensus().nSigmaPaddingBlock;
+    std::string toAddress;
+    int64_t referenceAmount;
+    auto input = PrepareSigmaSpend(request, toAddress, referenceAmount);
 
-        auto spend = wallet->CreateSigmaSpendV1(propertyId, denomination, fPadding);
-        auto key = wallet->GetSigmaSignatureKey(spend.mint);
-        auto pubkey = key.GetPubKey();
+    uint64_t id = spendJobs->Submit([toAddress, referenceAmount, input] {
+        return SendSigmaSpend(toAddress, referenceAmount, input);
+    });
 
-        SigmaV1SignatureBuilder sigBuilder(address, referenceAmount, spend.proof);
-        auto signature = sigBuilder.Sign(key);
+    return id;
+}
 
-        if (!sigBuilder.Verify(pubkey, signature)) {
-            throw JSONRPCError(RPC_WALLET_ERROR, "Fail to create valid signature to spend.");
-        }
+UniValue elysium_getspendjob(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1) {
+        throw std::runtime_error(
+            "elysium_getspendjob jobid\n"
+            "\nReturns the state of a spend created with elysium_sendspendasync.\n"
+            "\nArguments:\n"
+            "1. jobid                        (number, required) the identifier of the job\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"jobid\" : n,                  (number) the identifier of the job\n"
+            "  \"status\" : \"status\",          (string) one of \"pending\", \"done\" or \"failed\"\n"
+            "  \"hash\" : \"hash\",              (string) the hex-encoded transaction hash, or raw transaction without autocommit (if done)\n"
+            "  \"error\" : \"message\"           (string) the reason of the failure (if failed)\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("elysium_getspendjob", "1")
+            + HelpExampleRpc("elysium_getspendjob", "1")
+        );
+    }
 
-        mint = spend.mint;
-        payload = CreatePayload_SimpleSpend(
-            mint.property,
-            mint.denomination,
-            spend.group,
-            spend.groupSize,
-            spend.proof,
-            signature,
-            pubkey);
+    int64_t id = request.params[0].get_int64();
 
-    } catch (InsufficientFunds& e) {
-        throw JSONRPCError(RPC_WALLET_INSUFFICIENT_FUNDS, e.what());
-    } catch (WalletError &e) {
-        throw JSONRPCError(RPC_WALLET_ERROR, e.what());
+    boost::optional<SpendJobs::Job> job;
+    if (spendJobs && id > 0) {
+        job = spendJobs->Get(id);
     }
 
-    // request the wallet build the transaction (and if needed commit it)
-    uint256 txid;
-    std::string rawHex;
-    int result = WalletTxBuilder(
-        "",
-        toAddress,
-        "",
-        referenceAmount,
-        payload,
-        txid,
-        rawHex,
-        autoCommit,
-        InputMode::SIGMA
-    );
-
-    // check error and return the txid (or raw hex depending on autocommit)
-    if (result != 0) {
-        throw JSONRPCError(result, error_str(result));
-    } else {
-        // mark the coin as used
-        wallet->SetSigmaMintUsedTransaction(mint, txid);
+    if (!job) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Unknown job");
+    }
 
-        if (!autoCommit) {
-            return rawHex;
-        } else {
-            PendingAdd(
-                txid,
-                "Spend",
-                ELYSIUM_TYPE_SIMPLE_SPEND,
-                propertyId,
-                GetDenominationValue(mint.property, mint.denomination),
-                false,
-                toAddress);
-            return txid.GetHex();
-        }
+    UniValue response(UniValue::VOBJ);
+    response.push_back(Pair("jobid", id));
+
+    switch (job->status) {
+    case SpendJobs::Status::Pending:
+        response.push_back(Pair("status", "pending"));
+        break;
+    case SpendJobs::Status::Done:
+        response.push_back(Pair("status", "done"));
+        response.push_back(Pair("hash", job->result));
+        break;
+    case SpendJobs::Status::Failed:
+        response.push_back(Pair("status", "failed"));
+        response.push_back(Pair("error", job->result));
+        break;
     }
+
+    return response;
 }
 
 static const CRPCCommand commands[] =
@@ -1851,6 +1968,8 @@ static const CRPCCommand commands[] =
     { "elysium (transaction creation)",  "elysium_sendcreatedenomination",    &elysium_sendcreatedenomination,     false },
     { "elysium (transaction creation)",  "elysium_sendmint",                  &elysium_sendmint,                   false },
     { "elysium (transaction creation)",  "elysium_sendspend",                 &elysium_sendspend,                  false },
+    { "elysium (transaction creation)",  "elysium_sendspendasync",            &elysium_sendspendasync,             false },
+    { "elysium (transaction creation)",  "elysium_getspendjob",               &elysium_getspendjob,                false },
 
     /* depreciated: */
     { "hidden",                          "sendrawtx_MP",                      &elysium_sendrawtx,                  false },
@@ -6,7 +6,7 @@
 #include "../validation.h"
 #include "../sync.h"
 
-#include <iterator>
+#include <memory>
 #include <vector>
 
 namespace elysium {
@@ -20,19 +20,19 @@ bool VerifySigmaSpend(
     const secp_primitives::Scalar& serial,
     bool fPadding)
 {
-    std::vector<SigmaPublicKey> anonimitySet; // Don't preallocate the vector due to it will allow attacker to crash all client.
+    std::shared_ptr<const std::vector<SigmaPublicKey>> anonimitySet;
 
     {
         LOCK(cs_main);
-        sigmaDb->GetAnonimityGroup(property, denomination, group, groupSize, std::back_inserter(anonimitySet));
+        anonimitySet = sigmaDb->GetCachedAnonimityGroup(property, denomination, group);
     }
 
-    // If the size of anonimity set is not the expected once then no need to verify the proof.
-    if (anonimitySet.size() != groupSize) {
+    // If the anonimity set doesn't have the expected number of coins then no need to verify the proof.
+    if (anonimitySet->size() < groupSize) {
         return false;
     }
 
-    return proof.Verify(serial, anonimitySet.begin(), anonimitySet.end(), fPadding);
+    return proof.Verify(serial, anonimitySet->begin(), anonimitySet->begin() + groupSize, fPadding);
 }
 
 } // namespace elysium
@@ -16,6 +16,7 @@
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -244,6 +245,7 @@ void SafeSeekToPreviousKey(leveldb::Iterator *it, const leveldb::Slice& key)
 SigmaDatabase *sigmaDb;
 
 constexpr uint16_t SigmaDatabase::MAX_GROUP_SIZE;
+constexpr size_t SigmaDatabase::MAX_CACHED_GROUPS;
 
 // Database structure
 // Index height and commitment
@@ -251,6 +253,7 @@ constexpr uint16_t SigmaDatabase::MAX_GROUP_SIZE;
 // Sequence of mint sorted following blockchain
 // 1<seq uint64>=key
 SigmaDatabase::SigmaDatabase(const boost::filesystem::path& path, bool wipe, uint16_t groupSize)
+    : cacheClock(0)
 {
     auto status = Open(path, wipe);
     if (!status.ok()) {
@@ -258,6 +261,24 @@ SigmaDatabase::SigmaDatabase(const boost::filesystem::path& path, bool wipe, uin
     }
 
     this->groupSize = InitGroupSize(groupSize);
+
+    // Keep the cached anonimity groups in sync with the database.
+    mintAddedConnection = MintAdded.connect([this] (
+        PropertyId property,
+        SigmaDenomination denomination,
+        SigmaMintGroup group,
+        SigmaMintIndex index,
+        const SigmaPublicKey& pubKey,
+        int block) {
+        OnMintAdded(property, denomination, group, index, pubKey);
+    });
+
+    mintRemovedConnection = MintRemoved.connect([this] (
+        PropertyId property,
+        SigmaDenomination denomination,
+        const SigmaPublicKey& pubKey) {
+        OnMintRemoved(property, denomination);
+    });
 }
 
 SigmaDatabase::~SigmaDatabase()
@@ -553,6 +574,90 @@ size_t SigmaDatabase::GetAnonimityGroup(
     return i;
 }
 
+std::shared_ptr<const std::vector<SigmaPublicKey>> SigmaDatabase::GetCachedAnonimityGroup(
+    uint32_t propertyId, uint8_t denomination, uint32_t groupId)
+{
+    LOCK(cacheMutex);
+
+    auto key = std::make_tuple(propertyId, denomination, groupId);
+    auto it = anonimityGroupCache.find(key);
+
+    if (it == anonimityGroupCache.end()) {
+        auto coins = std::make_shared<std::vector<SigmaPublicKey>>();
+        auto count = GetMintCount(propertyId, denomination, groupId);
+
+        coins->reserve(count);
+        GetAnonimityGroup(propertyId, denomination, groupId, count, [&coins](elysium::SigmaPublicKey& pub) {
+            coins->push_back(std::move(pub));
+        });
+
+        if (anonimityGroupCache.size() >= MAX_CACHED_GROUPS) {
+            auto lru = std::min_element(
+                anonimityGroupCache.begin(),
+                anonimityGroupCache.end(),
+                [](const std::pair<const AnonimityGroupKey, CachedAnonimityGroup>& a,
+                   const std::pair<const AnonimityGroupKey, CachedAnonimityGroup>& b) {
+                    return a.second.lastUsed < b.second.lastUsed;
+                });
+            anonimityGroupCache.erase(lru);
+        }
+
+        it = anonimityGroupCache.emplace(key, CachedAnonimityGroup{coins, 0}).first;
+    }
+
+    it->second.lastUsed = ++cacheClock;
+    return it->second.coins;
+}
+
+void SigmaDatabase::OnMintAdded(
+    PropertyId property, SigmaDenomination denomination, SigmaMintGroup group,
+    SigmaMintIndex index, const SigmaPublicKey& pubKey)
+{
+    LOCK(cacheMutex);
+
+    auto it = anonimityGroupCache.find(std::make_tuple(property, denomination, group));
+    if (it == anonimityGroupCache.end()) {
+        return;
+    }
+
+    auto& coins = it->second.coins;
+
+    if (index != coins->size() || !pubKey.IsMember()) {
+        // Not in sync with the database, read the group again on next use.
+        anonimityGroupCache.erase(it);
+        return;
+    }
+
+    if (coins.use_count() != 1) {
+        // The current set is still in use, extend a copy of it.
+        coins = std::make_shared<std::vector<SigmaPublicKey>>(*coins);
+    }
+
+    coins->push_back(pubKey);
+}
+
+void SigmaDatabase::OnMintRemoved(PropertyId property, SigmaDenomination denomination)
+{
+    LOCK(cacheMutex);
+
+    // The event is raised after the mints were deleted, so drop every cached group which has
+    // more coins than the database.
+    auto lastGroup = GetLastGroupId(property, denomination);
+    auto lastCount = GetMintCount(property, denomination, lastGroup);
+
+    auto it = anonimityGroupCache.lower_bound(std::make_tuple(property, denomination, lastGroup));
+
+    while (it != anonimityGroupCache.end() &&
+        std::get<0>(it->first) == property &&
+        std::get<1>(it->first) == denomination) {
+        if (std::get<2>(it->first) != lastGroup || it->second.coins->size() > lastCount) {
+            it = anonimityGroupCache.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
 uint32_t SigmaDatabase::GetLastGroupId(
     uint32_t propertyId,
     uint8_t denomination)
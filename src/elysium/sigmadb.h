@@ -6,6 +6,7 @@
 #include "property.h"
 #include "sigmaprimitives.h"
 
+#include "../sync.h"
 #include "../uint256.h"
 
 #include <univalue.h>
@@ -15,7 +16,10 @@
 
 #include <leveldb/slice.h>
 
+#include <map>
+#include <memory>
 #include <string>
+#include <tuple>
 #include <vector>
 
 #include <inttypes.h>
@@ -42,6 +46,11 @@ public:
      */
     static constexpr uint16_t MAX_GROUP_SIZE = 16384;
 
+    /**
+     * Maximum number of decoded anonimity groups kept in memory.
+     */
+    static constexpr size_t MAX_CACHED_GROUPS = 32;
+
 public:
     SigmaDatabase(const boost::filesystem::path& path, bool wipe, uint16_t groupSize = 0);
     ~SigmaDatabase() override;
@@ -84,6 +93,14 @@ public:
         return firstIt;
     }
 
+    /**
+     * Get all coins of the anonimity group, decoded and validated. The group is read from the
+     * database once and then kept up to date with the mints being added and removed, the
+     * returned set is shared with the cache and stays unchanged while it is being used.
+     */
+    std::shared_ptr<const std::vector<SigmaPublicKey>> GetCachedAnonimityGroup(
+        uint32_t propertyId, uint8_t denomination, uint32_t groupId);
+
     void DeleteAll(int startBlock);
 
     uint32_t GetLastGroupId(uint32_t propertyId, uint8_t denomination);
@@ -104,9 +121,29 @@ public:
 protected:
     void AddEntry(const leveldb::Slice& key, const leveldb::Slice& value, int block);
 
+private:
+    typedef std::tuple<PropertyId, SigmaDenomination, SigmaMintGroup> AnonimityGroupKey;
+
+    struct CachedAnonimityGroup
+    {
+        std::shared_ptr<std::vector<SigmaPublicKey>> coins;
+        uint64_t lastUsed;
+    };
+
+    CCriticalSection cacheMutex;
+    std::map<AnonimityGroupKey, CachedAnonimityGroup> anonimityGroupCache;
+    uint64_t cacheClock;
+
+    boost::signals2::scoped_connection mintAddedConnection;
+    boost::signals2::scoped_connection mintRemovedConnection;
+
 private:
     void RecordGroupSize(uint16_t groupSize);
 
+    void OnMintAdded(PropertyId property, SigmaDenomination denomination, SigmaMintGroup group,
+        SigmaMintIndex index, const SigmaPublicKey& pubKey);
+    void OnMintRemoved(PropertyId property, SigmaDenomination denomination);
+
     std::unique_ptr<leveldb::Iterator> NewIterator() const;
 
 protected:
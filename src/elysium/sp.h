@@ -239,7 +239,22 @@ public:
 
     std::string toString(const std::string& address) const;
     void print(const std::string& address, FILE* fp = stdout) const;
-    void saveCrowdSale(std::ofstream& file, SHA256_CTX* shaCtx, const std::string& addr) const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(propertyId);
+        READWRITE(nValue);
+        READWRITE(property_desired);
+        READWRITE(deadline);
+        READWRITE(early_bird);
+        READWRITE(percentage);
+        READWRITE(u_created);
+        READWRITE(i_created);
+        READWRITE(txFundraiserData);
+    }
 };
 
 namespace elysium {
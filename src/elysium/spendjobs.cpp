@@ -0,0 +1,90 @@
+#include "spendjobs.h"
+
+#include "log.h"
+
+#include "../util.h"
+#include "../utiltime.h"
+
+#include <univalue.h>
+
+#include <exception>
+#include <utility>
+
+namespace elysium {
+
+SpendJobs *spendJobs;
+
+SpendJobs::SpendJobs(int threads) : nextId(1)
+{
+    workerPool.resize(threads);
+    RenameThreadPool(workerPool, "zcoin-elysium-spend");
+}
+
+SpendJobs::~SpendJobs()
+{
+    Stop();
+}
+
+uint64_t SpendJobs::Submit(std::function<std::string()> task)
+{
+    uint64_t id;
+
+    {
+        LOCK(cs);
+        id = nextId++;
+        jobs[id].nCreateTime = GetTime();
+    }
+
+    workerPool.push([this, id, task](int) {
+        try {
+            Finish(id, Status::Done, task());
+        } catch (const UniValue& error) {
+            // JSON-RPC errors are thrown as objects
+            const UniValue& message = find_value(error, "message");
+            Finish(id, Status::Failed, message.isStr() ? message.get_str() : error.write());
+        } catch (const std::exception& e) {
+            Finish(id, Status::Failed, e.what());
+        } catch (...) {
+            Finish(id, Status::Failed, "unknown error");
+        }
+    });
+
+    return id;
+}
+
+boost::optional<SpendJobs::Job> SpendJobs::Get(uint64_t id) const
+{
+    LOCK(cs);
+
+    auto it = jobs.find(id);
+    if (it == jobs.end()) {
+        return boost::none;
+    }
+
+    return it->second;
+}
+
+void SpendJobs::Stop()
+{
+    workerPool.clear_queue();
+    workerPool.stop(true);
+}
+
+void SpendJobs::Finish(uint64_t id, Status status, const std::string& result)
+{
+    if (status == Status::Failed) PrintToLog("%s(): spend job %d failed: %s\n", __func__, id, result);
+
+    LOCK(cs);
+
+    Job& job = jobs[id];
+    job.status = status;
+    job.result = result;
+
+    finished.push_back(id);
+    while (finished.size() > MAX_FINISHED_SPEND_JOBS) {
+        jobs.erase(finished.front());
+        finished.pop_front();
+    }
+}
+
+} // namespace elysium
@@ -0,0 +1,82 @@
+#ifndef ELYSIUM_SPENDJOBS_H
+#define ELYSIUM_SPENDJOBS_H
+
+#include "../ctpl.h"
+#include "../sync.h"
+
+#include <boost/optional.hpp>
+
+#include <stdint.h>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+
+/** Default number of threads generating spend proofs in the background. */
+static const int DEFAULT_ELYSIUM_SPEND_THREADS = 2;
+/** Number of finished jobs which are kept until they are forgotten. */
+static const size_t MAX_FINISHED_SPEND_JOBS = 1000;
+
+namespace elysium {
+
+/** Spends which are created on a worker pool, so the RPC server isn't blocked while their proofs
+ * are generated. Every job has an identifier to poll its result with.
+ */
+class SpendJobs
+{
+public:
+    enum class Status
+    {
+        Pending,
+        Done,
+        Failed
+    };
+
+    struct Job
+    {
+        Status status;
+        //! The transaction hash or raw transaction, if done, or the error, if failed
+        std::string result;
+        int64_t nCreateTime;
+
+        Job() : status(Status::Pending), nCreateTime(0) {}
+    };
+
+public:
+    explicit SpendJobs(int threads);
+    ~SpendJobs();
+
+    /**
+     * Queues a job.
+     *
+     * @param task  Creates the spend and returns its result, throws on failure
+     * @return The identifier of the job
+     */
+    uint64_t Submit(std::function<std::string()> task);
+
+    /** Returns a job, or none if it is unknown or was forgotten. */
+    boost::optional<Job> Get(uint64_t id) const;
+
+    /** Drops the queued jobs and waits for the running ones. */
+    void Stop();
+
+private:
+    void Finish(uint64_t id, Status status, const std::string& result);
+
+private:
+    ctpl::thread_pool workerPool;
+
+    mutable CCriticalSection cs;
+    std::map<uint64_t, Job> jobs;
+    //! Finished jobs, oldest first
+    std::deque<uint64_t> finished;
+    uint64_t nextId;
+};
+
+//! Spends created in the background
+extern SpendJobs *spendJobs;
+
+} // namespace elysium
+
+#endif // ELYSIUM_SPENDJOBS_H
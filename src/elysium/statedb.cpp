@@ -0,0 +1,201 @@
+#include "elysium/statedb.h"
+
+#include "elysium/elysium.h"
+#include "elysium/log.h"
+
+#include "chain.h"
+#include "clientversion.h"
+#include "serialize.h"
+#include "streams.h"
+#include "uint256.h"
+
+#include "leveldb/db.h"
+#include "leveldb/write_batch.h"
+
+#include <boost/filesystem/path.hpp>
+
+#include <assert.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace elysium;
+
+namespace {
+
+const char SNAPSHOT_KEY_PREFIX = 's';
+const char CHANGES_KEY_PREFIX = 'c';
+
+/** Keys are ordered by height, so pruning can stop at the first state it has to keep. */
+std::string GetStateKey(char prefix, int nHeight, const uint256& hash)
+{
+    CDataStream key(SER_DISK, CLIENT_VERSION);
+    key << prefix;
+    ser_writedata32be(key, nHeight);
+    key << hash;
+    return key.str();
+}
+
+bool ParseStateKey(const leveldb::Slice& key, char& prefix, int& nHeight, uint256& hash)
+{
+    if (key.size() != 1 + sizeof(uint32_t) + hash.size()) {
+        return false;
+    }
+
+    CDataStream stream(key.data(), key.data() + key.size(), SER_DISK, CLIENT_VERSION);
+    stream >> prefix;
+    nHeight = ser_readdata32be(stream);
+    stream >> hash;
+    return true;
+}
+
+} // namespace
+
+CElysiumStateDB::CElysiumStateDB(const boost::filesystem::path& path, bool fWipe)
+{
+    leveldb::Status status = Open(path, fWipe);
+    PrintToLog("Loading state database: %s\n", status.ToString());
+}
+
+CElysiumStateDB::~CElysiumStateDB()
+{
+    if (elysium_debug_persistence) PrintToLog("CElysiumStateDB closed\n");
+}
+
+void CElysiumStateDB::WriteState(const CBlockIndex* pBlockIndex, const CElysiumState& state)
+{
+    assert(pdb);
+
+    const uint256 hash = pBlockIndex->GetBlockHash();
+    char prefix = state.fSnapshot ? SNAPSHOT_KEY_PREFIX : CHANGES_KEY_PREFIX;
+    char otherPrefix = state.fSnapshot ? CHANGES_KEY_PREFIX : SNAPSHOT_KEY_PREFIX;
+
+    CDataStream value(SER_DISK, CLIENT_VERSION);
+    value << state;
+
+    leveldb::WriteBatch batch;
+    batch.Delete(GetStateKey(otherPrefix, pBlockIndex->nHeight, hash));
+    batch.Put(GetStateKey(prefix, pBlockIndex->nHeight, hash), leveldb::Slice(value.data(), value.size()));
+
+    leveldb::Status status = pdb->Write(writeoptions, &batch);
+    if (!status.ok()) {
+        PrintToLog("%s(): failed to store state of block %s: %s\n", __func__, hash.GetHex(), status.ToString());
+        return;
+    }
+    ++nWritten;
+
+    if (elysium_debug_persistence) {
+        PrintToLog("%s(): stored %s of block %d with %d balances (%d bytes)\n", __func__,
+            state.fSnapshot ? "snapshot" : "changes", pBlockIndex->nHeight, state.balances.size(), value.size());
+    }
+}
+
+bool CElysiumStateDB::ReadState(const CBlockIndex* pBlockIndex, CElysiumState& state)
+{
+    assert(pdb);
+
+    const uint256 hash = pBlockIndex->GetBlockHash();
+    const char prefixes[] = {SNAPSHOT_KEY_PREFIX, CHANGES_KEY_PREFIX};
+
+    for (char prefix : prefixes) {
+        std::string value;
+        leveldb::Status status = pdb->Get(readoptions, GetStateKey(prefix, pBlockIndex->nHeight, hash), &value);
+        if (status.IsNotFound()) {
+            continue;
+        }
+        if (!status.ok()) {
+            PrintToLog("%s(): failed to read state of block %s: %s\n", __func__, hash.GetHex(), status.ToString());
+            return false;
+        }
+
+        try {
+            CDataStream stream(value.data(), value.data() + value.size(), SER_DISK, CLIENT_VERSION);
+            stream >> state;
+        } catch (const std::exception& e) {
+            PrintToLog("%s(): failed to deserialize state of block %s: %s\n", __func__, hash.GetHex(), e.what());
+            return false;
+        }
+
+        ++nRead;
+        return true;
+    }
+
+    return false;
+}
+
+bool CElysiumStateDB::ReadStates(const CBlockIndex* pBlockIndex, std::vector<CElysiumState>& states)
+{
+    states.clear();
+
+    for (const CBlockIndex* pindex = pBlockIndex; pindex != NULL; pindex = pindex->pprev) {
+        CElysiumState state;
+        if (!ReadState(pindex, state)) {
+            break;
+        }
+
+        bool fSnapshot = state.fSnapshot;
+        states.push_back(std::move(state));
+
+        if (fSnapshot) {
+            std::reverse(states.begin(), states.end());
+            return true;
+        }
+    }
+
+    states.clear();
+    return false;
+}
+
+void CElysiumStateDB::Prune(const CBlockIndex* pTip)
+{
+    assert(pdb);
+
+    // the state of the oldest block to keep is rebuilt from the most recent snapshot
+    // at or before it, everything older than that snapshot can go
+    const int nKeepHeight = pTip->nHeight - MAX_STATE_HISTORY;
+    int nSnapshotHeight = -1;
+
+    leveldb::Iterator* it = NewIterator();
+    for (it->Seek(std::string(1, SNAPSHOT_KEY_PREFIX)); it->Valid(); it->Next()) {
+        char prefix;
+        int nHeight;
+        uint256 hash;
+        if (!ParseStateKey(it->key(), prefix, nHeight, hash) || prefix != SNAPSHOT_KEY_PREFIX) break;
+        if (nHeight > nKeepHeight) break;
+
+        const CBlockIndex* pindex = pTip->GetAncestor(nHeight);
+        if (pindex != NULL && pindex->GetBlockHash() == hash) {
+            nSnapshotHeight = nHeight;
+        }
+    }
+
+    leveldb::WriteBatch batch;
+    unsigned int n = 0;
+    const char prefixes[] = {SNAPSHOT_KEY_PREFIX, CHANGES_KEY_PREFIX};
+
+    for (char prefix : prefixes) {
+        for (it->Seek(std::string(1, prefix)); it->Valid(); it->Next()) {
+            char keyPrefix;
+            int nHeight;
+            uint256 hash;
+            if (!ParseStateKey(it->key(), keyPrefix, nHeight, hash) || keyPrefix != prefix) break;
+            if (nHeight >= nSnapshotHeight) break;
+
+            batch.Delete(it->key());
+            ++n;
+        }
+    }
+    delete it;
+
+    if (n > 0) {
+        leveldb::Status status = pdb->Write(writeoptions, &batch);
+        if (elysium_debug_persistence) PrintToLog("%s(): removed %d states older than block %d: %s\n", __func__, n, nSnapshotHeight, status.ToString());
+    }
+}
+
+void CElysiumStateDB::printStats()
+{
+    PrintToLog("CElysiumStateDB stats: nWritten= %d , nRead= %d\n", nWritten, nRead);
+}
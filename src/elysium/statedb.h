@@ -0,0 +1,141 @@
+#ifndef ELYSIUM_STATEDB_H
+#define ELYSIUM_STATEDB_H
+
+#include "elysium/dex.h"
+#include "elysium/mdex.h"
+#include "elysium/persistence.h"
+#include "elysium/sp.h"
+
+#include "serialize.h"
+
+#include <boost/filesystem/path.hpp>
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+class CBlockIndex;
+
+/** Default number of blocks between two full snapshots of the state. */
+static const int DEFAULT_STATE_SNAPSHOT_INTERVAL = 50;
+
+/** Balances of one address in one property.
+ */
+struct CElysiumStateBalance
+{
+    std::string address;
+    uint32_t propertyId;
+    int64_t balance;
+    int64_t sellReserved;
+    int64_t acceptReserved;
+    int64_t metadexReserved;
+
+    CElysiumStateBalance() : propertyId(0), balance(0), sellReserved(0), acceptReserved(0), metadexReserved(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(address);
+        READWRITE(propertyId);
+        READWRITE(balance);
+        READWRITE(sellReserved);
+        READWRITE(acceptReserved);
+        READWRITE(metadexReserved);
+    }
+};
+
+/** The persisted state as of a block.
+ *
+ * A snapshot holds all balances, the state of any other block only holds the
+ * balances which changed since the state of its previous block. Offers,
+ * accepts, crowdsales, trades and the globals are small and always complete.
+ */
+struct CElysiumState
+{
+    bool fSnapshot;
+    std::vector<CElysiumStateBalance> balances;
+    int64_t elysiumPrev;
+    uint32_t nextSPID;
+    uint32_t nextTestSPID;
+    elysium::OfferMap offers;
+    elysium::AcceptMap accepts;
+    elysium::CrowdMap crowds;
+    std::vector<CMPMetaDEx> trades;
+
+    CElysiumState() : fSnapshot(false), elysiumPrev(0), nextSPID(0), nextTestSPID(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(fSnapshot);
+        READWRITE(balances);
+        READWRITE(elysiumPrev);
+        READWRITE(nextSPID);
+        READWRITE(nextTestSPID);
+        READWRITE(offers);
+        READWRITE(accepts);
+        READWRITE(crowds);
+        READWRITE(trades);
+    }
+};
+
+/** LevelDB based storage of the state snapshots and the balance changes of
+ * the blocks in between.
+ */
+class CElysiumStateDB : public CDBBase
+{
+public:
+    CElysiumStateDB(const boost::filesystem::path& path, bool fWipe);
+    virtual ~CElysiumStateDB();
+
+    /**
+     * Stores the state as of a block, replacing any state stored for it.
+     *
+     * @param pBlockIndex  The block
+     * @param state        The state after the block
+     */
+    void WriteState(const CBlockIndex* pBlockIndex, const CElysiumState& state);
+
+    /**
+     * Reads the state stored for a block.
+     *
+     * @param pBlockIndex  The block
+     * @param state        The state after the block
+     * @return True, if a state was stored for the block
+     */
+    bool ReadState(const CBlockIndex* pBlockIndex, CElysiumState& state);
+
+    /**
+     * Reads the states to apply to rebuild the state as of a block, starting
+     * with the most recent snapshot among the ancestors of the block.
+     *
+     * @param pBlockIndex  The block
+     * @param states       The states, oldest first
+     * @return True, if all states down to a snapshot are available
+     */
+    bool ReadStates(const CBlockIndex* pBlockIndex, std::vector<CElysiumState>& states);
+
+    /**
+     * Removes the states which are not needed to rebuild the state of the
+     * last MAX_STATE_HISTORY blocks.
+     *
+     * @param pTip  The most recent block with a stored state
+     */
+    void Prune(const CBlockIndex* pTip);
+
+    /** Prints statistics of the database. */
+    void printStats();
+};
+
+namespace elysium
+{
+//! LevelDB based storage of the state
+extern CElysiumStateDB* p_statedb;
+}
+
+#endif // ELYSIUM_STATEDB_H
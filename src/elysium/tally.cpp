@@ -4,44 +4,69 @@
 #include "elysium/elysium.h"
 
 #include <stdint.h>
+#include <algorithm>
 #include <map>
+#include <string>
+
+/**
+ * Orders balance records by property identifier.
+ */
+static bool ComparePropertyId(const std::pair<uint32_t, CMPTally::BalanceRecord>& record, uint32_t propertyId)
+{
+    return record.first < propertyId;
+}
 
 /**
  * Creates an empty tally.
  */
 CMPTally::CMPTally()
 {
-    my_it = mp_token.begin();
 }
 
 /**
- * Resets the internal iterator.
+ * Returns the balance record of a token.
  *
- * @return Identifier of the first tally element.
+ * @param propertyId  The identifier of the tally to lookup
+ * @return Iterator to the balance record, or end(), if there is none
  */
-uint32_t CMPTally::init()
+CMPTally::const_iterator CMPTally::find(uint32_t propertyId) const
 {
-    uint32_t propertyId = 0;
-    my_it = mp_token.begin();
-    if (my_it != mp_token.end()) {
-        propertyId = my_it->first;
+    const_iterator it = std::lower_bound(mp_token.begin(), mp_token.end(), propertyId, ComparePropertyId);
+    if (it != mp_token.end() && it->first == propertyId) {
+        return it;
     }
-    return propertyId;
+    return mp_token.end();
 }
 
 /**
- * Advances the internal iterator.
+ * Returns an iterator to the first balance record which consensus relevant loops must visit.
  *
- * @return Identifier of the tally element before the update.
+ * The former init()/next() iteration ended at a record for property 0. The records are sorted, so such a
+ * record comes first and hides all others. Loops which affect the consensus state, or its hash, must iterate
+ * from here to end() to preserve this.
+ *
+ * @return Iterator to the first balance record, or end(), if there is a record for property 0
  */
-uint32_t CMPTally::next()
+CMPTally::const_iterator CMPTally::consensusBegin() const
 {
-    uint32_t ret = 0;
-    if (my_it != mp_token.end()) {
-        ret = my_it->first;
-        ++my_it;
+    if (!mp_token.empty() && mp_token.front().first == 0) {
+        return mp_token.end();
     }
-    return ret;
+    return mp_token.begin();
+}
+
+/**
+ * Checks whether there is a balance record for the given token.
+ *
+ * A record is kept, once the token was ever credited to or debited from the
+ * entity, even if all balances are zero.
+ *
+ * @param propertyId  The identifier of the tally to lookup
+ * @return True, if there is a balance record
+ */
+bool CMPTally::hasProperty(uint32_t propertyId) const
+{
+    return find(propertyId) != mp_token.end();
 }
 
 /**
@@ -73,7 +98,13 @@ bool CMPTally::updateMoney(uint32_t propertyId, int64_t amount, TallyType ttype)
         return false;
     }
     bool fUpdated = false;
-    int64_t now64 = mp_token[propertyId].balance[ttype];
+
+    TokenVector::iterator it = std::lower_bound(mp_token.begin(), mp_token.end(), propertyId, ComparePropertyId);
+    if (it == mp_token.end() || it->first != propertyId) {
+        BalanceRecord record = {};
+        it = mp_token.insert(it, std::make_pair(propertyId, record));
+    }
+    int64_t now64 = it->second.balance[ttype];
 
     if (isOverflow(now64, amount)) {
         PrintToLog("%s(): ERROR: arithmetic overflow [%d + %d]\n", __func__, now64, amount);
@@ -86,7 +117,7 @@ bool CMPTally::updateMoney(uint32_t propertyId, int64_t amount, TallyType ttype)
     } else {
 
         now64 += amount;
-        mp_token[propertyId].balance[ttype] = now64;
+        it->second.balance[ttype] = now64;
 
         fUpdated = true;
     }
@@ -107,7 +138,7 @@ int64_t CMPTally::getMoney(uint32_t propertyId, TallyType ttype) const
         return 0;
     }
     int64_t money = 0;
-    TokenMap::const_iterator it = mp_token.find(propertyId);
+    const_iterator it = find(propertyId);
 
     if (it != mp_token.end()) {
         const BalanceRecord& record = it->second;
@@ -128,7 +159,7 @@ int64_t CMPTally::getMoney(uint32_t propertyId, TallyType ttype) const
  */
 int64_t CMPTally::getMoneyAvailable(uint32_t propertyId) const
 {
-    TokenMap::const_iterator it = mp_token.find(propertyId);
+    const_iterator it = find(propertyId);
 
     if (it != mp_token.end()) {
         const BalanceRecord& record = it->second;
@@ -154,7 +185,7 @@ int64_t CMPTally::getMoneyAvailable(uint32_t propertyId) const
 int64_t CMPTally::getMoneyReserved(uint32_t propertyId) const
 {
     int64_t money = 0;
-    TokenMap::const_iterator it = mp_token.find(propertyId);
+    const_iterator it = find(propertyId);
 
     if (it != mp_token.end()) {
         const BalanceRecord& record = it->second;
@@ -177,8 +208,8 @@ bool CMPTally::operator==(const CMPTally& rhs) const
     if (mp_token.size() != rhs.mp_token.size()) {
         return false;
     }
-    TokenMap::const_iterator pc1 = mp_token.begin();
-    TokenMap::const_iterator pc2 = rhs.mp_token.begin();
+    const_iterator pc1 = mp_token.begin();
+    const_iterator pc2 = rhs.mp_token.begin();
 
     for (unsigned int i = 0; i < mp_token.size(); ++i) {
         if (pc1->first != pc2->first) {
@@ -228,7 +259,7 @@ int64_t CMPTally::print(uint32_t propertyId, bool bDivisible) const
     int64_t pending = 0;
     int64_t metadex_reserve = 0;
 
-    TokenMap::const_iterator it = mp_token.find(propertyId);
+    const_iterator it = find(propertyId);
 
     if (it != mp_token.end()) {
         const BalanceRecord& record = it->second;
@@ -251,3 +282,79 @@ int64_t CMPTally::print(uint32_t propertyId, bool bDivisible) const
 
     return (balance + selloffer_reserve + accept_reserve + metadex_reserve);
 }
+
+/**
+ * Creates an empty holder record.
+ */
+CMPHolders::CMPHolders()
+{
+    for (int ttype = 0; ttype < TALLY_TYPE_COUNT; ++ttype) {
+        totals[ttype] = 0;
+    }
+}
+
+/**
+ * Returns the total number of tokens, excluding pending amounts.
+ *
+ * @return The total number of tokens
+ */
+int64_t CMPHolders::getTotalTokens() const
+{
+    return totals[BALANCE] + totals[SELLOFFER_RESERVE] + totals[ACCEPT_RESERVE] + totals[METADEX_RESERVE];
+}
+
+/**
+ * Records a successful balance update of an address.
+ *
+ * Pending amounts are part of the totals, but don't make an address a holder.
+ *
+ * @param address     The address whose balance was updated
+ * @param propertyId  The identifier of the updated property
+ * @param amount      The amount which was added
+ * @param ttype       The tally type
+ */
+void CMPHolderIndex::update(const std::string& address, uint32_t propertyId, int64_t amount, TallyType ttype)
+{
+    if (TALLY_TYPE_COUNT <= ttype || amount == 0) {
+        return;
+    }
+
+    CMPHolders& holders = properties[propertyId];
+    holders.totals[ttype] += amount;
+
+    if (PENDING == ttype) {
+        return;
+    }
+
+    std::map<std::string, int64_t>::iterator it = holders.addresses.find(address);
+    if (it == holders.addresses.end()) {
+        holders.addresses.insert(std::make_pair(address, amount));
+    } else if (0 == (it->second += amount)) {
+        holders.addresses.erase(it);
+    }
+}
+
+/**
+ * Returns the holders of a property.
+ *
+ * @param propertyId  The identifier of the property
+ * @return The holders, or NULL, if the property never had any balance
+ */
+const CMPHolders* CMPHolderIndex::get(uint32_t propertyId) const
+{
+    std::unordered_map<uint32_t, CMPHolders>::const_iterator it = properties.find(propertyId);
+
+    if (it != properties.end()) {
+        return &(it->second);
+    }
+
+    return NULL;
+}
+
+/**
+ * Removes all entries.
+ */
+void CMPHolderIndex::clear()
+{
+    properties.clear();
+}
@@ -3,6 +3,10 @@
 
 #include <stdint.h>
 #include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 //! Balance record types
 enum TallyType {
@@ -15,30 +19,45 @@ enum TallyType {
 };
 
 /** Balance records of a single entity.
+ *
+ * Most entities hold only a few tokens, so the records are kept in a vector
+ * sorted by property identifier rather than in a map.
  */
 class CMPTally
 {
-private:
-    typedef struct {
+public:
+    //! Balances of one token per tally type
+    struct BalanceRecord
+    {
         int64_t balance[TALLY_TYPE_COUNT];
-    } BalanceRecord;
+    };
+
+    //! Vector of balance records, sorted by property identifier
+    typedef std::vector<std::pair<uint32_t, BalanceRecord> > TokenVector;
+    typedef TokenVector::const_iterator const_iterator;
 
-    //! Map of balance records
-    typedef std::map<uint32_t, BalanceRecord> TokenMap;
+private:
     //! Balance records for different tokens
-    TokenMap mp_token;
-    //! Internal iterator pointing to a balance record
-    TokenMap::iterator my_it;
+    TokenVector mp_token;
+
+    /** Returns the balance record of a token, or end(), if there is none. */
+    const_iterator find(uint32_t propertyId) const;
 
 public:
     /** Creates an empty tally. */
     CMPTally();
 
-    /** Resets the internal iterator. */
-    uint32_t init();
+    /** Returns an iterator to the first balance record, in order of the property identifiers. */
+    const_iterator begin() const { return mp_token.begin(); }
+
+    /** Returns an iterator past the last balance record. */
+    const_iterator end() const { return mp_token.end(); }
 
-    /** Advances the internal iterator. */
-    uint32_t next();
+    /** Returns an iterator to the first balance record which consensus relevant loops must visit. */
+    const_iterator consensusBegin() const;
+
+    /** Checks whether there is a balance record for the given token. */
+    bool hasProperty(uint32_t propertyId) const;
 
     /** Updates the number of tokens for the given tally type. */
     bool updateMoney(uint32_t propertyId, int64_t amount, TallyType ttype);
@@ -62,5 +81,40 @@ public:
     int64_t print(uint32_t propertyId = 1, bool bDivisible = true) const;
 };
 
+/** Holders of a single property and the total number of tokens per tally type.
+ */
+struct CMPHolders
+{
+    //! Addresses with tokens, excluding pending amounts, and their number of tokens
+    std::map<std::string, int64_t> addresses;
+    //! Total number of tokens per tally type
+    int64_t totals[TALLY_TYPE_COUNT];
+
+    /** Creates an empty holder record. */
+    CMPHolders();
+
+    /** Returns the total number of tokens, excluding pending amounts. */
+    int64_t getTotalTokens() const;
+};
+
+/** Index of the holders of every property, maintained alongside the tally map.
+ */
+class CMPHolderIndex
+{
+private:
+    //! Holders per property identifier
+    std::unordered_map<uint32_t, CMPHolders> properties;
+
+public:
+    /** Records a successful balance update of an address. */
+    void update(const std::string& address, uint32_t propertyId, int64_t amount, TallyType ttype);
+
+    /** Returns the holders of a property, or NULL, if there were never any. */
+    const CMPHolders* get(uint32_t propertyId) const;
+
+    /** Removes all entries. */
+    void clear();
+};
+
 
 #endif // ELYSIUM_TALLY_H
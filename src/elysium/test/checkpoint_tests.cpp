@@ -14,8 +14,11 @@
 #include <boost/test/unit_test.hpp>
 
 #include <stdint.h>
+#include <map>
 #include <string>
 
+#include <openssl/sha.h>
+
 namespace elysium
 {
 extern std::string GenerateConsensusString(const CMPTally& tallyObj, const std::string& address, const uint32_t propertyId); // done
@@ -98,4 +101,64 @@ BOOST_AUTO_TEST_CASE(consensus_string_property_issuer)
             GenerateConsensusString(5, "3CwZ7FiQ4MqBenRdCkjjc41M5bnoKQGC2b"));
 }
 
+static uint256 GetBalancesHashFromScratch(uint32_t propertyId)
+{
+    std::map<std::string, CMPTally> tallyMapSorted(mp_tally_map.begin(), mp_tally_map.end());
+
+    SHA256_CTX shaCtx;
+    SHA256_Init(&shaCtx);
+    for (auto& entry : tallyMapSorted) {
+        std::string dataStr = GenerateConsensusString(entry.second, entry.first, propertyId);
+        SHA256_Update(&shaCtx, dataStr.c_str(), dataStr.length());
+    }
+
+    uint256 hash;
+    SHA256_Final((unsigned char*)&hash, &shaCtx);
+    return hash;
+}
+
+BOOST_AUTO_TEST_CASE(balances_hash_follows_tally_changes)
+{
+    LOCK(cs_main);
+
+    for (int i = 0; i < 3000; i++) {
+        BOOST_CHECK(update_tally_map(strprintf("address%d", i), 3, i + 1, BALANCE));
+    }
+    BOOST_CHECK(GetBalancesHashFromScratch(3) == GetBalancesHash(3));
+
+    BOOST_CHECK(update_tally_map("address2500", 3, -2501, BALANCE));
+    BOOST_CHECK(update_tally_map("address1200", 3, 100, SELLOFFER_RESERVE));
+    BOOST_CHECK(update_tally_map("address0", 4, 5, BALANCE));
+    BOOST_CHECK(update_tally_map("address9999", 3, 5, BALANCE));
+    BOOST_CHECK(GetBalancesHashFromScratch(3) == GetBalancesHash(3));
+    BOOST_CHECK(GetBalancesHashFromScratch(4) == GetBalancesHash(4));
+
+    // Pending amounts are not part of the hash
+    uint256 hash = GetBalancesHash(3);
+    BOOST_CHECK(update_tally_map("address1", 3, -1, PENDING));
+    BOOST_CHECK(hash == GetBalancesHash(3));
+
+    mp_tally_map.clear();
+    ClearConsensusHashCache();
+    BOOST_CHECK(GetBalancesHashFromScratch(3) == GetBalancesHash(3));
+}
+
+BOOST_AUTO_TEST_CASE(balances_hash_skips_property_zero_holders)
+{
+    LOCK(cs_main);
+
+    BOOST_CHECK(update_tally_map("address1", 3, 5, BALANCE));
+    uint256 hash = GetBalancesHash(3);
+
+    // A record for property 0 sorts first and hides all balances of its address
+    BOOST_CHECK(update_tally_map("address0", 3, 7, BALANCE));
+    BOOST_CHECK(hash != GetBalancesHash(3));
+    BOOST_CHECK(update_tally_map("address0", 0, 1, BALANCE));
+    BOOST_CHECK(mp_tally_map["address0"].begin()->first == 0);
+    BOOST_CHECK(hash == GetBalancesHash(3));
+
+    mp_tally_map.clear();
+    ClearConsensusHashCache();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -26,6 +26,7 @@ BOOST_AUTO_TEST_CASE(class_no_marker)
         CTransaction tx(mutableTx);
 
         BOOST_CHECK_EQUAL(DeterminePacketClass(tx, nBlock), boost::none);
+        BOOST_CHECK(!MayHavePacket(tx));
     }
     {
         int nBlock = 0;
@@ -41,6 +42,7 @@ BOOST_AUTO_TEST_CASE(class_no_marker)
 
         CTransaction tx(mutableTx);
         BOOST_CHECK_EQUAL(DeterminePacketClass(tx, nBlock), boost::none);
+        BOOST_CHECK(!MayHavePacket(tx));
     }
     {
         int nBlock = std::numeric_limits<int>::max();
@@ -56,6 +58,7 @@ BOOST_AUTO_TEST_CASE(class_no_marker)
 
         CTransaction tx(mutableTx);
         BOOST_CHECK_EQUAL(DeterminePacketClass(tx, nBlock), boost::none);
+        BOOST_CHECK(!MayHavePacket(tx));
     }
     {
         int nBlock = std::numeric_limits<int>::max();
@@ -73,6 +76,7 @@ BOOST_AUTO_TEST_CASE(class_no_marker)
 
         CTransaction tx(mutableTx);
         BOOST_CHECK_EQUAL(DeterminePacketClass(tx, nBlock), boost::none);
+        BOOST_CHECK(!MayHavePacket(tx));
     }
 }
 
@@ -87,6 +91,7 @@ BOOST_AUTO_TEST_CASE(class_class_b)
 
         CTransaction tx(mutableTx);
         BOOST_CHECK_EQUAL(DeterminePacketClass(tx, nBlock), PacketClass::B);
+        BOOST_CHECK(MayHavePacket(tx));
     }
     {
         int nBlock = ConsensusParams().NULLDATA_BLOCK;
@@ -100,6 +105,7 @@ BOOST_AUTO_TEST_CASE(class_class_b)
 
         CTransaction tx(mutableTx);
         BOOST_CHECK_EQUAL(DeterminePacketClass(tx, nBlock), PacketClass::B);
+        BOOST_CHECK(MayHavePacket(tx));
     }
     {
         int nBlock = 0;
@@ -118,6 +124,7 @@ BOOST_AUTO_TEST_CASE(class_class_b)
 
         CTransaction tx(mutableTx);
         BOOST_CHECK_EQUAL(DeterminePacketClass(tx, nBlock), PacketClass::B);
+        BOOST_CHECK(MayHavePacket(tx));
     }
     {
         int nBlock = std::numeric_limits<int>::max();
@@ -135,6 +142,7 @@ BOOST_AUTO_TEST_CASE(class_class_b)
 
         CTransaction tx(mutableTx);
         BOOST_CHECK_EQUAL(DeterminePacketClass(tx, nBlock), PacketClass::B);
+        BOOST_CHECK(MayHavePacket(tx));
     }
 }
 
@@ -148,6 +156,7 @@ BOOST_AUTO_TEST_CASE(class_class_c)
 
         CTransaction tx(mutableTx);
         BOOST_CHECK_EQUAL(DeterminePacketClass(tx, nBlock), PacketClass::C);
+        BOOST_CHECK(MayHavePacket(tx));
     }
     {
         int nBlock = std::numeric_limits<int>::max();
@@ -159,6 +168,7 @@ BOOST_AUTO_TEST_CASE(class_class_c)
 
         CTransaction tx(mutableTx);
         BOOST_CHECK_EQUAL(DeterminePacketClass(tx, nBlock), PacketClass::C);
+        BOOST_CHECK(MayHavePacket(tx));
     }
     {
         int nBlock = std::numeric_limits<int>::max();
@@ -175,6 +185,7 @@ BOOST_AUTO_TEST_CASE(class_class_c)
 
         CTransaction tx(mutableTx);
         BOOST_CHECK_EQUAL(DeterminePacketClass(tx, nBlock), PacketClass::C);
+        BOOST_CHECK(MayHavePacket(tx));
     }
     {
         int nBlock = ConsensusParams().NULLDATA_BLOCK;
@@ -193,6 +204,7 @@ BOOST_AUTO_TEST_CASE(class_class_c)
 
         CTransaction tx(mutableTx);
         BOOST_CHECK_EQUAL(DeterminePacketClass(tx, nBlock), PacketClass::C);
+        BOOST_CHECK(MayHavePacket(tx));
     }
     {
         int nBlock = std::numeric_limits<int>::max();
@@ -209,6 +221,7 @@ BOOST_AUTO_TEST_CASE(class_class_c)
 
         CTransaction tx(mutableTx);
         BOOST_CHECK_EQUAL(DeterminePacketClass(tx, nBlock), PacketClass::C);
+        BOOST_CHECK(MayHavePacket(tx));
     }
     {
         int nBlock = ConsensusParams().NULLDATA_BLOCK;
@@ -227,6 +240,7 @@ BOOST_AUTO_TEST_CASE(class_class_c)
 
         CTransaction tx(mutableTx);
         BOOST_CHECK_EQUAL(DeterminePacketClass(tx, nBlock), PacketClass::C);
+        BOOST_CHECK(MayHavePacket(tx));
     }
 }
 
@@ -0,0 +1,42 @@
+#include "elysium/mdex.h"
+
+#include "test/test_bitcoin.h"
+#include "uint256.h"
+
+#include <stdint.h>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace elysium;
+
+BOOST_FIXTURE_TEST_SUITE(elysium_mdex_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(open_trades_by_txid)
+{
+    MetaDEx_CLEAR();
+
+    uint256 txid1 = uint256S("1");
+    uint256 txid2 = uint256S("2");
+    CMPMetaDEx trade1("a", 1, 3, 100, 4, 200, txid1, 1, CMPTransaction::ADD);
+    CMPMetaDEx trade2("b", 1, 3, 100, 4, 200, txid2, 2, CMPTransaction::ADD);
+
+    BOOST_CHECK(MetaDEx_INSERT(trade1));
+    BOOST_CHECK(!MetaDEx_INSERT(trade1));
+    BOOST_CHECK(MetaDEx_INSERT(trade2));
+
+    BOOST_CHECK(MetaDEx_isOpen(txid1));
+    BOOST_CHECK(MetaDEx_isOpen(txid1, 3));
+    BOOST_CHECK(!MetaDEx_isOpen(txid1, 4));
+    BOOST_CHECK(!MetaDEx_isOpen(uint256S("3")));
+
+    const CMPMetaDEx* trade = MetaDEx_RetrieveTrade(txid2);
+    BOOST_REQUIRE(trade != NULL);
+    BOOST_CHECK_EQUAL(trade->getAddr(), "b");
+    BOOST_CHECK(MetaDEx_RetrieveTrade(uint256S("3")) == NULL);
+
+    MetaDEx_CLEAR();
+    BOOST_CHECK(!MetaDEx_isOpen(txid1));
+    BOOST_CHECK(MetaDEx_RetrieveTrade(txid2) == NULL);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
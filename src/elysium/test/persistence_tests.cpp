@@ -0,0 +1,67 @@
+#include "elysium/persistence.h"
+
+#include "elysium/elysium.h"
+
+#include "arith_uint256.h"
+#include "uint256.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+
+BOOST_FIXTURE_TEST_SUITE(elysium_persistence_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(batch_reads_pending_writes)
+{
+    std::unique_ptr<CMPTxList> db(new CMPTxList(pathTemp / "MP_txlist_test", true));
+    uint256 txidMaster = ArithToUint256(arith_uint256(1));
+    uint256 txidSub = ArithToUint256(arith_uint256(2));
+
+    db->BeginBatch();
+    db->recordMetaDExCancelTX(txidMaster, txidSub, true, 100, 3, 1000);
+    db->recordMetaDExCancelTX(txidMaster, txidSub, true, 100, 4, 2000);
+    db->recordSendAllSubRecord(txidSub, 1, 5, 3000);
+
+    // the second cancel sees the first one
+    BOOST_CHECK_EQUAL(db->getNumberOfMetaDExCancels(txidMaster), 2);
+
+    uint32_t propertyId = 0;
+    int64_t amount = 0;
+    BOOST_CHECK(db->getSendAllDetails(txidSub, 1, propertyId, amount));
+    BOOST_CHECK_EQUAL(propertyId, 5U);
+    BOOST_CHECK_EQUAL(amount, 3000);
+
+    BOOST_CHECK(db->CommitBatch().ok());
+    BOOST_CHECK_EQUAL(db->getNumberOfMetaDExCancels(txidMaster), 2);
+    BOOST_CHECK(db->getSendAllDetails(txidSub, 1, propertyId, amount));
+}
+
+BOOST_AUTO_TEST_CASE(batch_written_on_commit)
+{
+    std::unique_ptr<CMPTradeList> db(new CMPTradeList(pathTemp / "MP_tradelist_test", true));
+    uint256 txid1 = ArithToUint256(arith_uint256(1));
+    uint256 txid2 = ArithToUint256(arith_uint256(2));
+
+    db->BeginBatch();
+    db->recordNewTrade(txid1, "a", 3, 4, 100, 1);
+    db->recordMatchedTrade(txid1, txid2, "a", "b", 3, 4, 10, 20, 100, 0);
+    BOOST_CHECK_EQUAL(db->getMPTradeCountTotal(), 0);
+
+    BOOST_CHECK(db->CommitBatch().ok());
+    BOOST_CHECK_EQUAL(db->getMPTradeCountTotal(), 2);
+
+    // without a batch, writes are direct
+    db->recordNewTrade(txid2, "b", 4, 3, 101, 1);
+    BOOST_CHECK_EQUAL(db->getMPTradeCountTotal(), 3);
+
+    // discarded when the database is cleared
+    db->BeginBatch();
+    db->recordNewTrade(ArithToUint256(arith_uint256(3)), "c", 3, 4, 102, 1);
+    db->Clear();
+    BOOST_CHECK(db->CommitBatch().ok());
+    BOOST_CHECK_EQUAL(db->getMPTradeCountTotal(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -504,6 +504,58 @@ BOOST_AUTO_TEST_CASE(get_anonimity_group_by_iterator)
     BOOST_CHECK_EQUAL(mints, result);
 }
 
+BOOST_AUTO_TEST_CASE(get_cached_anonimity_group_follows_new_mints)
+{
+    auto db = CreateDb();
+    auto mints = CreateMints(10);
+
+    for (size_t i = 0; i < 5; i++) {
+        db->RecordMint(1, 1, mints[i], 10);
+    }
+
+    auto cached = db->GetCachedAnonimityGroup(1, 1, 0);
+    BOOST_CHECK_EQUAL(GetFirstN(mints, 5), *cached);
+
+    for (size_t i = 5; i < 10; i++) {
+        db->RecordMint(1, 1, mints[i], 11);
+    }
+
+    // The set in use is not changed.
+    BOOST_CHECK_EQUAL(GetFirstN(mints, 5), *cached);
+    BOOST_CHECK_EQUAL(mints, *db->GetCachedAnonimityGroup(1, 1, 0));
+    BOOST_CHECK_EQUAL(db->GetCachedAnonimityGroup(1, 2, 0)->empty(), true);
+}
+
+BOOST_AUTO_TEST_CASE(get_cached_anonimity_group_follows_deleted_mints)
+{
+    auto db = CreateDb();
+    auto mints1 = CreateMints(TEST_MAX_COINS_PER_GROUP);
+    auto mints2 = CreateMints(2);
+
+    for (auto& mint : mints1) {
+        db->RecordMint(1, 0, mint, 10);
+    }
+
+    db->RecordMint(1, 0, mints2[0], 11);
+    db->RecordMint(1, 0, mints2[1], 12);
+
+    BOOST_CHECK_EQUAL(mints1, *db->GetCachedAnonimityGroup(1, 0, 0));
+    BOOST_CHECK_EQUAL(mints2, *db->GetCachedAnonimityGroup(1, 0, 1));
+
+    db->DeleteAll(12);
+
+    BOOST_CHECK_EQUAL(mints1, *db->GetCachedAnonimityGroup(1, 0, 0));
+    BOOST_CHECK_EQUAL(GetFirstN(mints2, 1), *db->GetCachedAnonimityGroup(1, 0, 1));
+
+    db->DeleteAll(10);
+
+    BOOST_CHECK_EQUAL(db->GetCachedAnonimityGroup(1, 0, 0)->empty(), true);
+    BOOST_CHECK_EQUAL(db->GetCachedAnonimityGroup(1, 0, 1)->empty(), true);
+
+    db->RecordMint(1, 0, mints2[1], 13);
+    BOOST_CHECK_EQUAL(mints2[1], db->GetCachedAnonimityGroup(1, 0, 0)->at(0));
+}
+
 BOOST_AUTO_TEST_CASE(group_size_default)
 {
     auto db = CreateDb(0);
@@ -0,0 +1,125 @@
+#include "elysium/statedb.h"
+
+#include "elysium/elysium.h"
+
+#include "arith_uint256.h"
+#include "chain.h"
+#include "uint256.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct StateDbTestingSetup : TestingSetup
+{
+    std::vector<uint256> hashes;
+    std::vector<CBlockIndex> blocks;
+
+    StateDbTestingSetup() : TestingSetup(CBaseChainParams::REGTEST), hashes(200), blocks(200)
+    {
+        for (size_t i = 0; i < blocks.size(); i++) {
+            hashes[i] = ArithToUint256(arith_uint256(i + 1));
+            blocks[i].phashBlock = &hashes[i];
+            blocks[i].nHeight = i;
+            blocks[i].pprev = i > 0 ? &blocks[i - 1] : NULL;
+        }
+    }
+};
+
+CElysiumState MakeState(bool fSnapshot, const std::string& address, int64_t balance)
+{
+    CElysiumState state;
+    state.fSnapshot = fSnapshot;
+    state.balances.resize(1);
+    state.balances[0].address = address;
+    state.balances[0].propertyId = 3;
+    state.balances[0].balance = balance;
+    return state;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(elysium_statedb_tests, StateDbTestingSetup)
+
+BOOST_AUTO_TEST_CASE(snapshot_and_changes)
+{
+    std::unique_ptr<CElysiumStateDB> db(new CElysiumStateDB(pathTemp / "MP_persist_test", true));
+    std::vector<CElysiumState> states;
+
+    // no snapshot, nothing to rebuild from
+    db->WriteState(&blocks[10], MakeState(false, "a", 1));
+    BOOST_CHECK(!db->ReadStates(&blocks[10], states));
+
+    db->WriteState(&blocks[10], MakeState(true, "a", 1));
+    db->WriteState(&blocks[11], MakeState(false, "b", 2));
+    db->WriteState(&blocks[12], MakeState(false, "a", 3));
+
+    BOOST_REQUIRE(db->ReadStates(&blocks[12], states));
+    BOOST_REQUIRE_EQUAL(states.size(), 3U);
+    BOOST_CHECK(states[0].fSnapshot);
+    BOOST_CHECK_EQUAL(states[0].balances[0].balance, 1);
+    BOOST_CHECK(!states[1].fSnapshot);
+    BOOST_CHECK_EQUAL(states[1].balances[0].address, "b");
+    BOOST_CHECK_EQUAL(states[2].balances[0].balance, 3);
+
+    // a gap in the changes
+    BOOST_CHECK(!db->ReadStates(&blocks[14], states));
+    BOOST_CHECK(states.empty());
+}
+
+BOOST_AUTO_TEST_CASE(prune_keeps_history)
+{
+    std::unique_ptr<CElysiumStateDB> db(new CElysiumStateDB(pathTemp / "MP_persist_test", true));
+    std::vector<CElysiumState> states;
+
+    for (int i = 0; i < 150; i++) {
+        db->WriteState(&blocks[i], MakeState(i % 20 == 0, "a", i + 1));
+        db->Prune(&blocks[i]);
+    }
+
+    // every block of the recent history can still be rebuilt
+    for (int i = 149 - MAX_STATE_HISTORY; i < 150; i++) {
+        BOOST_CHECK(db->ReadStates(&blocks[i], states));
+    }
+
+    // older ones are gone
+    CElysiumState state;
+    BOOST_CHECK(!db->ReadState(&blocks[0], state));
+    BOOST_CHECK(!db->ReadState(&blocks[79], state));
+    BOOST_CHECK(db->ReadState(&blocks[80], state));
+    BOOST_CHECK(state.fSnapshot);
+}
+
+BOOST_AUTO_TEST_CASE(restore_frozen_after_debit)
+{
+    std::unique_ptr<CElysiumStateDB> db(new CElysiumStateDB(pathTemp / "MP_persist_test", true));
+    std::vector<CElysiumState> states;
+
+    // "a" was debited after the snapshot and frozen later on
+    db->WriteState(&blocks[10], MakeState(true, "a", 10));
+    db->WriteState(&blocks[11], MakeState(false, "a", 4));
+    BOOST_REQUIRE(db->ReadStates(&blocks[11], states));
+
+    elysium::freezeAddress("a", 3);
+    BOOST_CHECK(elysium::RestoreTallies(states));
+    BOOST_CHECK_EQUAL(getMPbalance("a", 3, BALANCE), 4);
+    BOOST_CHECK(elysium::isAddressFrozen("a", 3));
+
+    // restoring again replaces the tallies instead of adding to them
+    BOOST_CHECK(elysium::RestoreTallies(states));
+    BOOST_CHECK_EQUAL(getMPbalance("a", 3, BALANCE), 4);
+
+    elysium::ClearFreezeState();
+    elysium::mp_tally_map.clear();
+    elysium::mp_holder_index.clear();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
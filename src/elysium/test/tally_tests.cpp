@@ -4,8 +4,21 @@
 
 #include <stdint.h>
 
+#include <string>
+
 #include <boost/test/unit_test.hpp>
 
+/** Returns the identifiers of the tokens of a tally, in order of iteration. */
+static std::string GetPropertyIds(const CMPTally& tally)
+{
+    std::string ids;
+    for (CMPTally::const_iterator it = tally.begin(); it != tally.end(); ++it) {
+        if (!ids.empty()) ids += ",";
+        ids += std::to_string(it->first);
+    }
+    return ids;
+}
+
 BOOST_FIXTURE_TEST_SUITE(elysium_tally_tests, BasicTestingSetup)
 
 BOOST_AUTO_TEST_CASE(empty_tally)
@@ -23,8 +36,8 @@ BOOST_AUTO_TEST_CASE(empty_tally)
     BOOST_CHECK(!tally.updateMoney(0, 1, static_cast<TallyType>(5)));
     BOOST_CHECK(!tally.updateMoney(0, 1, static_cast<TallyType>(6)));
 
-    BOOST_CHECK_EQUAL(0, tally.init());
-    BOOST_CHECK_EQUAL(0, tally.next());
+    BOOST_CHECK(tally.begin() == tally.end());
+    BOOST_CHECK(!tally.hasProperty(0));
 
     BOOST_CHECK_EQUAL(0, tally.getMoneyAvailable(0));
     BOOST_CHECK_EQUAL(0, tally.getMoneyReserved(0));
@@ -92,19 +105,9 @@ BOOST_AUTO_TEST_CASE(filled_tally)
     BOOST_CHECK_EQUAL(tally.getMoneyAvailable(5), 0);
     BOOST_CHECK_EQUAL(tally.getMoneyReserved(5), int64_t(4294967296L));
 
-    /**
-     * Note:
-     * The internal iterator must be replaced via init(),
-     * after inserting a new entry via updateMoney().
-     */
-    BOOST_CHECK_EQUAL(0, tally.init());
-    BOOST_CHECK_EQUAL(0, tally.next());
-    BOOST_CHECK_EQUAL(1, tally.next());
-    BOOST_CHECK_EQUAL(2, tally.next());
-    BOOST_CHECK_EQUAL(5, tally.next());
-    BOOST_CHECK_EQUAL(0, tally.init());
-    BOOST_CHECK_EQUAL(0, tally.next());
-    BOOST_CHECK_EQUAL(1, tally.next());
+    BOOST_CHECK_EQUAL(GetPropertyIds(tally), "0,1,2,5");
+    BOOST_CHECK(tally.hasProperty(2));
+    BOOST_CHECK(!tally.hasProperty(3));
 }
 
 BOOST_AUTO_TEST_CASE(tally_entry_order)
@@ -137,20 +140,7 @@ BOOST_AUTO_TEST_CASE(tally_entry_order)
     BOOST_CHECK(tally.updateMoney(4, -1, PENDING));
     BOOST_CHECK(tally.updateMoney(2, -1, PENDING));
 
-    BOOST_CHECK_EQUAL(1, tally.init());
-    // Begin iterations:
-    BOOST_CHECK_EQUAL(1, tally.next());
-    BOOST_CHECK_EQUAL(2, tally.next());
-    BOOST_CHECK_EQUAL(3, tally.next());
-    BOOST_CHECK_EQUAL(4, tally.next());
-    BOOST_CHECK_EQUAL(5, tally.next());
-    BOOST_CHECK_EQUAL(6, tally.next());
-    BOOST_CHECK_EQUAL(7, tally.next());
-    BOOST_CHECK_EQUAL(8, tally.next());
-    BOOST_CHECK_EQUAL(9, tally.next());
-    BOOST_CHECK_EQUAL(70, tally.next());
-    // End of tally reached:
-    BOOST_CHECK_EQUAL(0, tally.next());
+    BOOST_CHECK_EQUAL(GetPropertyIds(tally), "1,2,3,4,5,6,7,8,9,70");
 
     BOOST_CHECK_EQUAL(tally.getMoneyAvailable(1), 2);
     BOOST_CHECK_EQUAL(tally.getMoneyReserved(1), 0);
@@ -218,16 +208,8 @@ BOOST_AUTO_TEST_CASE(tally_equality)
     BOOST_CHECK(tally2.getMoneyReserved(9) == tally1.getMoneyReserved(9));
     BOOST_CHECK(tally2.getMoneyReserved(0) == tally1.getMoneyReserved(0));
 
-    BOOST_CHECK_EQUAL(1, tally1.init());
-    BOOST_CHECK_EQUAL(1, tally1.next());
-    BOOST_CHECK_EQUAL(3, tally1.next());
-    BOOST_CHECK_EQUAL(4, tally1.next());
-    BOOST_CHECK_EQUAL(9, tally1.next());
-    BOOST_CHECK_EQUAL(0, tally1.next());
-    BOOST_CHECK_EQUAL(1, tally2.init());
-    BOOST_CHECK_EQUAL(1, tally2.next());
-    BOOST_CHECK_EQUAL(3, tally2.next());
-    BOOST_CHECK_EQUAL(4, tally2.next());
+    BOOST_CHECK_EQUAL(GetPropertyIds(tally1), "1,3,4,9");
+    BOOST_CHECK_EQUAL(GetPropertyIds(tally2), "1,3,4,9");
 
     BOOST_CHECK(tally1 == tally2);
 
@@ -318,5 +300,37 @@ BOOST_AUTO_TEST_CASE(tally_overflow)
     BOOST_CHECK_EQUAL(tally.getMoneyReserved(3), int64_t(9223372036854775807LL));
 }
 
+BOOST_AUTO_TEST_CASE(holder_index)
+{
+    CMPHolderIndex index;
+    BOOST_CHECK(index.get(3) == NULL);
+
+    index.update("a", 3, 100, BALANCE);
+    index.update("b", 3, 50, SELLOFFER_RESERVE);
+    index.update("c", 3, -20, PENDING);
+    index.update("c", 4, 10, BALANCE);
+
+    const CMPHolders* holders = index.get(3);
+    BOOST_REQUIRE(holders != NULL);
+    BOOST_CHECK_EQUAL(holders->addresses.size(), 2U);
+    BOOST_CHECK_EQUAL(holders->addresses.at("a"), 100);
+    BOOST_CHECK_EQUAL(holders->addresses.at("b"), 50);
+    BOOST_CHECK_EQUAL(holders->totals[PENDING], -20);
+    BOOST_CHECK_EQUAL(holders->getTotalTokens(), 150);
+
+    // Moving tokens between tally types keeps the holder
+    index.update("b", 3, -50, SELLOFFER_RESERVE);
+    index.update("b", 3, 50, BALANCE);
+    BOOST_CHECK_EQUAL(holders->addresses.at("b"), 50);
+
+    index.update("a", 3, -100, BALANCE);
+    BOOST_CHECK_EQUAL(holders->addresses.count("a"), 0U);
+    BOOST_CHECK_EQUAL(holders->totals[BALANCE], 50);
+    BOOST_CHECK_EQUAL(holders->getTotalTokens(), 50);
+    BOOST_CHECK_EQUAL(index.get(4)->addresses.size(), 1U);
+
+    index.clear();
+    BOOST_CHECK(index.get(3) == NULL);
+}
 
 BOOST_AUTO_TEST_SUITE_END()
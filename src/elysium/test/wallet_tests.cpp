@@ -160,6 +160,32 @@ BOOST_AUTO_TEST_CASE(sigma_spend_create_with_spendable_mints)
     BOOST_CHECK_EQUAL(spend.groupSize, sigmaDb->groupSize);
 }
 
+BOOST_AUTO_TEST_CASE(sigma_spend_prepare_reserves_mint)
+{
+    auto firstMintId = wallet->CreateSigmaMint(3, 0);
+    sigmaDb->RecordMint(3, 0, firstMintId.pubKey, 100);
+    auto secondMintId = wallet->CreateSigmaMint(3, 0);
+    sigmaDb->RecordMint(3, 0, secondMintId.pubKey, 101);
+
+    auto first = wallet->PrepareSigmaSpendV1(3, 0, false);
+    auto second = wallet->PrepareSigmaSpendV1(3, 0, false);
+
+    BOOST_CHECK_EQUAL(first.id, firstMintId);
+    BOOST_CHECK_EQUAL(second.id, secondMintId);
+    BOOST_CHECK_THROW(wallet->PrepareSigmaSpendV1(3, 0, false), InsufficientFunds);
+
+    auto spend = Wallet::CreateSigmaSpend(second);
+    BOOST_CHECK_EQUAL(spend.mint, secondMintId);
+    BOOST_CHECK_EQUAL(spend.groupSize, 2);
+
+    // A released mint can be spent again, a used one can't.
+    wallet->ReleaseSigmaMint(first.id);
+    wallet->SetSigmaMintUsedTransaction(second.id, uint256S("890e968f9b65dbacd576100c9b1c446f06471ed27df845ab7a24931cb640b388"));
+
+    BOOST_CHECK_EQUAL(wallet->PrepareSigmaSpendV1(3, 0, false).id, firstMintId);
+    BOOST_CHECK_THROW(wallet->PrepareSigmaSpendV1(3, 0, false), InsufficientFunds);
+}
+
 BOOST_AUTO_TEST_CASE(sigma_spend_create_not_enough_anonimity)
 {
     auto mintId = wallet->CreateSigmaMint(3, 0);
@@ -0,0 +1,260 @@
+#include "elysium/walletcache.h"
+
+#include "elysium/dex.h"
+#include "elysium/elysium.h"
+#include "elysium/sp.h"
+#include "elysium/statedb.h"
+#include "elysium/tally.h"
+
+#include "base58.h"
+#include "key.h"
+#include "rpc/register.h"
+#include "rpc/server.h"
+#include "script/standard.h"
+#include "sync.h"
+#include "validation.h"
+#include "wallet/wallet.h"
+
+#include "wallet/test/wallet_test_fixture.h"
+
+#include <univalue.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace elysium;
+
+namespace {
+
+struct WalletCacheTestingSetup : WalletTestingSetup
+{
+    WalletCacheTestingSetup()
+    {
+        _my_sps = new CMPSPInfo(pathTemp / "MP_spinfo_test", false);
+        RegisterElysiumDataRetrievalRPCCommands(tableRPC);
+        RegisterWalletCacheSignals(pwalletMain);
+
+        LOCK(cs_main);
+        mp_tally_map.clear();
+        mp_holder_index.clear();
+        ClearWalletCache();
+    }
+
+    ~WalletCacheTestingSetup()
+    {
+        UnregisterWalletCacheSignals(pwalletMain);
+
+        LOCK(cs_main);
+        mp_tally_map.clear();
+        mp_holder_index.clear();
+        ClearWalletCache();
+    }
+};
+
+//! Initializes Elysium completely, to run the block handlers
+struct WalletCacheBlockTestingSetup : WalletTestingSetup
+{
+    WalletCacheBlockTestingSetup()
+    {
+        elysium_init();
+
+        LOCK(cs_main);
+        mp_tally_map.clear();
+        mp_holder_index.clear();
+        ClearWalletCache();
+    }
+
+    ~WalletCacheBlockTestingSetup()
+    {
+        LOCK(cs_main);
+        mp_tally_map.clear();
+        mp_holder_index.clear();
+        ClearWalletCache();
+    }
+};
+
+std::string AddWalletKey(bool watchOnly = false)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    CPubKey pubKey = key.GetPubKey();
+
+    if (watchOnly) {
+        BOOST_CHECK(pwalletMain->AddWatchOnly(GetScriptForDestination(pubKey.GetID()), 0));
+    } else {
+        {
+            LOCK(pwalletMain->cs_wallet);
+            BOOST_CHECK(pwalletMain->AddKeyPubKey(key, pubKey));
+        }
+        BOOST_CHECK(pwalletMain->SetAddressBook(pubKey.GetID(), "", "receive"));
+    }
+
+    return CBitcoinAddress(pubKey.GetID()).ToString();
+}
+
+void UpdateTally(const std::string& address, int64_t amount, TallyType ttype)
+{
+    LOCK(cs_main);
+    BOOST_CHECK(update_tally_map(address, 3, amount, ttype));
+}
+
+UniValue CallRpc(const std::string& method, bool includeWatchOnly = false)
+{
+    JSONRPCRequest request;
+    request.strMethod = method;
+    request.params = UniValue(UniValue::VARR);
+    request.params.push_back(includeWatchOnly);
+    request.fHelp = false;
+
+    const CRPCCommand* command = tableRPC[method];
+    BOOST_REQUIRE(command);
+    return command->actor(request);
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(elysium_walletcache_tests, WalletCacheTestingSetup)
+
+BOOST_AUTO_TEST_CASE(new_wallet_address)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    std::string address = CBitcoinAddress(key.GetPubKey().GetID()).ToString();
+
+    // not a wallet address yet
+    UpdateTally(address, 100, BALANCE);
+    WalletCacheUpdate();
+    BOOST_CHECK(GetWalletAddressBalances(true).empty());
+    BOOST_CHECK_EQUAL(CallRpc("elysium_getwalletaddressbalances").size(), 0U);
+
+    // the address book entry of the new key triggers a rebuild
+    {
+        LOCK(pwalletMain->cs_wallet);
+        BOOST_CHECK(pwalletMain->AddKeyPubKey(key, key.GetPubKey()));
+    }
+    BOOST_CHECK(pwalletMain->SetAddressBook(key.GetPubKey().GetID(), "", "receive"));
+    BOOST_CHECK_EQUAL(WalletCacheUpdate(), 1);
+
+    std::map<std::string, std::map<uint32_t, WalletBalance>> balances = GetWalletAddressBalances();
+    BOOST_REQUIRE_EQUAL(balances.count(address), 1U);
+    BOOST_CHECK_EQUAL(balances[address][3].available, 100);
+
+    UniValue result = CallRpc("elysium_getwalletaddressbalances");
+    BOOST_REQUIRE_EQUAL(result.size(), 1U);
+    BOOST_CHECK_EQUAL(find_value(result[0], "address").get_str(), address);
+    BOOST_CHECK_EQUAL(find_value(find_value(result[0], "balances")[0], "balance").get_str(), "100");
+
+    // nothing changed since
+    BOOST_CHECK_EQUAL(WalletCacheUpdate(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(watch_only_address)
+{
+    std::string address = AddWalletKey(true);
+    UpdateTally(address, 50, BALANCE);
+    BOOST_CHECK_EQUAL(WalletCacheUpdate(), 1);
+
+    BOOST_CHECK(GetWalletAddressBalances().empty());
+    BOOST_CHECK_EQUAL(GetWalletAddressBalances(true).count(address), 1U);
+    BOOST_CHECK_EQUAL(GetWalletBalances()[3].available, 0);
+    BOOST_CHECK_EQUAL(GetWalletBalances(true)[3].available, 50);
+
+    UniValue result = CallRpc("elysium_getwalletbalances", true);
+    BOOST_REQUIRE_EQUAL(result.size(), 1U);
+    BOOST_CHECK_EQUAL(find_value(result[0], "balance").get_str(), "50");
+    BOOST_CHECK_EQUAL(CallRpc("elysium_getwalletbalances").size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(spent_balance)
+{
+    std::string address = AddWalletKey();
+    UpdateTally(address, 100, BALANCE);
+    BOOST_CHECK_EQUAL(WalletCacheUpdate(), 1);
+
+    // an unconfirmed spend lowers the available balance
+    UpdateTally(address, -30, PENDING);
+    BOOST_CHECK_EQUAL(WalletCacheUpdate(), 1);
+    BOOST_CHECK_EQUAL(GetWalletBalances()[3].available, 70);
+
+    UniValue result = CallRpc("elysium_getwalletbalances");
+    BOOST_REQUIRE_EQUAL(result.size(), 1U);
+    BOOST_CHECK_EQUAL(find_value(result[0], "balance").get_str(), "70");
+
+    // and so does a reserve
+    UpdateTally(address, -20, BALANCE);
+    UpdateTally(address, 20, SELLOFFER_RESERVE);
+    BOOST_CHECK_EQUAL(WalletCacheUpdate(), 1);
+    BOOST_CHECK_EQUAL(GetWalletBalances()[3].available, 50);
+    BOOST_CHECK_EQUAL(GetWalletBalances()[3].reserved, 20);
+}
+
+BOOST_AUTO_TEST_CASE(reorg)
+{
+    std::string address = AddWalletKey();
+    UpdateTally(address, 100, BALANCE);
+    BOOST_CHECK_EQUAL(WalletCacheUpdate(), 1);
+    UpdateTally(address, -60, BALANCE);
+    BOOST_CHECK_EQUAL(WalletCacheUpdate(), 1);
+    BOOST_CHECK_EQUAL(GetWalletBalances()[3].available, 40);
+
+    // rolling back to a state before the debit, as load_state() does
+    std::vector<CElysiumState> states(1);
+    states[0].fSnapshot = true;
+    states[0].balances.resize(1);
+    states[0].balances[0].address = address;
+    states[0].balances[0].propertyId = 3;
+    states[0].balances[0].balance = 100;
+    {
+        LOCK(cs_main);
+        ClearWalletCache();
+        BOOST_CHECK(RestoreTallies(states));
+    }
+    BOOST_CHECK_EQUAL(WalletCacheUpdate(), 1);
+    BOOST_CHECK_EQUAL(GetWalletBalances()[3].available, 100);
+
+    // rolling back to a state before the address held tokens
+    {
+        LOCK(cs_main);
+        ClearWalletCache();
+        BOOST_CHECK(RestoreTallies(std::vector<CElysiumState>()));
+    }
+    WalletCacheUpdate();
+    BOOST_CHECK(GetWalletAddressBalances().empty());
+    BOOST_CHECK_EQUAL(CallRpc("elysium_getwalletaddressbalances").size(), 0U);
+}
+
+BOOST_FIXTURE_TEST_CASE(expired_accept_without_elysium_transactions, WalletCacheBlockTestingSetup)
+{
+    std::string seller = AddWalletKey();
+    CKey key;
+    key.MakeNewKey(true);
+    std::string buyer = CBitcoinAddress(key.GetPubKey().GetID()).ToString();
+
+    LOCK(cs_main);
+    CBlockIndex* pindex = chainActive.Tip();
+    int nBlock = pindex->nHeight;
+
+    // the offer is cancelled after the accept, so the accepted amount goes back to the balance when the accept expires
+    BOOST_CHECK(update_tally_map(seller, 3, 100, BALANCE));
+    BOOST_CHECK_EQUAL(DEx_offerCreate(seller, 3, 60, nBlock, 10, 0, 1, uint256()), 0);
+    BOOST_CHECK_EQUAL(DEx_acceptCreate(buyer, seller, 3, 60, nBlock, 0), 0);
+    BOOST_CHECK_EQUAL(DEx_offerDestroy(seller, 3), 0);
+    BOOST_CHECK_EQUAL(WalletCacheUpdate(), 1);
+    BOOST_CHECK_EQUAL(GetWalletBalances()[3].available, 40);
+    BOOST_CHECK_EQUAL(GetWalletBalances()[3].reserved, 60);
+
+    // the next block has no Elysium transactions, but ends the payment window
+    BOOST_CHECK_EQUAL(elysium_handler_block_begin(nBlock, pindex), 0);
+    BOOST_CHECK_EQUAL(elysium_handler_block_end(nBlock + 1, pindex, 0), 0);
+
+    BOOST_CHECK(!DEx_acceptExists(seller, 3, buyer));
+    BOOST_CHECK_EQUAL(GetWalletBalances()[3].available, 100);
+    BOOST_CHECK_EQUAL(GetWalletBalances()[3].reserved, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1411,10 +1411,11 @@ int CMPTransaction::logicMath_SendAll()
         return (PKT_ERROR_SEND_ALL -54);
     }
 
-    uint32_t propertyId = ptally->init();
     int numberOfPropertiesSent = 0;
 
-    while (0 != (propertyId = ptally->next())) {
+    // the balance records of the sender already exist, so updating them doesn't invalidate the iterator
+    for (CMPTally::const_iterator it = ptally->consensusBegin(); it != ptally->end(); ++it) {
+        uint32_t propertyId = it->first;
         // only transfer tokens in the specified ecosystem
         if (ecosystem == ELYSIUM_PROPERTY_ELYSIUM && isTestEcosystemProperty(propertyId)) {
             continue;
@@ -73,6 +73,9 @@ void Wallet::SetSigmaMintUsedTransaction(const SigmaMintId& id, const uint256& t
 {
     auto &wallet = GetMintWallet(id);
     wallet.UpdateMintSpendTx(id, tx);
+
+    LOCK(cs_main);
+    reservedMints.erase(id);
 }
 
 void Wallet::ClearAllChainState()
@@ -92,6 +95,25 @@ SigmaSpend Wallet::CreateSigmaSpendV1(PropertyId property, SigmaDenomination den
 }
 
 SigmaSpend Wallet::CreateSigmaSpend(PropertyId property, SigmaDenomination denomination, bool fPadding, SigmaMintVersion version)
+{
+    auto input = PrepareSigmaSpend(property, denomination, fPadding, version);
+
+    try {
+        auto spend = CreateSigmaSpend(input);
+        ReleaseSigmaMint(input.id);
+        return spend;
+    } catch (...) {
+        ReleaseSigmaMint(input.id);
+        throw;
+    }
+}
+
+Wallet::SigmaSpendInput Wallet::PrepareSigmaSpendV1(PropertyId property, SigmaDenomination denomination, bool fPadding)
+{
+    return PrepareSigmaSpend(property, denomination, fPadding, SigmaMintVersion::V1);
+}
+
+Wallet::SigmaSpendInput Wallet::PrepareSigmaSpend(PropertyId property, SigmaDenomination denomination, bool fPadding, SigmaMintVersion version)
 {
     LOCK(cs_main);
 
@@ -101,29 +123,44 @@ SigmaSpend Wallet::CreateSigmaSpend(PropertyId property, SigmaDenomination denom
     }
 
     // Get anonimity set for spend.
-    std::vector<SigmaPublicKey> anonimitySet;
-
-    sigmaDb->GetAnonimityGroup(
+    SigmaSpendInput input;
+    input.anonimitySet = sigmaDb->GetCachedAnonimityGroup(
         mint->property,
         mint->denomination,
-        mint->chainState.group,
-        std::back_inserter(anonimitySet)
+        mint->chainState.group
     );
 
-    if (anonimitySet.size() < 2) {
+    if (input.anonimitySet->size() < 2) {
         throw WalletError(_("Amount of coins in anonimity set is not enough to spend"));
     }
 
-    // Create spend.
-    auto key = GetKey(mint.get());
-    SigmaProof proof(DefaultSigmaParams, key, anonimitySet.begin(), anonimitySet.end(), fPadding);
+    input.mint = mint.get();
+    input.key = GetKey(input.mint);
+    input.id = SigmaMintId(mint->property, mint->denomination, SigmaPublicKey(input.key, DefaultSigmaParams));
+    input.fPadding = fPadding;
+
+    reservedMints.insert(input.id);
+
+    return input;
+}
 
-    if (!VerifySigmaSpend(mint->property, mint->denomination, mint->chainState.group, anonimitySet.size(), proof, key.serial, fPadding)) {
+SigmaSpend Wallet::CreateSigmaSpend(const SigmaSpendInput& input)
+{
+    auto& anonimitySet = *input.anonimitySet;
+    SigmaProof proof(DefaultSigmaParams, input.key, anonimitySet.begin(), anonimitySet.end(), input.fPadding);
+
+    // The anonimity group is the one the proof was generated for, so it is verified against it directly.
+    if (!proof.Verify(input.key.serial, anonimitySet.begin(), anonimitySet.end(), input.fPadding)) {
         throw WalletError(_("Failed to create spendable spend"));
     }
 
-    return SigmaSpend(SigmaMintId(mint->property, mint->denomination, SigmaPublicKey(key, DefaultSigmaParams)),
-        mint->chainState.group, anonimitySet.size(), proof);
+    return SigmaSpend(input.id, input.mint.chainState.group, anonimitySet.size(), proof);
+}
+
+void Wallet::ReleaseSigmaMint(const SigmaMintId& id)
+{
+    LOCK(cs_main);
+    reservedMints.erase(id);
 }
 
 void Wallet::DeleteUnconfirmedSigmaMint(const SigmaMintId &id)
@@ -168,6 +205,10 @@ boost::optional<SigmaMint> Wallet::GetSpendableSigmaMint(PropertyId property, Si
             return;
         }
 
+        if (reservedMints.count(m.first)) {
+            return;
+        }
+
         spendables.push_back(m.second);
     }));
 
@@ -16,7 +16,10 @@
 #include <boost/optional.hpp>
 
 #include <forward_list>
+#include <memory>
 #include <string>
+#include <unordered_set>
+#include <vector>
 
 namespace elysium {
 
@@ -29,6 +32,20 @@ protected:
         V1
     };
 
+public:
+    /**
+     * Everything needed to generate the proof of a spend, so the proof can be generated without
+     * holding cs_main. The mint stays reserved until it is used or released.
+     */
+    struct SigmaSpendInput
+    {
+        SigmaMintId id;
+        SigmaMint mint;
+        SigmaPrivateKey key;
+        std::shared_ptr<const std::vector<SigmaPublicKey>> anonimitySet;
+        bool fPadding;
+    };
+
 public:
     Wallet(const std::string& walletFile);
     virtual ~Wallet();
@@ -57,6 +74,13 @@ public:
     SigmaSpend CreateSigmaSpendV0(PropertyId property, SigmaDenomination denomination, bool fPadding);
     SigmaSpend CreateSigmaSpendV1(PropertyId property, SigmaDenomination denomination, bool fPadding);
 
+    /** Selects and reserves a mint to spend and obtains its anonimity group. */
+    SigmaSpendInput PrepareSigmaSpendV1(PropertyId property, SigmaDenomination denomination, bool fPadding);
+    /** Generates and verifies the proof of a prepared spend, doesn't lock cs_main. */
+    static SigmaSpend CreateSigmaSpend(const SigmaSpendInput& input);
+    /** Makes a reserved mint available again, if its spend wasn't used. */
+    void ReleaseSigmaMint(const SigmaMintId& id);
+
     void DeleteUnconfirmedSigmaMint(SigmaMintId const &id);
 
 public:
@@ -91,6 +115,7 @@ protected:
     boost::optional<SigmaMintVersion> GetSigmaMintVersion(const secp_primitives::Scalar &scalar);
 
     SigmaSpend CreateSigmaSpend(PropertyId property, SigmaDenomination denomination, bool fPadding, SigmaMintVersion version);
+    SigmaSpendInput PrepareSigmaSpend(PropertyId property, SigmaDenomination denomination, bool fPadding, SigmaMintVersion version);
 
 private:
     void OnSpendAdded(
@@ -119,6 +144,9 @@ private:
     std::forward_list<boost::signals2::scoped_connection> eventConnections;
     SigmaWalletV0 mintWalletV0;
     SigmaWalletV1 mintWalletV1;
+
+    //! Mints of spends which are being created, guarded by cs_main
+    std::unordered_set<SigmaMintId> reservedMints;
 };
 
 extern Wallet *wallet;
@@ -1,11 +1,14 @@
 #include "walletcache.h"
 
+#include "elysium.h"
 #include "log.h"
+#include "sp.h"
 #include "tally.h"
 #include "wallettxs.h"
 
 #include "../init.h"
 #include "../validation.h"
+#include "../script/ismine.h"
 #include "../sync.h"
 #include "../uint256.h"
 #ifdef ENABLE_WALLET
@@ -13,6 +16,7 @@
 #endif
 
 #include <algorithm>
+#include <atomic>
 #include <list>
 #include <map>
 #include <set>
@@ -27,8 +31,30 @@ namespace elysium {
 //! Global vector of Elysium transactions in the wallet
 std::vector<uint256> walletTXIDCache;
 
-//! Map of wallet balances
-static std::map<std::string, CMPTally> walletBalancesCache;
+/** Cached balances of one wallet address.
+ */
+struct CachedAddress
+{
+    //! Whether the address is spendable or watch only
+    int isMine;
+    //! Balances per property of the address
+    std::map<uint32_t, WalletBalance> balances;
+};
+
+//! Guards the cached balances, which are read without cs_main
+static CCriticalSection cs_walletcache;
+
+//! Balances of the wallet addresses
+static std::map<std::string, CachedAddress> walletBalancesCache;
+
+//! Addresses whose tally changed since the last update, guarded by cs_main
+static std::set<std::string> changedAddresses;
+
+//! Whether the next update has to check all addresses of the tally map, guarded by cs_main
+static bool fRebuildWalletCache = true;
+
+//! Whether the wallet reported added or removed addresses since the last update, set without cs_main
+static std::atomic<bool> fWalletAddressesChanged(false);
 
 /**
  * Adds a txid to the wallet txid cache, performing duplicate detection.
@@ -70,64 +96,200 @@ void WalletTXIDCacheInit()
 #endif
 }
 
+/**
+ * Obtains the balances of an address, if it is a wallet address.
+ */
+static bool GetAddressBalances(const std::string& address, CachedAddress& cached)
+{
+    cached.isMine = IsMyAddress(address);
+    cached.balances.clear();
+    if (!cached.isMine) return false;
+
+    const CMPTally* tally = getTally(address);
+    if (tally == NULL) return false;
+
+    for (CMPTally::const_iterator it = tally->begin(); it != tally->end(); ++it) {
+        uint32_t propertyId = it->first;
+        WalletBalance& balance = cached.balances[propertyId];
+        balance.available = getUserAvailableMPbalance(address, propertyId);
+        balance.reserved = getMPbalance(address, propertyId, SELLOFFER_RESERVE);
+        balance.reserved += getMPbalance(address, propertyId, METADEX_RESERVE);
+        balance.reserved += getMPbalance(address, propertyId, ACCEPT_RESERVE);
+        balance.frozen = getUserFrozenMPbalance(address, propertyId);
+
+        CMPSPInfo::Entry property;
+        if (_my_sps->getSP(propertyId, property)) {
+            balance.name = property.name;
+            balance.divisible = property.isDivisible();
+        }
+    }
+
+    return true;
+}
+
 /**
  * Updates the cache with the latest state, returning true if changes were made to wallet addresses (including watch only).
  *
- * Also prepares a list of addresses that were changed (for future usage).
+ * Only the addresses whose tally changed since the last update are checked, all addresses are
+ * checked after the cache was cleared or addresses were added to the wallet.
  */
 int WalletCacheUpdate()
 {
     if (elysium_debug_walletcache) PrintToLog("WALLETCACHE: Update requested\n");
     int numChanges = 0;
-    std::set<std::string> changedAddresses;
 
     LOCK(cs_main);
 
-    for (std::unordered_map<string, CMPTally>::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
-        const std::string& address = my_it->first;
+    if (fWalletAddressesChanged.exchange(false)) {
+        fRebuildWalletCache = true;
+    }
 
-        // determine if this address is in the wallet
-        int addressIsMine = IsMyAddress(address);
-        if (!addressIsMine) {
-            if (elysium_debug_walletcache) PrintToLog("WALLETCACHE: Ignoring non-wallet address %s\n", address);
-            continue; // ignore this address, not in wallet
+    std::set<std::string> addresses;
+    if (fRebuildWalletCache) {
+        for (std::unordered_map<std::string, CMPTally>::const_iterator it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
+            addresses.insert(it->first);
+        }
+        LOCK(cs_walletcache);
+        for (std::map<std::string, CachedAddress>::const_iterator it = walletBalancesCache.begin(); it != walletBalancesCache.end(); ++it) {
+            addresses.insert(it->first);
         }
+        fRebuildWalletCache = false;
+    }
+    addresses.insert(changedAddresses.begin(), changedAddresses.end());
+    changedAddresses.clear();
+
+    for (std::set<std::string>::const_iterator it = addresses.begin(); it != addresses.end(); ++it) {
+        const std::string& address = *it;
+        CachedAddress cached;
+        bool isWalletAddress = GetAddressBalances(address, cached);
+
+        LOCK(cs_walletcache);
+        std::map<std::string, CachedAddress>::iterator search_it = walletBalancesCache.find(address);
 
-        // obtain & init the tally
-        CMPTally& tally = my_it->second;
-        tally.init();
+        if (!isWalletAddress) {
+            if (search_it != walletBalancesCache.end()) {
+                ++numChanges;
+                walletBalancesCache.erase(search_it);
+            }
+            continue;
+        }
 
-        // check cache for miss on address
-        std::map<std::string, CMPTally>::iterator search_it = walletBalancesCache.find(address);
         if (search_it == walletBalancesCache.end()) { // cache miss, new address
             ++numChanges;
-            changedAddresses.insert(address);
-            walletBalancesCache.insert(std::make_pair(address,tally));
+            walletBalancesCache.insert(std::make_pair(address, cached));
             if (elysium_debug_walletcache) PrintToLog("WALLETCACHE: *CACHE MISS* - %s not in cache\n", address);
             continue;
         }
 
-        // check cache for miss on balance - TODO TRY AND OPTIMIZE THIS
-        CMPTally &cacheTally = search_it->second;
-        uint32_t propertyId;
-        while (0 != (propertyId = (tally.next()))) {
-            if (tally.getMoney(propertyId, BALANCE) != cacheTally.getMoney(propertyId, BALANCE) ||
-                    tally.getMoney(propertyId, PENDING) != cacheTally.getMoney(propertyId, PENDING) ||
-                    tally.getMoney(propertyId, SELLOFFER_RESERVE) != cacheTally.getMoney(propertyId, SELLOFFER_RESERVE) ||
-                    tally.getMoney(propertyId, ACCEPT_RESERVE) != cacheTally.getMoney(propertyId, ACCEPT_RESERVE) ||
-                    tally.getMoney(propertyId, METADEX_RESERVE) != cacheTally.getMoney(propertyId, METADEX_RESERVE)) { // cache miss, balance
-                ++numChanges;
-                changedAddresses.insert(address);
-                walletBalancesCache.erase(search_it);
-                walletBalancesCache.insert(std::make_pair(address,tally));
-                if (elysium_debug_walletcache) PrintToLog("WALLETCACHE: *CACHE MISS* - %s balance for property %d differs\n", address, propertyId);
-                break;
-            }
+        if (search_it->second.isMine != cached.isMine || search_it->second.balances != cached.balances) { // cache miss, balance
+            ++numChanges;
+            search_it->second = cached;
+            if (elysium_debug_walletcache) PrintToLog("WALLETCACHE: *CACHE MISS* - %s balance differs\n", address);
         }
     }
-    if (elysium_debug_walletcache) PrintToLog("WALLETCACHE: Update finished - there were %d changes\n", numChanges);
+
+    if (elysium_debug_walletcache) PrintToLog("WALLETCACHE: Update finished - checked %d addresses, there were %d changes\n", addresses.size(), numChanges);
     return numChanges;
 }
 
+/**
+ * Marks the balances of an address as changed, so the next update checks it.
+ */
+void NotifyWalletCacheBalanceChanged(const std::string& address)
+{
+    AssertLockHeld(cs_main);
+    changedAddresses.insert(address);
+}
+
+/**
+ * Drops the cached balances, so the next update rebuilds them from the tally map.
+ */
+void ClearWalletCache()
+{
+    AssertLockHeld(cs_main);
+    changedAddresses.clear();
+    fRebuildWalletCache = true;
+
+    LOCK(cs_walletcache);
+    walletBalancesCache.clear();
+}
+
+#ifdef ENABLE_WALLET
+/**
+ * Notifications of the wallet, which are sent with cs_wallet held, so they must not lock cs_main.
+ */
+static void WalletAddressBookChanged(CWallet* wallet, const CTxDestination& address, const std::string& label,
+        bool isMine, const std::string& purpose, ChangeType status)
+{
+    fWalletAddressesChanged = true;
+}
+
+static void WalletWatchonlyChanged(bool fHaveWatchOnly)
+{
+    fWalletAddressesChanged = true;
+}
+
+/**
+ * Rebuilds the cache on the next update whenever addresses are added to or removed from the wallet.
+ *
+ * New keys are added to the address book, imported keys and scripts as well, so this covers
+ * every address which can start or stop being a wallet address.
+ */
+void RegisterWalletCacheSignals(CWallet* wallet)
+{
+    wallet->NotifyAddressBookChanged.connect(&WalletAddressBookChanged);
+    wallet->NotifyWatchonlyChanged.connect(&WalletWatchonlyChanged);
+    fWalletAddressesChanged = true;
+}
+
+void UnregisterWalletCacheSignals(CWallet* wallet)
+{
+    wallet->NotifyAddressBookChanged.disconnect(&WalletAddressBookChanged);
+    wallet->NotifyWatchonlyChanged.disconnect(&WalletWatchonlyChanged);
+}
+#endif
+
+/**
+ * Returns the balances of the wallet per property as of the last update.
+ *
+ * Watch only addresses are only included, if requested. Properties of watch only addresses are
+ * always listed, as empty balances if they are not included.
+ */
+std::map<uint32_t, WalletBalance> GetWalletBalances(bool includeWatchOnly)
+{
+    std::map<uint32_t, WalletBalance> totals;
+
+    LOCK(cs_walletcache);
+    for (std::map<std::string, CachedAddress>::const_iterator it = walletBalancesCache.begin(); it != walletBalancesCache.end(); ++it) {
+        bool included = includeWatchOnly || it->second.isMine == ISMINE_SPENDABLE;
+        for (std::map<uint32_t, WalletBalance>::const_iterator pit = it->second.balances.begin(); pit != it->second.balances.end(); ++pit) {
+            WalletBalance& total = totals[pit->first];
+            total.name = pit->second.name;
+            total.divisible = pit->second.divisible;
+            if (!included) continue;
+            total.available += pit->second.available;
+            total.reserved += pit->second.reserved;
+            total.frozen += pit->second.frozen;
+        }
+    }
+
+    return totals;
+}
+
+/**
+ * Returns the balances per property of each wallet address as of the last update.
+ */
+std::map<std::string, std::map<uint32_t, WalletBalance>> GetWalletAddressBalances(bool includeWatchOnly)
+{
+    std::map<std::string, std::map<uint32_t, WalletBalance>> balances;
+
+    LOCK(cs_walletcache);
+    for (std::map<std::string, CachedAddress>::const_iterator it = walletBalancesCache.begin(); it != walletBalancesCache.end(); ++it) {
+        if (!includeWatchOnly && it->second.isMine != ISMINE_SPENDABLE) continue;
+        balances.insert(std::make_pair(it->first, it->second.balances));
+    }
+
+    return balances;
+}
 
 } // namespace elysium
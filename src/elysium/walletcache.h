@@ -1,12 +1,45 @@
 #ifndef ELYSIUM_WALLETCACHE_H
 #define ELYSIUM_WALLETCACHE_H
 
+class CWallet;
 class uint256;
 
+#include <stdint.h>
+
+#include <map>
+#include <string>
 #include <vector>
 
 namespace elysium
 {
+/** Balances of the wallet in one property.
+ */
+struct WalletBalance
+{
+    //! Name of the property
+    std::string name;
+    //! Whether the property is divisible
+    bool divisible;
+    //! Balance minus outgoing pending amounts
+    int64_t available;
+    //! Amounts reserved by sell offers, accepts and MetaDEx trades
+    int64_t reserved;
+    //! Balance of frozen addresses
+    int64_t frozen;
+
+    WalletBalance() : divisible(false), available(0), reserved(0), frozen(0) {}
+
+    bool operator==(const WalletBalance& other) const
+    {
+        return available == other.available && reserved == other.reserved && frozen == other.frozen;
+    }
+
+    bool operator!=(const WalletBalance& other) const
+    {
+        return !(*this == other);
+    }
+};
+
 //! Global vector of Elysium transactions in the wallet
 extern std::vector<uint256> walletTXIDCache;
 
@@ -18,6 +51,22 @@ void WalletTXIDCacheInit();
 
 /** Updates the cache and returns whether any wallet addresses were changed */
 int WalletCacheUpdate();
+
+/** Marks the balances of an address as changed, so the next update checks it */
+void NotifyWalletCacheBalanceChanged(const std::string& address);
+
+/** Drops the cached balances, so the next update rebuilds them from the tally map */
+void ClearWalletCache();
+
+/** Rebuilds the cache on the next update whenever addresses are added to or removed from the wallet */
+void RegisterWalletCacheSignals(CWallet* wallet);
+void UnregisterWalletCacheSignals(CWallet* wallet);
+
+/** Returns the balances of the wallet per property as of the last update, without locking cs_main */
+std::map<uint32_t, WalletBalance> GetWalletBalances(bool includeWatchOnly = false);
+
+/** Returns the balances per property of each wallet address as of the last update, without locking cs_main */
+std::map<std::string, std::map<uint32_t, WalletBalance>> GetWalletAddressBalances(bool includeWatchOnly = false);
 }
 
 #endif // ELYSIUM_WALLETCACHE_H
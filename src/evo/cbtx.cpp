@@ -103,7 +103,7 @@ bool CalcCbTxMerkleRootMNList(const CBlock& block, const CBlockIndex* pindexPrev
     LOCK(deterministicMNManager->cs);
 
     static int64_t nTimeDMN = 0;
-    static int64_t nTimeSMNL = 0;
+    static int64_t nTimeDiff = 0;
     static int64_t nTimeMerkle = 0;
 
     int64_t nTime1 = GetTimeMicros();
@@ -116,30 +116,33 @@ bool CalcCbTxMerkleRootMNList(const CBlock& block, const CBlockIndex* pindexPrev
     int64_t nTime2 = GetTimeMicros(); nTimeDMN += nTime2 - nTime1;
     LogPrint("bench", "            - BuildNewListFromBlock: %.2fms [%.2fs]\n", 0.001 * (nTime2 - nTime1), nTimeDMN * 0.000001);
 
-    CSimplifiedMNList sml(tmpMNList);
+    // The tree is kept for the list it was last updated to, consecutive lists usually only differ in a few MNs
+    static CDeterministicMNList mnListCached;
+    static CSimplifiedMNListMerkleTree merkleTreeCached;
+    static bool fMerkleTreeCached{false};
 
-    int64_t nTime3 = GetTimeMicros(); nTimeSMNL += nTime3 - nTime2;
-    LogPrint("bench", "            - CSimplifiedMNList: %.2fms [%.2fs]\n", 0.001 * (nTime3 - nTime2), nTimeSMNL * 0.000001);
+    CDeterministicMNListDiff diff;
+    if (fMerkleTreeCached) {
+        diff = mnListCached.BuildDiff(tmpMNList);
+    }
 
-    static CSimplifiedMNList smlCached;
-    static uint256 merkleRootCached;
-    static bool mutatedCached{false};
+    int64_t nTime3 = GetTimeMicros(); nTimeDiff += nTime3 - nTime2;
+    LogPrint("bench", "            - BuildDiff: %.2fms [%.2fs]\n", 0.001 * (nTime3 - nTime2), nTimeDiff * 0.000001);
 
-    if (sml.mnList == smlCached.mnList) {
-        merkleRootRet = merkleRootCached;
-        return !mutatedCached;
+    if (fMerkleTreeCached) {
+        merkleTreeCached.ApplyDiff(mnListCached, tmpMNList, diff);
+    } else {
+        merkleTreeCached.Build(tmpMNList);
+        fMerkleTreeCached = true;
     }
+    mnListCached = tmpMNList;
 
     bool mutated = false;
-    merkleRootRet = sml.CalcMerkleRoot(&mutated);
+    merkleRootRet = merkleTreeCached.GetMerkleRoot(&mutated);
 
     int64_t nTime4 = GetTimeMicros(); nTimeMerkle += nTime4 - nTime3;
     LogPrint("bench", "            - CalcMerkleRoot: %.2fms [%.2fs]\n", 0.001 * (nTime4 - nTime3), nTimeMerkle * 0.000001);
 
-    smlCached = std::move(sml);
-    merkleRootCached = merkleRootRet;
-    mutatedCached = mutated;
-
     return !mutated;
 }
 
@@ -8,6 +8,9 @@
 #include "base58.h"
 #include "chainparams.h"
 #include "core_io.h"
+#include "core_memusage.h"
+#include "memusage.h"
+#include "saltedhasher.h"
 #include "script/standard.h"
 #include "ui_interface.h"
 #include "validation.h"
@@ -18,11 +21,60 @@
 
 #include <univalue.h>
 
+#include <unordered_map>
+#include <unordered_set>
+
 static const std::string DB_LIST_SNAPSHOT = "dmn_S";
 static const std::string DB_LIST_DIFF = "dmn_D";
+static const std::string DB_LIST_SML_DIFF = "dmn_SD";
 
 CDeterministicMNManager* deterministicMNManager;
 
+static const size_t MIN_INTERNED_KEYS_PRUNE_SIZE = 1000;
+
+static CCriticalSection cs_internedOperatorKeys;
+static std::unordered_map<uint256, std::weak_ptr<const CBLSLazyPublicKey>, StaticSaltedHasher> internedOperatorKeys;
+static size_t nInternedOperatorKeysPruneSize = MIN_INTERNED_KEYS_PRUNE_SIZE;
+
+std::shared_ptr<const CBLSLazyPublicKey> CDeterministicMNOperatorKey::Intern(const CBLSLazyPublicKey& lazyKey)
+{
+    uint256 hash = lazyKey.GetHash();
+
+    LOCK(cs_internedOperatorKeys);
+    auto& entry = internedOperatorKeys[hash];
+    auto ret = entry.lock();
+    if (ret) {
+        return ret;
+    }
+    ret = std::make_shared<const CBLSLazyPublicKey>(lazyKey);
+    entry = ret;
+
+    // entries expire when the last state using a key goes away, drop them once the map doubled in size
+    if (internedOperatorKeys.size() > nInternedOperatorKeysPruneSize) {
+        for (auto it = internedOperatorKeys.begin(); it != internedOperatorKeys.end(); ) {
+            if (it->second.expired()) {
+                it = internedOperatorKeys.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        nInternedOperatorKeysPruneSize = std::max(MIN_INTERNED_KEYS_PRUNE_SIZE, internedOperatorKeys.size() * 2);
+    }
+    return ret;
+}
+
+size_t CDeterministicMNOperatorKey::GetInternedCount()
+{
+    LOCK(cs_internedOperatorKeys);
+    size_t n = 0;
+    for (const auto& p : internedOperatorKeys) {
+        if (!p.second.expired()) {
+            n++;
+        }
+    }
+    return n;
+}
+
 std::string CDeterministicMNState::ToString() const
 {
     CTxDestination dest;
@@ -539,6 +591,10 @@ bool CDeterministicMNManager::ProcessBlock(const CBlock& block, const CBlockInde
         diff = oldList.BuildDiff(newList);
 
         evoDb.Write(std::make_pair(DB_LIST_DIFF, newList.GetBlockHash()), diff);
+
+        CSimplifiedMNListBlockDiff smlDiff;
+        smlDiff.Build(block, oldList, newList, diff);
+        evoDb.Write(std::make_pair(DB_LIST_SML_DIFF, newList.GetBlockHash()), smlDiff);
         if ((nHeight % SNAPSHOT_LIST_PERIOD) == 0 || oldList.GetHeight() == -1) {
             evoDb.Write(std::make_pair(DB_LIST_SNAPSHOT, newList.GetBlockHash()), newList);
             LogPrintf("CDeterministicMNManager::%s -- Wrote snapshot. nHeight=%d, mapCurMNs.allMNsCount=%d\n",
@@ -587,6 +643,7 @@ bool CDeterministicMNManager::UndoBlock(const CBlock& block, const CBlockIndex*
         }
 
         evoDb.Erase(std::make_pair(DB_LIST_DIFF, blockHash));
+        evoDb.Erase(std::make_pair(DB_LIST_SML_DIFF, blockHash));
         evoDb.Erase(std::make_pair(DB_LIST_SNAPSHOT, blockHash));
 
         mnListsCache.erase(blockHash);
@@ -942,6 +999,11 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
     return snapshot;
 }
 
+bool CDeterministicMNManager::GetSimplifiedBlockDiff(const uint256& blockHash, CSimplifiedMNListBlockDiff& smlDiffRet)
+{
+    return evoDb.Read(std::make_pair(DB_LIST_SML_DIFF, blockHash), smlDiffRet);
+}
+
 CDeterministicMNList CDeterministicMNManager::GetListAtChainTip()
 {
     LOCK(cs);
@@ -987,6 +1049,37 @@ bool CDeterministicMNManager::IsDIP3Enforced(int nHeight)
     return nHeight >= Params().GetConsensus().DIP0003EnforcementHeight;
 }
 
+void CDeterministicMNManager::GetListsCacheStats(CDeterministicMNListsCacheStats& stats)
+{
+    LOCK(cs);
+
+    stats = CDeterministicMNListsCacheStats();
+    std::unordered_set<const CDeterministicMN*> mns;
+    std::unordered_set<const CDeterministicMNState*> states;
+
+    for (const auto& p : mnListsCache) {
+        stats.nLists++;
+        p.second.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
+            stats.nEntries++;
+            if (mns.emplace(dmn.get()).second) {
+                stats.nUsage += memusage::DynamicUsage(dmn);
+            }
+            const auto& pdmnState = dmn->pdmnState;
+            if (states.emplace(pdmnState.get()).second) {
+                stats.nUsage += memusage::DynamicUsage(pdmnState);
+                stats.nUsage += RecursiveDynamicUsage(pdmnState->scriptPayout);
+                stats.nUsage += RecursiveDynamicUsage(pdmnState->scriptOperatorPayout);
+            }
+        });
+    }
+    stats.nUsage += memusage::DynamicUsage(mnListsCache);
+    stats.nMNs = mns.size();
+    stats.nStates = states.size();
+
+    stats.nOperatorKeys = CDeterministicMNOperatorKey::GetInternedCount();
+    stats.nUsage += stats.nOperatorKeys * (memusage::MallocUsage(sizeof(CBLSLazyPublicKey)) + memusage::MallocUsage(sizeof(memusage::stl_shared_counter)));
+}
+
 void CDeterministicMNManager::CleanupCache(int nHeight)
 {
     AssertLockHeld(cs);
@@ -27,6 +27,75 @@ namespace llmq
     class CFinalCommitment;
 }
 
+/**
+ * The operator key of a CDeterministicMNState.
+ *
+ * States are copied whenever a diff is applied to them and mnListsCache keeps many versions of the
+ * list alive, so every MN whose state changed would otherwise carry its own copy of the key, including
+ * the decompressed form. Keys are interned by their hash instead, copying one only copies a pointer and
+ * each key is decompressed once.
+ */
+class CDeterministicMNOperatorKey
+{
+private:
+    std::shared_ptr<const CBLSLazyPublicKey> key;
+
+    static std::shared_ptr<const CBLSLazyPublicKey> Intern(const CBLSLazyPublicKey& lazyKey);
+
+    const CBLSLazyPublicKey& GetLazy() const
+    {
+        static const CBLSLazyPublicKey nullKey;
+        return key ? *key : nullKey;
+    }
+
+public:
+    CDeterministicMNOperatorKey() {}
+
+    void Set(const CBLSPublicKey& pubKey)
+    {
+        CBLSLazyPublicKey lazyKey;
+        lazyKey.Set(pubKey);
+        key = Intern(lazyKey);
+    }
+    const CBLSPublicKey& Get() const
+    {
+        return GetLazy().Get();
+    }
+    uint256 GetHash() const
+    {
+        return GetLazy().GetHash();
+    }
+    operator const CBLSLazyPublicKey&() const
+    {
+        return GetLazy();
+    }
+
+    bool operator==(const CDeterministicMNOperatorKey& r) const
+    {
+        return key == r.key || GetLazy() == r.GetLazy();
+    }
+    bool operator!=(const CDeterministicMNOperatorKey& r) const
+    {
+        return !(*this == r);
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        GetLazy().Serialize(s);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        CBLSLazyPublicKey lazyKey;
+        lazyKey.Unserialize(s);
+        key = Intern(lazyKey);
+    }
+
+    // number of distinct keys currently in use
+    static size_t GetInternedCount();
+};
+
 class CDeterministicMNState
 {
 public:
@@ -44,7 +113,7 @@ public:
     uint256 confirmedHashWithProRegTxHash;
 
     CKeyID keyIDOwner;
-    CBLSLazyPublicKey pubKeyOperator;
+    CDeterministicMNOperatorKey pubKeyOperator;
     CKeyID keyIDVoting;
     CService addr;
     CScript scriptPayout;
@@ -623,6 +692,19 @@ public:
     }
 };
 
+struct CDeterministicMNListsCacheStats
+{
+    size_t nLists{0};
+    // MN entries summed over all cached lists
+    size_t nEntries{0};
+    // distinct MN and state objects, most of them are shared between lists
+    size_t nMNs{0};
+    size_t nStates{0};
+    size_t nOperatorKeys{0};
+    // estimated heap usage of the distinct objects, the nodes of the immer maps are not included
+    size_t nUsage{0};
+};
+
 class CDeterministicMNManager
 {
     static const int SNAPSHOT_LIST_PERIOD = 576; // once per day
@@ -652,12 +734,16 @@ public:
 
     CDeterministicMNList GetListForBlock(const CBlockIndex* pindex);
     CDeterministicMNList GetListAtChainTip();
+    // the SML changes of a block in the active chain, as written by ProcessBlock
+    bool GetSimplifiedBlockDiff(const uint256& blockHash, CSimplifiedMNListBlockDiff& smlDiffRet);
 
     // Test if given TX is a ProRegTx which also contains the collateral at index n
     bool IsProTxWithCollateral(const CTransactionRef& tx, uint32_t n);
 
     bool IsDIP3Enforced(int nHeight = -1);
 
+    void GetListsCacheStats(CDeterministicMNListsCacheStats& stats);
+
 public:
     // TODO these can all be removed in a future version
     bool UpgradeDiff(CDBBatch& batch, const CBlockIndex* pindexNext, const CDeterministicMNList& curMNList, CDeterministicMNList& newMNList);
@@ -14,7 +14,10 @@
 #include "base58.h"
 #include "chainparams.h"
 #include "consensus/merkle.h"
+#include "saltedhasher.h"
+#include "sync.h"
 #include "univalue.h"
+#include "unordered_lru_cache.h"
 #include "validation.h"
 
 CSimplifiedMNListEntry::CSimplifiedMNListEntry(const CDeterministicMN& dmn) :
@@ -88,6 +91,208 @@ uint256 CSimplifiedMNList::CalcMerkleRoot(bool* pmutated) const
     return ComputeMerkleRoot(leaves, pmutated);
 }
 
+static uint256 HashMerkleNodes(const uint256& left, const uint256& right)
+{
+    return Hash(BEGIN(left), END(left), BEGIN(right), END(right));
+}
+
+void CSimplifiedMNListMerkleTree::Build(const CDeterministicMNList& dmnList)
+{
+    std::vector<std::pair<uint256, uint256>> leaves;
+    leaves.reserve(dmnList.GetAllMNsCount());
+    dmnList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
+        leaves.emplace_back(dmn->proTxHash, CSimplifiedMNListEntry(*dmn).CalcHash());
+    });
+    std::sort(leaves.begin(), leaves.end(), [](const std::pair<uint256, uint256>& a, const std::pair<uint256, uint256>& b) {
+        return a.first < b.first;
+    });
+
+    proTxHashes.clear();
+    proTxHashes.reserve(leaves.size());
+    levels.assign(1, std::vector<uint256>());
+    levels[0].reserve(leaves.size());
+    for (const auto& p : leaves) {
+        proTxHashes.emplace_back(p.first);
+        levels[0].emplace_back(p.second);
+    }
+
+    nMutated = 0;
+    RebuildFrom(0);
+}
+
+void CSimplifiedMNListMerkleTree::ApplyDiff(const CDeterministicMNList& oldList, const CDeterministicMNList& newList, const CDeterministicMNListDiff& diff)
+{
+    std::vector<std::pair<size_t, uint256>> updated;
+    updated.reserve(diff.updatedMNs.size());
+    for (const auto& p : diff.updatedMNs) {
+        auto dmn = newList.GetMNByInternalId(p.first);
+        assert(dmn);
+        updated.emplace_back(FindLeaf(dmn->proTxHash), CSimplifiedMNListEntry(*dmn).CalcHash());
+    }
+
+    std::vector<size_t> removed;
+    removed.reserve(diff.removedMns.size());
+    for (const auto& id : diff.removedMns) {
+        auto dmn = oldList.GetMNByInternalId(id);
+        assert(dmn);
+        removed.emplace_back(FindLeaf(dmn->proTxHash));
+    }
+    std::sort(removed.begin(), removed.end());
+
+    std::vector<std::pair<uint256, uint256>> added;
+    added.reserve(diff.addedMNs.size());
+    for (const auto& dmn : diff.addedMNs) {
+        added.emplace_back(dmn->proTxHash, CSimplifiedMNListEntry(*dmn).CalcHash());
+    }
+    std::sort(added.begin(), added.end(), [](const std::pair<uint256, uint256>& a, const std::pair<uint256, uint256>& b) {
+        return a.first < b.first;
+    });
+
+    // leaves in front of the first added or removed one keep their position
+    size_t nFirstShifted = proTxHashes.size();
+    if (!removed.empty()) {
+        nFirstShifted = removed.front();
+    }
+    if (!added.empty()) {
+        auto it = std::lower_bound(proTxHashes.begin(), proTxHashes.end(), added.front().first);
+        nFirstShifted = std::min(nFirstShifted, (size_t)(it - proTxHashes.begin()));
+    }
+
+    for (const auto& p : updated) {
+        if (p.first < nFirstShifted) {
+            UpdateLeaf(p.first, p.second);
+        }
+    }
+    if (removed.empty() && added.empty()) {
+        return;
+    }
+
+    nMutated -= CountMutatedFrom(nFirstShifted);
+    for (const auto& p : updated) {
+        if (p.first >= nFirstShifted) {
+            levels[0][p.first] = p.second;
+        }
+    }
+
+    // merge the remaining leaves behind nFirstShifted with the added ones
+    std::vector<uint256> tailProTxHashes;
+    std::vector<uint256> tailLeaves;
+    size_t nTailSize = proTxHashes.size() - nFirstShifted - removed.size() + added.size();
+    tailProTxHashes.reserve(nTailSize);
+    tailLeaves.reserve(nTailSize);
+
+    auto itRemoved = removed.begin();
+    auto itAdded = added.begin();
+    for (size_t i = nFirstShifted; i < proTxHashes.size(); i++) {
+        if (itRemoved != removed.end() && *itRemoved == i) {
+            ++itRemoved;
+            continue;
+        }
+        for (; itAdded != added.end() && itAdded->first < proTxHashes[i]; ++itAdded) {
+            tailProTxHashes.emplace_back(itAdded->first);
+            tailLeaves.emplace_back(itAdded->second);
+        }
+        tailProTxHashes.emplace_back(proTxHashes[i]);
+        tailLeaves.emplace_back(levels[0][i]);
+    }
+    for (; itAdded != added.end(); ++itAdded) {
+        tailProTxHashes.emplace_back(itAdded->first);
+        tailLeaves.emplace_back(itAdded->second);
+    }
+
+    proTxHashes.resize(nFirstShifted);
+    proTxHashes.insert(proTxHashes.end(), tailProTxHashes.begin(), tailProTxHashes.end());
+    levels[0].resize(nFirstShifted);
+    levels[0].insert(levels[0].end(), tailLeaves.begin(), tailLeaves.end());
+
+    RebuildFrom(nFirstShifted);
+}
+
+uint256 CSimplifiedMNListMerkleTree::GetMerkleRoot(bool* pmutated) const
+{
+    if (pmutated) {
+        *pmutated = nMutated != 0;
+    }
+    if (levels[0].empty()) {
+        return uint256();
+    }
+    return levels.back()[0];
+}
+
+size_t CSimplifiedMNListMerkleTree::FindLeaf(const uint256& proTxHash) const
+{
+    auto it = std::lower_bound(proTxHashes.begin(), proTxHashes.end(), proTxHash);
+    assert(it != proTxHashes.end() && *it == proTxHash);
+    return it - proTxHashes.begin();
+}
+
+void CSimplifiedMNListMerkleTree::UpdateLeaf(size_t pos, const uint256& leafHash)
+{
+    if (levels[0][pos] == leafHash) {
+        return;
+    }
+
+    nMutated -= CountMutatedOnPath(pos);
+    levels[0][pos] = leafHash;
+    for (size_t l = 1, i = pos >> 1; l < levels.size(); l++, i >>= 1) {
+        const auto& below = levels[l - 1];
+        size_t left = i * 2;
+        levels[l][i] = HashMerkleNodes(below[left], below[std::min(left + 1, below.size() - 1)]);
+    }
+    nMutated += CountMutatedOnPath(pos);
+}
+
+void CSimplifiedMNListMerkleTree::RebuildFrom(size_t nFirstLeaf)
+{
+    size_t nLevels = 1;
+    for (size_t n = levels[0].size(); n > 1; n = (n + 1) / 2) {
+        nLevels++;
+    }
+    levels.resize(nLevels);
+
+    // an odd node at the end of a level is paired with itself, same as in ComputeMerkleRoot
+    for (size_t l = 1; l < nLevels; l++) {
+        const auto& below = levels[l - 1];
+        auto& level = levels[l];
+        level.resize((below.size() + 1) / 2);
+        for (size_t i = nFirstLeaf >> l; i < level.size(); i++) {
+            size_t left = i * 2;
+            level[i] = HashMerkleNodes(below[left], below[std::min(left + 1, below.size() - 1)]);
+        }
+    }
+
+    nMutated += CountMutatedFrom(nFirstLeaf);
+}
+
+// ComputeMerkleRoot only compares pairs whose right node covers a complete subtree, it doesn't check the pairs made up
+// when padding the last nodes of the levels
+size_t CSimplifiedMNListMerkleTree::CountMutatedFrom(size_t nFirstLeaf) const
+{
+    size_t n = levels[0].size();
+    size_t count = 0;
+    for (size_t l = 0; l + 1 < levels.size(); l++) {
+        for (size_t right = (nFirstLeaf >> l) | 1; ((right + 1) << l) <= n; right += 2) {
+            if (levels[l][right - 1] == levels[l][right]) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+size_t CSimplifiedMNListMerkleTree::CountMutatedOnPath(size_t pos) const
+{
+    size_t n = levels[0].size();
+    size_t count = 0;
+    for (size_t l = 0; l + 1 < levels.size(); l++) {
+        size_t right = (pos >> l) | 1;
+        if (((right + 1) << l) <= n && levels[l][right - 1] == levels[l][right]) {
+            count++;
+        }
+    }
+    return count;
+}
+
 CSimplifiedMNListDiff::CSimplifiedMNListDiff()
 {
 }
@@ -185,6 +390,97 @@ void CSimplifiedMNListDiff::ToJson(UniValue& obj) const
     }
 }
 
+static CPartialMerkleTree BuildCbTxMerkleTree(const CBlock& block)
+{
+    std::vector<uint256> vHashes;
+    std::vector<bool> vMatch(block.vtx.size(), false);
+    for (const auto& tx : block.vtx) {
+        vHashes.emplace_back(tx->GetHash());
+    }
+    vMatch[0] = true; // only coinbase matches
+    return CPartialMerkleTree(vHashes, vMatch);
+}
+
+void CSimplifiedMNListBlockDiff::Build(const CBlock& block, const CDeterministicMNList& oldList, const CDeterministicMNList& newList, const CDeterministicMNListDiff& diff)
+{
+    cbTx = block.vtx[0];
+    cbTxMerkleTree = BuildCbTxMerkleTree(block);
+
+    for (const auto& id : diff.removedMns) {
+        auto dmn = oldList.GetMNByInternalId(id);
+        assert(dmn);
+        deletedMNs.emplace_back(dmn->proTxHash);
+    }
+    for (const auto& dmn : diff.addedMNs) {
+        addedMNs.emplace_back(*dmn);
+    }
+    for (const auto& p : diff.updatedMNs) {
+        auto oldDmn = oldList.GetMNByInternalId(p.first);
+        auto newDmn = newList.GetMNByInternalId(p.first);
+        assert(oldDmn && newDmn);
+        CSimplifiedMNListEntry sme(*newDmn);
+        if (sme != CSimplifiedMNListEntry(*oldDmn)) {
+            updatedMNs.emplace_back(std::move(sme));
+        }
+    }
+}
+
+// Composing reads one block diff per block, longer ranges are cheaper to build from the two full lists, which are
+// mostly found in mnListsCache
+static const int MAX_COMPOSED_SML_DIFF_BLOCKS = 64;
+
+static bool ComposeSimplifiedMNListDiff(const CBlockIndex* baseBlockIndex, const CBlockIndex* blockIndex, CSimplifiedMNListDiff& mnListDiffRet)
+{
+    int nBlocks = blockIndex->nHeight - baseBlockIndex->nHeight;
+    if (nBlocks < 1 || nBlocks > MAX_COMPOSED_SML_DIFF_BLOCKS) {
+        return false;
+    }
+
+    // blocks connected before the block diffs were introduced don't have one, these fall back to the full lists
+    std::vector<CSimplifiedMNListBlockDiff> blockDiffs(nBlocks);
+    const CBlockIndex* pindex = blockIndex;
+    for (int i = nBlocks - 1; i >= 0; i--, pindex = pindex->pprev) {
+        if (!deterministicMNManager->GetSimplifiedBlockDiff(pindex->GetBlockHash(), blockDiffs[i])) {
+            return false;
+        }
+    }
+
+    // An entry which changed back to its state in the base list is still returned, applying it is a no-op
+    std::map<uint256, CSimplifiedMNListEntry> entries;
+    std::set<uint256> addedMNs;
+    std::set<uint256> deletedMNs;
+    for (const auto& blockDiff : blockDiffs) {
+        for (const auto& sme : blockDiff.addedMNs) {
+            addedMNs.emplace(sme.proRegTxHash);
+            entries[sme.proRegTxHash] = sme;
+        }
+        for (const auto& sme : blockDiff.updatedMNs) {
+            entries[sme.proRegTxHash] = sme;
+        }
+        for (const auto& proTxHash : blockDiff.deletedMNs) {
+            entries.erase(proTxHash);
+            // MNs which were registered and removed again inside the range are unknown to the peer
+            if (!addedMNs.erase(proTxHash)) {
+                deletedMNs.emplace(proTxHash);
+            }
+        }
+    }
+
+    mnListDiffRet.blockHash = blockIndex->GetBlockHash();
+    mnListDiffRet.cbTx = blockDiffs.back().cbTx;
+    mnListDiffRet.cbTxMerkleTree = blockDiffs.back().cbTxMerkleTree;
+    mnListDiffRet.deletedMNs.assign(deletedMNs.begin(), deletedMNs.end());
+    mnListDiffRet.mnList.reserve(entries.size());
+    for (const auto& p : entries) {
+        mnListDiffRet.mnList.emplace_back(p.second);
+    }
+    return true;
+}
+
+// Peers syncing the list mostly ask for the same few ranges, e.g. from their last known block to the tip
+static CCriticalSection cs_mnListDiffCache;
+static unordered_lru_cache<std::pair<uint256, uint256>, CSimplifiedMNListDiff, StaticSaltedHasher, 32> mnListDiffCache;
+
 bool BuildSimplifiedMNListDiff(const uint256& baseBlockHash, const uint256& blockHash, CSimplifiedMNListDiff& mnListDiffRet, std::string& errorRet)
 {
     AssertLockHeld(cs_main);
@@ -215,11 +511,35 @@ bool BuildSimplifiedMNListDiff(const uint256& baseBlockHash, const uint256& bloc
         return false;
     }
 
-    LOCK(deterministicMNManager->cs);
+    // Both blocks are in the active chain, so the diff between them can't have changed since it was cached
+    auto cacheKey = std::make_pair(baseBlockHash, blockHash);
+    {
+        LOCK(cs_mnListDiffCache);
+        if (mnListDiffCache.get(cacheKey, mnListDiffRet)) {
+            return true;
+        }
+    }
 
-    auto baseDmnList = deterministicMNManager->GetListForBlock(baseBlockIndex);
-    auto dmnList = deterministicMNManager->GetListForBlock(blockIndex);
-    mnListDiffRet = baseDmnList.BuildSimplifiedDiff(dmnList);
+    if (!ComposeSimplifiedMNListDiff(baseBlockIndex, blockIndex, mnListDiffRet)) {
+        mnListDiffRet = CSimplifiedMNListDiff();
+        {
+            LOCK(deterministicMNManager->cs);
+
+            auto baseDmnList = deterministicMNManager->GetListForBlock(baseBlockIndex);
+            auto dmnList = deterministicMNManager->GetListForBlock(blockIndex);
+            mnListDiffRet = baseDmnList.BuildSimplifiedDiff(dmnList);
+        }
+
+        // TODO store coinbase TX in CBlockIndex
+        CBlock block;
+        if (!ReadBlockFromDisk(block, blockIndex, Params().GetConsensus())) {
+            errorRet = strprintf("failed to read block %s from disk", blockHash.ToString());
+            return false;
+        }
+
+        mnListDiffRet.cbTx = block.vtx[0];
+        mnListDiffRet.cbTxMerkleTree = BuildCbTxMerkleTree(block);
+    }
 
     // We need to return the value that was provided by the other peer as it otherwise won't be able to recognize the
     // response. This will usually be identical to the block found in baseBlockIndex. The only difference is when a
@@ -231,22 +551,8 @@ bool BuildSimplifiedMNListDiff(const uint256& baseBlockHash, const uint256& bloc
         return false;
     }
 
-    // TODO store coinbase TX in CBlockIndex
-    CBlock block;
-    if (!ReadBlockFromDisk(block, blockIndex, Params().GetConsensus())) {
-        errorRet = strprintf("failed to read block %s from disk", blockHash.ToString());
-        return false;
-    }
-
-    mnListDiffRet.cbTx = block.vtx[0];
-
-    std::vector<uint256> vHashes;
-    std::vector<bool> vMatch(block.vtx.size(), false);
-    for (const auto& tx : block.vtx) {
-        vHashes.emplace_back(tx->GetHash());
-    }
-    vMatch[0] = true; // only coinbase matches
-    mnListDiffRet.cbTxMerkleTree = CPartialMerkleTree(vHashes, vMatch);
+    LOCK(cs_mnListDiffCache);
+    mnListDiffCache.insert(cacheKey, mnListDiffRet);
 
     return true;
 }
@@ -14,6 +14,7 @@
 
 class UniValue;
 class CDeterministicMNList;
+class CDeterministicMNListDiff;
 class CDeterministicMN;
 
 namespace llmq
@@ -84,6 +85,40 @@ public:
     uint256 CalcMerkleRoot(bool* pmutated = NULL) const;
 };
 
+/**
+ * Merkle tree over the SML entries of a deterministic MN list, sorted by proRegTxHash. All levels are kept, so when
+ * entries only change between two lists just the paths from their leaves up to the root are rehashed. Added and
+ * removed entries shift the leaves behind them, in this case the inner nodes from the first shifted leaf on are
+ * recomputed from the kept leaf hashes. Root and mutation flag are the same as of CSimplifiedMNList::CalcMerkleRoot.
+ */
+class CSimplifiedMNListMerkleTree
+{
+private:
+    // proRegTxHash of the entry of each leaf
+    std::vector<uint256> proTxHashes;
+    // levels[0] holds the leaf hashes, the last level the root
+    std::vector<std::vector<uint256>> levels;
+    // number of pairs which ComputeMerkleRoot would report as mutated
+    size_t nMutated{0};
+
+public:
+    CSimplifiedMNListMerkleTree() : levels(1) {}
+
+    void Build(const CDeterministicMNList& dmnList);
+    // oldList must be the list the tree currently represents and diff must lead from oldList to newList
+    void ApplyDiff(const CDeterministicMNList& oldList, const CDeterministicMNList& newList, const CDeterministicMNListDiff& diff);
+
+    uint256 GetMerkleRoot(bool* pmutated = NULL) const;
+    size_t GetLeafCount() const { return proTxHashes.size(); }
+
+private:
+    size_t FindLeaf(const uint256& proTxHash) const;
+    void UpdateLeaf(size_t pos, const uint256& leafHash);
+    void RebuildFrom(size_t nFirstLeaf);
+    size_t CountMutatedFrom(size_t nFirstLeaf) const;
+    size_t CountMutatedOnPath(size_t pos) const;
+};
+
 /// P2P messages
 
 class CGetSimplifiedMNListDiff
@@ -145,6 +180,40 @@ public:
     void ToJson(UniValue& obj) const;
 };
 
+/**
+ * The SML changes of one block and its coinbase with the merkle path to it, written by
+ * CDeterministicMNManager::ProcessBlock. Diffs over short ranges of the active chain are composed from these, without
+ * loading and comparing the two full lists or reading the last block from disk.
+ */
+class CSimplifiedMNListBlockDiff
+{
+public:
+    CPartialMerkleTree cbTxMerkleTree;
+    CTransactionRef cbTx;
+    std::vector<uint256> deletedMNs;
+    // entries of MNs registered in the block
+    std::vector<CSimplifiedMNListEntry> addedMNs;
+    // entries of MNs which existed before and whose SML entry changed in the block
+    std::vector<CSimplifiedMNListEntry> updatedMNs;
+
+public:
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(cbTxMerkleTree);
+        READWRITE(cbTx);
+        READWRITE(deletedMNs);
+        READWRITE(addedMNs);
+        READWRITE(updatedMNs);
+    }
+
+public:
+    // diff must lead from oldList to newList, which is the list after block
+    void Build(const CBlock& block, const CDeterministicMNList& oldList, const CDeterministicMNList& newList, const CDeterministicMNListDiff& diff);
+};
+
 bool BuildSimplifiedMNListDiff(const uint256& baseBlockHash, const uint256& blockHash, CSimplifiedMNListDiff& mnListDiffRet, std::string& errorRet);
 
 #endif //DASH_SIMPLIFIEDMNS_H
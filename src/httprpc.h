@@ -34,4 +34,12 @@ void InterruptREST();
  */
 void StopREST();
 
+/** Start serving the P2P message statistics in the Prometheus text format on /metrics.
+ * Precondition; HTTP has been started.
+ */
+bool StartHTTPMetrics();
+/** Stop serving the P2P message statistics.
+ */
+void StopHTTPMetrics();
+
 #endif
@@ -26,6 +26,7 @@ namespace llmq
 
 static const std::string DB_QUORUM_SK_SHARE = "q_Qsk";
 static const std::string DB_QUORUM_QUORUM_VVEC = "q_Qqvvec";
+static const std::string DB_QUORUM_PUBKEY_SHARES = "q_Qpkshares";
 
 CQuorumManager* quorumManager;
 
@@ -43,6 +44,11 @@ static uint256 MakeQuorumKey(const CQuorum& q)
 CQuorum::~CQuorum()
 {
     // most likely the thread is already done
+    StopCachePopulatorThread();
+}
+
+void CQuorum::StopCachePopulatorThread()
+{
     stopCachePopulatorThread = true;
     // watch out to not join the thread when we're called from inside the thread, which might happen on shutdown. This
     // is because on shutdown the thread is the last owner of the shared CQuorum instance and thus the destroyer of it.
@@ -84,6 +90,9 @@ CBLSPublicKey CQuorum::GetPubKeyShare(size_t memberIdx) const
     if (quorumVvec == nullptr || memberIdx >= members.size() || !qc.validMembers[memberIdx]) {
         return CBLSPublicKey();
     }
+    if (!pubKeyShares.empty()) {
+        return pubKeyShares[memberIdx].Get();
+    }
     auto& m = members[memberIdx];
     return blsCache.BuildPubKeyShare(m->proTxHash, quorumVvec, CBLSId::FromHash(m->proTxHash));
 }
@@ -133,7 +142,35 @@ bool CQuorum::ReadContributions(CEvoDB& evoDb)
     return true;
 }
 
-void CQuorum::StartCachePopulatorThread(std::shared_ptr<CQuorum> _this)
+// The public key shares are stored together with the hash of the quorum vvec they were recovered from, so that
+// they are only used with the vvec they belong to
+void CQuorum::WritePubKeyShares(CEvoDB& evoDb, const std::vector<CBLSLazyPublicKey>& _pubKeyShares) const
+{
+    auto k = std::make_pair(DB_QUORUM_PUBKEY_SHARES, MakeQuorumKey(*this));
+    evoDb.GetRawDB().Write(k, std::make_pair(::SerializeHash(*quorumVvec), _pubKeyShares));
+}
+
+bool CQuorum::ReadPubKeyShares(CEvoDB& evoDb)
+{
+    if (quorumVvec == nullptr) {
+        return false;
+    }
+
+    std::pair<uint256, std::vector<CBLSLazyPublicKey>> p;
+    if (!evoDb.Read(std::make_pair(DB_QUORUM_PUBKEY_SHARES, MakeQuorumKey(*this)), p)) {
+        return false;
+    }
+    if (p.first != ::SerializeHash(*quorumVvec) || p.second.size() != members.size()) {
+        LogPrint("llmq", "CQuorum::%s -- ignoring public key shares of quorum %s not matching the quorum vvec\n", __func__,
+                 qc.quorumHash.ToString());
+        return false;
+    }
+
+    pubKeyShares = std::move(p.second);
+    return true;
+}
+
+void CQuorum::StartCachePopulatorThread(std::shared_ptr<CQuorum> _this, CEvoDB& evoDb)
 {
     if (_this->quorumVvec == nullptr) {
         return;
@@ -144,13 +181,22 @@ void CQuorum::StartCachePopulatorThread(std::shared_ptr<CQuorum> _this)
 
     // this thread will exit after some time
     // when then later some other thread tries to get keys, it will be much faster
-    _this->cachePopulatorThread = std::thread([_this, t]() {
+    _this->cachePopulatorThread = std::thread([_this, t, &evoDb]() {
         RenameThread("dash-q-cachepop");
-        for (size_t i = 0; i < _this->members.size() && !_this->stopCachePopulatorThread && !ShutdownRequested(); i++) {
+        std::vector<CBLSLazyPublicKey> pubKeyShares(_this->members.size());
+        size_t i = 0;
+        for (; i < _this->members.size() && !_this->stopCachePopulatorThread && !ShutdownRequested(); i++) {
             if (_this->qc.validMembers[i]) {
-                _this->GetPubKeyShare(i);
+                pubKeyShares[i].Set(_this->GetPubKeyShare(i));
+            } else {
+                pubKeyShares[i].Set(CBLSPublicKey());
             }
         }
+        if (i == _this->members.size()) {
+            // persist the recovered shares so that we don't have to recover them again after a restart. evoDb is still
+            // alive, CQuorumManager stops this thread before it is destroyed
+            _this->WritePubKeyShares(evoDb, pubKeyShares);
+        }
         LogPrint("llmq", "CQuorum::StartCachePopulatorThread -- done. time=%d\n", t.count());
     });
 }
@@ -162,6 +208,26 @@ CQuorumManager::CQuorumManager(CEvoDB& _evoDb, CBLSWorker& _blsWorker, CDKGSessi
 {
 }
 
+CQuorumManager::~CQuorumManager()
+{
+    StopCachePopulatorThreads();
+}
+
+void CQuorumManager::StopCachePopulatorThreads()
+{
+    // every quorum with a cache populator thread was built by this manager and is still in quorumsCache
+    std::vector<CQuorumPtr> quorums;
+    {
+        LOCK(quorumsCacheCs);
+        for (const auto& p : quorumsCache) {
+            quorums.emplace_back(p.second);
+        }
+    }
+    for (auto& quorum : quorums) {
+        quorum->StopCachePopulatorThread();
+    }
+}
+
 void CQuorumManager::UpdatedBlockTip(const CBlockIndex* pindexNew, bool fInitialDownload)
 {
     if (!masternodeSync.IsBlockchainSynced()) {
@@ -249,11 +315,11 @@ bool CQuorumManager::BuildQuorumFromCommitment(const CFinalCommitment& qc, const
         }
     }
 
-    if (hasValidVvec) {
+    if (hasValidVvec && !quorum->ReadPubKeyShares(evoDb)) {
         // pre-populate caches in the background
         // recovering public key shares is quite expensive and would result in serious lags for the first few signing
         // sessions if the shares would be calculated on-demand
-        CQuorum::StartCachePopulatorThread(quorum);
+        CQuorum::StartCachePopulatorThread(quorum, evoDb);
     }
 
     return true;
@@ -52,6 +52,10 @@ private:
     std::atomic<bool> stopCachePopulatorThread;
     std::thread cachePopulatorThread;
 
+    // Public key shares of all members as persisted by the cache populator thread after a previous start. These are
+    // only decompressed on first use and thus don't need the cache populator thread
+    std::vector<CBLSLazyPublicKey> pubKeyShares;
+
 public:
     CQuorum(const Consensus::LLMQParams& _params, CBLSWorker& _blsWorker) : params(_params), blsCache(_blsWorker), stopCachePopulatorThread(false) {}
     ~CQuorum();
@@ -64,10 +68,16 @@ public:
     CBLSPublicKey GetPubKeyShare(size_t memberIdx) const;
     CBLSSecretKey GetSkShare() const;
 
+    // Persists the public key shares of all members together with the hash of the current quorum vvec
+    void WritePubKeyShares(CEvoDB& evoDb, const std::vector<CBLSLazyPublicKey>& _pubKeyShares) const;
+    // Loads persisted public key shares, fails if they were recovered from another quorum vvec
+    bool ReadPubKeyShares(CEvoDB& evoDb);
+
 private:
     void WriteContributions(CEvoDB& evoDb);
     bool ReadContributions(CEvoDB& evoDb);
-    static void StartCachePopulatorThread(std::shared_ptr<CQuorum> _this);
+    static void StartCachePopulatorThread(std::shared_ptr<CQuorum> _this, CEvoDB& evoDb);
+    void StopCachePopulatorThread();
 };
 typedef std::shared_ptr<CQuorum> CQuorumPtr;
 typedef std::shared_ptr<const CQuorum> CQuorumCPtr;
@@ -91,6 +101,10 @@ private:
 
 public:
     CQuorumManager(CEvoDB& _evoDb, CBLSWorker& _blsWorker, CDKGSessionManager& _dkgManager);
+    ~CQuorumManager();
+
+    // The cache populator threads write to evoDb, so they must be stopped before it is destroyed
+    void StopCachePopulatorThreads();
 
     void UpdatedBlockTip(const CBlockIndex *pindexNew, bool fInitialDownload);
 
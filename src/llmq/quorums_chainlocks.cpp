@@ -451,18 +451,33 @@ bool CChainLocksHandler::IsTxSafeForMining(const uint256& txid)
         if (!isSporkActive) {
             return true;
         }
+        if (txsSafeForMining.count(txid)) {
+            return true;
+        }
         auto it = txFirstSeenTime.find(txid);
         if (it != txFirstSeenTime.end()) {
             txAge = GetAdjustedTime() - it->second;
         }
+        if (txAge >= WAIT_FOR_ISLOCK_TIMEOUT) {
+            txsSafeForMining.emplace(txid);
+            return true;
+        }
     }
 
-    if (txAge < WAIT_FOR_ISLOCK_TIMEOUT && !quorumInstantSendManager->IsLocked(txid)) {
+    // only TXs which arrived before NotifyTxLocked was called for them (e.g. before a restart) end up here
+    if (!quorumInstantSendManager->IsLocked(txid)) {
         return false;
     }
+    NotifyTxLocked(txid);
     return true;
 }
 
+void CChainLocksHandler::NotifyTxLocked(const uint256& txid)
+{
+    LOCK(cs);
+    txsSafeForMining.emplace(txid);
+}
+
 // WARNING: cs_main and cs should not be held!
 // This should also not be called from validation signals, as this might result in recursive calls
 void CChainLocksHandler::EnforceBestChainLock()
@@ -686,6 +701,9 @@ void CChainLocksHandler::Cleanup()
             it = blockTxs.erase(it);
         } else if (InternalHasConflictingChainLock(pindex->nHeight, pindex->GetBlockHash())) {
             it = blockTxs.erase(it);
+        } else if (chainActive.Height() - pindex->nHeight >= BLOCK_TXS_MAX_DEPTH) {
+            // not looked at by TrySignChainTip anymore
+            it = blockTxs.erase(it);
         } else {
             ++it;
         }
@@ -708,6 +726,13 @@ void CChainLocksHandler::Cleanup()
             ++it;
         }
     }
+    for (auto it = txsSafeForMining.begin(); it != txsSafeForMining.end(); ) {
+        if (!mempool.exists(*it)) {
+            it = txsSafeForMining.erase(it);
+        } else {
+            ++it;
+        }
+    }
 
     lastCleanupTime = GetTimeMillis();
 }
@@ -48,6 +48,8 @@ class CChainLocksHandler : public CRecoveredSigsListener
 
     // how long to wait for ixlocks until we consider a block with non-ixlocked TXs to be safe to sign
     static const int64_t WAIT_FOR_ISLOCK_TIMEOUT = 10 * 60;
+    // TrySignChainTip only looks at the tip and the previous 5 blocks, txids of deeper blocks are not kept
+    static const int BLOCK_TXS_MAX_DEPTH = 6;
 
 private:
     CScheduler* scheduler;
@@ -71,6 +73,9 @@ private:
     typedef std::unordered_map<uint256, std::shared_ptr<std::unordered_set<uint256, StaticSaltedHasher>>> BlockTxs;
     BlockTxs blockTxs;
     std::unordered_map<uint256, int64_t> txFirstSeenTime;
+    // TXs which are known to be ixlocked or old enough, so that IsTxSafeForMining doesn't need to ask the InstantSend
+    // manager again. Only mempool TXs are kept here
+    std::unordered_set<uint256, StaticSaltedHasher> txsSafeForMining;
 
     std::map<uint256, int64_t> seenChainLocks;
 
@@ -100,6 +105,7 @@ public:
     bool HasConflictingChainLock(int nHeight, const uint256& blockHash);
 
     bool IsTxSafeForMining(const uint256& txid);
+    void NotifyTxLocked(const uint256& txid);
 
 private:
     // these require locks to be held already
@@ -109,6 +109,19 @@ UniValue CDKGDebugSessionStatus::ToJson(int detailLevel) const
         ret.push_back(Pair("allMembers", arr));
     }
 
+    // indexed by QuorumPhase
+    static const char* phaseNames[] = {"", "initialized", "contribute", "complain", "justify", "commit", "finalize", "idle"};
+    UniValue timingsJson(UniValue::VOBJ);
+    for (const auto& p : phaseTimings) {
+        std::string name = p.first < sizeof(phaseNames) / sizeof(phaseNames[0]) ? phaseNames[p.first] : std::to_string(p.first);
+        UniValue t(UniValue::VOBJ);
+        t.push_back(Pair("startTimeMs", p.second.nStartTime / 1000));
+        t.push_back(Pair("processTimeMs", p.second.nProcessTime / 1000));
+        t.push_back(Pair("messages", (int)p.second.nMessages));
+        timingsJson.push_back(Pair(name, t));
+    }
+    ret.push_back(Pair("phaseTimings", timingsJson));
+
     return ret;
 }
 
@@ -174,6 +187,7 @@ void CDKGDebugManager::InitLocalSessionStatus(Consensus::LLMQType llmqType, cons
     session.statusBitset = 0;
     session.members.clear();
     session.members.resize((size_t)params.size);
+    session.phaseTimings.clear();
 }
 
 void CDKGDebugManager::UpdateLocalStatus(std::function<bool(CDKGDebugStatus& status)>&& func)
@@ -9,6 +9,7 @@
 #include "sync.h"
 #include "univalue.h"
 
+#include <map>
 #include <set>
 
 class CDataStream;
@@ -44,6 +45,16 @@ public:
     CDKGDebugMemberStatus() : statusBitset(0) {}
 };
 
+class CDKGDebugPhaseTiming
+{
+public:
+    // time spent in the function which starts the phase, e.g. sending our own messages
+    int64_t nStartTime{0};
+    // time spent on deserializing, verifying and processing received messages
+    int64_t nProcessTime{0};
+    uint32_t nMessages{0};
+};
+
 class CDKGDebugSessionStatus
 {
 public:
@@ -68,6 +79,9 @@ public:
 
     std::vector<CDKGDebugMemberStatus> members;
 
+    // timings in microseconds per phase
+    std::map<uint8_t, CDKGDebugPhaseTiming> phaseTimings;
+
 public:
     CDKGDebugSessionStatus() : statusBitset(0) {}
 
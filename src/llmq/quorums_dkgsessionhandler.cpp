@@ -14,6 +14,8 @@
 #include "net_processing.h"
 #include "validation.h"
 
+#include "cxxtimer.hpp"
+
 namespace llmq
 {
 
@@ -92,7 +94,8 @@ CDKGSessionHandler::CDKGSessionHandler(const Consensus::LLMQParams& _params, ctp
     pendingContributions((size_t)_params.size * 2), // we allow size*2 messages as we need to make sure we see bad behavior (double messages)
     pendingComplaints((size_t)_params.size * 2),
     pendingJustifications((size_t)_params.size * 2),
-    pendingPrematureCommitments((size_t)_params.size * 2)
+    pendingPrematureCommitments((size_t)_params.size * 2),
+    fParallelVerify(GetBoolArg("-llmqparalleldkg", DEFAULT_LLMQ_PARALLEL_DKG))
 {
     phaseHandlerThread = std::thread([this] {
         RenameThread(strprintf("dash-q-phase-%d", (uint8_t)params.type).c_str());
@@ -167,6 +170,9 @@ std::pair<QuorumPhase, uint256> CDKGSessionHandler::GetPhaseAndQuorumHash() cons
     return std::make_pair(phase, quorumHash);
 }
 
+// number of messages whose signatures are verified in one job when verifying in parallel
+static const size_t SIG_VERIFY_CHUNK_SIZE = 8;
+
 class AbortPhaseException : public std::exception {
 };
 
@@ -262,7 +268,15 @@ void CDKGSessionHandler::HandlePhase(QuorumPhase curPhase,
                                      const WhileWaitFunc& runWhileWaiting)
 {
     SleepBeforePhase(curPhase, expectedQuorumHash, randomSleepFactor, runWhileWaiting);
+
+    cxxtimer::Timer t1(true);
     startPhaseFunc();
+    t1.stop();
+    quorumDKGDebugManager->UpdateLocalSessionStatus(params.type, [&](CDKGDebugSessionStatus& status) {
+        status.phaseTimings[(uint8_t)curPhase].nStartTime += t1.count<std::chrono::microseconds>();
+        return false;
+    });
+
     WaitForNextPhase(curPhase, nextPhase, expectedQuorumHash, runWhileWaiting);
 }
 
@@ -362,55 +376,120 @@ std::set<NodeId> BatchVerifyMessageSigs(CDKGSession& session, const std::vector<
 }
 
 template<typename Message>
-bool ProcessPendingMessageBatch(CDKGSession& session, CDKGPendingMessages& pendingMessages, size_t maxCount)
+struct PreVerifiedMessage
+{
+    NodeId nodeId;
+    std::shared_ptr<Message> msg;
+    uint256 hash;
+    bool valid{false};
+    bool ban{false};
+};
+
+// deserializes and pre-verifies a single message, might run on the BLS worker pool. msg is nullptr if deserialization failed
+template<typename Message>
+PreVerifiedMessage<Message> PreVerifyPendingMessage(const CDKGSession& session, const CDKGPendingMessages::BinaryMessage& bm)
+{
+    PreVerifiedMessage<Message> ret;
+    ret.nodeId = bm.first;
+    ret.msg = std::make_shared<Message>();
+    try {
+        *bm.second >> *ret.msg;
+    } catch (...) {
+        ret.msg = nullptr;
+        return ret;
+    }
+    ret.hash = ::SerializeHash(*ret.msg);
+    ret.valid = session.PreVerifyMessage(ret.hash, *ret.msg, ret.ban);
+    return ret;
+}
+
+template<typename Message>
+bool CDKGSessionHandler::ProcessPendingMessageBatch(QuorumPhase curPhase, CDKGPendingMessages& pendingMessages, size_t maxCount)
 {
-    auto msgs = pendingMessages.PopAndDeserializeMessages<Message>(maxCount);
-    if (msgs.empty()) {
+    // the parallel path takes larger batches so that all workers get something to do
+    auto binaryMessages = pendingMessages.PopPendingMessages(fParallelVerify ? maxCount * 4 : maxCount);
+    if (binaryMessages.empty()) {
         return false;
     }
 
+    cxxtimer::Timer t1(true);
+
+    // keep the session alive while jobs on the worker pool reference it
+    std::shared_ptr<CDKGSession> session = curSession;
+
+    std::vector<PreVerifiedMessage<Message>> msgs;
+    msgs.reserve(binaryMessages.size());
+    if (fParallelVerify) {
+        // PreVerifyMessage only reads the session, which is not modified until ReceiveMessage is called below
+        std::vector<std::future<PreVerifiedMessage<Message>>> futures;
+        futures.reserve(binaryMessages.size());
+        for (auto& bm : binaryMessages) {
+            futures.emplace_back(blsWorker.AsyncRun([session, bm](int threadId) {
+                return PreVerifyPendingMessage<Message>(*session, bm);
+            }));
+        }
+        for (auto& f : futures) {
+            msgs.emplace_back(f.get());
+        }
+    } else {
+        for (const auto& bm : binaryMessages) {
+            msgs.emplace_back(PreVerifyPendingMessage<Message>(*session, bm));
+        }
+    }
+
     std::vector<uint256> hashes;
     std::vector<std::pair<NodeId, std::shared_ptr<Message>>> preverifiedMessages;
     hashes.reserve(msgs.size());
     preverifiedMessages.reserve(msgs.size());
 
     for (const auto& p : msgs) {
-        if (!p.second) {
-            LogPrintf("%s -- failed to deserialize message, peer=%d\n", __func__, p.first);
+        if (!p.msg) {
+            LogPrintf("%s -- failed to deserialize message, peer=%d\n", __func__, p.nodeId);
             {
                 LOCK(cs_main);
-                Misbehaving(p.first, 100);
+                Misbehaving(p.nodeId, 100);
             }
             continue;
         }
-        const auto& msg = *p.second;
 
-        auto hash = ::SerializeHash(msg);
         {
             LOCK(cs_main);
-            g_connman->RemoveAskFor(hash);
+            g_connman->RemoveAskFor(p.hash);
         }
 
-        bool ban = false;
-        if (!session.PreVerifyMessage(hash, msg, ban)) {
-            if (ban) {
-                LogPrintf("%s -- banning node due to failed preverification, peer=%d\n", __func__, p.first);
+        if (!p.valid) {
+            if (p.ban) {
+                LogPrintf("%s -- banning node due to failed preverification, peer=%d\n", __func__, p.nodeId);
                 {
                     LOCK(cs_main);
-                    Misbehaving(p.first, 100);
+                    Misbehaving(p.nodeId, 100);
                 }
             }
-            LogPrintf("%s -- skipping message due to failed preverification, peer=%d\n", __func__, p.first);
+            LogPrintf("%s -- skipping message due to failed preverification, peer=%d\n", __func__, p.nodeId);
             continue;
         }
-        hashes.emplace_back(hash);
-        preverifiedMessages.emplace_back(p);
-    }
-    if (preverifiedMessages.empty()) {
-        return true;
+        hashes.emplace_back(p.hash);
+        preverifiedMessages.emplace_back(p.nodeId, p.msg);
     }
 
-    auto badNodes = BatchVerifyMessageSigs(session, preverifiedMessages);
+    std::set<NodeId> badNodes;
+    if (fParallelVerify && preverifiedMessages.size() > SIG_VERIFY_CHUNK_SIZE) {
+        // verify the signatures in chunks on the worker pool, a bad signature only forces single verification of its own chunk
+        std::vector<std::future<std::set<NodeId>>> futures;
+        for (size_t i = 0; i < preverifiedMessages.size(); i += SIG_VERIFY_CHUNK_SIZE) {
+            size_t end = std::min(i + SIG_VERIFY_CHUNK_SIZE, preverifiedMessages.size());
+            std::vector<std::pair<NodeId, std::shared_ptr<Message>>> chunk(preverifiedMessages.begin() + i, preverifiedMessages.begin() + end);
+            futures.emplace_back(blsWorker.AsyncRun([session, chunk](int threadId) {
+                return BatchVerifyMessageSigs(*session, chunk);
+            }));
+        }
+        for (auto& f : futures) {
+            auto chunkBadNodes = f.get();
+            badNodes.insert(chunkBadNodes.begin(), chunkBadNodes.end());
+        }
+    } else {
+        badNodes = BatchVerifyMessageSigs(*session, preverifiedMessages);
+    }
     if (!badNodes.empty()) {
         LOCK(cs_main);
         for (auto nodeId : badNodes) {
@@ -419,6 +498,7 @@ bool ProcessPendingMessageBatch(CDKGSession& session, CDKGPendingMessages& pendi
         }
     }
 
+    // ReceiveMessage modifies the session and thus always happens in this thread
     for (size_t i = 0; i < preverifiedMessages.size(); i++) {
         NodeId nodeId = preverifiedMessages[i].first;
         if (badNodes.count(nodeId)) {
@@ -426,7 +506,7 @@ bool ProcessPendingMessageBatch(CDKGSession& session, CDKGPendingMessages& pendi
         }
         const auto& msg = *preverifiedMessages[i].second;
         bool ban = false;
-        session.ReceiveMessage(hashes[i], msg, ban);
+        session->ReceiveMessage(hashes[i], msg, ban);
         if (ban) {
             LogPrintf("%s -- banning node after ReceiveMessage failed, peer=%d\n", __func__, nodeId);
             LOCK(cs_main);
@@ -435,6 +515,14 @@ bool ProcessPendingMessageBatch(CDKGSession& session, CDKGPendingMessages& pendi
         }
     }
 
+    t1.stop();
+    quorumDKGDebugManager->UpdateLocalSessionStatus(params.type, [&](CDKGDebugSessionStatus& status) {
+        auto& timing = status.phaseTimings[(uint8_t)curPhase];
+        timing.nProcessTime += t1.count<std::chrono::microseconds>();
+        timing.nMessages += (uint32_t)binaryMessages.size();
+        return false;
+    });
+
     return true;
 }
 
@@ -508,7 +596,7 @@ void CDKGSessionHandler::HandleDKGRound()
         curSession->Contribute(pendingContributions);
     };
     auto fContributeWait = [this] {
-        return ProcessPendingMessageBatch<CDKGContribution>(*curSession, pendingContributions, 8);
+        return ProcessPendingMessageBatch<CDKGContribution>(QuorumPhase_Contribute, pendingContributions, 8);
     };
     HandlePhase(QuorumPhase_Contribute, QuorumPhase_Complain, curQuorumHash, 0.05, fContributeStart, fContributeWait);
 
@@ -517,7 +605,7 @@ void CDKGSessionHandler::HandleDKGRound()
         curSession->VerifyAndComplain(pendingComplaints);
     };
     auto fComplainWait = [this] {
-        return ProcessPendingMessageBatch<CDKGComplaint>(*curSession, pendingComplaints, 8);
+        return ProcessPendingMessageBatch<CDKGComplaint>(QuorumPhase_Complain, pendingComplaints, 8);
     };
     HandlePhase(QuorumPhase_Complain, QuorumPhase_Justify, curQuorumHash, 0.05, fComplainStart, fComplainWait);
 
@@ -526,7 +614,7 @@ void CDKGSessionHandler::HandleDKGRound()
         curSession->VerifyAndJustify(pendingJustifications);
     };
     auto fJustifyWait = [this] {
-        return ProcessPendingMessageBatch<CDKGJustification>(*curSession, pendingJustifications, 8);
+        return ProcessPendingMessageBatch<CDKGJustification>(QuorumPhase_Justify, pendingJustifications, 8);
     };
     HandlePhase(QuorumPhase_Justify, QuorumPhase_Commit, curQuorumHash, 0.05, fJustifyStart, fJustifyWait);
 
@@ -535,7 +623,7 @@ void CDKGSessionHandler::HandleDKGRound()
         curSession->VerifyAndCommit(pendingPrematureCommitments);
     };
     auto fCommitWait = [this] {
-        return ProcessPendingMessageBatch<CDKGPrematureCommitment>(*curSession, pendingPrematureCommitments, 8);
+        return ProcessPendingMessageBatch<CDKGPrematureCommitment>(QuorumPhase_Commit, pendingPrematureCommitments, 8);
     };
     HandlePhase(QuorumPhase_Commit, QuorumPhase_Finalize, curQuorumHash, 0.1, fCommitStart, fCommitWait);
 
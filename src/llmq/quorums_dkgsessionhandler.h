@@ -117,6 +117,9 @@ private:
     CDKGPendingMessages pendingJustifications;
     CDKGPendingMessages pendingPrematureCommitments;
 
+    // pre-verify pending messages on the BLS worker pool (-llmqparalleldkg)
+    bool fParallelVerify;
+
 public:
     CDKGSessionHandler(const Consensus::LLMQParams& _params, ctpl::thread_pool& _messageHandlerPool, CBLSWorker& blsWorker, CDKGSessionManager& _dkgManager);
     ~CDKGSessionHandler();
@@ -135,6 +138,8 @@ private:
     void WaitForNewQuorum(const uint256& oldQuorumHash);
     void SleepBeforePhase(QuorumPhase curPhase, const uint256& expectedQuorumHash, double randomSleepFactor, const WhileWaitFunc& runWhileWaiting);
     void HandlePhase(QuorumPhase curPhase, QuorumPhase nextPhase, const uint256& expectedQuorumHash, double randomSleepFactor, const StartPhaseFunc& startPhaseFunc, const WhileWaitFunc& runWhileWaiting);
+    template<typename Message>
+    bool ProcessPendingMessageBatch(QuorumPhase curPhase, CDKGPendingMessages& pendingMessages, size_t maxCount);
     void HandleDKGRound();
     void PhaseHandlerThread();
 };
@@ -109,6 +109,9 @@ void StopLLMQSystem()
     if (quorumDKGSessionManager) {
         quorumDKGSessionManager->StopMessageHandlerPool();
     }
+    if (quorumManager) {
+        quorumManager->StopCachePopulatorThreads();
+    }
     if (blsWorker) {
         blsWorker->Stop();
     }
@@ -14,6 +14,8 @@ namespace llmq
 
 // If true, we will connect to all new quorums and watch their communication
 static const bool DEFAULT_WATCH_QUORUMS = false;
+// If true, DKG messages are deserialized and pre-verified on the BLS worker pool instead of the phase handler thread
+static const bool DEFAULT_LLMQ_PARALLEL_DKG = true;
 
 // Init/destroy LLMQ globals
 void InitLLMQSystem(CEvoDB& evoDb, CScheduler* scheduler, bool unitTests, bool fWipe = false);
@@ -31,6 +31,11 @@ namespace llmq
 static const std::string INPUTLOCK_REQUESTID_PREFIX = "inlock";
 static const std::string ISLOCK_REQUESTID_PREFIX = "islock";
 
+// maximum number of pending islocks verified in one round of the worker thread
+static const size_t MAX_PENDING_ISLOCKS_PER_ROUND = 256;
+// number of islocks whose signatures are aggregated and verified together
+static const size_t ISLOCK_VERIFY_SUB_BATCH_SIZE = 32;
+
 CInstantSendManager* quorumInstantSendManager;
 
 uint256 CInstantSendLock::GetRequestId() const
@@ -742,7 +747,17 @@ bool CInstantSendManager::ProcessPendingInstantSendLocks()
 
     {
         LOCK(cs);
-        pend = std::move(pendingInstantSendLocks);
+        // Only take a limited number of locks per round, so that during peaks locks which arrive in the meantime
+        // don't have to wait for one huge batch and ProcessPendingRetryLockTxs gets its turn in between
+        if (pendingInstantSendLocks.size() <= MAX_PENDING_ISLOCKS_PER_ROUND) {
+            pend = std::move(pendingInstantSendLocks);
+        } else {
+            while (pend.size() < MAX_PENDING_ISLOCKS_PER_ROUND) {
+                auto it = pendingInstantSendLocks.begin();
+                pend.emplace(it->first, std::move(it->second));
+                pendingInstantSendLocks.erase(it);
+            }
+        }
     }
 
     if (pend.empty()) {
@@ -763,54 +778,58 @@ bool CInstantSendManager::ProcessPendingInstantSendLocks()
 
     // Every time a new quorum enters the active set, an older one is removed. This means that between two blocks, the
     // active set can be different, leading to different selection of the signing quorum. When we detect such rotation
-    // of the active set, we must re-check invalid sigs against the previous active set and only ban nodes when this also
-    // fails.
-    auto quorums1 = quorumSigningManager->GetActiveQuorumSet(llmqType, tipHeight);
-    auto quorums2 = quorumSigningManager->GetActiveQuorumSet(llmqType, tipHeight - 1);
-    bool quorumsRotated = quorums1 != quorums2;
-
-    if (quorumsRotated) {
-        // first check against the current active set and don't ban
-        auto badISLocks = ProcessPendingInstantSendLocks(tipHeight, pend, false);
-        if (!badISLocks.empty()) {
-            LogPrintf("CInstantSendManager::%s -- detected LLMQ active set rotation, redoing verification on old active set\n", __func__);
-
-            // filter out valid IS locks from "pend"
-            for (auto it = pend.begin(); it != pend.end(); ) {
-                if (!badISLocks.count(it->first)) {
-                    it = pend.erase(it);
-                } else {
-                    ++it;
-                }
-            }
-            // now check against the previous active set and perform banning if this fails
-            ProcessPendingInstantSendLocks(tipHeight - 1, pend, true);
-        }
-    } else {
-        ProcessPendingInstantSendLocks(tipHeight, pend, true);
+    // of the active set, locks which fail verification are re-checked against the previous active set and nodes are
+    // only banned when this also fails.
+    // Both sets are retrieved once per round instead of once per lock.
+    auto quorums = quorumSigningManager->GetActiveQuorumSet(llmqType, tipHeight);
+    auto prevQuorums = quorumSigningManager->GetActiveQuorumSet(llmqType, tipHeight - 1);
+    if (prevQuorums == quorums) {
+        prevQuorums.clear();
     }
 
+    ProcessPendingInstantSendLocks(quorums, prevQuorums, pend);
+
     return true;
 }
 
-std::unordered_set<uint256> CInstantSendManager::ProcessPendingInstantSendLocks(int signHeight, const std::unordered_map<uint256, std::pair<NodeId, CInstantSendLock>>& pend, bool ban)
+std::unordered_set<uint256> CInstantSendManager::ProcessPendingInstantSendLocks(const std::vector<CQuorumCPtr>& quorums, const std::vector<CQuorumCPtr>& prevQuorums, const std::unordered_map<uint256, std::pair<NodeId, CInstantSendLock>>& pend)
 {
     auto llmqType = Params().GetConsensus().llmqForInstantSend;
 
-    CBLSBatchVerifier<NodeId, uint256> batchVerifier(false, true, 8);
-    std::unordered_map<uint256, std::pair<CQuorumCPtr, CRecoveredSig>> recSigs;
+    if (quorums.empty()) {
+        // should not happen, but if one fails to select, all others will also fail to select
+        return {};
+    }
+
+    std::unordered_set<uint256> badISLocks;
+    std::unordered_set<NodeId> badNodes;
+    // the quorum each lock is verified against, locks with an already known recovered sig are not verified again
+    std::unordered_map<uint256, CQuorumCPtr> lockQuorums;
+    // locks which were not verified because we already have the recovered sig
+    std::unordered_set<uint256> alreadyVerified;
+
+    // Verifies all locks in one aggregated pass, only falling back to verifying per node and lock when this fails.
+    // Returns the invalid locks
+    auto verifyLocks = [&](const std::unordered_map<uint256, CQuorumCPtr>& locks) {
+        CBLSBatchVerifier<NodeId, uint256> batchVerifier(false, true, ISLOCK_VERIFY_SUB_BATCH_SIZE);
+        for (const auto& p : locks) {
+            auto nodeId = pend.at(p.first).first;
+            auto& islock = pend.at(p.first).second;
+            uint256 signHash = CLLMQUtils::BuildSignHash(llmqType, p.second->qc.quorumHash, islock.GetRequestId(), islock.txid);
+            batchVerifier.PushMessage(nodeId, p.first, signHash, islock.sig.Get(), p.second->qc.quorumPublicKey);
+        }
+        batchVerifier.Verify();
+        return std::move(batchVerifier.badMessages);
+    };
 
     for (const auto& p : pend) {
         auto& hash = p.first;
         auto nodeId = p.second.first;
         auto& islock = p.second.second;
 
-        if (batchVerifier.badSources.count(nodeId)) {
-            continue;
-        }
-
         if (!islock.sig.Get().IsValid()) {
-            batchVerifier.badSources.emplace(nodeId);
+            badISLocks.emplace(hash);
+            badNodes.emplace(nodeId);
             continue;
         }
 
@@ -818,71 +837,86 @@ std::unordered_set<uint256> CInstantSendManager::ProcessPendingInstantSendLocks(
 
         // no need to verify an ISLOCK if we already have verified the recovered sig that belongs to it
         if (quorumSigningManager->HasRecoveredSig(llmqType, id, islock.txid)) {
+            alreadyVerified.emplace(hash);
             continue;
         }
 
-        auto quorum = quorumSigningManager->SelectQuorumForSigning(llmqType, signHeight, id);
-        if (!quorum) {
-            // should not happen, but if one fails to select, all others will also fail to select
-            return {};
-        }
-        uint256 signHash = CLLMQUtils::BuildSignHash(llmqType, quorum->qc.quorumHash, id, islock.txid);
-        batchVerifier.PushMessage(nodeId, hash, signHash, islock.sig.Get(), quorum->qc.quorumPublicKey);
-
-        // We can reconstruct the CRecoveredSig objects from the islock and pass it to the signing manager, which
-        // avoids unnecessary double-verification of the signature. We however only do this when verification here
-        // turns out to be good (which is checked further down)
-        if (!quorumSigningManager->HasRecoveredSigForId(llmqType, id)) {
-            CRecoveredSig recSig;
-            recSig.llmqType = llmqType;
-            recSig.quorumHash = quorum->qc.quorumHash;
-            recSig.id = id;
-            recSig.msgHash = islock.txid;
-            recSig.sig = islock.sig;
-            recSigs.emplace(std::piecewise_construct,
-                    std::forward_as_tuple(hash),
-                    std::forward_as_tuple(std::move(quorum), std::move(recSig)));
-        }
+        lockQuorums.emplace(hash, CSigningManager::SelectQuorumForSigning(llmqType, quorums, id));
     }
 
-    batchVerifier.Verify();
+    auto badMessages = verifyLocks(lockQuorums);
 
-    std::unordered_set<uint256> badISLocks;
+    // re-check the failed locks which the previous active set assigns to a different quorum
+    std::unordered_map<uint256, CQuorumCPtr> retryLocks;
+    for (const auto& hash : badMessages) {
+        if (!prevQuorums.empty()) {
+            auto prevQuorum = CSigningManager::SelectQuorumForSigning(llmqType, prevQuorums, pend.at(hash).second.GetRequestId());
+            if (prevQuorum && prevQuorum->qc.quorumHash != lockQuorums.at(hash)->qc.quorumHash) {
+                retryLocks.emplace(hash, std::move(prevQuorum));
+                continue;
+            }
+        }
+        badISLocks.emplace(hash);
+    }
+    if (!retryLocks.empty()) {
+        LogPrintf("CInstantSendManager::%s -- detected LLMQ active set rotation, redoing verification of %d islocks on old active set\n", __func__,
+                  retryLocks.size());
+        auto retryBadMessages = verifyLocks(retryLocks);
+        for (auto& p : retryLocks) {
+            if (retryBadMessages.count(p.first)) {
+                badISLocks.emplace(p.first);
+            } else {
+                lockQuorums.at(p.first) = std::move(p.second);
+            }
+        }
+    }
 
-    if (ban && !batchVerifier.badSources.empty()) {
+    for (const auto& hash : badISLocks) {
+        auto nodeId = pend.at(hash).first;
+        auto& islock = pend.at(hash).second;
+        LogPrintf("CInstantSendManager::%s -- txid=%s, islock=%s: invalid sig in islock, peer=%d\n", __func__,
+                 islock.txid.ToString(), hash.ToString(), nodeId);
+        badNodes.emplace(nodeId);
+    }
+    if (!badNodes.empty()) {
         LOCK(cs_main);
-        for (auto& nodeId : batchVerifier.badSources) {
+        for (auto& nodeId : badNodes) {
             // Let's not be too harsh, as the peer might simply be unlucky and might have sent us an old lock which
             // does not validate anymore due to changed quorums
             Misbehaving(nodeId, 20);
         }
     }
+
     for (const auto& p : pend) {
         auto& hash = p.first;
         auto nodeId = p.second.first;
         auto& islock = p.second.second;
 
-        if (batchVerifier.badMessages.count(hash)) {
-            LogPrintf("CInstantSendManager::%s -- txid=%s, islock=%s: invalid sig in islock, peer=%d\n", __func__,
-                     islock.txid.ToString(), hash.ToString(), nodeId);
-            badISLocks.emplace(hash);
+        if (badISLocks.count(hash)) {
             continue;
         }
 
         ProcessInstantSendLock(nodeId, hash, islock);
 
-        // See comment further on top. We pass a reconstructed recovered sig to the signing manager to avoid
-        // double-verification of the sig.
-        auto it = recSigs.find(hash);
-        if (it != recSigs.end()) {
-            auto& quorum = it->second.first;
-            auto& recSig = it->second.second;
-            if (!quorumSigningManager->HasRecoveredSigForId(llmqType, recSig.id)) {
-                recSig.UpdateHash();
-                LogPrint("instantsend", "CInstantSendManager::%s -- txid=%s, islock=%s: passing reconstructed recSig to signing mgr, peer=%d\n", __func__,
-                         islock.txid.ToString(), hash.ToString(), nodeId);
-                quorumSigningManager->PushReconstructedRecoveredSig(recSig, quorum);
-            }
+        if (alreadyVerified.count(hash)) {
+            continue;
+        }
+
+        // We can reconstruct the CRecoveredSig object from the islock and pass it to the signing manager, which
+        // avoids unnecessary double-verification of the signature.
+        auto& quorum = lockQuorums.at(hash);
+        auto id = islock.GetRequestId();
+        if (!quorumSigningManager->HasRecoveredSigForId(llmqType, id)) {
+            CRecoveredSig recSig;
+            recSig.llmqType = llmqType;
+            recSig.quorumHash = quorum->qc.quorumHash;
+            recSig.id = id;
+            recSig.msgHash = islock.txid;
+            recSig.sig = islock.sig;
+            recSig.UpdateHash();
+            LogPrint("instantsend", "CInstantSendManager::%s -- txid=%s, islock=%s: passing reconstructed recSig to signing mgr, peer=%d\n", __func__,
+                     islock.txid.ToString(), hash.ToString(), nodeId);
+            quorumSigningManager->PushReconstructedRecoveredSig(recSig, quorum);
         }
     }
 
@@ -952,6 +986,8 @@ void CInstantSendManager::ProcessInstantSendLock(NodeId from, const uint256& has
         RemoveNonLockedTx(islock.txid, true);
     }
 
+    chainLocksHandler->NotifyTxLocked(islock.txid);
+
     CInv inv(MSG_ISLOCK, hash);
     if (tx != nullptr) {
         g_connman->RelayInvFiltered(inv, *tx, LLMQS_PROTO_VERSION);
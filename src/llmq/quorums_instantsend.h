@@ -137,7 +137,7 @@ public:
     void ProcessMessageInstantSendLock(CNode* pfrom, const CInstantSendLock& islock, CConnman& connman);
     bool PreVerifyInstantSendLock(NodeId nodeId, const CInstantSendLock& islock, bool& retBan);
     bool ProcessPendingInstantSendLocks();
-    std::unordered_set<uint256> ProcessPendingInstantSendLocks(int signHeight, const std::unordered_map<uint256, std::pair<NodeId, CInstantSendLock>>& pend, bool ban);
+    std::unordered_set<uint256> ProcessPendingInstantSendLocks(const std::vector<CQuorumCPtr>& quorums, const std::vector<CQuorumCPtr>& prevQuorums, const std::unordered_map<uint256, std::pair<NodeId, CInstantSendLock>>& pend);
     void ProcessInstantSendLock(NodeId from, const uint256& hash, const CInstantSendLock& islock);
     void UpdateWalletTransaction(const uint256& txid, const CTransactionRef& tx);
 
@@ -24,6 +24,10 @@ namespace llmq
 
 CSigningManager* quorumSigningManager;
 
+// minimum number of keys the recovered sigs keys filter can hold before it needs to be rebuilt
+static const size_t MIN_KEYS_FILTER_CAPACITY = 100000;
+static const double KEYS_FILTER_FP_RATE = 0.001;
+
 UniValue CRecoveredSig::ToJson() const
 {
     UniValue ret(UniValue::VOBJ);
@@ -50,6 +54,81 @@ CRecoveredSigsDb::CRecoveredSigsDb(CDBWrapper& _db) :
 
         db.Write(std::string("rs_upgraded"), (uint8_t)1);
     }
+
+    RebuildKeysFilter(true);
+}
+
+template<typename K>
+static std::vector<unsigned char> KeysFilterKey(const K& key)
+{
+    // same serialization as used by CDBWrapper for its keys
+    CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+    ssKey << key;
+    return std::vector<unsigned char>(ssKey.begin(), ssKey.end());
+}
+
+template<typename K>
+void CRecoveredSigsDb::AddToKeysFilter(const K& key)
+{
+    AssertLockHeld(cs);
+    keysFilter->insert(KeysFilterKey(key));
+    nKeysFilterInserted++;
+}
+
+template<typename K>
+bool CRecoveredSigsDb::MaybeHasKey(const K& key)
+{
+    AssertLockHeld(cs);
+    if (nKeysFilterInserted > nKeysFilterCapacity) {
+        // older keys might have been rolled out already
+        return true;
+    }
+    return keysFilter->contains(KeysFilterKey(key));
+}
+
+void CRecoveredSigsDb::RebuildKeysFilter(bool fForce)
+{
+    LOCK(cs);
+
+    // rebuild when half of the capacity is used, so that it's not exceeded before the next cleanup
+    if (!fForce && nKeysFilterInserted <= nKeysFilterCapacity / 2) {
+        return;
+    }
+
+    int64_t nTime = GetTimeMillis();
+
+    std::vector<std::vector<unsigned char>> keys;
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    auto start = std::make_tuple(std::string("rs_r"));
+    pcursor->Seek(start);
+
+    while (pcursor->Valid()) {
+        std::tuple<std::string, uint8_t, uint256> k;
+        if (!pcursor->GetKey(k) || std::get<0>(k) != "rs_r") {
+            break;
+        }
+
+        CRecoveredSig recSig;
+        if (pcursor->GetKeySize() == ::GetSerializeSize(k, SER_DISK, CLIENT_VERSION) && pcursor->GetValue(recSig)) {
+            keys.emplace_back(KeysFilterKey(k));
+            keys.emplace_back(KeysFilterKey(std::make_tuple(std::string("rs_r"), recSig.llmqType, recSig.id, recSig.msgHash)));
+            keys.emplace_back(KeysFilterKey(std::make_tuple(std::string("rs_h"), recSig.GetHash())));
+            keys.emplace_back(KeysFilterKey(std::make_tuple(std::string("rs_s"), CLLMQUtils::BuildSignHash(recSig))));
+        }
+
+        pcursor->Next();
+    }
+    pcursor.reset();
+
+    nKeysFilterCapacity = std::max(MIN_KEYS_FILTER_CAPACITY, keys.size() * 4);
+    nKeysFilterInserted = keys.size();
+    keysFilter.reset(new CRollingBloomFilter(nKeysFilterCapacity, KEYS_FILTER_FP_RATE));
+    for (const auto& k : keys) {
+        keysFilter->insert(k);
+    }
+
+    LogPrint("llmq", "CRecoveredSigsDb::%s -- built keys filter with %d keys and capacity %d, time=%d\n", __func__,
+             keys.size(), nKeysFilterCapacity, GetTimeMillis() - nTime);
 }
 
 // This converts time values in "rs_t" from host endiannes to big endiannes, which is required to have proper ordering of the keys
@@ -128,22 +207,30 @@ void CRecoveredSigsDb::AddVoteTimeKeys()
 bool CRecoveredSigsDb::HasRecoveredSig(Consensus::LLMQType llmqType, const uint256& id, const uint256& msgHash)
 {
     auto k = std::make_tuple(std::string("rs_r"), (uint8_t)llmqType, id, msgHash);
+    {
+        LOCK(cs);
+        if (!MaybeHasKey(k)) {
+            return false;
+        }
+    }
     return db.Exists(k);
 }
 
 bool CRecoveredSigsDb::HasRecoveredSigForId(Consensus::LLMQType llmqType, const uint256& id)
 {
     auto cacheKey = std::make_pair(llmqType, id);
+    auto k = std::make_tuple(std::string("rs_r"), (uint8_t)llmqType, id);
     bool ret;
     {
         LOCK(cs);
+        if (!MaybeHasKey(k)) {
+            return false;
+        }
         if (hasSigForIdCache.get(cacheKey, ret)) {
             return ret;
         }
     }
 
-
-    auto k = std::make_tuple(std::string("rs_r"), (uint8_t)llmqType, id);
     ret = db.Exists(k);
 
     LOCK(cs);
@@ -153,15 +240,18 @@ bool CRecoveredSigsDb::HasRecoveredSigForId(Consensus::LLMQType llmqType, const
 
 bool CRecoveredSigsDb::HasRecoveredSigForSession(const uint256& signHash)
 {
+    auto k = std::make_tuple(std::string("rs_s"), signHash);
     bool ret;
     {
         LOCK(cs);
+        if (!MaybeHasKey(k)) {
+            return false;
+        }
         if (hasSigForSessionCache.get(signHash, ret)) {
             return ret;
         }
     }
 
-    auto k = std::make_tuple(std::string("rs_s"), signHash);
     ret = db.Exists(k);
 
     LOCK(cs);
@@ -171,15 +261,18 @@ bool CRecoveredSigsDb::HasRecoveredSigForSession(const uint256& signHash)
 
 bool CRecoveredSigsDb::HasRecoveredSigForHash(const uint256& hash)
 {
+    auto k = std::make_tuple(std::string("rs_h"), hash);
     bool ret;
     {
         LOCK(cs);
+        if (!MaybeHasKey(k)) {
+            return false;
+        }
         if (hasSigForHashCache.get(hash, ret)) {
             return ret;
         }
     }
 
-    auto k = std::make_tuple(std::string("rs_h"), hash);
     ret = db.Exists(k);
 
     LOCK(cs);
@@ -247,6 +340,15 @@ void CRecoveredSigsDb::WriteRecoveredSig(const llmq::CRecoveredSig& recSig)
     auto k5 = std::make_tuple(std::string("rs_t"), (uint32_t)htobe32(curTime), recSig.llmqType, recSig.id);
     batch.Write(k5, (uint8_t)1);
 
+    {
+        // add the keys before they hit the db, so that there is no point in time where the filter misses them
+        LOCK(cs);
+        AddToKeysFilter(k1);
+        AddToKeysFilter(k2);
+        AddToKeysFilter(k3);
+        AddToKeysFilter(k4);
+    }
+
     db.WriteBatch(batch);
 
     {
@@ -726,6 +828,7 @@ void CSigningManager::Cleanup()
 
     db.CleanupOldRecoveredSigs(maxAge);
     db.CleanupOldVotes(maxAge);
+    db.RebuildKeysFilter();
 
     lastCleanupTime = GetTimeMillis();
 }
@@ -881,7 +984,11 @@ std::vector<CQuorumCPtr> CSigningManager::GetActiveQuorumSet(Consensus::LLMQType
 
 CQuorumCPtr CSigningManager::SelectQuorumForSigning(Consensus::LLMQType llmqType, int signHeight, const uint256& selectionHash)
 {
-    auto quorums = GetActiveQuorumSet(llmqType, signHeight);
+    return SelectQuorumForSigning(llmqType, GetActiveQuorumSet(llmqType, signHeight), selectionHash);
+}
+
+CQuorumCPtr CSigningManager::SelectQuorumForSigning(Consensus::LLMQType llmqType, const std::vector<CQuorumCPtr>& quorums, const uint256& selectionHash)
+{
     if (quorums.empty()) {
         return nullptr;
     }
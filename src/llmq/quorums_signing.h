@@ -7,6 +7,7 @@
 
 #include "llmq/quorums.h"
 
+#include "bloom.h"
 #include "net.h"
 #include "chainparams.h"
 #include "saltedhasher.h"
@@ -71,6 +72,14 @@ private:
     unordered_lru_cache<uint256, bool, StaticSaltedHasher, 30000> hasSigForSessionCache;
     unordered_lru_cache<uint256, bool, StaticSaltedHasher, 30000> hasSigForHashCache;
 
+    // Contains the "rs_r", "rs_h" and "rs_s" keys of all recovered sigs in the db, so that lookups for missing sigs
+    // don't need to hit the db. Removed sigs stay in the filter until it's rebuilt. A rolling filter only guarantees
+    // to contain the last nKeysFilterCapacity insertions, so it is not used anymore when more keys than that were
+    // inserted since it was built
+    std::unique_ptr<CRollingBloomFilter> keysFilter;
+    size_t nKeysFilterCapacity{0};
+    size_t nKeysFilterInserted{0};
+
 public:
     CRecoveredSigsDb(CDBWrapper& _db);
 
@@ -95,9 +104,18 @@ public:
 
     void CleanupOldVotes(int64_t maxAge);
 
+    // Rebuilds the keys filter from the db if it can't be used anymore or got too full
+    void RebuildKeysFilter(bool fForce = false);
+
 private:
     bool ReadRecoveredSig(Consensus::LLMQType llmqType, const uint256& id, CRecoveredSig& ret);
     void RemoveRecoveredSig(CDBBatch& batch, Consensus::LLMQType llmqType, const uint256& id, bool deleteTimeKey);
+
+    template<typename K>
+    void AddToKeysFilter(const K& key);
+    // returns false if the key is definitely not in the db
+    template<typename K>
+    bool MaybeHasKey(const K& key);
 };
 
 class CRecoveredSigsListener
@@ -179,6 +197,8 @@ public:
 
     std::vector<CQuorumCPtr> GetActiveQuorumSet(Consensus::LLMQType llmqType, int signHeight);
     CQuorumCPtr SelectQuorumForSigning(Consensus::LLMQType llmqType, int signHeight, const uint256& selectionHash);
+    // Same as above, but selects from an active quorum set previously retrieved with GetActiveQuorumSet
+    static CQuorumCPtr SelectQuorumForSigning(Consensus::LLMQType llmqType, const std::vector<CQuorumCPtr>& quorums, const uint256& selectionHash);
 
     // Verifies a recovered sig that was signed while the chain tip was at signedAtTip
     bool VerifyRecoveredSig(Consensus::LLMQType llmqType, int signedAtHeight, const uint256& id, const uint256& msgHash, const CBLSSignature& sig);
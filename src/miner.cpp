@@ -51,6 +51,7 @@
 #include "evo/deterministicmns.h"
 
 #include "llmq/quorums_blockprocessor.h"
+#include "llmq/quorums_chainlocks.h"
 
 using namespace std;
 #include <utility>
@@ -368,6 +369,9 @@ bool BlockAssembler::TestPackageTransactions(const CTxMemPool::setEntries& packa
             return false;
         if (!fIncludeWitness && it->GetTx().HasWitness())
             return false;
+        // don't include TXs which would prevent the block from being ChainLocked
+        if (llmq::chainLocksHandler && !llmq::chainLocksHandler->IsTxSafeForMining(it->GetTx().GetHash()))
+            return false;
         if (fNeedSizeAccounting) {
             uint64_t nTxSize = ::GetSerializeSize(it->GetTx(), SER_NETWORK, PROTOCOL_VERSION);
             if (nPotentialBlockSize + nTxSize >= nBlockMaxSize) {
@@ -0,0 +1,155 @@
+// Copyright (c) 2020 The Zcoin Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "msgstats.h"
+
+#include "protocol.h"
+#include "tinyformat.h"
+#include "utiltime.h"
+
+#include <algorithm>
+
+CMessageStats messageStats;
+
+static const std::string MSGSTATS_COMMAND_OTHER = "*other*";
+
+void CDurationHistogram::SetNull()
+{
+    buckets.fill(0);
+    nCount = 0;
+    nTotalMicros = 0;
+    nMaxMicros = 0;
+}
+
+void CDurationHistogram::Add(int64_t nMicros)
+{
+    if (nMicros < 0)
+        nMicros = 0;
+    buckets[GetBucket(nMicros)]++;
+    nCount++;
+    nTotalMicros += nMicros;
+    nMaxMicros = std::max(nMaxMicros, nMicros);
+}
+
+int CDurationHistogram::GetBucket(int64_t nMicros)
+{
+    int nBucket = 0;
+    while (nBucket < DURATION_HISTOGRAM_BUCKETS - 1 && nMicros >= GetBucketBound(nBucket))
+        nBucket++;
+    return nBucket;
+}
+
+int64_t CDurationHistogram::GetBucketBound(int nBucket)
+{
+    return int64_t(1) << nBucket;
+}
+
+CMessageTypeStats& CMessageStats::GetTypeStats(const std::string& strCommand)
+{
+    AssertLockHeld(cs);
+    auto it = mapStats.find(strCommand);
+    if (it != mapStats.end())
+        return it->second;
+    const std::vector<std::string>& allMessages = getAllNetMessageTypes();
+    if (std::find(allMessages.begin(), allMessages.end(), strCommand) != allMessages.end())
+        return mapStats[strCommand];
+    return mapStats[MSGSTATS_COMMAND_OTHER];
+}
+
+void CMessageStats::RecordReceived(const std::string& strCommand, uint64_t nBytes, int64_t nProcessMicros, int64_t nMainWaitMicros)
+{
+    LOCK(cs);
+    CMessageTypeStats& stats = GetTypeStats(strCommand);
+    stats.nRecvCount++;
+    stats.nRecvBytes += nBytes;
+    stats.processTime.Add(nProcessMicros);
+    stats.nMainWaitMicros += nMainWaitMicros;
+}
+
+void CMessageStats::RecordSent(const std::string& strCommand, uint64_t nBytes)
+{
+    LOCK(cs);
+    CMessageTypeStats& stats = GetTypeStats(strCommand);
+    stats.nSentCount++;
+    stats.nSentBytes += nBytes;
+}
+
+void CMessageStats::RecordSendMessages(int64_t nProcessMicros)
+{
+    LOCK(cs);
+    sendMessagesStats.processTime.Add(nProcessMicros);
+}
+
+void CMessageStats::GetStats(std::map<std::string, CMessageTypeStats>& mapStatsOut, CSendMessagesStats& sendMessagesStatsOut, bool fReset)
+{
+    LOCK(cs);
+    mapStatsOut = mapStats;
+    sendMessagesStatsOut = sendMessagesStats;
+    if (fReset) {
+        mapStats.clear();
+        sendMessagesStats = CSendMessagesStats();
+    }
+}
+
+void CMessageStats::Clear()
+{
+    LOCK(cs);
+    mapStats.clear();
+    sendMessagesStats = CSendMessagesStats();
+}
+
+CSendMessagesScope::CSendMessagesScope() :
+    nStartMicros(GetTimeMicros())
+{
+}
+
+CSendMessagesScope::~CSendMessagesScope()
+{
+    messageStats.RecordSendMessages(GetTimeMicros() - nStartMicros);
+}
+
+static void AppendHistogram(std::string& strOut, const std::string& strName, const std::string& strLabels, const CDurationHistogram& hist)
+{
+    // Prometheus buckets are cumulative and in seconds
+    std::string strSep = strLabels.empty() ? "" : ",";
+    uint64_t nCumulative = 0;
+    for (int i = 0; i < DURATION_HISTOGRAM_BUCKETS - 1; i++) {
+        nCumulative += hist.buckets[i];
+        strOut += strprintf("%s_bucket{%s%sle=\"%g\"} %u\n", strName, strLabels, strSep, CDurationHistogram::GetBucketBound(i) / 1e6, nCumulative);
+    }
+    strOut += strprintf("%s_bucket{%s%sle=\"+Inf\"} %u\n", strName, strLabels, strSep, hist.nCount);
+    std::string strLabelSet = strLabels.empty() ? "" : "{" + strLabels + "}";
+    strOut += strprintf("%s_sum%s %.6f\n", strName, strLabelSet, hist.nTotalMicros / 1e6);
+    strOut += strprintf("%s_count%s %u\n", strName, strLabelSet, hist.nCount);
+}
+
+std::string MessageStatsToPrometheus(const std::map<std::string, CMessageTypeStats>& mapStats, const CSendMessagesStats& sendMessagesStats)
+{
+    std::string strOut;
+
+    strOut += "# TYPE zcoin_p2p_messages_received_total counter\n";
+    for (const auto& p : mapStats)
+        strOut += strprintf("zcoin_p2p_messages_received_total{command=\"%s\"} %u\n", p.first, p.second.nRecvCount);
+    strOut += "# TYPE zcoin_p2p_bytes_received_total counter\n";
+    for (const auto& p : mapStats)
+        strOut += strprintf("zcoin_p2p_bytes_received_total{command=\"%s\"} %u\n", p.first, p.second.nRecvBytes);
+    strOut += "# TYPE zcoin_p2p_messages_sent_total counter\n";
+    for (const auto& p : mapStats)
+        strOut += strprintf("zcoin_p2p_messages_sent_total{command=\"%s\"} %u\n", p.first, p.second.nSentCount);
+    strOut += "# TYPE zcoin_p2p_bytes_sent_total counter\n";
+    for (const auto& p : mapStats)
+        strOut += strprintf("zcoin_p2p_bytes_sent_total{command=\"%s\"} %u\n", p.first, p.second.nSentBytes);
+
+    strOut += "# TYPE zcoin_p2p_process_seconds histogram\n";
+    for (const auto& p : mapStats)
+        AppendHistogram(strOut, "zcoin_p2p_process_seconds", strprintf("command=\"%s\"", p.first), p.second.processTime);
+    strOut += "# TYPE zcoin_p2p_cs_main_wait_seconds_total counter\n";
+    for (const auto& p : mapStats)
+        strOut += strprintf("zcoin_p2p_cs_main_wait_seconds_total{command=\"%s\"} %.6f\n", p.first, p.second.nMainWaitMicros / 1e6);
+
+    strOut += "# TYPE zcoin_p2p_sendmessages_seconds histogram\n";
+    AppendHistogram(strOut, "zcoin_p2p_sendmessages_seconds", "", sendMessagesStats.processTime);
+
+    return strOut;
+}
@@ -0,0 +1,107 @@
+// Copyright (c) 2020 The Zcoin Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef ZCOIN_MSGSTATS_H
+#define ZCOIN_MSGSTATS_H
+
+#include "sync.h"
+
+#include <array>
+#include <map>
+#include <stdint.h>
+#include <string>
+
+/** Number of buckets in a duration histogram, bucket i counts durations below 2^i microseconds */
+static const int DURATION_HISTOGRAM_BUCKETS = 24;
+
+/**
+ * Histogram of durations with power-of-two microsecond buckets. The last bucket
+ * also counts everything above its bound (~8 seconds).
+ */
+class CDurationHistogram
+{
+public:
+    std::array<uint64_t, DURATION_HISTOGRAM_BUCKETS> buckets;
+    uint64_t nCount;
+    int64_t nTotalMicros;
+    int64_t nMaxMicros;
+
+    CDurationHistogram() { SetNull(); }
+
+    void SetNull();
+    void Add(int64_t nMicros);
+
+    /** Returns the index of the bucket nMicros is counted in */
+    static int GetBucket(int64_t nMicros);
+    /** Returns the exclusive upper bound of bucket nBucket in microseconds */
+    static int64_t GetBucketBound(int nBucket);
+};
+
+/** Statistics about one P2P message type */
+struct CMessageTypeStats
+{
+    uint64_t nRecvCount = 0;
+    uint64_t nRecvBytes = 0;
+    uint64_t nSentCount = 0;
+    uint64_t nSentBytes = 0;
+    /** Time ProcessMessage spent handling received messages of this type */
+    CDurationHistogram processTime;
+    /** Part of processTime spent waiting for cs_main */
+    int64_t nMainWaitMicros = 0;
+};
+
+/** Statistics about the SendMessages calls, which are not tied to a message type */
+struct CSendMessagesStats
+{
+    CDurationHistogram processTime;
+};
+
+/**
+ * Statistics about the P2P messages received, processed and sent. Commands not
+ * listed in getAllNetMessageTypes() are accounted as "*other*" so that peers
+ * can't grow the map with made up commands. Byte counts include the message
+ * header.
+ */
+class CMessageStats
+{
+private:
+    mutable CCriticalSection cs;
+    std::map<std::string, CMessageTypeStats> mapStats;
+    CSendMessagesStats sendMessagesStats;
+
+    CMessageTypeStats& GetTypeStats(const std::string& strCommand);
+
+public:
+    /** Records one received strCommand message and the time ProcessMessage took to handle it */
+    void RecordReceived(const std::string& strCommand, uint64_t nBytes, int64_t nProcessMicros, int64_t nMainWaitMicros);
+    /** Records one strCommand message queued for sending */
+    void RecordSent(const std::string& strCommand, uint64_t nBytes);
+    /** Records one SendMessages call for a peer */
+    void RecordSendMessages(int64_t nProcessMicros);
+
+    /** Copies the statistics, clearing them afterwards if fReset is set */
+    void GetStats(std::map<std::string, CMessageTypeStats>& mapStatsOut, CSendMessagesStats& sendMessagesStatsOut, bool fReset = false);
+    void Clear();
+};
+
+/**
+ * Times a SendMessages call until it goes out of scope. Its cs_main wait isn't
+ * tracked, SendMessages only ever tries to take cs_main.
+ */
+class CSendMessagesScope
+{
+private:
+    int64_t nStartMicros;
+
+public:
+    CSendMessagesScope();
+    ~CSendMessagesScope();
+};
+
+/** Formats the message statistics in the Prometheus text exposition format */
+std::string MessageStatsToPrometheus(const std::map<std::string, CMessageTypeStats>& mapStats, const CSendMessagesStats& sendMessagesStats);
+
+extern CMessageStats messageStats;
+
+#endif // ZCOIN_MSGSTATS_H
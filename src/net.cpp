@@ -30,6 +30,9 @@
 #include "masternode-sync.h"
 #include "llmq/quorums_instantsend.h"
 #include "evo/mnauth.h"
+#include "ctpl.h"
+#include "dandelion.h"
+#include "msgstats.h"
 
 #ifdef WIN32
 #include <string.h>
@@ -37,6 +40,10 @@
 #include <fcntl.h>
 #endif
 
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/miniwget.h>
@@ -88,29 +95,6 @@ const static std::string NET_MESSAGE_COMMAND_OTHER = "*other*";
 static const uint64_t RANDOMIZER_ID_NETGROUP = 0x6c0edd8036ef4036ULL; // SHA256("netgroup")[0:8]
 static const uint64_t RANDOMIZER_ID_LOCALHOSTNONCE = 0xd93e69e2bbfa5735ULL; // SHA256("localhostnonce")[0:8]
 
-// Public Dandelion fields.
-
-// All transactions embargoed by dandelion.
-std::map<uint256, int64_t> CNode::mDandelionEmbargo;
-
-// Inbound connections. Transactions from each connection
-// are broadcast to one of 2 dandelion destinations.
-std::vector<CNode*> CNode::vDandelionInbound;
-
-// All of our outbound destinations.
-std::vector<CNode*> CNode::vDandelionOutbound;
-std::vector<CNode*> CNode::vDandelionDestination;
-
-// Dandelion routes, showing txn from which peer must go to which destination.
-std::map<CNode*, CNode*> CNode::mDandelionRoutes;
-
-// Destination node to which are stem-ed all local transactions.
-CNode* CNode::localDandelionDestination = nullptr;
-
-// All txn are put in the stempool in stem phase.
-// After getting relayed they are moved to mempool.
-extern CTxPoolAggregate txpools;
-
 /** Services this node implementation cares about */
 ServiceFlags nRelevantServices = NODE_NETWORK;
 
@@ -125,6 +109,7 @@ std::map<CNetAddr, LocalServiceInfo> mapLocalHost;
 static bool vfLimited[NET_MAX] = {};
 std::string strSubVersion;
 
+CCriticalSection cs_mapAlreadyAskedFor;
 limitedmap<uint256, int64_t> mapAlreadyAskedFor(MAX_INV_SZ);
 
 // Signals for message handling
@@ -414,7 +399,7 @@ CNode* CConnman::ConnectNode(CAddress addrConnect, const char *pszDest, bool fCo
     if (pszDest ? ConnectSocketByName(addrConnect, hSocket, pszDest, Params().GetDefaultPort(), nConnectTimeout, &proxyConnectionFailed) :
                   ConnectSocket(addrConnect, hSocket, nConnectTimeout, &proxyConnectionFailed))
     {
-        if (!IsSelectableSocket(hSocket)) {
+        if (!CanHandleSocket(hSocket)) {
             LogPrintf("Cannot create connection: non-selectable socket created (fd >= FD_SETSIZE ?)\n");
             CloseSocket(hSocket);
             return NULL;
@@ -908,7 +893,7 @@ size_t CConnman::SocketSendData(CNode *pnode) const
     size_t nSentSize = 0;
 
     while (it != pnode->vSendMsg.end()) {
-        const auto &data = *it;
+        const auto &data = it->Get();
         assert(data.size() > pnode->nSendOffset);
         int nBytes = 0;
         {
@@ -929,6 +914,7 @@ size_t CConnman::SocketSendData(CNode *pnode) const
                 it++;
             } else {
                 // could not send full message; stop sending more
+                pnode->fCanSendData = false;
                 break;
             }
         } else {
@@ -942,6 +928,7 @@ size_t CConnman::SocketSendData(CNode *pnode) const
                 }
             }
             // couldn't send anything at all
+            pnode->fCanSendData = false;
             break;
         }
     }
@@ -1120,70 +1107,6 @@ bool CConnman::AttemptToEvictConnection()
     return false;
 }
 
-// Randomly selects the destination CNode from a list of destination nodes
-// that have minimal number of routs from "mDandelionRoutes" going to them.
-CNode* CNode::SelectFromDandelionDestinations()
-{
-    std::map<CNode*,uint64_t> mDandelionDestinationCounts;
-    for (size_t i = 0; i < vDandelionDestination.size(); i++) {
-        mDandelionDestinationCounts.insert(std::make_pair(vDandelionDestination.at(i),0));
-    }
-    for (auto const& f : mDandelionRoutes) {
-        if (mDandelionDestinationCounts.find(f.second) != mDandelionDestinationCounts.end())
-            mDandelionDestinationCounts[f.second]++;
-    }
-    unsigned int minNumConnections = vDandelionInbound.size();
-    for (auto const& e : mDandelionDestinationCounts) {
-        if (e.second < minNumConnections) {
-            minNumConnections = e.second;
-        }
-    }
-    std::vector<CNode*> candidateDestinations;
-    for (auto const& e : mDandelionDestinationCounts) {
-        if (e.second == minNumConnections) {
-            candidateDestinations.push_back(e.first);
-        }
-    }
-    FastRandomContext rng;
-    CNode* dandelionDestination = nullptr;
-    if (candidateDestinations.size() > 0) {
-        dandelionDestination = candidateDestinations.at(rng.rand32() % candidateDestinations.size());
-    }
-    return dandelionDestination;
-}
-
-std::string CNode::GetDandelionRoutingDataDebugString() {
-    std::string dandelionRoutingDataDebugString = "";
-    dandelionRoutingDataDebugString.append("  vDandelionInbound: ");
-    for(auto const& e : vDandelionInbound) {
-        dandelionRoutingDataDebugString.append(std::to_string(e->GetId())+" ");
-    }
-    dandelionRoutingDataDebugString.append("\n");
-    dandelionRoutingDataDebugString.append("  vDandelionOutbound: ");
-    for(auto const& e : vDandelionOutbound) {
-        dandelionRoutingDataDebugString.append(std::to_string(e->GetId())+" ");
-    }
-    dandelionRoutingDataDebugString.append("\n");
-    dandelionRoutingDataDebugString.append("  vDandelionDestination: ");
-    for(auto const& e : vDandelionDestination) {
-        dandelionRoutingDataDebugString.append(std::to_string(e->GetId())+" ");
-    }
-    dandelionRoutingDataDebugString.append("\n");
-    dandelionRoutingDataDebugString.append("  mDandelionRoutes: ");
-    for(auto const& e : mDandelionRoutes) {
-        dandelionRoutingDataDebugString.append("("+std::to_string(e.first->GetId())+","+std::to_string(e.second->GetId())+") ");
-    }
-    dandelionRoutingDataDebugString.append("\n");
-    dandelionRoutingDataDebugString.append("  localDandelionDestination: ");
-    if(localDandelionDestination == nullptr) {
-        dandelionRoutingDataDebugString.append("nullptr");
-    } else {
-        dandelionRoutingDataDebugString.append(std::to_string(localDandelionDestination->GetId()));
-    }
-    dandelionRoutingDataDebugString.append("\n");
-    return dandelionRoutingDataDebugString;
-}
-
 void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
     struct sockaddr_storage sockaddr;
     socklen_t len = sizeof(sockaddr);
@@ -1225,7 +1148,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
         return;
     }
 
-    if (!IsSelectableSocket(hSocket))
+    if (!CanHandleSocket(hSocket))
     {
         LogPrintf("connection from %s dropped: non-selectable socket\n", addr.ToString());
         CloseSocket(hSocket);
@@ -1271,99 +1194,134 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
+#ifdef HAVE_SYS_EPOLL_H
+        if (!RegisterEvents(pnode))
+            pnode->fDisconnect = true;
+#endif
         // Dandelion: new inbound connection
-        CNode::vDandelionInbound.push_back(pnode);
-        CNode* pto = CNode::SelectFromDandelionDestinations();
-        if (pto != nullptr) {
-            CNode::mDandelionRoutes.insert(std::make_pair(pnode, pto));
-        }
-        LogPrintf("Added inbound Dandelion connection:\n%s",
-                  CNode::GetDandelionRoutingDataDebugString());
+        dandelion.AddInbound(pnode);
     }
 }
 
-void CNode::CloseDandelionConnections(const CNode* const pnode)
+bool CConnman::CanHandleSocket(SOCKET hSocket) const
 {
-    // Remove pnode from vDandelionInbound, if present
-    for (auto iter=vDandelionInbound.begin(); iter!=vDandelionInbound.end();) {
-        if (*iter==pnode) {
-            iter=vDandelionInbound.erase(iter);
-        } else {
-            iter++;
-        }
+    // epoll has no limit on the socket descriptor values it can wait for
+    if (socketEventsMode == SOCKETEVENTS_EPOLL)
+        return true;
+    return ::IsSelectableSocket(hSocket);
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+bool CConnman::RegisterEvents(CNode *pnode)
+{
+    if (socketEventsMode != SOCKETEVENTS_EPOLL)
+        return true;
+
+    LOCK(pnode->cs_hSocket);
+    if (pnode->hSocket == INVALID_SOCKET)
+        return false;
+
+    epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLET;
+    event.data.ptr = pnode;
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, pnode->hSocket, &event) != 0) {
+        LogPrintf("Failed to add socket of peer=%d to epoll set: %s\n", pnode->id, NetworkErrorString(WSAGetLastError()));
+        return false;
     }
-    // Remove pnode from vDandelionOutbound, if present
-    for (auto iter=vDandelionOutbound.begin(); iter!=vDandelionOutbound.end();) {
-        if (*iter==pnode) {
-            iter=vDandelionOutbound.erase(iter);
-        } else {
-            iter++;
-        }
+    // A freshly connected socket is writable, a failing send will clear this again
+    pnode->fCanSendData = true;
+    return true;
+}
+#endif
+
+bool CConnman::SocketRecvData(CNode *pnode)
+{
+    // typical socket buffer is 8K-64K
+    char pchBuf[0x10000];
+    int nBytes = 0;
+    {
+        LOCK(pnode->cs_hSocket);
+        if (pnode->hSocket == INVALID_SOCKET)
+            return false;
+        nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
     }
-    // Remove pnode from vDandelionDestination, if present
-    bool isDandelionDestination = false;
-    for (auto iter = vDandelionDestination.begin(); iter != vDandelionDestination.end();) {
-        if (*iter == pnode) {
-            isDandelionDestination = true;
-            iter=vDandelionDestination.erase(iter);
-        } else {
-            iter++;
-        }
-    }
-    // Generate a replacement Dandelion destination, if necessary
-    if (isDandelionDestination) {
-        // Gather a vector of candidate replacements (outbound peers that are not already destinations)
-        std::vector<CNode*> candidateReplacements;
-        for (auto iteri = vDandelionOutbound.begin(); iteri != vDandelionOutbound.end();) {
-            bool eligibleCandidate = true;
-            for (auto iterj=vDandelionDestination.begin(); iterj!=vDandelionDestination.end();) {
-                if (*iteri==*iterj) {
-                    eligibleCandidate = false;
-                    iterj = vDandelionDestination.end();
-                } else {
-                    iterj++;
-                }
-            }
-            if (eligibleCandidate) {
-                candidateReplacements.push_back(*iteri);
+    if (nBytes > 0)
+    {
+        bool notify = false;
+        if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
+            pnode->CloseSocketDisconnect();
+        RecordBytesRecv(nBytes);
+        if (notify) {
+            size_t nSizeAdded = 0;
+            auto it(pnode->vRecvMsg.begin());
+            for (; it != pnode->vRecvMsg.end(); ++it) {
+                if (!it->complete())
+                    break;
+                nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
             }
-            iteri++;
-        }
-        // Select a candidate to be the replacement destination
-        FastRandomContext rng;
-        CNode* replacementDestination = nullptr;
-        if (candidateReplacements.size() > 0) {
-            replacementDestination = candidateReplacements.at(rng.rand32() % candidateReplacements.size());
-        }
-        if (replacementDestination != nullptr) {
-            vDandelionDestination.push_back(replacementDestination);
-        }
-    }
-    // Generate a replacement pnode, to be used if necessary
-    CNode* newPto = CNode::SelectFromDandelionDestinations();
-    // Remove from mDandelionRoutes, if present; if destination, try to replace
-    for(auto iter=mDandelionRoutes.begin(); iter!=mDandelionRoutes.end();) {
-        if (iter->first==pnode) {
-            iter = mDandelionRoutes.erase(iter);
-        } else if (iter->second==pnode) {
-            if (newPto==nullptr) {
-                iter = mDandelionRoutes.erase(iter);
-            } else {
-                iter->second = newPto;
-                iter++;
+            {
+                LOCK(pnode->cs_vProcessMsg);
+                pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
+                pnode->nProcessQueueSize += nSizeAdded;
+                pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
             }
-        } else {
-            iter++;
+            WakeMessageHandler();
         }
+        // a full buffer means there is probably more data waiting
+        return nBytes == sizeof(pchBuf);
+    }
+    else if (nBytes == 0)
+    {
+        // socket closed gracefully
+        if (!pnode->fDisconnect)
+            LogPrint("net", "socket closed\n");
+        pnode->CloseSocketDisconnect();
     }
-    // Replace localDandelionDestination if equal to pnode
-    if (localDandelionDestination == pnode) {
-        localDandelionDestination = newPto;
+    else if (nBytes < 0)
+    {
+        // error
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
+        {
+            if (!pnode->fDisconnect)
+                LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
+            pnode->CloseSocketDisconnect();
+        }
     }
+    return false;
+}
 
-    // Dandelion debug message
-    LogPrintf("After closing Dandelion connections:\n%s",
-              CNode::GetDandelionRoutingDataDebugString());
+void CConnman::InactivityCheck(CNode *pnode)
+{
+    int64_t nTime = GetSystemTimeInSeconds();
+    if (nTime - pnode->nTimeConnected > 60)
+    {
+        if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
+        {
+            LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
+            pnode->fDisconnect = true;
+        }
+        else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
+        {
+            LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
+            pnode->fDisconnect = true;
+        }
+        else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
+        {
+            LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
+            pnode->fDisconnect = true;
+        }
+        else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
+        {
+            LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
+            pnode->fDisconnect = true;
+        }
+        else if (!pnode->fSuccessfullyConnected)
+        {
+            LogPrintf("version handshake timeout from %d\n", pnode->id);
+            pnode->fDisconnect = true;
+        }
+    }
 }
 
 void CConnman::ThreadSocketHandler()
@@ -1392,6 +1350,17 @@ void CConnman::ThreadSocketHandler()
                     // close socket and cleanup
                     pnode->CloseSocketDisconnect();
 
+#ifdef HAVE_SYS_EPOLL_H
+                    // drop the references held by the epoll readiness bookkeeping
+                    if (setReceivableNodes.erase(pnode))
+                        pnode->Release();
+                    {
+                        LOCK(cs_setNodesWithDataToSend);
+                        if (setNodesWithDataToSend.erase(pnode))
+                            pnode->Release();
+                    }
+#endif
+
                     // hold in disconnected pool until all refs are released
                     pnode->Release();
                     vNodesDisconnected.push_back(pnode);
@@ -1417,7 +1386,7 @@ void CConnman::ThreadSocketHandler()
                     }
                     if (fDelete) {
                         // Dandelion: close connection
-                        CNode::CloseDandelionConnections(pnode);
+                        dandelion.RemoveNode(pnode);
                         vNodesDisconnected.remove(pnode);
                         DeleteNode(pnode);
                     }
@@ -1435,238 +1404,321 @@ void CConnman::ThreadSocketHandler()
                 clientInterface->NotifyNumConnectionsChanged(nPrevNodeCount);
         }
 
-        //
-        // Find which sockets have data to receive
-        //
-        struct timeval timeout;
-        timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
-
-        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = std::max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
+#ifdef HAVE_SYS_EPOLL_H
+        if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+            SocketHandlerEpoll();
+            continue;
         }
+#endif
+        SocketHandlerSelect();
+    }
+}
 
+void CConnman::SocketHandlerSelect()
+{
+    //
+    // Find which sockets have data to receive
+    //
+    struct timeval timeout;
+    timeout.tv_sec  = 0;
+    timeout.tv_usec = 50000; // frequency to poll pnode->vSend
+
+    fd_set fdsetRecv;
+    fd_set fdsetSend;
+    fd_set fdsetError;
+    FD_ZERO(&fdsetRecv);
+    FD_ZERO(&fdsetSend);
+    FD_ZERO(&fdsetError);
+    SOCKET hSocketMax = 0;
+    bool have_fds = false;
+
+    BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
+        FD_SET(hListenSocket.socket, &fdsetRecv);
+        hSocketMax = std::max(hSocketMax, hListenSocket.socket);
+        have_fds = true;
+    }
+
+    {
+        LOCK(cs_vNodes);
+        BOOST_FOREACH(CNode* pnode, vNodes)
         {
-            LOCK(cs_vNodes);
-            BOOST_FOREACH(CNode* pnode, vNodes)
+            // Implement the following logic:
+            // * If there is data to send, select() for sending data. As this only
+            //   happens when optimistic write failed, we choose to first drain the
+            //   write buffer in this case before receiving more. This avoids
+            //   needlessly queueing received data, if the remote peer is not themselves
+            //   receiving data. This means properly utilizing TCP flow control signalling.
+            // * Otherwise, if there is space left in the receive buffer, select() for
+            //   receiving data.
+            // * Hand off all complete messages to the processor, to be handled without
+            //   blocking here.
+
+            bool select_recv = !pnode->fPauseRecv;
+            bool select_send;
             {
-                // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
-                //   happens when optimistic write failed, we choose to first drain the
-                //   write buffer in this case before receiving more. This avoids
-                //   needlessly queueing received data, if the remote peer is not themselves
-                //   receiving data. This means properly utilizing TCP flow control signalling.
-                // * Otherwise, if there is space left in the receive buffer, select() for
-                //   receiving data.
-                // * Hand off all complete messages to the processor, to be handled without
-                //   blocking here.
-
-                bool select_recv = !pnode->fPauseRecv;
-                bool select_send;
-                {
-                    LOCK(pnode->cs_vSend);
-                    select_send = !pnode->vSendMsg.empty();
-                }
+                LOCK(pnode->cs_vSend);
+                select_send = !pnode->vSendMsg.empty();
+            }
 
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
+            LOCK(pnode->cs_hSocket);
+            if (pnode->hSocket == INVALID_SOCKET)
+                continue;
 
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = std::max(hSocketMax, pnode->hSocket);
-                have_fds = true;
+            FD_SET(pnode->hSocket, &fdsetError);
+            hSocketMax = std::max(hSocketMax, pnode->hSocket);
+            have_fds = true;
 
-                if (select_send) {
-                    FD_SET(pnode->hSocket, &fdsetSend);
-                    continue;
-                }
-                if (select_recv) {
-                    FD_SET(pnode->hSocket, &fdsetRecv);
-                }
+            if (select_send) {
+                FD_SET(pnode->hSocket, &fdsetSend);
+                continue;
+            }
+            if (select_recv) {
+                FD_SET(pnode->hSocket, &fdsetRecv);
             }
         }
+    }
 
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
-        if (interruptNet)
+    int nSelect = select(have_fds ? hSocketMax + 1 : 0,
+                         &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+    if (interruptNet)
+        return;
+
+    if (nSelect == SOCKET_ERROR)
+    {
+        if (have_fds)
+        {
+            int nErr = WSAGetLastError();
+            LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
+            for (unsigned int i = 0; i <= hSocketMax; i++)
+                FD_SET(i, &fdsetRecv);
+        }
+        FD_ZERO(&fdsetSend);
+        FD_ZERO(&fdsetError);
+        if (!interruptNet.sleep_for(std::chrono::milliseconds(timeout.tv_usec/1000)))
             return;
+    }
 
-        if (nSelect == SOCKET_ERROR)
+    //
+    // Accept new connections
+    //
+    BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
+    {
+        if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
         {
-            if (have_fds)
-            {
-                int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            if (!interruptNet.sleep_for(std::chrono::milliseconds(timeout.tv_usec/1000)))
-                return;
+            AcceptConnection(hListenSocket);
         }
+    }
+
+    //
+    // Service each socket
+    //
+    std::vector<CNode*> vNodesCopy;
+    {
+        LOCK(cs_vNodes);
+        vNodesCopy = vNodes;
+        BOOST_FOREACH(CNode* pnode, vNodesCopy)
+            pnode->AddRef();
+    }
+    BOOST_FOREACH(CNode* pnode, vNodesCopy)
+    {
+        if (interruptNet)
+            return;
 
         //
-        // Accept new connections
+        // Receive
         //
-        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
+        bool recvSet = false;
+        bool sendSet = false;
+        bool errorSet = false;
         {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
-            {
-                AcceptConnection(hListenSocket);
-            }
+            LOCK(pnode->cs_hSocket);
+            if (pnode->hSocket == INVALID_SOCKET)
+                continue;
+            recvSet = FD_ISSET(pnode->hSocket, &fdsetRecv);
+            sendSet = FD_ISSET(pnode->hSocket, &fdsetSend);
+            errorSet = FD_ISSET(pnode->hSocket, &fdsetError);
+        }
+        if (recvSet || errorSet)
+        {
+            SocketRecvData(pnode);
         }
 
         //
-        // Service each socket
+        // Send
         //
-        std::vector<CNode*> vNodesCopy;
+        if (sendSet)
         {
-            LOCK(cs_vNodes);
-            vNodesCopy = vNodes;
-            BOOST_FOREACH(CNode* pnode, vNodesCopy)
-                pnode->AddRef();
+            LOCK(pnode->cs_vSend);
+            size_t nBytes = SocketSendData(pnode);
+            if (nBytes) {
+                RecordBytesSent(nBytes);
+            }
         }
+
+        //
+        // Inactivity checking
+        //
+        InactivityCheck(pnode);
+    }
+    {
+        LOCK(cs_vNodes);
         BOOST_FOREACH(CNode* pnode, vNodesCopy)
-        {
-            if (interruptNet)
-                return;
+            pnode->Release();
+    }
+}
 
-            //
-            // Receive
-            //
-            bool recvSet = false;
-            bool sendSet = false;
-            bool errorSet = false;
-            {
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-                recvSet = FD_ISSET(pnode->hSocket, &fdsetRecv);
-                sendSet = FD_ISSET(pnode->hSocket, &fdsetSend);
-                errorSet = FD_ISSET(pnode->hSocket, &fdsetError);
-            }
-            if (recvSet || errorSet)
-            {
-                {
-                    {
-                        // typical socket buffer is 8K-64K
-                        char pchBuf[0x10000];
-                        int nBytes = 0;
-                        {
-                            LOCK(pnode->cs_hSocket);
-                            if (pnode->hSocket == INVALID_SOCKET)
-                                continue;
-                            nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
-                        }
-                        if (nBytes > 0)
-                        {
-                            bool notify = false;
-                            if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
-                                pnode->CloseSocketDisconnect();
-                            RecordBytesRecv(nBytes);
-                            if (notify) {
-                                size_t nSizeAdded = 0;
-                                auto it(pnode->vRecvMsg.begin());
-                                for (; it != pnode->vRecvMsg.end(); ++it) {
-                                    if (!it->complete())
-                                        break;
-                                    nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
-                                }
-                                {
-                                    LOCK(pnode->cs_vProcessMsg);
-                                    pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
-                                    pnode->nProcessQueueSize += nSizeAdded;
-                                    pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
-                                }
-                                WakeMessageHandler();
-                            }
-                        }
-                        else if (nBytes == 0)
-                        {
-                            // socket closed gracefully
-                            if (!pnode->fDisconnect)
-                                LogPrint("net", "socket closed\n");
-                            pnode->CloseSocketDisconnect();
-                        }
-                        else if (nBytes < 0)
-                        {
-                            // error
-                            int nErr = WSAGetLastError();
-                            if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
-                            {
-                                if (!pnode->fDisconnect)
-                                    LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
-                                pnode->CloseSocketDisconnect();
-                            }
-                        }
-                    }
-                }
+#ifdef HAVE_SYS_EPOLL_H
+void CConnman::SocketHandlerEpoll()
+{
+    // Don't block if readiness reported earlier has not been used up yet
+    bool fMoreWork = false;
+    BOOST_FOREACH(CNode* pnode, setReceivableNodes) {
+        if (!pnode->fPauseRecv) {
+            fMoreWork = true;
+            break;
+        }
+    }
+    if (!fMoreWork) {
+        LOCK(cs_setNodesWithDataToSend);
+        BOOST_FOREACH(CNode* pnode, setNodesWithDataToSend) {
+            if (pnode->fCanSendData) {
+                fMoreWork = true;
+                break;
             }
+        }
+    }
 
-            //
-            // Send
-            //
-            if (sendSet)
-            {
-                LOCK(pnode->cs_vSend);
-                size_t nBytes = SocketSendData(pnode);
-                if (nBytes) {
-                    RecordBytesSent(nBytes);
-                }
+    epoll_event events[MAX_EPOLL_EVENTS];
+    int nEvents = epoll_wait(epollfd, events, MAX_EPOLL_EVENTS, fMoreWork ? 0 : 50); // 50ms is the frequency to poll pnode->vSend
+    if (interruptNet)
+        return;
+
+    if (nEvents == SOCKET_ERROR)
+    {
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEINTR) {
+            LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(nErr));
+            if (!interruptNet.sleep_for(std::chrono::milliseconds(50)))
+                return;
+        }
+        nEvents = 0;
+    }
+
+    //
+    // Accept new connections and record socket readiness
+    //
+    for (int i = 0; i < nEvents; i++)
+    {
+        const epoll_event& event = events[i];
+
+        bool fListenSocket = false;
+        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
+        {
+            if (event.data.ptr == &hListenSocket) {
+                AcceptConnection(hListenSocket);
+                fListenSocket = true;
+                break;
             }
+        }
+        if (fListenSocket)
+            continue;
 
-            //
-            // Inactivity checking
-            //
-            int64_t nTime = GetSystemTimeInSeconds();
-            if (nTime - pnode->nTimeConnected > 60)
-            {
-                if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
-                {
-                    LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
-                {
-                    LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
-                {
-                    LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
-                    pnode->fDisconnect = true;
-                }
-                else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
-                {
-                    LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
-                    pnode->fDisconnect = true;
-                }
-                else if (!pnode->fSuccessfullyConnected)
-                {
-                    LogPrintf("version handshake timeout from %d\n", pnode->id);
-                    pnode->fDisconnect = true;
-                }
+        // Nodes are only deleted by this thread after their socket was closed, which also removes
+        // the socket from the epoll set, so the pointer is still valid here.
+        CNode* pnode = static_cast<CNode*>(event.data.ptr);
+        if (event.events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+            pnode->fHasRecvData = true;
+            if (setReceivableNodes.insert(pnode).second)
+                pnode->AddRef();
+        }
+        if (event.events & EPOLLOUT) {
+            // SocketSendData() clears the flag under cs_vSend after a short send. An edge that arrives
+            // in between must not be overwritten by that, as it is reported only once.
+            LOCK(pnode->cs_vSend);
+            pnode->fCanSendData = true;
+        }
+    }
+
+    //
+    // Receive, one buffer per node and round to stay fair between peers
+    //
+    std::vector<CNode*> vReceivableNodes(setReceivableNodes.begin(), setReceivableNodes.end());
+    BOOST_FOREACH(CNode* pnode, vReceivableNodes)
+    {
+        if (interruptNet)
+            return;
+        // keep the readiness until the message handler has caught up
+        if (pnode->fPauseRecv && !pnode->fDisconnect)
+            continue;
+        if (!pnode->fDisconnect && SocketRecvData(pnode))
+            continue;
+        pnode->fHasRecvData = false;
+        setReceivableNodes.erase(pnode);
+        pnode->Release();
+    }
+
+    //
+    // Send
+    //
+    std::vector<CNode*> vSendableNodes;
+    {
+        LOCK(cs_setNodesWithDataToSend);
+        for (auto it = setNodesWithDataToSend.begin(); it != setNodesWithDataToSend.end(); ) {
+            CNode* pnode = *it;
+            if (pnode->fDisconnect) {
+                pnode->Release();
+                it = setNodesWithDataToSend.erase(it);
+            } else if (pnode->fCanSendData) {
+                // the reference moves to vSendableNodes
+                vSendableNodes.push_back(pnode);
+                it = setNodesWithDataToSend.erase(it);
+            } else {
+                ++it;
             }
         }
+    }
+    BOOST_FOREACH(CNode* pnode, vSendableNodes)
+    {
         {
-            LOCK(cs_vNodes);
-            BOOST_FOREACH(CNode* pnode, vNodesCopy)
-                pnode->Release();
+            LOCK(pnode->cs_vSend);
+            size_t nBytes = SocketSendData(pnode);
+            if (nBytes) {
+                RecordBytesSent(nBytes);
+            }
+            if (!pnode->vSendMsg.empty()) {
+                // wait for the socket to become writable again
+                LOCK(cs_setNodesWithDataToSend);
+                if (setNodesWithDataToSend.insert(pnode).second)
+                    pnode->AddRef();
+            }
         }
+        pnode->Release();
+    }
+
+    //
+    // Inactivity checking, once per second is enough as it works with second resolution
+    //
+    int64_t nTime = GetSystemTimeInSeconds();
+    if (nTime == nLastInactivityCheck)
+        return;
+    nLastInactivityCheck = nTime;
+
+    std::vector<CNode*> vNodesCopy;
+    {
+        LOCK(cs_vNodes);
+        vNodesCopy = vNodes;
+        BOOST_FOREACH(CNode* pnode, vNodesCopy)
+            pnode->AddRef();
+    }
+    BOOST_FOREACH(CNode* pnode, vNodesCopy)
+        InactivityCheck(pnode);
+    {
+        LOCK(cs_vNodes);
+        BOOST_FOREACH(CNode* pnode, vNodesCopy)
+            pnode->Release();
     }
 }
+#endif
 
 void CConnman::WakeMessageHandler()
 {
@@ -2309,15 +2361,8 @@ bool CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
     // Martun: if dandelion is enabled, then send a special transaction
     // to the new peer to check, if the peer supports dandelion or not.
     if (GetBoolArg("-dandelion", true)) {
-        LOCK(cs_vNodes);
         // Dandelion: new outbound connection
-        CNode::vDandelionOutbound.push_back(pnode);
-        const Consensus::Params& consensus = Params().GetConsensus();
-        if (CNode::vDandelionDestination.size() < consensus.nDandelionMaxDestinations) {
-            CNode::vDandelionDestination.push_back(pnode);
-        }
-        //LogPrintf("Added outbound Dandelion connection:\n%s",
-        //          CNode::GetDandelionRoutingDataDebugString());
+        dandelion.AddOutbound(pnode);
         // Dandelion service discovery
         uint256 dummyHash;
         dummyHash.SetHex("0xffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
@@ -2332,6 +2377,10 @@ bool CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
+#ifdef HAVE_SYS_EPOLL_H
+        if (!RegisterEvents(pnode))
+            pnode->fDisconnect = true;
+#endif
     }
 
     return true;
@@ -2341,8 +2390,33 @@ bool CConnman::OpenMasternodeConnection(const CAddress &addrConnect) {
     return OpenNetworkConnection(addrConnect, false, NULL, NULL, false, false, false, true);
 }
 
+bool CConnman::ProcessNodeMessages(CNode* pnode)
+{
+    // Receive messages
+    bool fMoreNodeWork = GetNodeSignals().ProcessMessages(pnode, *this, flagInterruptMsgProc);
+    fMoreNodeWork = fMoreNodeWork && !pnode->fPauseSend;
+    if (flagInterruptMsgProc)
+        return false;
+
+    // Send messages
+    {
+        LOCK(pnode->cs_sendProcessing);
+        GetNodeSignals().SendMessages(pnode, *this, flagInterruptMsgProc);
+    }
+    return fMoreNodeWork;
+}
+
 void CConnman::ThreadMessageHandler()
 {
+    // With -msghandlerthreads > 1 the workers first serve read-only requests (see ProcessConcurrentMessages)
+    // of this round's nodes together with this thread. Everything else, including SendMessages, stays on
+    // this thread afterwards, so handlers touching global state without cs_main still run sequentially.
+    std::unique_ptr<ctpl::thread_pool> workerPool;
+    if (nMessageHandlerThreads > 1) {
+        workerPool.reset(new ctpl::thread_pool(nMessageHandlerThreads - 1));
+        RenameThreadPool(*workerPool, "zcoin-msghand");
+    }
+
     while (!flagInterruptMsgProc)
     {
         std::vector<CNode*> vNodesCopy;
@@ -2354,26 +2428,42 @@ void CConnman::ThreadMessageHandler()
             }
         }
 
+        if (workerPool) {
+            // A node is handled by only one thread at a time, so per-node state needs no extra locking
+            std::atomic<size_t> nNextNode{0};
+            auto processNodes = [&]() {
+                size_t i;
+                while (!flagInterruptMsgProc && (i = nNextNode++) < vNodesCopy.size()) {
+                    CNode* pnode = vNodesCopy[i];
+                    if (pnode->fDisconnect || pnode->fPauseSend)
+                        continue;
+                    GetNodeSignals().ProcessConcurrentMessages(pnode, *this, flagInterruptMsgProc);
+                }
+            };
+
+            std::vector<std::future<void>> vWorkers;
+            for (size_t i = 0; i < (size_t)workerPool->size() && i + 1 < vNodesCopy.size(); i++) {
+                vWorkers.emplace_back(workerPool->push([&](int) { processNodes(); }));
+            }
+            processNodes();
+
+            // Wait for all workers before rethrowing, they reference this round's locals
+            for (auto& f : vWorkers)
+                f.wait();
+            for (auto& f : vWorkers)
+                f.get();
+        }
+
         bool fMoreWork = false;
 
         BOOST_FOREACH(CNode* pnode, vNodesCopy)
         {
+            if (flagInterruptMsgProc)
+                break;
             if (pnode->fDisconnect)
                 continue;
-
-            // Receive messages
-            bool fMoreNodeWork = GetNodeSignals().ProcessMessages(pnode, *this, flagInterruptMsgProc);
-            fMoreWork |= (fMoreNodeWork && !pnode->fPauseSend);
-            if (flagInterruptMsgProc)
-                return;
-
-            // Send messages
-            {
-                LOCK(pnode->cs_sendProcessing);
-                GetNodeSignals().SendMessages(pnode, *this, flagInterruptMsgProc);
-            }
-            if (flagInterruptMsgProc)
-                return;
+            if (ProcessNodeMessages(pnode))
+                fMoreWork = true;
         }
 
         {
@@ -2382,12 +2472,18 @@ void CConnman::ThreadMessageHandler()
                 pnode->Release();
         }
 
+        if (flagInterruptMsgProc)
+            break;
+
         std::unique_lock<std::mutex> lock(mutexMsgProc);
         if (!fMoreWork) {
             condMsgProc.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [this] { return fMsgProcWake; });
         }
         fMsgProcWake = false;
     }
+
+    if (workerPool)
+        workerPool->stop(true);
 }
 
 
@@ -2417,7 +2513,7 @@ bool CConnman::BindListenPort(const CService &addrBind, std::string& strError, b
         LogPrintf("%s\n", strError);
         return false;
     }
-    if (!IsSelectableSocket(hListenSocket))
+    if (!CanHandleSocket(hListenSocket))
     {
         strError = "Error: Couldn't create a listenable socket for incoming connections";
         LogPrintf("%s\n", strError);
@@ -2544,78 +2640,13 @@ void Discover(boost::thread_group& threadGroup)
 #endif
 }
 
-void CNode::DandelionShuffle() {
-    // Dandelion debug message
-    LogPrintf(
-        "Before Dandelion shuffle:\n%s",
-        CNode::GetDandelionRoutingDataDebugString());
-    
-    std::vector<CNode *> vNodes = g_connman->CopyNodeVector([] (const CNode *)->bool {return true;});
-    {
-        // Iterate through mDandelionRoutes to facilitate bookkeeping
-        mDandelionRoutes.clear();
-        // Set localDandelionDestination to nulltpr and perform bookkeeping
-        if (localDandelionDestination != nullptr) {
-            localDandelionDestination = nullptr;
-        }
-        // Clear vDandelionDestination
-        //  (bookkeeping already done while iterating through mDandelionRoutes)
-        vDandelionDestination.clear();
-        // Repopulate vDandelionDestination
-        const Consensus::Params& consensus = Params().GetConsensus();
-        if (vDandelionDestination.size() < consensus.nDandelionMaxDestinations &&
-            vDandelionDestination.size() < vDandelionOutbound.size()) {
-            std::vector<CNode*> candidateDestinations;
-            for (auto iteri = vDandelionOutbound.begin(); iteri != vDandelionOutbound.end();) {
-                bool eligibleCandidate = true;
-                for (auto iterj = vDandelionDestination.begin(); iterj != vDandelionDestination.end(); ++iterj) {
-                    if (*iteri==*iterj) {
-                        eligibleCandidate = false;
-                        break;
-                    }
-                }
-                if (eligibleCandidate) {
-                    candidateDestinations.push_back(*iteri);
-                }
-                ++iteri;
-            }
-            // Sample "vDandelionDestination.size() - DANDELION_MAX_DESTINATIONS" destinations
-            // if there are that many to choose from.
-            FastRandomContext rng;
-            const Consensus::Params& consensus = Params().GetConsensus();
-            while (vDandelionDestination.size() < consensus.nDandelionMaxDestinations &&
-                   vDandelionDestination.size() < vDandelionOutbound.size() &&
-                   candidateDestinations.size() > 0) {
-                int rand_index = rng.rand32() % candidateDestinations.size();
-                vDandelionDestination.push_back(candidateDestinations[rand_index]);
-                candidateDestinations.erase(candidateDestinations.begin() + rand_index);
-            }
-        }
-
-        // Generate new routes
-        for (auto pnode : vDandelionInbound) {
-            CNode* pto = CNode::SelectFromDandelionDestinations();
-            if (pto != nullptr) {
-                mDandelionRoutes.insert(std::make_pair(pnode, pto));
-            }
-        }
-        localDandelionDestination = CNode::SelectFromDandelionDestinations();
-    }
-    g_connman->ReleaseNodeVector(vNodes);
-
-    // Dandelion debug message
-    LogPrintf(
-        "After Dandelion shuffle:\n%s",
-        CNode::GetDandelionRoutingDataDebugString());
-}
-
 void CConnman::ThreadDandelionShuffle() {
     LogPrintf("Started Dandelion shuffle thread.\n");
 
     int64_t nNextDandelionShuffle = 0;
     while (!interruptNet) {
         if (GetTimeMicros() > nNextDandelionShuffle) {
-            CNode::DandelionShuffle();
+            dandelion.Shuffle();
             const Consensus::Params& consensus = Params().GetConsensus();
             nNextDandelionShuffle = PoissonNextSend(
                 GetTimeMicros(), consensus.nDandelionShuffleInterval);
@@ -2673,6 +2704,8 @@ CConnman::CConnman(uint64_t nSeed0In, uint64_t nSeed1In) : nSeed0(nSeed0In), nSe
     nBestHeight = 0;
     clientInterface = NULL;
     flagInterruptMsgProc = false;
+    nMessageHandlerThreads = DEFAULT_MSGHANDLER_THREADS;
+    socketEventsMode = SOCKETEVENTS_SELECT;
 }
 
 NodeId CConnman::GetNewNodeId()
@@ -2702,6 +2735,31 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
 
     SetBestHeight(connOptions.nBestHeight);
 
+    nMessageHandlerThreads = std::max(1, std::min(connOptions.nMessageHandlerThreads, MAX_MSGHANDLER_THREADS));
+
+    socketEventsMode = connOptions.socketEventsMode;
+#ifdef HAVE_SYS_EPOLL_H
+    if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+        epollfd = epoll_create1(0);
+        if (epollfd == -1) {
+            strNodeError = strprintf("Failed to create epoll file descriptor: %s", NetworkErrorString(WSAGetLastError()));
+            LogPrintf("%s\n", strNodeError);
+            return false;
+        }
+        BOOST_FOREACH(ListenSocket& hListenSocket, vhListenSocket) {
+            // Listen sockets stay level-triggered, they accept one connection per round like select() does
+            epoll_event event;
+            event.events = EPOLLIN;
+            event.data.ptr = &hListenSocket;
+            if (epoll_ctl(epollfd, EPOLL_CTL_ADD, hListenSocket.socket, &event) != 0) {
+                strNodeError = strprintf("Failed to add listen socket to epoll set: %s", NetworkErrorString(WSAGetLastError()));
+                LogPrintf("%s\n", strNodeError);
+                return false;
+            }
+        }
+    }
+#endif
+
     clientInterface = connOptions.uiInterface;
     if (clientInterface)
         clientInterface->InitMessage(_("Loading addresses..."));
@@ -2872,7 +2930,21 @@ void CConnman::Stop()
             if (!CloseSocket(hListenSocket.socket))
                 LogPrintf("CloseSocket(hListenSocket) failed with error %s\n", NetworkErrorString(WSAGetLastError()));
 
+#ifdef HAVE_SYS_EPOLL_H
+    // the nodes are deleted below, regardless of the references held here
+    setReceivableNodes.clear();
+    {
+        LOCK(cs_setNodesWithDataToSend);
+        setNodesWithDataToSend.clear();
+    }
+    if (epollfd != -1) {
+        close(epollfd);
+        epollfd = -1;
+    }
+#endif
+
     // clean up some globals (to help leak detection)
+    dandelion.Clear();
     BOOST_FOREACH(CNode *pnode, vNodes) {
         DeleteNode(pnode);
     }
@@ -2948,112 +3020,6 @@ bool CConnman::AddNode(const std::string& strNode)
     return true;
 }
 
-CNode* CNode::getDandelionDestination(CNode* pfrom) {
-    for (auto const& e : mDandelionRoutes) {
-        if (pfrom==e.first) {
-            return e.second;
-        }
-    }
-    CNode* newPto = CNode::SelectFromDandelionDestinations();
-    if (newPto != nullptr) {
-        mDandelionRoutes.insert(std::make_pair(pfrom, newPto));
-        //LogPrint(
-        //    "dandelion",
-        //    "Added Dandelion route:\n%s",
-        //    CNode::GetDandelionRoutingDataDebugString());
-    }
-    return newPto;
-}
-
-void CNode::RelayDandelionTransaction(const CTransaction& tx, CNode* pfrom)
-{
-    if (!txpools.getStemTxPool().exists(tx.GetHash())) {
-        LogPrintf("ERROR: Trying to relay dandelion transaction %s which is not in the stempool.\n",
-                  tx.GetHash().ToString());
-        return;
-    }
-    FastRandomContext rng;
-    const Consensus::Params& consensus = Params().GetConsensus();
-    if (rng.rand32() % 100 < consensus.nDandelionFluff) {
-        // Start fluffing current transaction.
-
-        // LogPrint("dandelion", "Dandelion fluff: %s\n", tx.GetHash().ToString());
-        CValidationState state;
-        std::shared_ptr<const CTransaction> ptx = txpools.getStemTxPool().get(tx.GetHash());
-        bool fMissingInputs = false;
-        std::list<CTransactionRef> lRemovedTxn;
-        AcceptToMemoryPool(
-            mempool,
-            state,
-            ptx,
-            true, // fLimitFree
-            &fMissingInputs, // pfMissingInputs
-            &lRemovedTxn,
-            false, /* fOverrideMempoolLimit */
-            0, /* nAbsurdFee */
-            false /*isCheckWalletTransaction*/
-            );
-        //LogPrint(
-        //    "mempool", "AcceptToMemoryPool: peer=%d: accepted %s (poolsz %u txn, %u kB)\n",
-        //    pfrom->GetId(), tx.GetHash().ToString(),
-        //    mempool.size(), mempool.DynamicMemoryUsage() / 1000);
-        g_connman->RelayTransaction(tx);
-    } else {
-        // Relay transaction to a single dandelion destination.
-        CInv inv(MSG_DANDELION_TX, tx.GetHash());
-        CNode* destination = getDandelionDestination(pfrom);
-        if (destination!=nullptr) {
-            destination->PushInventory(inv);
-        }
-        //LogPrint("dandelion", "Dandelion stem, relaying transaction %s to destination %s \n",
-        //    tx.GetHash().ToString(),
-        //    destination==nullptr?"nullptr":destination->addrName);
-    }
-}
-
-void CNode::CheckDandelionEmbargoes()
-{
-    int64_t nCurrTime = GetTimeMicros();
-    for (auto iter=mDandelionEmbargo.begin(); iter != mDandelionEmbargo.end();) {
-        // If we got the embargoed transaction back, erase it.
-        if (mempool.exists(iter->first)) {
-           iter = mDandelionEmbargo.erase(iter);
-        } else if (iter->second < nCurrTime) {
-            // Embargo time is over, we did not "see" the transaction back in fluff phase,
-            // so start fluffing/relaying it.
-            CValidationState state;
-            shared_ptr<const CTransaction> ptx = txpools.getStemTxPool().get(iter->first);
-            // If txn was not found in Stempool, then something went wrong,
-            // Keep it embargoed for now.
-            if (!ptx) {
-               iter = mDandelionEmbargo.erase(iter);
-                continue;
-            }
-            bool fMissingInputs = false;
-            std::list<CTransactionRef> lRemovedTxn;
-            AcceptToMemoryPool(
-                mempool,
-                state,
-                ptx,
-                true, // fLimitFree
-                &fMissingInputs,
-                &lRemovedTxn,
-                false, /* fOverrideMempoolLimit */
-                0, /* nAbsurdFee */
-                false /*isCheckWalletTransaction*/
-                );
-            LogPrintf("AcceptToMemoryPool: accepted %s (poolsz %u txn, %u kB)\n",
-                      iter->first.ToString(),
-                      mempool.size(),
-                      mempool.DynamicMemoryUsage() / 1000);
-            g_connman->RelayTransaction(*ptx);
-            iter = mDandelionEmbargo.erase(iter);
-        } else {
-            iter++;
-        }
-    }
-}
-
 bool CConnman::RemoveAddedNode(const std::string& strNode)
 {
     LOCK(cs_vAddedNodes);
@@ -3276,7 +3242,10 @@ void CConnman::RelayInvFiltered(CInv &inv, const uint256& relatedTxHash, const i
 
 void CConnman::RemoveAskFor(const uint256& hash)
 {
-    mapAlreadyAskedFor.erase(hash);
+    {
+        LOCK(cs_mapAlreadyAskedFor);
+        mapAlreadyAskedFor.erase(hash);
+    }
 
     LOCK(cs_vNodes);
     for (const auto& pnode : vNodes) {
@@ -3475,6 +3444,8 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     fZnode = false;
     fPauseRecv = false;
     fPauseSend = false;
+    fHasRecvData = false;
+    fCanSendData = false;
     nProcessQueueSize = 0;
     pendingMNVerification = nullptr;
 
@@ -3501,6 +3472,7 @@ CNode::~CNode()
 
 void CNode::AskFor(const CInv& inv, int64_t doubleRequestDelay)
 {
+    LOCK(cs_inventory);
     if (vecAskFor.size() > MAPASKFOR_MAX_SZ || setAskFor.size() > SETASKFOR_MAX_SZ) {
         int64_t nNow = GetTime();
         if(nNow - nLastWarningTime > WARNING_INTERVAL) {
@@ -3520,6 +3492,7 @@ void CNode::AskFor(const CInv& inv, int64_t doubleRequestDelay)
 
     // We're using vecAskFor as a priority queue,
     // the key is the earliest time the request can be sent
+    LOCK(cs_mapAlreadyAskedFor);
     int64_t nRequestTime;
     limitedmap<uint256, int64_t>::const_iterator it = mapAlreadyAskedFor.find(inv.hash);
     if (it != mapAlreadyAskedFor.end())
@@ -3546,6 +3519,7 @@ void CNode::AskFor(const CInv& inv, int64_t doubleRequestDelay)
 
 void CNode::RemoveAskFor(const uint256& hash)
 {
+    LOCK(cs_inventory);
     if (setAskFor.erase(hash)) {
         vecAskFor.erase(std::remove_if(vecAskFor.begin(), vecAskFor.end(), [&](const std::pair<int64_t, CInv>& item) {
             return item.second.hash == hash;
@@ -3560,13 +3534,14 @@ bool CConnman::NodeFullyConnected(const CNode* pnode)
 
 void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg, bool allowOptimisticSend)
 {
-    size_t nMessageSize = msg.data.size();
+    const std::vector<unsigned char>& payload = msg.GetData();
+    size_t nMessageSize = payload.size();
     size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
     LogPrint("net", "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), nMessageSize, pnode->id);
 
     std::vector<unsigned char> serializedHeader;
     serializedHeader.reserve(CMessageHeader::HEADER_SIZE);
-    uint256 hash = Hash(msg.data.data(), msg.data.data() + nMessageSize);
+    uint256 hash = Hash(payload.data(), payload.data() + nMessageSize);
     CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), nMessageSize);
     memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
 
@@ -3575,7 +3550,8 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg, bool allowOpti
     size_t nBytesSent = 0;
     {
         LOCK(pnode->cs_vSend);
-        bool optimisticSend(allowOptimisticSend && pnode->vSendMsg.empty());
+        bool hasPendingData = !pnode->vSendMsg.empty();
+        bool optimisticSend(allowOptimisticSend && !hasPendingData);
 
         //log total amount of bytes per command
         pnode->mapSendBytesPerMsgCmd[msg.command] += nTotalSize;
@@ -3583,14 +3559,28 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg, bool allowOpti
 
         if (pnode->nSendSize > nSendBufferMaxSize)
             pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
-        if (nMessageSize)
-            pnode->vSendMsg.push_back(std::move(msg.data));
+        pnode->vSendMsg.emplace_back(std::move(serializedHeader));
+        if (nMessageSize) {
+            if (msg.sharedData)
+                pnode->vSendMsg.emplace_back(msg.sharedData);
+            else
+                pnode->vSendMsg.emplace_back(std::move(msg.data));
+        }
+
+#ifdef HAVE_SYS_EPOLL_H
+        // Let the socket handler know about the queued data, epoll won't report an already writable socket again
+        if (socketEventsMode == SOCKETEVENTS_EPOLL && !hasPendingData && !pnode->fDisconnect) {
+            LOCK(cs_setNodesWithDataToSend);
+            if (setNodesWithDataToSend.insert(pnode).second)
+                pnode->AddRef();
+        }
+#endif
 
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend == true)
             nBytesSent = SocketSendData(pnode);
     }
+    messageStats.RecordSent(msg.command, nTotalSize);
     if (nBytesSent)
         RecordBytesSent(nBytesSent);
 }
@@ -3670,57 +3660,3 @@ uint64_t CConnman::CalculateKeyedNetGroup(const CAddress& ad) const
 
     return GetDeterministicRandomizer(RANDOMIZER_ID_NETGROUP).Write(&vchNetGroup[0], vchNetGroup.size()).Finalize();
 }
-
-// Dandelion
-bool CNode::isDandelionInbound(const CNode* const pnode)
-{
-    return (std::find(vDandelionInbound.begin(), vDandelionInbound.end(), pnode) != vDandelionInbound.end());
-}
-
-bool CNode::isLocalDandelionDestinationSet()
-{
-    return (localDandelionDestination != nullptr);
-}
-
-bool CNode::setLocalDandelionDestination()
-{
-    if (!isLocalDandelionDestinationSet()) {
-        localDandelionDestination = CNode::SelectFromDandelionDestinations();
-        LogPrintf("Set local Dandelion destination:\n%s", CNode::GetDandelionRoutingDataDebugString());
-    }
-    return isLocalDandelionDestinationSet();
-}
-
-bool CNode::localDandelionDestinationPushInventory(const CInv& inv) {
-    if (!isLocalDandelionDestinationSet()) {
-        setLocalDandelionDestination();
-    }
-    if (isLocalDandelionDestinationSet()) {
-        //LogPrintf("Dandelion: Pushing inventory item %s to %s.\n",
-        //          inv.ToString(),
-        //          localDandelionDestination->addrName);
-        localDandelionDestination->PushInventory(inv);
-        return true;
-    } else {
-        return false;
-    }
-}
-
-bool CNode::insertDandelionEmbargo(const uint256& hash, const int64_t& embargo) {
-    auto pair = mDandelionEmbargo.insert(std::make_pair(hash, embargo));
-    return pair.second;
-}
-
-bool CNode::isTxDandelionEmbargoed(const uint256& hash) {
-    return mDandelionEmbargo.find(hash) != mDandelionEmbargo.end();
-}
-
-bool CNode::removeDandelionEmbargo(const uint256& hash) {
-    auto iter = mDandelionEmbargo.find(hash);
-    if (iter != mDandelionEmbargo.end()) {
-        mDandelionEmbargo.erase(iter);
-        return true;
-    }
-    return false;
-}
-
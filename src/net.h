@@ -112,6 +112,20 @@ static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
 
+/** How the socket handler thread waits for socket readiness */
+enum SocketEventsMode {
+    SOCKETEVENTS_SELECT = 0,
+    SOCKETEVENTS_EPOLL = 1,
+};
+/** -socketevents default */
+static const char* const DEFAULT_SOCKETEVENTS = "select";
+/** Maximum number of readiness events fetched by one epoll_wait() call */
+static const int MAX_EPOLL_EVENTS = 64;
+/** -msghandlerthreads default, a single thread services all peers */
+static const int DEFAULT_MSGHANDLER_THREADS = 1;
+/** Maximum number of message handler threads */
+static const int MAX_MSGHANDLER_THREADS = 16;
+
 static const ServiceFlags REQUIRED_SERVICES = NODE_NETWORK;
 
 // NOTE: When adjusting this, update rpcnet:setban's help ("24h")
@@ -143,7 +157,23 @@ struct CSerializedNetMsg
     CSerializedNetMsg& operator=(const CSerializedNetMsg&) = delete;
 
     std::vector<unsigned char> data;
+    // payload shared with the messages to other peers, sent instead of data when set
+    std::shared_ptr<const std::vector<unsigned char>> sharedData;
     std::string command;
+
+    const std::vector<unsigned char>& GetData() const { return sharedData ? *sharedData : data; }
+};
+
+/** A part of a message queued for sending, either owned by the node or shared with other nodes */
+struct CSendQueueEntry
+{
+    std::vector<unsigned char> data;
+    std::shared_ptr<const std::vector<unsigned char>> sharedData;
+
+    explicit CSendQueueEntry(std::vector<unsigned char>&& _data) : data(std::move(_data)) {}
+    explicit CSendQueueEntry(const std::shared_ptr<const std::vector<unsigned char>>& _sharedData) : sharedData(_sharedData) {}
+
+    const std::vector<unsigned char>& Get() const { return sharedData ? *sharedData : data; }
 };
 
 
@@ -172,6 +202,8 @@ public:
         unsigned int nReceiveFloodSize = 0;
         uint64_t nMaxOutboundTimeframe = 0;
         uint64_t nMaxOutboundLimit = 0;
+        SocketEventsMode socketEventsMode = SOCKETEVENTS_SELECT;
+        int nMessageHandlerThreads = DEFAULT_MSGHANDLER_THREADS;
     };
     CConnman(uint64_t seed0, uint64_t seed1);
     ~CConnman();
@@ -225,6 +257,9 @@ public:
 
     void PushMessage(CNode* pnode, CSerializedNetMsg&& msg, bool allowOptimisticSend = DEFAULT_ALLOW_OPTIMISTIC_SEND);
 
+    /** Whether the socket handler can wait for the socket, select() is limited to descriptors below FD_SETSIZE */
+    bool CanHandleSocket(SOCKET hSocket) const;
+
     
 
     template<typename Condition, typename Callable>
@@ -428,8 +463,18 @@ private:
     void ProcessOneShot();
     void ThreadOpenConnections();
     void ThreadMessageHandler();
+    /** Process received messages and send pending ones for a single node, returns true if more work is pending */
+    bool ProcessNodeMessages(CNode* pnode);
     void AcceptConnection(const ListenSocket& hListenSocket);
     void ThreadSocketHandler();
+    void SocketHandlerSelect();
+#ifdef HAVE_SYS_EPOLL_H
+    void SocketHandlerEpoll();
+    bool RegisterEvents(CNode* pnode);
+#endif
+    /** Read once from the node's socket, returns true if more data may be pending */
+    bool SocketRecvData(CNode* pnode);
+    void InactivityCheck(CNode* pnode);
     void ThreadDNSAddressSeed();
     void ThreadOpenMasternodeConnections();
     void ThreadDandelionShuffle();
@@ -490,6 +535,18 @@ private:
 
     std::vector<ListenSocket> vhListenSocket;
     std::atomic<bool> fNetworkActive;
+
+    SocketEventsMode socketEventsMode;
+#ifdef HAVE_SYS_EPOLL_H
+    int epollfd{-1};
+    // epoll is edge-triggered, so nodes with unread data are remembered until their socket is drained.
+    // Only accessed by the socket handler thread, every entry holds a reference to the node.
+    std::set<CNode*> setReceivableNodes;
+    // Nodes with queued send data, every entry holds a reference to the node
+    std::set<CNode*> setNodesWithDataToSend;
+    CCriticalSection cs_setNodesWithDataToSend;
+    int64_t nLastInactivityCheck{0};
+#endif
     banmap_t setBanned;
     CCriticalSection cs_setBanned;
     bool setBannedIsDirty;
@@ -537,6 +594,8 @@ private:
     std::condition_variable condMsgProc;
     std::mutex mutexMsgProc;
     std::atomic<bool> flagInterruptMsgProc;
+    /** Number of threads sharing the per-node work of the message handler */
+    int nMessageHandlerThreads;
 
     CThreadInterrupt interruptNet;
 
@@ -573,6 +632,7 @@ struct CombinerAll
 struct CNodeSignals
 {
     boost::signals2::signal<bool (CNode*, CConnman&, std::atomic<bool>&), CombinerAll> ProcessMessages;
+    boost::signals2::signal<bool (CNode*, CConnman&, std::atomic<bool>&), CombinerAll> ProcessConcurrentMessages;
     boost::signals2::signal<bool (CNode*, CConnman&, std::atomic<bool>&), CombinerAll> SendMessages;
     boost::signals2::signal<void (CNode*, CConnman&)> InitializeNode;
     boost::signals2::signal<void (NodeId, bool&)> FinalizeNode;
@@ -613,6 +673,7 @@ extern bool fDiscover;
 extern bool fListen;
 extern bool fRelayTxes;
 
+extern CCriticalSection cs_mapAlreadyAskedFor;
 extern limitedmap<uint256, int64_t> mapAlreadyAskedFor;
 
 /** Subversion as sent to the P2P network in `version` messages */
@@ -716,7 +777,7 @@ public:
     size_t nSendSize; // total size of all vSendMsg entries
     size_t nSendOffset; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes;
-    std::deque<std::vector<unsigned char>> vSendMsg;
+    std::deque<CSendQueueEntry> vSendMsg;
     CCriticalSection cs_vSend;
     CCriticalSection cs_hSocket;
     CCriticalSection cs_vRecv;
@@ -775,6 +836,10 @@ public:
     const uint64_t nKeyedNetGroup;
     std::atomic_bool fPauseRecv;
     std::atomic_bool fPauseSend;
+    // Socket readiness as reported by edge-triggered epoll, cleared once the socket would block
+    std::atomic_bool fHasRecvData;
+    // set and cleared under cs_vSend, so a writability edge can't be lost to a concurrent send
+    std::atomic_bool fCanSendData;
 protected:
 
     mapMsgCmdSize mapSendBytesPerMsgCmd;
@@ -808,6 +873,7 @@ public:
     // List of non-tx/non-block inventory items
     std::vector<CInv> vInventoryOtherToSend;
     CCriticalSection cs_inventory;
+    // Also protected by cs_inventory, AskFor/RemoveAskFor are called from LLMQ threads too
     std::set<uint256> setAskFor;
     std::vector<std::pair<int64_t, CInv>> vecAskFor;
     int64_t nNextInvSend;
@@ -876,18 +942,6 @@ private:
     CService addrLocal;
     mutable CCriticalSection cs_addrLocal;
 public:
-    // Dandelion fields.
-    static std::vector<CNode*> vDandelionInbound;
-    static std::vector<CNode*> vDandelionOutbound;
-    static std::vector<CNode*> vDandelionDestination;
-    static CNode* localDandelionDestination;
-    static std::map<CNode*, CNode*> mDandelionRoutes;
-
-    // Dandelion helper functions.
-    static CNode* SelectFromDandelionDestinations();
-    static void CloseDandelionConnections(const CNode* const pnode);
-    static std::string GetDandelionRoutingDataDebugString();
-    static void DandelionShuffle();
 
     NodeId GetId() const {
       return id;
@@ -1011,22 +1065,6 @@ public:
     // in case of no limit, it will always response 0
     static uint64_t GetMaxOutboundTimeLeftInCycle();
 
-    // Public Dandelion field.
-    static std::map<uint256, int64_t> mDandelionEmbargo;
-
-    // Dandelion methods, they all must be static, as they do not belong to any CNode, they belong
-		// to the currently running node.
-    static bool isDandelionInbound(const CNode* const pnode);
-    static bool isLocalDandelionDestinationSet();
-    static bool setLocalDandelionDestination();
-    static CNode* getDandelionDestination(CNode* pfrom);
-    static bool localDandelionDestinationPushInventory(const CInv& inv);
-    static bool insertDandelionEmbargo(const uint256& hash, const int64_t& embargo);
-    static bool isTxDandelionEmbargoed(const uint256& hash);
-    static bool removeDandelionEmbargo(const uint256& hash);
-    static void CheckDandelionEmbargoes();
-    static void RelayDandelionTransaction(const CTransaction& tx, CNode* pfrom);
-
     std::string GetAddrName() const;
     //! Sets the addrName only if it was not previously set
     void MaybeSetAddrName(const std::string& addrNameIn);
@@ -7,13 +7,16 @@
 
 #include "addrman.h"
 #include "arith_uint256.h"
+#include "blockcache.h"
 #include "blockencodings.h"
 #include "chainparams.h"
 #include "consensus/validation.h"
+#include "dandelion.h"
 #include "hash.h"
 #include "init.h"
 #include "validation.h"
 #include "merkleblock.h"
+#include "msgstats.h"
 #include "net.h"
 #include "netmessagemaker.h"
 #include "netbase.h"
@@ -603,6 +606,7 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats) {
 void RegisterNodeSignals(CNodeSignals& nodeSignals)
 {
     nodeSignals.ProcessMessages.connect(&ProcessMessages);
+    nodeSignals.ProcessConcurrentMessages.connect(&ProcessConcurrentMessages);
     nodeSignals.SendMessages.connect(&SendMessages);
     nodeSignals.InitializeNode.connect(&InitializeNode);
     nodeSignals.FinalizeNode.connect(&FinalizeNode);
@@ -611,6 +615,7 @@ void RegisterNodeSignals(CNodeSignals& nodeSignals)
 void UnregisterNodeSignals(CNodeSignals& nodeSignals)
 {
     nodeSignals.ProcessMessages.disconnect(&ProcessMessages);
+    nodeSignals.ProcessConcurrentMessages.disconnect(&ProcessConcurrentMessages);
     nodeSignals.SendMessages.disconnect(&SendMessages);
     nodeSignals.InitializeNode.disconnect(&InitializeNode);
     nodeSignals.FinalizeNode.disconnect(&FinalizeNode);
@@ -1057,6 +1062,22 @@ static void RelayAddress(const CAddress& addr, bool fReachable, CConnman& connma
     connman.ForEachNodeThen(std::move(sortfunc), std::move(pushfunc));
 }
 
+/**
+ * Push a BLOCK message. Blocks from the served block cache are sent from their
+ * shared serialized form instead of being serialized again for every peer.
+ */
+static void PushBlockMessage(CNode* pto, CConnman& connman, const CNetMsgMaker& msgMaker, const CServedBlockPtr& servedBlock, const CBlock& block, bool fWitness)
+{
+    if (servedBlock) {
+        CSerializedNetMsg msg;
+        msg.command = NetMsgType::BLOCK;
+        msg.sharedData = servedBlock->GetSerialized(fWitness);
+        connman.PushMessage(pto, std::move(msg));
+    } else {
+        connman.PushMessage(pto, msgMaker.Make(fWitness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, block));
+    }
+}
+
 void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParams, CConnman& connman, const std::atomic<bool>& interruptMsgProc)
 {
     std::deque<CInv>::iterator it = pfrom->vRecvGetData.begin();
@@ -1129,14 +1150,22 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 // it's available before trying to send.
                 if (send && (mi->second->nStatus & BLOCK_HAVE_DATA))
                 {
-                    // Send block from disk
-                    CBlock block;
-                    if (!ReadBlockFromDisk(block, (*mi).second, consensusParams))
-                        assert(!"cannot load block from disk");
+                    // Send block from the served block cache or from disk
+                    CServedBlockPtr servedBlock = servedBlockCache.Get(inv.hash);
+                    std::shared_ptr<const CBlock> pblock;
+                    if (servedBlock) {
+                        pblock = servedBlock->block;
+                    } else {
+                        std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
+                        if (!ReadBlockFromDisk(*pblockRead, (*mi).second, consensusParams))
+                            assert(!"cannot load block from disk");
+                        pblock = pblockRead;
+                    }
+                    const CBlock& block = *pblock;
                     if (inv.type == MSG_BLOCK)
-                        connman.PushMessage(pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, block));
+                        PushBlockMessage(pfrom, connman, msgMaker, servedBlock, block, false);
                     else if (inv.type == MSG_WITNESS_BLOCK)
-                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, block));
+                        PushBlockMessage(pfrom, connman, msgMaker, servedBlock, block, true);
                     else if (inv.type == MSG_FILTERED_BLOCK)
                     {
                         bool sendMerkleBlock = false;
@@ -1175,7 +1204,7 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                             CBlockHeaderAndShortTxIDs cmpctblock(block, fPeerWantsWitness);
                             connman.PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock));
                         } else
-                            connman.PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::BLOCK, block));
+                            PushBlockMessage(pfrom, connman, msgMaker, servedBlock, block, fPeerWantsWitness);
                     }
 
                     // Trigger the peer node to send a getblocks request for the next batch of inventory
@@ -1216,13 +1245,16 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                     int nSendFlags = (
                             inv.type == MSG_DANDELION_TX ?
                             SERIALIZE_TRANSACTION_NO_WITNESS : 0);
-                    auto txinfo = txpools.getStemTxPool().info(inv.hash);
+                    // Transactions in the stem phase are kept by the Dandelion manager while embargoed
+                    CTransactionRef ptx = dandelion.GetEmbargoedTx(inv.hash);
+                    if (!ptx)
+                        ptx = txpools.getStemTxPool().get(inv.hash);
                     uint256 dandelionServiceDiscoveryHash;
                     dandelionServiceDiscoveryHash.SetHex(
                             "0xffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
-                    if (txinfo.tx && !CNode::isDandelionInbound(pfrom) &&
+                    if (ptx && !dandelion.IsInbound(pfrom) &&
                             pfrom->setDandelionInventoryKnown.count(inv.hash) != 0) {                                
-                        connman.PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::DANDELIONTX, *txinfo.tx));
+                        connman.PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::DANDELIONTX, *ptx));
                         push = true;
                     } else if (inv.hash == dandelionServiceDiscoveryHash &&
                                pfrom->setDandelionInventoryKnown.count(inv.hash) != 0) {
@@ -1463,7 +1495,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
 
     {
         LOCK(cs_main);
-        CNode::CheckDandelionEmbargoes();
+        dandelion.CheckEmbargoes(connman);
     }
 
     if (strCommand == NetMsgType::REJECT)
@@ -1888,7 +1920,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                              inv.hash.ToString(), pfrom->GetId());
                 } else if ((!fAlreadyHave && !fImporting && !fReindex &&
                             !IsInitialBlockDownload() &&
-                            CNode::isDandelionInbound(pfrom)) ||
+                            dandelion.IsInbound(pfrom)) ||
                             inv.hash == dandelionServiceDiscoveryHash) {
                     pfrom->AskFor(inv);
                 }
@@ -2051,6 +2083,12 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             return true;
         }
 
+        CServedBlockPtr servedBlock = servedBlockCache.Get(req.blockhash);
+        if (servedBlock) {
+            SendBlockTransactions(*servedBlock->block, req, pfrom, connman);
+            return true;
+        }
+
         CBlock block;
         bool ret = ReadBlockFromDisk(block, it->second, chainparams.GetConsensus());
         assert(ret);
@@ -2167,8 +2205,14 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         CValidationState state;
         CValidationState dummyState; // Dummy state for Dandelion stempool
 
-        pfrom->setAskFor.erase(inv.hash);
-        mapAlreadyAskedFor.erase(inv.hash);
+        {
+            LOCK(pfrom->cs_inventory);
+            pfrom->setAskFor.erase(inv.hash);
+        }
+        {
+            LOCK(cs_mapAlreadyAskedFor);
+            mapAlreadyAskedFor.erase(inv.hash);
+        }
 
         std::list<CTransactionRef> lRemovedTxn;
 
@@ -2189,12 +2233,8 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 false /* markZcoinSpendTransactionSerial */
             );
 
-            if (CNode::isTxDandelionEmbargoed(tx.GetHash())) {
-                //LogPrintf(
-                //    "Embargoed dandeliontx %s found in mempool; removing from embargo map\n",
-                //    tx.GetHash().ToString());
-                CNode::removeDandelionEmbargo(tx.GetHash());
-            }
+            // Embargoed dandeliontx found in mempool, it reached the fluff phase
+            dandelion.RemoveEmbargo(tx.GetHash());
 
             mempool.check(pcoinsTip);
             connman.RelayTransaction(tx);
@@ -2300,9 +2340,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 true, /* isCheckWalletTransaction */
                 false /* markZcoinSpendTransactionSerial */
             );
-            if (CNode::isTxDandelionEmbargoed(tx.GetHash())) {
-                CNode::removeDandelionEmbargo(tx.GetHash());
-            }
+            dandelion.RemoveEmbargo(tx.GetHash());
             // Changes to mempool should also be made to Dandelion stempool
             txpools.getStemTxPool().check(pcoinsTip);
 
@@ -2413,7 +2451,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         std::list<CTransaction> lRemovedTxn;
         CInv inv(MSG_DANDELION_TX, tx.GetHash());
         LOCK(cs_main);
-        if (CNode::isDandelionInbound(pfrom)) {
+        if (dandelion.IsInbound(pfrom)) {
             if (!txpools.getStemTxPool().exists(inv.hash)) {
                 bool ret = AcceptToMemoryPool(
                     txpools.getStemTxPool(),
@@ -2438,7 +2476,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                     auto& consensus = Params().GetConsensus();
                     int64_t nEmbargo = 1000000 * consensus.nDandelionEmbargoMinimum +
                         PoissonNextSend(nCurrTime, consensus.nDandelionEmbargoAvgAdd);
-                    pfrom->insertDandelionEmbargo(tx.GetHash(), nEmbargo);
+                    dandelion.AddEmbargo(ptx, nEmbargo);
                }
                 int nDoS = 0;
                 if (state.IsInvalid(nDoS)) {
@@ -2463,7 +2501,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             // Or we just successfully added it there, relay it.
             // It will either get relayed to one Dandelion destination, or fluff phase will start.
             if (txpools.getStemTxPool().exists(inv.hash)) {
-                CNode::RelayDandelionTransaction(tx, pfrom);
+                dandelion.RelayTransaction(ptx, pfrom, connman);
             }
         }
     }
@@ -3218,7 +3256,21 @@ static bool SendRejectsAndCheckIfBanned(CNode* pnode, CConnman& connman)
     return false;
 }
 
-bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& interruptMsgProc)
+/**
+ * Requests that may be handled off the message handler thread. Their handlers either hold cs_main
+ * for their whole body or only touch per-node and self-locked state, so they don't race with the
+ * handler thread or with each other.
+ */
+static bool IsConcurrentMessage(const std::string& strCommand)
+{
+    return strCommand == NetMsgType::PING ||
+           strCommand == NetMsgType::GETDATA ||
+           strCommand == NetMsgType::GETHEADERS ||
+           strCommand == NetMsgType::GETBLOCKTXN ||
+           strCommand == NetMsgType::GETMNLISTDIFF;
+}
+
+static bool ProcessMessagesInternal(CNode* pfrom, CConnman& connman, const std::atomic<bool>& interruptMsgProc, bool fConcurrentOnly)
 {
     const CChainParams& chainparams = Params();
     //
@@ -3249,6 +3301,9 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& i
             LOCK(pfrom->cs_vProcessMsg);
             if (pfrom->vProcessMsg.empty())
                 return false;
+            // Leave everything else to the message handler thread
+            if (fConcurrentOnly && !IsConcurrentMessage(pfrom->vProcessMsg.front().hdr.GetCommand()))
+                return false;
             // Just take one message
             msgs.splice(msgs.begin(), pfrom->vProcessMsg, pfrom->vProcessMsg.begin());
             pfrom->nProcessQueueSize -= msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
@@ -3291,6 +3346,8 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& i
 
         // Process message
         bool fRet = false;
+        int64_t nProcessStart = GetTimeMicros();
+        CLockWaitTracker mainWait(&cs_main);
         try
         {
             fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc);
@@ -3325,6 +3382,7 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& i
         catch (...) {
             PrintExceptionContinue(std::current_exception(), "ProcessMessages()");
         }
+        messageStats.RecordReceived(strCommand, nMessageSize + CMessageHeader::HEADER_SIZE, GetTimeMicros() - nProcessStart, mainWait.GetWaitMicros());
 
         if (!fRet) {
             LogPrintf("%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->id);
@@ -3336,6 +3394,16 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& i
     return fMoreWork;
 }
 
+bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& interruptMsgProc)
+{
+    return ProcessMessagesInternal(pfrom, connman, interruptMsgProc, false);
+}
+
+bool ProcessConcurrentMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& interruptMsgProc)
+{
+    return ProcessMessagesInternal(pfrom, connman, interruptMsgProc, true);
+}
+
 class CompareInvMempoolOrder
 {
     CTxMemPool *mp;
@@ -3361,6 +3429,8 @@ bool SendMessages(CNode* pto, CConnman& connman, const std::atomic<bool>& interr
         if (!pto->fSuccessfullyConnected || pto->fDisconnect)
             return true;
 
+        CSendMessagesScope sendMessagesScope;
+
         // If we get here, the outgoing message serialization version is set and can't change.
         const CNetMsgMaker msgMaker(pto->GetSendVersion());
 
@@ -3559,11 +3629,17 @@ bool SendMessages(CNode* pto, CConnman& connman, const std::atomic<bool>& interr
                         }
                     }
                     if (!fGotBlockFromCache) {
-                        CBlock block;
-                        bool ret = ReadBlockFromDisk(block, pBestIndex, consensusParams);
-                        assert(ret);
-                        CBlockHeaderAndShortTxIDs cmpctblock(block, state.fWantsCmpctWitness);
-                        connman.PushMessage(pto, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock));
+                        CServedBlockPtr servedBlock = servedBlockCache.Get(pBestIndex->GetBlockHash());
+                        if (servedBlock) {
+                            CBlockHeaderAndShortTxIDs cmpctblock(*servedBlock->block, state.fWantsCmpctWitness);
+                            connman.PushMessage(pto, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock));
+                        } else {
+                            CBlock block;
+                            bool ret = ReadBlockFromDisk(block, pBestIndex, consensusParams);
+                            assert(ret);
+                            CBlockHeaderAndShortTxIDs cmpctblock(block, state.fWantsCmpctWitness);
+                            connman.PushMessage(pto, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock));
+                        }
                     }
                     state.pindexBestHeaderSent = pBestIndex;
                 } else if (state.fPreferHeaders) {
@@ -3831,6 +3907,8 @@ bool SendMessages(CNode* pto, CConnman& connman, const std::atomic<bool>& interr
         //
         // Message: getdata (non-blocks)
         //
+        {
+        LOCK(pto->cs_inventory);
         std::sort(pto->vecAskFor.begin(), pto->vecAskFor.end());
         auto it = pto->vecAskFor.begin();
         while (it != pto->vecAskFor.end() && it->first <= nNow)
@@ -3854,6 +3932,7 @@ bool SendMessages(CNode* pto, CConnman& connman, const std::atomic<bool>& interr
             ++it;
         }
         pto->vecAskFor.erase(pto->vecAskFor.begin(), it);
+        }
         if (!vGetData.empty()) {
             connman.PushMessage(pto, msgMaker.Make(NetMsgType::GETDATA, vGetData));
             LogPrint("net", "SendMessages -- GETDATA -- pushed size = %lu peer=%d\n", vGetData.size(), pto->id);
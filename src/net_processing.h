@@ -51,6 +51,8 @@ bool IsBanned(NodeId nodeid);
 
 /** Process protocol messages received from a given node */
 bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& interrupt);
+/** Process the next message of a node only if it is a read-only request that may run off the message handler thread */
+bool ProcessConcurrentMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& interrupt);
 /**
  * Send queued protocol messages to be sent to a give node.
  *
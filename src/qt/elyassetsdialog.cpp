@@ -211,17 +211,9 @@ void ElyAssetsDialog::PopulateBalances(unsigned int propertyId)
         for(std::unordered_map<string, CMPTally>::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
             const std::string& address = my_it->first;
             CMPTally& tally = my_it->second;
-            tally.init();
-
-            uint32_t id;
-            bool watchAddress = false, includeAddress = false;
-            while (0 != (id = (tally.next()))) {
-                if (id == propertyId) {
-                    includeAddress = true;
-                    break;
-                }
-            }
-            if (!includeAddress) continue; //ignore this address, has never transacted in this propertyId
+
+            bool watchAddress = false;
+            if (!tally.hasProperty(propertyId)) continue; //ignore this address, has never transacted in this propertyId
 
             // determine if this address is in the wallet
             int addressIsMine = IsMyAddress(address);
@@ -139,13 +139,9 @@ void MetaDExDialog::PopulateAddresses()
         ui->comboAddress->clear();
         for (std::unordered_map<string, CMPTally>::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
             string address = (my_it->first).c_str();
-            uint32_t id;
-            (my_it->second).init();
-            while (0 != (id = (my_it->second).next())) {
-                if (id == propertyId) {
-                    if (!getUserAvailableMPbalance(address, propertyId)) continue; // ignore this address, has no available balance to spend
-                    if (IsMyAddress(address)) ui->comboAddress->addItem((my_it->first).c_str()); // only include wallet addresses
-                }
+            if ((my_it->second).hasProperty(propertyId)) {
+                if (!getUserAvailableMPbalance(address, propertyId)) continue; // ignore this address, has no available balance to spend
+                if (IsMyAddress(address)) ui->comboAddress->addItem((my_it->first).c_str()); // only include wallet addresses
             }
         }
         int idx = ui->comboAddress->findText(currentSetAddress);
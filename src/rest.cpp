@@ -9,6 +9,7 @@
 #include "primitives/transaction.h"
 #include "validation.h"
 #include "httpserver.h"
+#include "msgstats.h"
 #include "rpc/server.h"
 #include "streams.h"
 #include "sync.h"
@@ -621,3 +622,25 @@ void StopREST()
     for (unsigned int i = 0; i < ARRAYLEN(uri_prefixes); i++)
         UnregisterHTTPHandler(uri_prefixes[i].prefix, false);
 }
+
+static bool http_metrics(HTTPRequest* req, const std::string& strURIPart)
+{
+    std::map<std::string, CMessageTypeStats> mapStats;
+    CSendMessagesStats sendMessagesStats;
+    messageStats.GetStats(mapStats, sendMessagesStats);
+
+    req->WriteHeader("Content-Type", "text/plain; version=0.0.4");
+    req->WriteReply(HTTP_OK, MessageStatsToPrometheus(mapStats, sendMessagesStats));
+    return true;
+}
+
+bool StartHTTPMetrics()
+{
+    RegisterHTTPHandler("/metrics", true, http_metrics);
+    return true;
+}
+
+void StopHTTPMetrics()
+{
+    UnregisterHTTPHandler("/metrics", true);
+}
@@ -127,6 +127,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "setban", 2, "bantime" },
     { "setban", 3, "absolute" },
     { "setnetworkactive", 0, "state" },
+    { "getmessagestats", 0, "reset" },
     { "getmempoolancestors", 1, "verbose" },
     { "getmempooldescendants", 1, "verbose" },
     { "bumpfee", 1, "options" },
@@ -202,6 +203,8 @@ static const CRPCConvertParam vRPCConvertParams[] =
 	{ "elysium_listmints", 1 },
 	{ "elysium_listmints", 2 },
 	{ "elysium_getallbalancesforid", 0 },
+	{ "elysium_getwalletbalances", 0 },
+	{ "elysium_getwalletaddressbalances", 0 },
 	{ "elysium_listblocktransactions", 0 },
 	{ "elysium_getorderbook", 0 },
 	{ "elysium_getorderbook", 1 },
@@ -267,6 +270,9 @@ static const CRPCConvertParam vRPCConvertParams[] =
 	{ "elysium_sendmint", 3 },
 	{ "elysium_sendspend", 1 },
 	{ "elysium_sendspend", 2 },
+	{ "elysium_sendspendasync", 1 },
+	{ "elysium_sendspendasync", 2 },
+	{ "elysium_getspendjob", 0 },
 
 	/* Elysium - raw transaction calls */
 	{ "elysium_decodetransaction", 1 },
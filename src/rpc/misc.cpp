@@ -24,6 +24,7 @@
 #include "zerocoin.h"
 
 #include "masternode-sync.h"
+#include "evo/deterministicmns.h"
 
 #include <stdint.h>
 
@@ -1439,6 +1440,22 @@ static UniValue RPCLockedMemoryInfo()
     return obj;
 }
 
+static UniValue RPCMNListsMemoryInfo()
+{
+    CDeterministicMNListsCacheStats stats;
+    if (deterministicMNManager) {
+        deterministicMNManager->GetListsCacheStats(stats);
+    }
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("lists", uint64_t(stats.nLists)));
+    obj.push_back(Pair("entries", uint64_t(stats.nEntries)));
+    obj.push_back(Pair("znodes", uint64_t(stats.nMNs)));
+    obj.push_back(Pair("states", uint64_t(stats.nStates)));
+    obj.push_back(Pair("operator_keys", uint64_t(stats.nOperatorKeys)));
+    obj.push_back(Pair("usage", uint64_t(stats.nUsage)));
+    return obj;
+}
+
 UniValue getmemoryinfo(const JSONRPCRequest& request)
 {
     /* Please, avoid using the word "pool" here in the RPC interface or help,
@@ -1457,6 +1474,14 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
             "    \"locked\": xxxxxx,       (numeric) Amount of bytes that succeeded locking. If this number is smaller than total, locking pages failed at some point and key data could be swapped to disk.\n"
             "    \"chunks_used\": xxxxx,   (numeric) Number allocated chunks\n"
             "    \"chunks_free\": xxxxx,   (numeric) Number unused chunks\n"
+            "  },\n"
+            "  \"mnlists\": {              (json object) Information about the cached deterministic znode lists\n"
+            "    \"lists\": xxxxx,         (numeric) Number of cached lists\n"
+            "    \"entries\": xxxxx,       (numeric) Number of znode entries summed over all cached lists\n"
+            "    \"znodes\": xxxxx,        (numeric) Number of distinct znode objects shared by the lists\n"
+            "    \"states\": xxxxx,        (numeric) Number of distinct znode states shared by the lists\n"
+            "    \"operator_keys\": xxxxx, (numeric) Number of distinct operator keys in use\n"
+            "    \"usage\": xxxxx,         (numeric) Estimated number of bytes used, not counting the list indexes\n"
             "  }\n"
             "}\n"
             "\nExamples:\n"
@@ -1465,6 +1490,7 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
         );
     UniValue obj(UniValue::VOBJ);
     obj.push_back(Pair("locked", RPCLockedMemoryInfo()));
+    obj.push_back(Pair("mnlists", RPCMNListsMemoryInfo()));
     return obj;
 }
 
@@ -4,8 +4,11 @@
 
 #include "rpc/server.h"
 
+#include "blockcache.h"
 #include "chainparams.h"
 #include "clientversion.h"
+#include "dandelion.h"
+#include "msgstats.h"
 #include "validation.h"
 #include "net.h"
 #include "net_processing.h"
@@ -351,6 +354,12 @@ UniValue getnettotals(const JSONRPCRequest& request)
             "    \"serve_historical_blocks\": true|false,  (boolean) True if serving historical blocks\n"
             "    \"bytes_left_in_cycle\": t,               (numeric) Bytes left in current time cycle\n"
             "    \"time_left_in_cycle\": t                 (numeric) Seconds left in current time cycle\n"
+            "  },\n"
+            "  \"servedblockcache\":\n"
+            "  {\n"
+            "    \"entries\": n,                           (numeric) Number of recently connected blocks kept for serving\n"
+            "    \"hits\": n,                              (numeric) Block requests served without reading from disk\n"
+            "    \"misses\": n                             (numeric) Block requests that had to read from disk\n"
             "  }\n"
             "}\n"
             "\nExamples:\n"
@@ -373,6 +382,14 @@ UniValue getnettotals(const JSONRPCRequest& request)
     outboundLimit.push_back(Pair("bytes_left_in_cycle", g_connman->GetOutboundTargetBytesLeft()));
     outboundLimit.push_back(Pair("time_left_in_cycle", g_connman->GetMaxOutboundTimeLeftInCycle()));
     obj.push_back(Pair("uploadtarget", outboundLimit));
+
+    CServedBlockCacheStats cacheStats;
+    servedBlockCache.GetStats(cacheStats);
+    UniValue blockCache(UniValue::VOBJ);
+    blockCache.push_back(Pair("entries", (uint64_t)cacheStats.nEntries));
+    blockCache.push_back(Pair("hits", cacheStats.nHits));
+    blockCache.push_back(Pair("misses", cacheStats.nMisses));
+    obj.push_back(Pair("servedblockcache", blockCache));
     return obj;
 }
 
@@ -608,6 +625,134 @@ UniValue setnetworkactive(const JSONRPCRequest& request)
     return g_connman->GetNetworkActive();
 }
 
+static UniValue DurationHistogramToJSON(const CDurationHistogram& hist)
+{
+    UniValue buckets(UniValue::VOBJ);
+    for (int i = 0; i < DURATION_HISTOGRAM_BUCKETS; i++) {
+        if (hist.buckets[i] == 0)
+            continue;
+        std::string strBound = i == DURATION_HISTOGRAM_BUCKETS - 1 ? "+inf" : i64tostr(CDurationHistogram::GetBucketBound(i));
+        buckets.push_back(Pair(strBound, hist.buckets[i]));
+    }
+    return buckets;
+}
+
+UniValue getmessagestats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw runtime_error(
+            "getmessagestats ( reset )\n"
+            "\nReturns statistics about the P2P messages received, processed and sent, per message type.\n"
+            "\nArguments:\n"
+            "1. reset       (boolean, optional, default=false) Clear the statistics after returning them\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"messages\":\n"
+            "  {\n"
+            "    \"command\":                   (json object) The message type, \"*other*\" for unknown ones\n"
+            "    {\n"
+            "      \"recv_count\": n,            (numeric) Number of messages received and processed\n"
+            "      \"recv_bytes\": n,            (numeric) Bytes received, headers included\n"
+            "      \"sent_count\": n,            (numeric) Number of messages queued for sending\n"
+            "      \"sent_bytes\": n,            (numeric) Bytes queued for sending, headers included\n"
+            "      \"process_total_us\": n,      (numeric) Total processing time in microseconds\n"
+            "      \"process_max_us\": n,        (numeric) Longest processing time in microseconds\n"
+            "      \"cs_main_wait_us\": n,       (numeric) Part of the processing time spent waiting for cs_main, 0 without -lockwaitstats\n"
+            "      \"histogram\":                (json object) Number of messages per processing time bucket\n"
+            "      {\n"
+            "        \"<bound>\": n,             (numeric) Messages processed in less than <bound> microseconds,\n"
+            "                                  the last bucket is \"+inf\". Empty buckets are omitted\n"
+            "        ...\n"
+            "      }\n"
+            "    },\n"
+            "    ...\n"
+            "  },\n"
+            "  \"sendmessages\":                (json object) The per-peer SendMessages calls\n"
+            "  {\n"
+            "    \"count\": n,                   (numeric) Number of calls\n"
+            "    \"total_us\": n,                (numeric) Total time in microseconds\n"
+            "    \"max_us\": n,                  (numeric) Longest call in microseconds\n"
+            "    \"histogram\": { ... }          (json object) Same format as above\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getmessagestats", "")
+            + HelpExampleRpc("getmessagestats", "")
+        );
+
+    std::map<std::string, CMessageTypeStats> mapStats;
+    CSendMessagesStats sendMessagesStats;
+    bool fReset = request.params.size() > 0 && request.params[0].get_bool();
+    messageStats.GetStats(mapStats, sendMessagesStats, fReset);
+
+    UniValue messages(UniValue::VOBJ);
+    for (const auto& p : mapStats) {
+        const CMessageTypeStats& stats = p.second;
+        UniValue cmdObj(UniValue::VOBJ);
+        cmdObj.push_back(Pair("recv_count", stats.nRecvCount));
+        cmdObj.push_back(Pair("recv_bytes", stats.nRecvBytes));
+        cmdObj.push_back(Pair("sent_count", stats.nSentCount));
+        cmdObj.push_back(Pair("sent_bytes", stats.nSentBytes));
+        cmdObj.push_back(Pair("process_total_us", stats.processTime.nTotalMicros));
+        cmdObj.push_back(Pair("process_max_us", stats.processTime.nMaxMicros));
+        cmdObj.push_back(Pair("cs_main_wait_us", stats.nMainWaitMicros));
+        cmdObj.push_back(Pair("histogram", DurationHistogramToJSON(stats.processTime)));
+        messages.push_back(Pair(p.first, cmdObj));
+    }
+
+    UniValue sendObj(UniValue::VOBJ);
+    sendObj.push_back(Pair("count", sendMessagesStats.processTime.nCount));
+    sendObj.push_back(Pair("total_us", sendMessagesStats.processTime.nTotalMicros));
+    sendObj.push_back(Pair("max_us", sendMessagesStats.processTime.nMaxMicros));
+    sendObj.push_back(Pair("histogram", DurationHistogramToJSON(sendMessagesStats.processTime)));
+
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("messages", messages));
+    obj.push_back(Pair("sendmessages", sendObj));
+    return obj;
+}
+
+UniValue getdandelioninfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw runtime_error(
+            "getdandelioninfo\n"
+            "\nReturns the state of Dandelion transaction routing.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"inbound\": n,              (numeric) Number of inbound peers whose transactions are stemmed\n"
+            "  \"outbound\": n,             (numeric) Number of outbound peers\n"
+            "  \"destinations\": n,         (numeric) Number of outbound peers transactions are stemmed to\n"
+            "  \"routes\": n,               (numeric) Number of inbound peers with an assigned destination\n"
+            "  \"embargoes\": n,            (numeric) Number of transactions in the stem phase under embargo\n"
+            "  \"stem_relayed\": n,         (numeric) Transactions passed on to a single destination\n"
+            "  \"fluffed\": n,              (numeric) Transactions switched to the fluff phase\n"
+            "  \"embargo_expired\": n,      (numeric) Transactions fluffed because their embargo expired\n"
+            "  \"embargo_cleared\": n,      (numeric) Embargoed transactions seen back in the fluff phase\n"
+            "  \"embargo_dropped\": n       (numeric) Expired embargoes dropped because the transaction left the stempool or was rejected\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdandelioninfo", "")
+            + HelpExampleRpc("getdandelioninfo", "")
+        );
+
+    CDandelionStats stats;
+    dandelion.GetStats(stats);
+
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("inbound", (uint64_t)stats.nInbound));
+    obj.push_back(Pair("outbound", (uint64_t)stats.nOutbound));
+    obj.push_back(Pair("destinations", (uint64_t)stats.nDestinations));
+    obj.push_back(Pair("routes", (uint64_t)stats.nRoutes));
+    obj.push_back(Pair("embargoes", (uint64_t)stats.nEmbargoes));
+    obj.push_back(Pair("stem_relayed", stats.nStemRelayed));
+    obj.push_back(Pair("fluffed", stats.nFluffed));
+    obj.push_back(Pair("embargo_expired", stats.nEmbargoExpired));
+    obj.push_back(Pair("embargo_cleared", stats.nEmbargoCleared));
+    obj.push_back(Pair("embargo_dropped", stats.nEmbargoDropped));
+    return obj;
+}
+
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafeMode
   //  --------------------- ------------------------  -----------------------  ----------
@@ -619,6 +764,8 @@ static const CRPCCommand commands[] =
     { "network",            "getaddednodeinfo",       &getaddednodeinfo,       true,  {"node"} },
     { "network",            "getnettotals",           &getnettotals,           true,  {} },
     { "network",            "getnetworkinfo",         &getnetworkinfo,         true,  {} },
+    { "network",            "getmessagestats",        &getmessagestats,        true,  {"reset"} },
+    { "network",            "getdandelioninfo",       &getdandelioninfo,       true,  {} },
     { "network",            "setban",                 &setban,                 true,  {"subnet", "command", "bantime", "absolute"} },
     { "network",            "listbanned",             &listbanned,             true,  {} },
     { "network",            "clearbanned",            &clearbanned,            true,  {} },
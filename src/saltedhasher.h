@@ -30,6 +30,15 @@ struct SaltedHasherImpl<std::pair<N, uint256>>
     }
 };
 
+template<>
+struct SaltedHasherImpl<std::pair<uint256, uint256>>
+{
+    static std::size_t CalcHash(const std::pair<uint256, uint256>& v, uint64_t k0, uint64_t k1)
+    {
+        return SipHashUint256Extra(k0, k1, v.first, (uint32_t) SipHashUint256(k0, k1, v.second));
+    }
+};
+
 template<>
 struct SaltedHasherImpl<uint256>
 {
@@ -39,6 +48,15 @@ struct SaltedHasherImpl<uint256>
     }
 };
 
+template<>
+struct SaltedHasherImpl<uint160>
+{
+    static std::size_t CalcHash(const uint160& v, uint64_t k0, uint64_t k1)
+    {
+        return CSipHasher(k0, k1).Write(v.begin(), v.size()).Finalize();
+    }
+};
+
 struct SaltedHasherBase
 {
     /** Salt */
@@ -12,6 +12,35 @@
 #include <boost/foreach.hpp>
 #include <boost/thread.hpp>
 
+static void NoCleanup(CLockWaitTracker*) {}
+// Points to the innermost tracker of each thread, trackers live on the stack of their thread
+static boost::thread_specific_ptr<CLockWaitTracker> lockWaitTracker(NoCleanup);
+
+std::atomic<bool> CLockWaitTracker::fEnabled{false};
+
+CLockWaitTracker::CLockWaitTracker(void* csIn) : cs(csIn), nWaitMicros(0), prev(nullptr), fRegistered(IsEnabled())
+{
+    if (fRegistered) {
+        prev = lockWaitTracker.get();
+        lockWaitTracker.reset(this);
+    }
+}
+
+CLockWaitTracker::~CLockWaitTracker()
+{
+    if (fRegistered)
+        lockWaitTracker.reset(prev);
+}
+
+CLockWaitTracker* CLockWaitTracker::Get(void* cs)
+{
+    for (CLockWaitTracker* tracker = lockWaitTracker.get(); tracker; tracker = tracker->prev) {
+        if (tracker->cs == cs)
+            return tracker;
+    }
+    return nullptr;
+}
+
 #ifdef DEBUG_LOCKCONTENTION
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine)
 {
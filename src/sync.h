@@ -13,6 +13,10 @@
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/recursive_mutex.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+
 
 ////////////////////////////////////////////////
 //                                            //
@@ -111,6 +115,37 @@ typedef boost::condition_variable CConditionVariable;
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine);
 #endif
 
+/**
+ * Accumulates the time the current thread spends waiting for one particular
+ * lock while the tracker is alive. Only contended acquisitions are timed.
+ * Trackers nest, a lock is accounted to the innermost tracker for it.
+ * Tracking is off unless enabled (-lockwaitstats), trackers created while it
+ * is off stay at zero and contended locks skip the thread-local lookup.
+ */
+class CLockWaitTracker
+{
+private:
+    static std::atomic<bool> fEnabled;
+
+    void* cs;
+    int64_t nWaitMicros;
+    CLockWaitTracker* prev;
+    bool fRegistered;
+
+public:
+    explicit CLockWaitTracker(void* csIn);
+    ~CLockWaitTracker();
+
+    void AddWait(int64_t nMicros) { nWaitMicros += nMicros; }
+    int64_t GetWaitMicros() const { return nWaitMicros; }
+
+    static void SetEnabled(bool fEnable) { fEnabled.store(fEnable, std::memory_order_relaxed); }
+    static bool IsEnabled() { return fEnabled.load(std::memory_order_relaxed); }
+
+    /** Returns the tracker of the current thread for cs or nullptr */
+    static CLockWaitTracker* Get(void* cs);
+};
+
 /** Wrapper around boost::unique_lock<Mutex> */
 template <typename Mutex>
 class SCOPED_LOCKABLE CMutexLock
@@ -121,14 +156,19 @@ private:
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(lock.mutex()));
-#ifdef DEBUG_LOCKCONTENTION
         if (!lock.try_lock()) {
+#ifdef DEBUG_LOCKCONTENTION
             PrintLockContention(pszName, pszFile, nLine);
 #endif
-            lock.lock();
-#ifdef DEBUG_LOCKCONTENTION
+            CLockWaitTracker* tracker = CLockWaitTracker::IsEnabled() ? CLockWaitTracker::Get((void*)(lock.mutex())) : nullptr;
+            if (tracker) {
+                auto start = std::chrono::steady_clock::now();
+                lock.lock();
+                tracker->AddWait(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+            } else {
+                lock.lock();
+            }
         }
-#endif
     }
 
     bool TryEnter(const char* pszName, const char* pszFile, int nLine)
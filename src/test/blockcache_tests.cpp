@@ -0,0 +1,73 @@
+// Copyright (c) 2020 The Zcoin Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockcache.h"
+
+#include "streams.h"
+#include "version.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockcache_tests, BasicTestingSetup)
+
+static std::shared_ptr<const CBlock> MakeBlock(uint32_t nNonce)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig = CScript() << nNonce;
+    tx.vout.resize(1);
+    tx.vout[0].nValue = 42;
+
+    auto block = std::make_shared<CBlock>();
+    block->nNonce = nNonce;
+    block->vtx.push_back(MakeTransactionRef(tx));
+    return block;
+}
+
+BOOST_AUTO_TEST_CASE(blockcache_serialized_form)
+{
+    CServedBlockCache cache(2);
+    auto block = MakeBlock(1);
+    cache.Add(block);
+
+    CServedBlockPtr served = cache.Get(block->GetHash());
+    BOOST_REQUIRE(served);
+    BOOST_CHECK(served->block == block);
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS);
+    ss << *block;
+    std::vector<unsigned char> expected(ss.begin(), ss.end());
+    BOOST_CHECK(*served->GetSerialized(false) == expected);
+
+    // the serialized form is built once and then shared
+    BOOST_CHECK(served->GetSerialized(false) == served->GetSerialized(false));
+    // without witness data both forms share the same buffer
+    BOOST_CHECK(served->GetSerialized(true) == served->GetSerialized(false));
+}
+
+BOOST_AUTO_TEST_CASE(blockcache_bounded)
+{
+    CServedBlockCache cache(2);
+    std::vector<std::shared_ptr<const CBlock>> blocks;
+    for (uint32_t i = 0; i < 4; i++) {
+        blocks.push_back(MakeBlock(i));
+        cache.Add(blocks.back());
+    }
+
+    BOOST_CHECK(cache.Get(blocks[3]->GetHash()));
+    BOOST_CHECK(!cache.Get(blocks[0]->GetHash()));
+
+    CServedBlockCacheStats stats;
+    cache.GetStats(stats);
+    BOOST_CHECK(stats.nEntries <= 3);
+    BOOST_CHECK_EQUAL(stats.nHits, 1);
+    BOOST_CHECK_EQUAL(stats.nMisses, 1);
+
+    cache.Clear();
+    BOOST_CHECK(!cache.Get(blocks[3]->GetHash()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
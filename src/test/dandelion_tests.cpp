@@ -0,0 +1,146 @@
+// Copyright (c) 2020 The Zcoin Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "dandelion.h"
+
+#include "net.h"
+#include "protocol.h"
+#include "txmempool.h"
+#include "utiltime.h"
+#include "validation.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(dandelion_tests, BasicTestingSetup)
+
+static CTransactionRef MakeTx(uint32_t n)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout.n = n;
+    tx.vout.resize(1);
+    tx.vout[0].nValue = 1;
+    return MakeTransactionRef(tx);
+}
+
+BOOST_AUTO_TEST_CASE(dandelion_embargo_timer_wheel)
+{
+    CDandelionManager manager;
+    const int64_t nStart = 1000 * DANDELION_TIMER_WHEEL_RESOLUTION;
+    BOOST_CHECK(manager.PopExpiredEmbargoes(nStart).empty());
+
+    CTransactionRef tx1 = MakeTx(1), tx2 = MakeTx(2), tx3 = MakeTx(3), tx4 = MakeTx(4);
+    BOOST_CHECK(manager.AddEmbargo(tx1, nStart + 1500000));
+    BOOST_CHECK(!manager.AddEmbargo(tx1, nStart + 2000000));
+    // Further out than one revolution of the wheel
+    BOOST_CHECK(manager.AddEmbargo(tx2, nStart + (DANDELION_TIMER_WHEEL_SLOTS + 5) * DANDELION_TIMER_WHEEL_RESOLUTION));
+    BOOST_CHECK(manager.AddEmbargo(tx3, nStart + 2000000));
+    BOOST_CHECK(manager.AddEmbargo(tx4, nStart + 2500000));
+    BOOST_CHECK(manager.RemoveEmbargo(tx4->GetHash()));
+    BOOST_CHECK(!manager.IsEmbargoed(tx4->GetHash()));
+    BOOST_CHECK(manager.GetEmbargoedTx(tx1->GetHash()) == tx1);
+
+    BOOST_CHECK(manager.PopExpiredEmbargoes(nStart + 1000000).empty());
+    // Same tick, tx1 expires after its embargo only
+    BOOST_CHECK(manager.PopExpiredEmbargoes(nStart + 1400000).empty());
+    std::vector<CTransactionRef> vExpired = manager.PopExpiredEmbargoes(nStart + 1600000);
+    BOOST_REQUIRE_EQUAL(vExpired.size(), 1U);
+    BOOST_CHECK(vExpired[0] == tx1);
+
+    vExpired = manager.PopExpiredEmbargoes(nStart + 10 * DANDELION_TIMER_WHEEL_RESOLUTION);
+    BOOST_REQUIRE_EQUAL(vExpired.size(), 1U);
+    BOOST_CHECK(vExpired[0] == tx3);
+    BOOST_CHECK(manager.IsEmbargoed(tx2->GetHash()));
+
+    // A long pause visits every slot once
+    vExpired = manager.PopExpiredEmbargoes(nStart + 1000 * DANDELION_TIMER_WHEEL_RESOLUTION);
+    BOOST_REQUIRE_EQUAL(vExpired.size(), 1U);
+    BOOST_CHECK(vExpired[0] == tx2);
+
+    CDandelionStats stats;
+    manager.GetStats(stats);
+    BOOST_CHECK_EQUAL(stats.nEmbargoes, 0U);
+    BOOST_CHECK_EQUAL(stats.nEmbargoCleared, 1U);
+}
+
+BOOST_FIXTURE_TEST_CASE(dandelion_expired_embargoes, TestingSetup)
+{
+    CDandelionManager manager;
+    TestMemPoolEntryHelper entry;
+    CTransactionRef tx1 = MakeTx(1), tx2 = MakeTx(2);
+    int64_t nEmbargo = GetTimeMicros() - 1;
+
+    // tx1 left the stempool, tx2 is still there but its inputs are unknown to the mempool
+    txpools.getStemTxPool().addUnchecked(tx2->GetHash(), entry.FromTx(*tx2));
+    BOOST_CHECK(manager.AddEmbargo(tx1, nEmbargo));
+    BOOST_CHECK(manager.AddEmbargo(tx2, nEmbargo));
+
+    {
+        LOCK(cs_main);
+        manager.CheckEmbargoes(*g_connman);
+    }
+
+    CDandelionStats stats;
+    manager.GetStats(stats);
+    BOOST_CHECK_EQUAL(stats.nEmbargoes, 0U);
+    BOOST_CHECK_EQUAL(stats.nEmbargoDropped, 2U);
+    BOOST_CHECK_EQUAL(stats.nEmbargoExpired, 0U);
+    BOOST_CHECK(!mempool.exists(tx2->GetHash()));
+    txpools.getStemTxPool().clear();
+}
+
+BOOST_AUTO_TEST_CASE(dandelion_routes)
+{
+    CDandelionManager manager;
+    std::vector<std::unique_ptr<CNode>> vNodes;
+    CAddress addr;
+    for (int i = 0; i < 7; i++) {
+        bool fInbound = i >= 3;
+        vNodes.emplace_back(new CNode(i, NODE_NETWORK, 0, INVALID_SOCKET, addr, i, i, "", fInbound));
+        if (fInbound)
+            manager.AddInbound(vNodes.back().get());
+        else
+            manager.AddOutbound(vNodes.back().get());
+    }
+
+    // Every inbound peer is routed to one of the destinations
+    CInv inv(MSG_DANDELION_TX, uint256());
+    for (int i = 3; i < 7; i++) {
+        BOOST_CHECK(manager.IsInbound(vNodes[i].get()));
+        BOOST_CHECK(manager.PushToDestination(vNodes[i].get(), inv));
+    }
+    BOOST_CHECK(!manager.IsInbound(vNodes[0].get()));
+
+    CDandelionStats stats;
+    manager.GetStats(stats);
+    size_t nMaxDestinations = Params().GetConsensus().nDandelionMaxDestinations;
+    BOOST_CHECK_EQUAL(stats.nInbound, 4U);
+    BOOST_CHECK_EQUAL(stats.nOutbound, 3U);
+    BOOST_CHECK_EQUAL(stats.nDestinations, std::min<size_t>(nMaxDestinations, 3));
+    BOOST_CHECK_EQUAL(stats.nRoutes, 4U);
+    BOOST_CHECK_EQUAL(stats.nStemRelayed, 4U);
+
+    // Losing a destination moves its routes to the replacement
+    manager.RemoveNode(vNodes[0].get());
+    manager.RemoveNode(vNodes[3].get());
+    manager.GetStats(stats);
+    BOOST_CHECK_EQUAL(stats.nInbound, 3U);
+    BOOST_CHECK_EQUAL(stats.nOutbound, 2U);
+    BOOST_CHECK_EQUAL(stats.nDestinations, std::min<size_t>(nMaxDestinations, 2));
+    BOOST_CHECK_EQUAL(stats.nRoutes, 3U);
+
+    manager.Shuffle();
+    manager.GetStats(stats);
+    BOOST_CHECK_EQUAL(stats.nRoutes, 3U);
+    BOOST_CHECK(manager.PushToLocalDestination(inv));
+
+    manager.Clear();
+    manager.GetStats(stats);
+    BOOST_CHECK_EQUAL(stats.nRoutes, 0U);
+    BOOST_CHECK(!manager.PushToLocalDestination(inv));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
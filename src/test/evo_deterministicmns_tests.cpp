@@ -17,6 +17,8 @@
 #include "evo/specialtx.h"
 #include "evo/providertx.h"
 #include "evo/deterministicmns.h"
+#include "evo/simplifiedmns.h"
+#include "llmq/quorums_commitment.h"
 
 #include <boost/test/unit_test.hpp>
 
@@ -200,6 +202,19 @@ static CScript GenerateRandomAddress()
     return GetScriptForDestination(key.GetPubKey().GetID());
 }
 
+static CMutableTransaction CreateCollateralSpendTx(const CMutableTransaction& proRegTx, const CKey& coinbaseKey)
+{
+    CMutableTransaction tx;
+    tx.vin.emplace_back(CTxIn(COutPoint(proRegTx.GetHash(), 0)));
+    tx.vout.emplace_back(CTxOut(999 * COIN, GenerateRandomAddress()));
+
+    CBasicKeyStore tempKeystore;
+    tempKeystore.AddKeyPubKey(coinbaseKey, coinbaseKey.GetPubKey());
+    BOOST_ASSERT(SignSignature(tempKeystore, CTransaction(proRegTx), tx, 0, SIGHASH_ALL));
+
+    return tx;
+}
+
 static CDeterministicMNCPtr FindPayoutDmn(const CBlock& block)
 {
     auto dmnList = deterministicMNManager->GetListAtChainTip();
@@ -386,7 +401,7 @@ BOOST_FIXTURE_TEST_CASE(dip3_protx, TestChainDIP3Setup)
     nHeight++;
 
     tx = CreateProUpServTx(utxos, dmnHashes[0], newOperatorKey, 100, CScript(), coinbaseKey);
-    CreateAndProcessBlock({tx}, coinbaseKey);
+    CBlock upServBlock = CreateAndProcessBlock({tx}, coinbaseKey);
     deterministicMNManager->UpdatedBlockTip(chainActive.Tip());
     BOOST_ASSERT(chainActive.Height() == nHeight + 1);
     nHeight++;
@@ -395,6 +410,14 @@ BOOST_FIXTURE_TEST_CASE(dip3_protx, TestChainDIP3Setup)
     BOOST_ASSERT(dmn != nullptr && dmn->pdmnState->addr.GetPort() == 100);
     BOOST_ASSERT(dmn != nullptr && dmn->pdmnState->nPoSeBanHeight == -1);
 
+    // the SML change and the coinbase of the block are stored with it
+    CSimplifiedMNListBlockDiff smlDiff;
+    BOOST_ASSERT(deterministicMNManager->GetSimplifiedBlockDiff(upServBlock.GetHash(), smlDiff));
+    BOOST_ASSERT(smlDiff.addedMNs.empty() && smlDiff.deletedMNs.empty());
+    BOOST_ASSERT(smlDiff.updatedMNs.size() == 1 && smlDiff.updatedMNs[0].proRegTxHash == dmnHashes[0]);
+    BOOST_ASSERT(smlDiff.updatedMNs[0].service.GetPort() == 100);
+    BOOST_ASSERT(smlDiff.cbTx->GetHash() == upServBlock.vtx[0]->GetHash());
+
     // test that the revived MN gets payments again
     bool foundRevived = false;
     for (size_t i = 0; i < 20; i++) {
@@ -417,4 +440,79 @@ BOOST_FIXTURE_TEST_CASE(dip3_protx, TestChainDIP3Setup)
 
     const_cast<Consensus::Params&>(Params().GetConsensus()).DIP0003EnforcementHeight = DIP0003EnforcementHeightBackup;
 }
+
+BOOST_FIXTURE_TEST_CASE(dip3_sml_block_diffs, TestChainDIP3Setup)
+{
+    auto utxos = BuildSimpleUtxoMap(coinbaseTxns);
+    // the collaterals of MNs which are removed again must be spendable by coinbaseKey
+    CScript scriptCollateral = GetScriptForDestination(coinbaseKey.GetPubKey().GetID());
+    int port = 1;
+
+    CKey ownerKey;
+    CBLSSecretKey operatorKeyUpdated;
+    auto txUpdated = CreateProRegTx(utxos, port++, GenerateRandomAddress(), coinbaseKey, ownerKey, operatorKeyUpdated);
+    CBLSSecretKey operatorKey;
+    auto txRemoved = CreateProRegTx(utxos, port++, scriptCollateral, coinbaseKey, ownerKey, operatorKey);
+    CreateAndProcessBlock({txUpdated, txRemoved}, coinbaseKey);
+    deterministicMNManager->UpdatedBlockTip(chainActive.Tip());
+    const CBlockIndex* baseBlockIndex = chainActive.Tip();
+
+    // an MN is added, another one is added and removed again inside the range
+    auto txAdded = CreateProRegTx(utxos, port++, GenerateRandomAddress(), coinbaseKey, ownerKey, operatorKey);
+    auto txTransient = CreateProRegTx(utxos, port++, scriptCollateral, coinbaseKey, ownerKey, operatorKey);
+    CreateAndProcessBlock({txAdded, txTransient}, coinbaseKey);
+    deterministicMNManager->UpdatedBlockTip(chainActive.Tip());
+
+    auto tx = CreateProUpServTx(utxos, txUpdated.GetHash(), operatorKeyUpdated, 1000, CScript(), coinbaseKey);
+    CreateAndProcessBlock({tx}, coinbaseKey);
+    deterministicMNManager->UpdatedBlockTip(chainActive.Tip());
+
+    CBlock removeBlock = CreateAndProcessBlock({CreateCollateralSpendTx(txRemoved, coinbaseKey), CreateCollateralSpendTx(txTransient, coinbaseKey)}, coinbaseKey);
+    deterministicMNManager->UpdatedBlockTip(chainActive.Tip());
+
+    LOCK(cs_main);
+    BOOST_ASSERT(chainActive.Height() == baseBlockIndex->nHeight + 3);
+    BOOST_ASSERT(removeBlock.GetHash() == chainActive.Tip()->GetBlockHash());
+
+    auto baseDmnList = deterministicMNManager->GetListForBlock(baseBlockIndex);
+    auto dmnList = deterministicMNManager->GetListAtChainTip();
+    BOOST_ASSERT(baseDmnList.HasMN(txRemoved.GetHash()) && !dmnList.HasMN(txRemoved.GetHash()));
+    BOOST_ASSERT(dmnList.HasMN(txAdded.GetHash()) && !dmnList.HasMN(txTransient.GetHash()));
+    BOOST_ASSERT(dmnList.GetMN(txUpdated.GetHash())->pdmnState->addr.GetPort() == 1000);
+
+    // every block of the range has a block diff, so the diff is composed from them
+    CSimplifiedMNListBlockDiff smlDiff;
+    for (const CBlockIndex* pindex = chainActive.Tip(); pindex != baseBlockIndex; pindex = pindex->pprev) {
+        BOOST_ASSERT(deterministicMNManager->GetSimplifiedBlockDiff(pindex->GetBlockHash(), smlDiff));
+    }
+
+    CSimplifiedMNListDiff composedDiff;
+    std::string strError;
+    BOOST_ASSERT(BuildSimplifiedMNListDiff(baseBlockIndex->GetBlockHash(), removeBlock.GetHash(), composedDiff, strError));
+    CSimplifiedMNListDiff expectedDiff = baseDmnList.BuildSimplifiedDiff(dmnList);
+
+    BOOST_CHECK(composedDiff.blockHash == removeBlock.GetHash());
+    BOOST_CHECK(composedDiff.cbTx->GetHash() == removeBlock.vtx[0]->GetHash());
+    BOOST_CHECK(std::set<uint256>(composedDiff.deletedMNs.begin(), composedDiff.deletedMNs.end()) ==
+                std::set<uint256>(expectedDiff.deletedMNs.begin(), expectedDiff.deletedMNs.end()));
+    BOOST_CHECK(composedDiff.deletedMNs.size() == 1 && composedDiff.deletedMNs[0] == txRemoved.GetHash());
+
+    std::map<uint256, CSimplifiedMNListEntry> composedEntries;
+    for (const auto& sme : composedDiff.mnList) {
+        composedEntries.emplace(sme.proRegTxHash, sme);
+    }
+    std::map<uint256, CSimplifiedMNListEntry> expectedEntries;
+    for (const auto& sme : expectedDiff.mnList) {
+        expectedEntries.emplace(sme.proRegTxHash, sme);
+    }
+    BOOST_CHECK(composedEntries == expectedEntries);
+    BOOST_CHECK(composedEntries.size() == 2 && composedEntries.count(txAdded.GetHash()) && composedEntries.count(txUpdated.GetHash()));
+
+    // disconnecting a block erases its block diff
+    CValidationState state;
+    InvalidateBlock(state, Params(), mapBlockIndex[removeBlock.GetHash()]);
+    BOOST_ASSERT(chainActive.Height() == baseBlockIndex->nHeight + 2);
+    BOOST_CHECK(!deterministicMNManager->GetSimplifiedBlockDiff(removeBlock.GetHash(), smlDiff));
+    BOOST_CHECK(deterministicMNManager->GetSimplifiedBlockDiff(chainActive.Tip()->GetBlockHash(), smlDiff));
+}
 BOOST_AUTO_TEST_SUITE_END()
@@ -5,6 +5,7 @@
 #include "test/test_bitcoin.h"
 
 #include "bls/bls.h"
+#include "evo/deterministicmns.h"
 #include "evo/simplifiedmns.h"
 #include "netbase.h"
 
@@ -70,4 +71,103 @@ BOOST_AUTO_TEST_CASE(simplifiedmns_merkleroots)
 
     BOOST_CHECK(expectedMerkleRoot == calculatedMerkleRoot);
 }
+
+static void AddTestMN(CDeterministicMNList& mnList, int i)
+{
+    auto dmn = std::make_shared<CDeterministicMN>();
+    dmn->proTxHash.SetHex(strprintf("%064x", (i * 7919) % 1009));
+    dmn->internalId = mnList.GetTotalRegisteredCount();
+    dmn->collateralOutpoint = COutPoint(dmn->proTxHash, 0);
+
+    CDeterministicMNState state;
+    state.keyIDOwner.SetHex(strprintf("%040x", i));
+    state.keyIDVoting = state.keyIDOwner;
+    dmn->pdmnState = std::make_shared<CDeterministicMNState>(state);
+
+    mnList.AddMN(dmn);
+    mnList.SetTotalRegisteredCount(mnList.GetTotalRegisteredCount() + 1);
+}
+
+static void UpdateTestMN(CDeterministicMNList& mnList, int i, int nBanHeight)
+{
+    uint256 proTxHash;
+    proTxHash.SetHex(strprintf("%064x", (i * 7919) % 1009));
+    auto state = std::make_shared<CDeterministicMNState>(*mnList.GetMN(proTxHash)->pdmnState);
+    state->confirmedHash = proTxHash;
+    state->nPoSeBanHeight = nBanHeight;
+    mnList.UpdateMN(proTxHash, state);
+}
+
+static void RemoveTestMN(CDeterministicMNList& mnList, int i)
+{
+    uint256 proTxHash;
+    proTxHash.SetHex(strprintf("%064x", (i * 7919) % 1009));
+    mnList.RemoveMN(proTxHash);
+}
+
+static void CheckMerkleTreeDiff(CSimplifiedMNListMerkleTree& tree, CDeterministicMNList& oldList, const CDeterministicMNList& newList)
+{
+    tree.ApplyDiff(oldList, newList, oldList.BuildDiff(newList));
+
+    bool mutated = false;
+    bool expectedMutated = false;
+    BOOST_CHECK(tree.GetMerkleRoot(&mutated) == CSimplifiedMNList(newList).CalcMerkleRoot(&expectedMutated));
+    BOOST_CHECK_EQUAL(mutated, expectedMutated);
+    BOOST_CHECK_EQUAL(tree.GetLeafCount(), newList.GetAllMNsCount());
+
+    CSimplifiedMNListMerkleTree builtTree;
+    builtTree.Build(newList);
+    BOOST_CHECK(builtTree.GetMerkleRoot() == tree.GetMerkleRoot());
+
+    oldList = newList;
+}
+
+BOOST_AUTO_TEST_CASE(simplifiedmns_merkletree_diffs)
+{
+    CDeterministicMNList oldList;
+    CDeterministicMNList newList;
+    CSimplifiedMNListMerkleTree tree;
+    tree.Build(oldList);
+    BOOST_CHECK(tree.GetMerkleRoot().IsNull());
+
+    AddTestMN(newList, 0);
+    CheckMerkleTreeDiff(tree, oldList, newList);
+
+    for (int i = 1; i < 13; i++) {
+        AddTestMN(newList, i);
+    }
+    CheckMerkleTreeDiff(tree, oldList, newList);
+
+    // only the paths of the changed leaves are rehashed
+    UpdateTestMN(newList, 3, -1);
+    UpdateTestMN(newList, 12, 100);
+    CheckMerkleTreeDiff(tree, oldList, newList);
+
+    // leaves behind the first added or removed one are shifted
+    UpdateTestMN(newList, 0, 101);
+    RemoveTestMN(newList, 5);
+    AddTestMN(newList, 13);
+    AddTestMN(newList, 14);
+    CheckMerkleTreeDiff(tree, oldList, newList);
+
+    for (int i = 15; i < 40; i++) {
+        AddTestMN(newList, i);
+        if (i % 3 == 0) {
+            UpdateTestMN(newList, i - 10, i);
+        }
+        CheckMerkleTreeDiff(tree, oldList, newList);
+    }
+
+    for (int i = 0; i < 40; i++) {
+        if (i != 5 && i != 17) {
+            RemoveTestMN(newList, i);
+        }
+    }
+    CheckMerkleTreeDiff(tree, oldList, newList);
+
+    RemoveTestMN(newList, 17);
+    CheckMerkleTreeDiff(tree, oldList, newList);
+    BOOST_CHECK_EQUAL(tree.GetLeafCount(), 0U);
+    BOOST_CHECK(tree.GetMerkleRoot().IsNull());
+}
 BOOST_AUTO_TEST_SUITE_END()
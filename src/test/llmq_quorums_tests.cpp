@@ -0,0 +1,80 @@
+// Copyright (c) 2020 The Zcoin Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "test/test_bitcoin.h"
+
+#include "bls/bls.h"
+#include "bls/bls_worker.h"
+#include "chainparams.h"
+#include "evo/deterministicmns.h"
+#include "llmq/quorums.h"
+#include "random.h"
+
+#include <boost/test/unit_test.hpp>
+
+static BLSVerificationVectorPtr MakeVvec(size_t threshold)
+{
+    auto vvec = std::make_shared<BLSVerificationVector>();
+    for (size_t i = 0; i < threshold; i++) {
+        CBLSSecretKey sk;
+        sk.MakeNewKey();
+        vvec->emplace_back(sk.GetPublicKey());
+    }
+    return vvec;
+}
+
+static std::vector<CBLSLazyPublicKey> MakePubKeyShares(size_t count)
+{
+    std::vector<CBLSLazyPublicKey> pubKeyShares(count);
+    for (auto& pubKeyShare : pubKeyShares) {
+        CBLSSecretKey sk;
+        sk.MakeNewKey();
+        pubKeyShare.Set(sk.GetPublicKey());
+    }
+    return pubKeyShares;
+}
+
+BOOST_FIXTURE_TEST_SUITE(llmq_quorums_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(pubkeyshares_vvec_mismatch)
+{
+    CBLSWorker blsWorker;
+    const auto& params = Params().GetConsensus().llmqs.begin()->second;
+
+    std::vector<CDeterministicMNCPtr> members;
+    for (size_t i = 0; i < 4; i++) {
+        auto dmn = std::make_shared<CDeterministicMN>();
+        dmn->proTxHash = GetRandHash();
+        members.emplace_back(dmn);
+    }
+
+    llmq::CFinalCommitment qc;
+    qc.validMembers.assign(members.size(), true);
+
+    llmq::CQuorum quorum(params, blsWorker);
+    quorum.Init(qc, nullptr, uint256(), members);
+
+    // nothing to check the shares against
+    BOOST_CHECK(!quorum.ReadPubKeyShares(*evoDb));
+
+    quorum.quorumVvec = MakeVvec(3);
+    BOOST_CHECK(!quorum.ReadPubKeyShares(*evoDb));
+
+    auto pubKeyShares = MakePubKeyShares(members.size());
+    quorum.WritePubKeyShares(*evoDb, pubKeyShares);
+    BOOST_CHECK(quorum.ReadPubKeyShares(*evoDb));
+    BOOST_CHECK(quorum.GetPubKeyShare(1) == pubKeyShares[1].Get());
+
+    // shares recovered from another vvec of the same quorum are rejected
+    llmq::CQuorum otherQuorum(params, blsWorker);
+    otherQuorum.Init(qc, nullptr, uint256(), members);
+    otherQuorum.quorumVvec = MakeVvec(3);
+    BOOST_CHECK(!otherQuorum.ReadPubKeyShares(*evoDb));
+
+    // and so are shares which don't cover all members
+    quorum.WritePubKeyShares(*evoDb, MakePubKeyShares(members.size() - 1));
+    BOOST_CHECK(!quorum.ReadPubKeyShares(*evoDb));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,122 @@
+// Copyright (c) 2020 The Zcoin Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "msgstats.h"
+
+#include "protocol.h"
+#include "sync.h"
+#include "utiltime.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <thread>
+
+BOOST_FIXTURE_TEST_SUITE(msgstats_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(msgstats_histogram_buckets)
+{
+    BOOST_CHECK_EQUAL(CDurationHistogram::GetBucket(0), 0);
+    BOOST_CHECK_EQUAL(CDurationHistogram::GetBucket(1), 1);
+    BOOST_CHECK_EQUAL(CDurationHistogram::GetBucket(3), 2);
+    BOOST_CHECK_EQUAL(CDurationHistogram::GetBucket(4), 3);
+    BOOST_CHECK_EQUAL(CDurationHistogram::GetBucket(1000), 10);
+    BOOST_CHECK_EQUAL(CDurationHistogram::GetBucket(int64_t(1) << 40), DURATION_HISTOGRAM_BUCKETS - 1);
+
+    CDurationHistogram hist;
+    hist.Add(5);
+    hist.Add(7);
+    hist.Add(-1);
+    BOOST_CHECK_EQUAL(hist.nCount, 3U);
+    BOOST_CHECK_EQUAL(hist.nTotalMicros, 12);
+    BOOST_CHECK_EQUAL(hist.nMaxMicros, 7);
+    BOOST_CHECK_EQUAL(hist.buckets[0], 1U);
+    BOOST_CHECK_EQUAL(hist.buckets[3], 2U);
+}
+
+BOOST_AUTO_TEST_CASE(msgstats_unknown_commands)
+{
+    CMessageStats stats;
+    stats.RecordReceived(NetMsgType::TX, 100, 10, 0);
+    stats.RecordReceived(NetMsgType::TX, 200, 20, 5);
+    stats.RecordSent(NetMsgType::TX, 300);
+    stats.RecordReceived("foo", 1, 5, 0);
+    stats.RecordReceived("bar", 1, 5, 0);
+
+    std::map<std::string, CMessageTypeStats> mapStats;
+    CSendMessagesStats sendMessagesStats;
+    stats.GetStats(mapStats, sendMessagesStats, true);
+    BOOST_CHECK_EQUAL(mapStats.size(), 2U);
+    BOOST_CHECK_EQUAL(mapStats[NetMsgType::TX].nRecvCount, 2U);
+    BOOST_CHECK_EQUAL(mapStats[NetMsgType::TX].nRecvBytes, 300U);
+    BOOST_CHECK_EQUAL(mapStats[NetMsgType::TX].nSentCount, 1U);
+    BOOST_CHECK_EQUAL(mapStats[NetMsgType::TX].nSentBytes, 300U);
+    BOOST_CHECK_EQUAL(mapStats[NetMsgType::TX].processTime.nTotalMicros, 30);
+    BOOST_CHECK_EQUAL(mapStats[NetMsgType::TX].nMainWaitMicros, 5);
+    BOOST_CHECK_EQUAL(mapStats["*other*"].nRecvCount, 2U);
+
+    // Statistics were reset
+    stats.GetStats(mapStats, sendMessagesStats);
+    BOOST_CHECK(mapStats.empty());
+}
+
+BOOST_AUTO_TEST_CASE(msgstats_lock_wait)
+{
+    CCriticalSection cs;
+    CCriticalSection csOther;
+
+    {
+        // Disabled trackers aren't registered
+        CLockWaitTracker tracker(&cs);
+        BOOST_CHECK(CLockWaitTracker::Get(&cs) == nullptr);
+    }
+
+    CLockWaitTracker::SetEnabled(true);
+    {
+        CLockWaitTracker tracker(&cs);
+        LOCK(cs);
+        BOOST_CHECK_EQUAL(tracker.GetWaitMicros(), 0);
+    }
+
+    std::atomic<bool> fLocked{false};
+    std::thread holder([&] {
+        LOCK(cs);
+        fLocked = true;
+        MilliSleep(50);
+    });
+    while (!fLocked)
+        MilliSleep(1);
+
+    CLockWaitTracker tracker(&cs);
+    {
+        // Other locks aren't accounted
+        CLockWaitTracker otherTracker(&csOther);
+        LOCK(cs);
+        BOOST_CHECK_EQUAL(otherTracker.GetWaitMicros(), 0);
+    }
+    BOOST_CHECK(tracker.GetWaitMicros() > 0);
+    BOOST_CHECK(CLockWaitTracker::Get(&csOther) == nullptr);
+    BOOST_CHECK(CLockWaitTracker::Get(&cs) == &tracker);
+    holder.join();
+    CLockWaitTracker::SetEnabled(false);
+}
+
+BOOST_AUTO_TEST_CASE(msgstats_prometheus)
+{
+    CMessageStats stats;
+    stats.RecordReceived(NetMsgType::INV, 61, 3, 0);
+
+    std::map<std::string, CMessageTypeStats> mapStats;
+    CSendMessagesStats sendMessagesStats;
+    stats.GetStats(mapStats, sendMessagesStats);
+    std::string strText = MessageStatsToPrometheus(mapStats, sendMessagesStats);
+    BOOST_CHECK(strText.find("zcoin_p2p_messages_received_total{command=\"inv\"} 1\n") != std::string::npos);
+    BOOST_CHECK(strText.find("zcoin_p2p_bytes_received_total{command=\"inv\"} 61\n") != std::string::npos);
+    BOOST_CHECK(strText.find("zcoin_p2p_process_seconds_bucket{command=\"inv\",le=\"+Inf\"} 1\n") != std::string::npos);
+    BOOST_CHECK(strText.find("zcoin_p2p_sendmessages_seconds_count 0\n") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -10,7 +10,10 @@
 #include "streams.h"
 #include "net.h"
 #include "netbase.h"
+#include "netmessagemaker.h"
 #include "chainparams.h"
+#include "scheduler.h"
+#include "utiltime.h"
 
 class CAddrManSerializationMock : public CAddrMan
 {
@@ -172,4 +175,103 @@ BOOST_AUTO_TEST_CASE(cnode_simple_test)
     BOOST_CHECK(pnode2->fFeeler == false);
 }
 
+#ifdef HAVE_SYS_EPOLL_H
+static std::vector<unsigned char> SerializeRawMessage(CSerializedNetMsg&& msg)
+{
+    CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), msg.data.size());
+    uint256 hash = Hash(msg.data.begin(), msg.data.end());
+    memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+    std::vector<unsigned char> ret;
+    CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, ret, 0, hdr};
+    ret.insert(ret.end(), msg.data.begin(), msg.data.end());
+    return ret;
+}
+
+static unsigned short GetFreeLocalPort()
+{
+    SOCKET hSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    BOOST_REQUIRE(hSocket != INVALID_SOCKET);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t len = sizeof(addr);
+    BOOST_REQUIRE(bind(hSocket, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    BOOST_REQUIRE(getsockname(hSocket, (struct sockaddr*)&addr, &len) == 0);
+    CloseSocket(hSocket);
+    return ntohs(addr.sin_port);
+}
+
+template <typename Condition>
+static bool WaitFor(Condition cond)
+{
+    for (int i = 0; i < 500; i++) {
+        if (cond())
+            return true;
+        MilliSleep(10);
+    }
+    return false;
+}
+
+static void TestSocketHandler(SocketEventsMode mode)
+{
+    CConnman connman(0x1337, 0x1337);
+    CService addrBind = LookupNumeric("127.0.0.1", GetFreeLocalPort());
+    std::string strError;
+    BOOST_REQUIRE(connman.BindListenPort(addrBind, strError));
+
+    CConnman::Options options;
+    options.nMaxConnections = 8;
+    options.nSendBufferMaxSize = 1000 * DEFAULT_MAXSENDBUFFER;
+    options.nReceiveFloodSize = 1000 * DEFAULT_MAXRECEIVEBUFFER;
+    options.socketEventsMode = mode;
+    CScheduler scheduler;
+    BOOST_REQUIRE(connman.Start(scheduler, strError, options));
+
+    // The listen socket reports the connection and the node is accepted
+    SOCKET hSocket;
+    BOOST_REQUIRE(ConnectSocket(addrBind, hSocket, DEFAULT_CONNECT_TIMEOUT));
+    BOOST_CHECK(WaitFor([&] { return connman.GetNodeCount(CConnman::CONNECTIONS_IN) == 1; }));
+
+    // Data sent by the peer is read from the node's socket
+    std::vector<unsigned char> ping = SerializeRawMessage(CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::PING, uint64_t(1)));
+    BOOST_REQUIRE_EQUAL(send(hSocket, (const char*)ping.data(), ping.size(), MSG_NOSIGNAL), (ssize_t)ping.size());
+    BOOST_CHECK(WaitFor([&] {
+        std::vector<CNodeStats> vstats;
+        connman.GetNodeStats(vstats);
+        return vstats.size() == 1 && vstats[0].nRecvBytes == ping.size();
+    }));
+
+    // Queued data is written by the socket handler
+    connman.ForEachNode(CConnman::AllNodes, [&](CNode* pnode) {
+        connman.PushMessage(pnode, CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::PONG, uint64_t(1)), false);
+    });
+    std::vector<unsigned char> pong(CMessageHeader::HEADER_SIZE + sizeof(uint64_t));
+    size_t nRead = 0;
+    WaitFor([&] {
+        ssize_t n = recv(hSocket, (char*)pong.data() + nRead, pong.size() - nRead, MSG_DONTWAIT);
+        if (n > 0)
+            nRead += n;
+        return nRead == pong.size();
+    });
+    BOOST_REQUIRE_EQUAL(nRead, pong.size());
+    CMessageHeader hdr(Params().MessageStart());
+    CDataStream(pong, SER_NETWORK, INIT_PROTO_VERSION) >> hdr;
+    BOOST_CHECK_EQUAL(hdr.GetCommand(), NetMsgType::PONG);
+
+    CloseSocket(hSocket);
+    connman.Interrupt();
+    connman.Stop();
+}
+
+BOOST_FIXTURE_TEST_CASE(socket_handler_connect_accept, TestingSetup)
+{
+    ForceSetArg("-dnsseed", "0");
+    TestSocketHandler(SOCKETEVENTS_SELECT);
+    TestSocketHandler(SOCKETEVENTS_EPOLL);
+    ForceSetArg("-dnsseed", "1");
+}
+#endif // HAVE_SYS_EPOLL_H
+
 BOOST_AUTO_TEST_SUITE_END()
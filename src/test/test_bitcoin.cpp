@@ -139,6 +139,7 @@ TestingSetup::~TestingSetup()
     UnregisterNodeSignals(GetNodeSignals());
     llmq::InterruptLLMQSystem();
 #ifdef ENABLE_ELYSIUM
+    elysium_interrupt();
     elysium_shutdown();
 #endif
     threadGroup.interrupt_all();
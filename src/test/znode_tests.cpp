@@ -258,4 +258,59 @@ BOOST_AUTO_TEST_CASE(Test_EnforceZnodePayment)
     BOOST_CHECK(true == CheckTransaction(*b.vtx[0], state, true, tx.GetHash(), false, 0));
 }
 
+BOOST_AUTO_TEST_CASE(Test_ZnodeRanksAfterRemoval)
+{
+    mnodeman.Clear();
+    // Emulates synced state of znodes, CheckAndRemove() skips an unsynced list.
+    for(size_t i =0; i < 4; ++i)
+        znodeSync.SwitchToNextAsset();
+
+    std::vector<CTxIn> vins;
+    for(int i = 0; i < 8; ++i) {
+        CKey key;
+        key.MakeNewKey(true);
+        CTxIn vin(COutPoint(GetRandHash(), 0));
+        CZnode mn(CService(CNetAddr(), 8168 + i), vin, key.GetPubKey(), key.GetPubKey(), MIN_ZNODE_PAYMENT_PROTO_VERSION_2);
+        // enabled znodes without a collateral in the UTXO set
+        mn.fUnitTest = true;
+        mn.lastPing.vin = vin;
+        mn.lastPing.sigTime = GetAdjustedTime();
+        BOOST_CHECK(mnodeman.Add(mn));
+        vins.push_back(vin);
+    }
+
+    int nHeight = chainActive.Height();
+    uint256 blockHash;
+    BOOST_CHECK(GetBlockHash(blockHash, nHeight));
+
+    // caches the score order with the positions before the removal
+    BOOST_CHECK_EQUAL(mnodeman.GetZnodeRanks(nHeight).size(), vins.size());
+
+    mnodeman.Find(vins[0])->nActiveState = CZnode::ZNODE_OUTPOINT_SPENT;
+    mnodeman.CheckAndRemove();
+    BOOST_CHECK(!mnodeman.Has(vins[0]));
+    BOOST_CHECK_EQUAL(mnodeman.GetZnodeRank(vins[0], nHeight), -1);
+
+    // ranks calculated without the cache, best score first
+    std::vector<CZnode> vZnodes = mnodeman.GetFullZnodeVector();
+    std::vector<std::pair<int64_t, CTxIn> > vecScores;
+    BOOST_FOREACH(CZnode& mn, vZnodes) {
+        BOOST_CHECK(mn.IsEnabled());
+        vecScores.push_back(std::make_pair(mn.CalculateScore(blockHash).GetCompact(false), mn.vin));
+    }
+    sort(vecScores.rbegin(), vecScores.rend());
+    BOOST_CHECK_EQUAL(vecScores.size(), vins.size() - 1);
+
+    std::vector<std::pair<int, CZnode> > vecZnodeRanks = mnodeman.GetZnodeRanks(nHeight);
+    BOOST_REQUIRE_EQUAL(vecZnodeRanks.size(), vecScores.size());
+    for(size_t i = 0; i < vecScores.size(); ++i) {
+        BOOST_CHECK_EQUAL(vecZnodeRanks[i].first, (int)i + 1);
+        BOOST_CHECK(vecZnodeRanks[i].second.vin == vecScores[i].second);
+        BOOST_CHECK_EQUAL(mnodeman.GetZnodeRank(vecScores[i].second, nHeight), (int)i + 1);
+    }
+
+    znodeSync.Reset();
+    mnodeman.Clear();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -12,6 +12,7 @@
 #include "zerocoin.h"
 
 #include "arith_uint256.h"
+#include "blockcache.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
@@ -3105,6 +3106,9 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     // Update chainActive & related variables.
     UpdateTip(pindexNew, chainparams);
 
+    // Keep the new tip in serialized form around, peers are about to request it
+    servedBlockCache.Add(connectTrace.blocksConnected.back().second);
+
 #ifdef ENABLE_ELYSIUM
         //! Elysium: new confirmed transaction notification
     if (fElysium) {
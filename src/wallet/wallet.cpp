@@ -13,6 +13,7 @@
 #include "wallet/coincontrol.h"
 #include "consensus/consensus.h"
 #include "consensus/validation.h"
+#include "dandelion.h"
 #include "key.h"
 #include "keystore.h"
 #include "validation.h"
@@ -2108,12 +2109,12 @@ bool CWalletTx::RelayWalletTransaction(CConnman* connman)
                 int64_t nCurrTime = GetTimeMicros();
                 int64_t nEmbargo = 1000000 * DANDELION_EMBARGO_MINIMUM
                         + PoissonNextSend(nCurrTime, DANDELION_EMBARGO_AVG_ADD);
-                CNode::insertDandelionEmbargo(GetHash(), nEmbargo);
+                dandelion.AddEmbargo(tx, nEmbargo);
                 //LogPrintf(
                 //    "dandeliontx %s embargoed for %d seconds\n",
                 //    GetHash().ToString(), (nEmbargo - nCurrTime) / 1000000);
                 CInv inv(MSG_DANDELION_TX, GetHash());
-                return CNode::localDandelionDestinationPushInventory(inv);
+                return dandelion.PushToLocalDestination(inv);
             }
             else {
                 // LogPrintf("Relaying wtx %s\n", GetHash().ToString());
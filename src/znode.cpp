@@ -659,7 +659,7 @@ bool CZnodeBroadcast::Update(CZnode *pmn, int &nDos) {
     if (!pmn->IsBroadcastedWithin(ZNODE_MIN_MNB_SECONDS) || (fMasternodeMode && pubKeyZnode == activeZnode.pubKeyZnode)) {
         // take the newest entry
         LogPrintf("CZnodeBroadcast::Update -- Got UPDATED Znode entry: addr=%s\n", addr.ToString());
-        if (pmn->UpdateFromNewBroadcast((*this))) {
+        if (mnodeman.UpdateZnodeFromBroadcast(pmn, *this)) {
             pmn->Check();
             RelayZNode();
         }
@@ -151,6 +151,9 @@ void CZnodeIndex::RebuildIndex()
 
 CZnodeMan::CZnodeMan() : cs(),
   vZnodes(),
+  rankedZnodesCache(RANKS_CACHE_SIZE),
+  nRanksCacheHits(0),
+  nRanksCacheMisses(0),
   mAskedUsForZnodeList(),
   mWeAskedForZnodeList(),
   mWeAskedForZnodeListEntry(),
@@ -179,6 +182,7 @@ bool CZnodeMan::Add(CZnode &mn)
     if (pmn == NULL) {
         LogPrint("znode", "CZnodeMan::Add -- Adding new Znode: addr=%s, %i now\n", mn.addr.ToString(), size() + 1);
         vZnodes.push_back(mn);
+        AddToLookupMaps(vZnodes.size() - 1);
         indexZnodes.AddZnodeVIN(mn.vin);
         fZnodesAdded = true;
         return true;
@@ -260,6 +264,8 @@ void CZnodeMan::CheckAndRemove()
 //                it->FlagGovernanceItemsAsDirty();
                 it = vZnodes.erase(it);
                 fZnodesRemoved = true;
+                // the ranks calculated below must not use positions from before the erase
+                rankedZnodesCache.clear();
             } else {
                 bool fAsk = pCurrentBlockIndex &&
                             (nAskForMnbRecovery > 0) &&
@@ -296,6 +302,11 @@ void CZnodeMan::CheckAndRemove()
             }
         }
 
+        // positions behind removed znodes have shifted
+        if(fZnodesRemoved) {
+            RebuildLookupMaps();
+        }
+
         // proces replies for ZNODE_NEW_START_REQUIRED znodes
         LogPrint("znode", "CZnodeMan::CheckAndRemove -- mMnbRecoveryGoodReplies size=%d\n", (int)mMnbRecoveryGoodReplies.size());
         std::map<uint256, std::vector<CZnodeBroadcast> >::iterator itMnbReplies = mMnbRecoveryGoodReplies.begin();
@@ -419,6 +430,10 @@ void CZnodeMan::Clear()
 {
     LOCK(cs);
     vZnodes.clear();
+    mapZnodesByOutpoint.clear();
+    mapZnodesByPubKey.clear();
+    mapZnodesByPayee.clear();
+    rankedZnodesCache.clear();
     mAskedUsForZnodeList.clear();
     mWeAskedForZnodeList.clear();
     mWeAskedForZnodeListEntry.clear();
@@ -496,55 +511,89 @@ void CZnodeMan::DsegUpdate(CNode* pnode)
     LogPrint("znode", "CZnodeMan::DsegUpdate -- asked %s for the list\n", pnode->addr.ToString());
 }
 
+void CZnodeMan::AddToLookupMaps(size_t nPos)
+{
+    const CZnode& mn = vZnodes[nPos];
+    mapZnodesByOutpoint.emplace(mn.vin.prevout, nPos);
+    mapZnodesByPubKey.emplace(mn.pubKeyZnode.GetID(), nPos);
+    mapZnodesByPayee.emplace(mn.pubKeyCollateralAddress.GetID(), nPos);
+    // the new znode is missing in the cached score orders
+    rankedZnodesCache.clear();
+}
+
+void CZnodeMan::RebuildLookupMaps()
+{
+    LOCK(cs);
+    mapZnodesByOutpoint.clear();
+    mapZnodesByPubKey.clear();
+    mapZnodesByPayee.clear();
+    rankedZnodesCache.clear();
+    for(size_t i = 0; i < vZnodes.size(); ++i) {
+        AddToLookupMaps(i);
+    }
+}
+
 CZnode* CZnodeMan::Find(const std::string &txHash, const std::string &outputIndex)
 {
     LOCK(cs);
 
-    BOOST_FOREACH(CZnode& mn, vZnodes)
-    {
-        COutPoint outpoint = mn.vin.prevout;
+    // only exact string representations of the outpoint match
+    uint256 hash = uint256S(txHash);
+    uint32_t n;
+    if(hash.ToString() != txHash || !ParseUInt32(outputIndex, &n) || to_string(n) != outputIndex)
+        return NULL;
 
-        if(txHash==outpoint.hash.ToString().substr(0,64) &&
-           outputIndex==to_string(outpoint.n))
-            return &mn;
-    }
-    return NULL;
+    auto it = mapZnodesByOutpoint.find(COutPoint(hash, n));
+    return it == mapZnodesByOutpoint.end() ? NULL : &vZnodes[it->second];
 }
 
 CZnode* CZnodeMan::Find(const CScript &payee)
 {
     LOCK(cs);
 
-    BOOST_FOREACH(CZnode& mn, vZnodes)
-    {
-        if(GetScriptForDestination(mn.pubKeyCollateralAddress.GetID()) == payee)
-            return &mn;
-    }
-    return NULL;
+    // znodes are paid to the P2PKH script of their collateral key
+    CTxDestination dest;
+    if(!ExtractDestination(payee, dest) || !boost::get<CKeyID>(&dest))
+        return NULL;
+
+    auto it = mapZnodesByPayee.find(boost::get<CKeyID>(dest));
+    if(it == mapZnodesByPayee.end())
+        return NULL;
+
+    CZnode& mn = vZnodes[it->second];
+    if(GetScriptForDestination(mn.pubKeyCollateralAddress.GetID()) != payee)
+        return NULL;
+    return &mn;
 }
 
 CZnode* CZnodeMan::Find(const CTxIn &vin)
 {
     LOCK(cs);
 
-    BOOST_FOREACH(CZnode& mn, vZnodes)
-    {
-        if(mn.vin.prevout == vin.prevout)
-            return &mn;
-    }
-    return NULL;
+    auto it = mapZnodesByOutpoint.find(vin.prevout);
+    return it == mapZnodesByOutpoint.end() ? NULL : &vZnodes[it->second];
 }
 
 CZnode* CZnodeMan::Find(const CPubKey &pubKeyZnode)
 {
     LOCK(cs);
 
-    BOOST_FOREACH(CZnode& mn, vZnodes)
-    {
-        if(mn.pubKeyZnode == pubKeyZnode)
-            return &mn;
+    auto it = mapZnodesByPubKey.find(pubKeyZnode.GetID());
+    if(it == mapZnodesByPubKey.end() || vZnodes[it->second].pubKeyZnode != pubKeyZnode)
+        return NULL;
+    return &vZnodes[it->second];
+}
+
+bool CZnodeMan::UpdateZnodeFromBroadcast(CZnode* pmn, CZnodeBroadcast& mnb)
+{
+    LOCK(cs);
+
+    CPubKey pubKeyZnodeOld = pmn->pubKeyZnode;
+    bool fUpdated = pmn->UpdateFromNewBroadcast(mnb);
+    if(pmn->pubKeyZnode != pubKeyZnodeOld) {
+        RebuildLookupMaps();
     }
-    return NULL;
+    return fUpdated;
 }
 
 bool CZnodeMan::Get(const CPubKey& pubKeyZnode, CZnode& znode)
@@ -797,18 +846,46 @@ CZnode* CZnodeMan::FindRandomNotInVec(const std::vector<CTxIn> &vecToExclude, in
     return NULL;
 }
 
-int CZnodeMan::GetZnodeRank(const CTxIn& vin, int nBlockHeight, int nMinProtocol, bool fOnlyActive)
+std::vector<size_t> CZnodeMan::GetZnodesByScore(const uint256& blockHash)
 {
+    AssertLockHeld(cs);
+
+    std::vector<size_t> vecPositions;
+    if(rankedZnodesCache.get(blockHash, vecPositions)) {
+        nRanksCacheHits++;
+        return vecPositions;
+    }
+    nRanksCacheMisses++;
+
     std::vector<std::pair<int64_t, CZnode*> > vecZnodeScores;
+    vecZnodeScores.reserve(vZnodes.size());
+    BOOST_FOREACH(CZnode& mn, vZnodes) {
+        int64_t nScore = mn.CalculateScore(blockHash).GetCompact(false);
+        vecZnodeScores.push_back(std::make_pair(nScore, &mn));
+    }
+
+    sort(vecZnodeScores.rbegin(), vecZnodeScores.rend(), CompareScoreMN());
 
+    vecPositions.reserve(vecZnodeScores.size());
+    BOOST_FOREACH (PAIRTYPE(int64_t, CZnode*)& s, vecZnodeScores) {
+        vecPositions.push_back(s.second - &vZnodes[0]);
+    }
+
+    rankedZnodesCache.insert(blockHash, vecPositions);
+    return vecPositions;
+}
+
+int CZnodeMan::GetZnodeRank(const CTxIn& vin, int nBlockHeight, int nMinProtocol, bool fOnlyActive)
+{
     //make sure we know about this block
     uint256 blockHash = uint256();
     if(!GetBlockHash(blockHash, nBlockHeight)) return -1;
 
     LOCK(cs);
 
-    // scan for winner
-    BOOST_FOREACH(CZnode& mn, vZnodes) {
+    int nRank = 0;
+    BOOST_FOREACH(size_t nPos, GetZnodesByScore(blockHash)) {
+        CZnode& mn = vZnodes[nPos];
         if(mn.nProtocolVersion < nMinProtocol) continue;
         if(fOnlyActive) {
             if(!mn.IsEnabled()) continue;
@@ -816,17 +893,8 @@ int CZnodeMan::GetZnodeRank(const CTxIn& vin, int nBlockHeight, int nMinProtocol
         else {
             if(!mn.IsValidForPayment()) continue;
         }
-        int64_t nScore = mn.CalculateScore(blockHash).GetCompact(false);
-
-        vecZnodeScores.push_back(std::make_pair(nScore, &mn));
-    }
-
-    sort(vecZnodeScores.rbegin(), vecZnodeScores.rend(), CompareScoreMN());
-
-    int nRank = 0;
-    BOOST_FOREACH (PAIRTYPE(int64_t, CZnode*)& scorePair, vecZnodeScores) {
         nRank++;
-        if(scorePair.second->vin.prevout == vin.prevout) return nRank;
+        if(mn.vin.prevout == vin.prevout) return nRank;
     }
 
     return -1;
@@ -834,7 +902,6 @@ int CZnodeMan::GetZnodeRank(const CTxIn& vin, int nBlockHeight, int nMinProtocol
 
 std::vector<std::pair<int, CZnode> > CZnodeMan::GetZnodeRanks(int nBlockHeight, int nMinProtocol)
 {
-    std::vector<std::pair<int64_t, CZnode*> > vecZnodeScores;
     std::vector<std::pair<int, CZnode> > vecZnodeRanks;
 
     //make sure we know about this block
@@ -843,22 +910,12 @@ std::vector<std::pair<int, CZnode> > CZnodeMan::GetZnodeRanks(int nBlockHeight,
 
     LOCK(cs);
 
-    // scan for winner
-    BOOST_FOREACH(CZnode& mn, vZnodes) {
-
-        if(mn.nProtocolVersion < nMinProtocol || !mn.IsEnabled()) continue;
-
-        int64_t nScore = mn.CalculateScore(blockHash).GetCompact(false);
-
-        vecZnodeScores.push_back(std::make_pair(nScore, &mn));
-    }
-
-    sort(vecZnodeScores.rbegin(), vecZnodeScores.rend(), CompareScoreMN());
-
     int nRank = 0;
-    BOOST_FOREACH (PAIRTYPE(int64_t, CZnode*)& s, vecZnodeScores) {
+    BOOST_FOREACH(size_t nPos, GetZnodesByScore(blockHash)) {
+        CZnode& mn = vZnodes[nPos];
+        if(mn.nProtocolVersion < nMinProtocol || !mn.IsEnabled()) continue;
         nRank++;
-        vecZnodeRanks.push_back(std::make_pair(nRank, *s.second));
+        vecZnodeRanks.push_back(std::make_pair(nRank, mn));
     }
 
     return vecZnodeRanks;
@@ -866,8 +923,6 @@ std::vector<std::pair<int, CZnode> > CZnodeMan::GetZnodeRanks(int nBlockHeight,
 
 CZnode* CZnodeMan::GetZnodeByRank(int nRank, int nBlockHeight, int nMinProtocol, bool fOnlyActive)
 {
-    std::vector<std::pair<int64_t, CZnode*> > vecZnodeScores;
-
     LOCK(cs);
 
     uint256 blockHash;
@@ -876,24 +931,14 @@ CZnode* CZnodeMan::GetZnodeByRank(int nRank, int nBlockHeight, int nMinProtocol,
         return NULL;
     }
 
-    // Fill scores
-    BOOST_FOREACH(CZnode& mn, vZnodes) {
-
+    int rank = 0;
+    BOOST_FOREACH(size_t nPos, GetZnodesByScore(blockHash)) {
+        CZnode& mn = vZnodes[nPos];
         if(mn.nProtocolVersion < nMinProtocol) continue;
         if(fOnlyActive && !mn.IsEnabled()) continue;
-
-        int64_t nScore = mn.CalculateScore(blockHash).GetCompact(false);
-
-        vecZnodeScores.push_back(std::make_pair(nScore, &mn));
-    }
-
-    sort(vecZnodeScores.rbegin(), vecZnodeScores.rend(), CompareScoreMN());
-
-    int rank = 0;
-    BOOST_FOREACH (PAIRTYPE(int64_t, CZnode*)& s, vecZnodeScores){
         rank++;
         if(rank == nRank) {
-            return s.second;
+            return &mn;
         }
     }
 
@@ -1555,6 +1600,7 @@ std::string CZnodeMan::ToString() const
             ", peers we asked for Znode list: " << (int)mWeAskedForZnodeList.size() <<
             ", entries in Znode list we asked for: " << (int)mWeAskedForZnodeListEntry.size() <<
             ", znode index size: " << indexZnodes.GetSize() <<
+            ", rank cache hits: " << nRanksCacheHits << ", misses: " << nRanksCacheMisses <<
             ", nDsqCount: " << (int)nDsqCount;
 
     return info.str();
@@ -1578,7 +1624,7 @@ void CZnodeMan::UpdateZnodeList(CZnodeBroadcast mnb)
             }
         } else {
             CZnodeBroadcast mnbOld = mapSeenZnodeBroadcast[CZnodeBroadcast(*pmn).GetHash()].second;
-            if (pmn->UpdateFromNewBroadcast(mnb)) {
+            if (UpdateZnodeFromBroadcast(pmn, mnb)) {
                 znodeSync.AddedZnodeList();
                 mapSeenZnodeBroadcast.erase(mnbOld.GetHash());
             }
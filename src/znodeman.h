@@ -6,7 +6,11 @@
 #define ZNODEMAN_H
 
 #include "znode.h"
+#include "saltedhasher.h"
 #include "sync.h"
+#include "unordered_lru_cache.h"
+
+#include <unordered_map>
 
 using namespace std;
 
@@ -110,6 +114,9 @@ private:
     static const int MNB_RECOVERY_WAIT_SECONDS      = 60;
     static const int MNB_RECOVERY_RETRY_SECONDS     = 3 * 60 * 60;
 
+    /// Number of block hashes to keep the score order of the znodes for
+    static const int RANKS_CACHE_SIZE           = 16;
+
 
     // critical section to protect the inner data structures
     mutable CCriticalSection cs;
@@ -119,6 +126,16 @@ private:
 
     // map to hold all MNs
     std::vector<CZnode> vZnodes;
+    // positions in vZnodes by collateral outpoint and by the key ids of pubKeyZnode and pubKeyCollateralAddress (the payee).
+    // If znodes share a key the first one in vZnodes is kept, same as a linear search would find.
+    std::unordered_map<COutPoint, size_t, SaltedOutpointHasher> mapZnodesByOutpoint;
+    std::unordered_map<uint160, size_t, StaticSaltedHasher> mapZnodesByPubKey;
+    std::unordered_map<uint160, size_t, StaticSaltedHasher> mapZnodesByPayee;
+    // positions in vZnodes ordered by score for a block hash, best first. Scores only depend on the collateral
+    // outpoints, filters like the protocol version or the state are applied when walking the order.
+    unordered_lru_cache<uint256, std::vector<size_t>, StaticSaltedHasher> rankedZnodesCache;
+    uint64_t nRanksCacheHits;
+    uint64_t nRanksCacheMisses;
     // who's asked for the Znode list and the last time
     std::map<CNetAddr, int64_t> mAskedUsForZnodeList;
     // who we asked for the Znode list and the last time
@@ -156,6 +173,13 @@ private:
 
     friend class CZnodeSync;
 
+    /// Add vZnodes[nPos] to the lookup maps
+    void AddToLookupMaps(size_t nPos);
+    /// Rebuild the lookup maps after znodes were removed or a key changed
+    void RebuildLookupMaps();
+    /// Positions of all znodes in vZnodes ordered by their score for blockHash, best first
+    std::vector<size_t> GetZnodesByScore(const uint256& blockHash);
+
 public:
     // Keep track of all broadcasts I've seen
     std::map<uint256, std::pair<int64_t, CZnodeBroadcast> > mapSeenZnodeBroadcast;
@@ -196,6 +220,9 @@ public:
         if(ser_action.ForRead() && (strVersion != SERIALIZATION_VERSION_STRING)) {
             Clear();
         }
+        if(ser_action.ForRead()) {
+            RebuildLookupMaps();
+        }
     }
 
     CZnodeMan();
@@ -322,6 +349,9 @@ public:
 
     std::string ToString() const;
 
+    /// Update a znode from a newer broadcast, keeping the lookup maps in sync
+    bool UpdateZnodeFromBroadcast(CZnode* pmn, CZnodeBroadcast& mnb);
+
     /// Update znode list and maps using provided CZnodeBroadcast
     void UpdateZnodeList(CZnodeBroadcast mnb);
     /// Perform complete check and only then update list and maps